@@ -141,6 +141,7 @@ private:
 			void*			ReadRawFromPort(int32* code,
 								bigtime_t tout = B_INFINITE_TIMEOUT);
 			BMessage*		ReadMessageFromPort(bigtime_t tout = B_INFINITE_TIMEOUT);
+			void			_DequeuePendingMessages();
 	virtual	BMessage*		ConvertToMessage(void* raw, int32 code);
 	virtual	void			task_looper();
 			void			_QuitRequested(BMessage* msg);
@@ -168,7 +169,8 @@ private:
 			BList*			fCommonFilters;
 			bool			fTerminating;
 			bool			fRunCalled;
-			uint32			_reserved[11];
+			uint8*			fPendingMessageBuffers;
+			uint32			_reserved[10];
 };
 
 #endif	// _LOOPER_H
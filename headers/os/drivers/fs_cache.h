@@ -74,6 +74,8 @@ extern void *block_cache_get_empty(void *cache, off_t blockNumber,
 extern const void *block_cache_get_etc(void *cache, off_t blockNumber,
 					off_t base, off_t length);
 extern const void *block_cache_get(void *cache, off_t blockNumber);
+extern status_t block_cache_prefetch(void *cache, off_t blockNumber,
+					size_t *_numBlocks);
 extern status_t block_cache_set_dirty(void *cache, off_t blockNumber,
 					bool isDirty, int32 transaction);
 extern void block_cache_put(void *cache, off_t blockNumber);
@@ -104,6 +106,8 @@ extern status_t file_map_translate(void *map, off_t offset, size_t size,
 /* entry cache */
 extern status_t entry_cache_add(dev_t mountID, ino_t dirID, const char* name,
 					ino_t nodeID);
+extern status_t entry_cache_add_missing(dev_t mountID, ino_t dirID,
+					const char* name);
 extern status_t entry_cache_remove(dev_t mountID, ino_t dirID,
 					const char* name);
 
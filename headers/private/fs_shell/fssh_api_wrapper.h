@@ -56,6 +56,13 @@
 #define atomic_or			fssh_atomic_or
 #define atomic_get			fssh_atomic_get
 
+#define atomic_set64			fssh_atomic_set64
+#define atomic_test_and_set64	fssh_atomic_test_and_set64
+#define atomic_add64			fssh_atomic_add64
+#define atomic_and64			fssh_atomic_and64
+#define atomic_or64				fssh_atomic_or64
+#define atomic_get64			fssh_atomic_get64
+
 
 ////////////////////////////////////////////////////////////////////////////////
 // #pragma mark - fssh_bytes_order.h
@@ -836,6 +843,7 @@
 #define block_cache_get_empty			fssh_block_cache_get_empty
 #define block_cache_get_etc				fssh_block_cache_get_etc
 #define block_cache_get					fssh_block_cache_get
+#define block_cache_prefetch			fssh_block_cache_prefetch
 #define block_cache_set_dirty			fssh_block_cache_set_dirty
 #define block_cache_put					fssh_block_cache_put
 
@@ -859,6 +867,7 @@
 
 /* entry cache */
 #define entry_cache_add					fssh_entry_cache_add
+#define entry_cache_add_missing			fssh_entry_cache_add_missing
 #define entry_cache_remove				fssh_entry_cache_remove
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -1687,6 +1696,7 @@
 #define uint64	uint64_t
 
 #define vint32	vint32_t
+#define vint64	vint64_t
 
 
 #endif	// _FSSH_API_WRAPPER_H
@@ -132,6 +132,7 @@
 #define IA32_FEATURE_EPB	(1 << 3) //IA32_ENERGY_PERF_BIAS
 
 // cr4 flags
+#define IA32_CR4_PSE					(1UL << 4)
 #define IA32_CR4_PAE					(1UL << 5)
 #define IA32_CR4_GLOBAL_PAGES			(1UL << 7)
 
@@ -16,6 +16,8 @@
 
 #define CACHE_CLEAR			1	// takes no parameters
 #define CACHE_SET_MODULE	2	// gets the module name as parameter
+#define CACHE_SET_READ_AHEAD_LIMIT	3
+	// gets the maximum read-ahead window size in bytes (size_t)
 
 #define CACHE_MODULES_NAME	"file_cache"
 
@@ -23,6 +25,11 @@
 #define FILE_CACHE_LOADED_COMPLETELY 	0x02
 #define FILE_CACHE_NO_IO				0x04
 
+// prefetch priority classes, in descending order
+#define CACHE_PREFETCH_LAUNCH			0
+#define CACHE_PREFETCH_READAHEAD		1
+#define CACHE_PREFETCH_PRIORITIES		2
+
 struct cache_module_info {
 	module_info	info;
 
@@ -44,6 +51,8 @@ extern void cache_node_closed(struct vnode *vnode, int32 fdType, VMCache *cache,
 extern void cache_node_launched(size_t argCount, char * const *args);
 extern void cache_prefetch_vnode(struct vnode *vnode, off_t offset, size_t size);
 extern void cache_prefetch(dev_t mountID, ino_t vnodeID, off_t offset, size_t size);
+extern void cache_prefetch_etc(dev_t mountID, ino_t vnodeID, off_t offset,
+				size_t size, uint32 priority);
 
 extern status_t file_map_init(void);
 extern status_t file_cache_init_post_boot_device(void);
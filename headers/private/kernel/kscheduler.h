@@ -13,6 +13,8 @@
 #include <thread_types.h>
 
 
+struct scheduler_cpu_stats;
+struct scheduler_thread_stats;
 struct scheduling_analysis;
 struct SchedulerListener;
 
@@ -94,10 +96,15 @@ void scheduler_remove_listener(struct SchedulerListener* listener);
 
 void scheduler_init(void);
 void scheduler_enable_scheduling(void);
+void scheduler_stats_init(void);
 
 bigtime_t _user_estimate_max_scheduling_latency(thread_id thread);
 status_t _user_analyze_scheduling(bigtime_t from, bigtime_t until, void* buffer,
 	size_t size, struct scheduling_analysis* analysis);
+status_t _user_get_scheduler_cpu_stats(int32 cpu,
+	struct scheduler_cpu_stats* stats, size_t size);
+status_t _user_get_scheduler_thread_stats(thread_id thread,
+	struct scheduler_thread_stats* stats, size_t size);
 
 #ifdef __cplusplus
 }
@@ -8,6 +8,7 @@
 
 #include <thread.h>
 #include <iovec.h>
+#include <port_defs.h>
 
 struct kernel_args;
 struct select_info;
@@ -65,6 +66,12 @@ status_t	_user_write_port_etc(port_id port, int32 msgCode,
 status_t	_user_writev_port_etc(port_id id, int32 msgCode,
 				const iovec *msgVecs, size_t vecCount,
 				size_t bufferSize, uint32 flags, bigtime_t timeout);
+ssize_t		_user_write_port_messages_etc(port_id port,
+				const port_message_data *messages, int32 count,
+				uint32 flags, bigtime_t timeout);
+ssize_t		_user_read_port_messages_etc(port_id port,
+				port_message_data *messages, int32 count, uint32 flags,
+				bigtime_t timeout);
 status_t	_user_get_port_message_info_etc(port_id port,
 				port_message_info *info, size_t infoSize, uint32 flags,
 				bigtime_t timeout);
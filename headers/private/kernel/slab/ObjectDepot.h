@@ -12,6 +12,7 @@
 
 
 struct DepotMagazine;
+struct object_cache_stats;
 
 typedef struct object_depot {
 	rw_lock					outer_lock;
@@ -25,10 +26,28 @@ typedef struct object_depot {
 	struct depot_cpu_store*	stores;
 	void*					cookie;
 
+	// statistics, protected by inner_lock
+	uint64					refills;
+	uint64					exchanges;
+	uint64					contention;
+	uint32					resizes;
+
+	// contention since the last check, used to grow the magazines
+	uint32					recent_exchanges;
+	uint32					recent_contention;
+	vint32					resize_state;
+
 	void (*return_object)(struct object_depot* depot, void* cookie,
 		void* object, uint32 flags);
 } object_depot;
 
+enum {
+	/* object_depot::resize_state */
+	DEPOT_RESIZE_NONE = 0,
+	DEPOT_RESIZE_NEEDED,		// the magazines should be grown
+	DEPOT_RESIZE_SCHEDULED		// the owner is going to grow them
+};
+
 
 #ifdef __cplusplus
 extern "C" {
@@ -45,6 +64,12 @@ void object_depot_store(object_depot* depot, void* object, uint32 flags);
 
 void object_depot_make_empty(object_depot* depot, uint32 flags);
 
+status_t object_depot_set_magazine_capacity(object_depot* depot,
+	size_t capacity, uint32 flags);
+void object_depot_grow_magazines(object_depot* depot, uint32 flags);
+void object_depot_get_stats(object_depot* depot,
+	struct object_cache_stats* stats);
+
 #if PARANOID_KERNEL_FREE
 bool object_depot_contains_object(object_depot* depot, void* object);
 #endif
@@ -32,6 +32,7 @@ enum {
 
 struct ObjectCache;
 typedef struct ObjectCache object_cache;
+struct object_cache_stats;
 
 typedef status_t (*object_cache_constructor)(void* cookie, void* object);
 typedef void (*object_cache_destructor)(void* cookie, void* object);
@@ -55,6 +56,8 @@ void delete_object_cache(object_cache* cache);
 
 status_t object_cache_set_minimum_reserve(object_cache* cache,
 	size_t objectCount);
+status_t object_cache_set_magazine_capacity(object_cache* cache,
+	size_t capacity);
 
 void* object_cache_alloc(object_cache* cache, uint32 flags);
 void object_cache_free(object_cache* cache, void* object, uint32 flags);
@@ -64,6 +67,9 @@ status_t object_cache_reserve(object_cache* cache, size_t object_count,
 
 void object_cache_get_usage(object_cache* cache, size_t* _allocatedMemory);
 
+status_t _user_get_object_cache_stats(struct object_cache_stats* stats,
+	size_t size, int32* _count);
+
 #ifdef __cplusplus
 }
 #endif
@@ -66,6 +66,10 @@ bool team_dissociate_data(AssociatedData* data);
 thread_id _user_load_image(const char* const* flatArgs, size_t flatArgsSize,
 			int32 argCount, int32 envCount, int32 priority, uint32 flags,
 			port_id errorPort, uint32 errorToken);
+thread_id _user_load_image_etc(const char* path, const char* const* flatArgs,
+			size_t flatArgsSize, int32 argCount, int32 envCount,
+			int32 priority, uint32 flags, port_id errorPort,
+			uint32 errorToken);
 status_t _user_wait_for_team(team_id id, status_t *_returnCode);
 void _user_exit_team(status_t returnValue);
 status_t _user_kill_team(thread_id thread);
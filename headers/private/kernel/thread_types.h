@@ -17,6 +17,7 @@
 #include <heap.h>
 #include <ksignal.h>
 #include <lock.h>
+#include <scheduler_defs.h>
 #include <smp.h>
 #include <thread_defs.h>
 #include <timer.h>
@@ -445,6 +446,8 @@ struct Thread : TeamThreadIteratorEntry<thread_id>, KernelReferenceable {
 									// this thread
 	bool			was_yielded;	// protected by scheduler lock
 	struct scheduler_thread_data* scheduler_data; // protected by scheduler lock
+	bigtime_t		ready_time;		// protected by scheduler lock
+	scheduler_thread_stats scheduler_stats;	// protected by scheduler lock
 
 	struct user_thread*	user_thread;	// write-protected by fLock, only
 										// modified by the thread itself and
@@ -21,6 +21,12 @@ status_t	_user_mutex_unlock(int32* mutex, uint32 flags);
 status_t	_user_mutex_switch_lock(int32* fromMutex, int32* toMutex,
 				const char* name, uint32 flags, bigtime_t timeout);
 
+status_t	_user_address_wait(int32* address, int32 value, uint32 bitset,
+				uint32 flags, bigtime_t timeout);
+int32		_user_address_wake(int32* address, int32 count, uint32 bitset);
+int32		_user_address_requeue(int32* address, int32 value,
+				int32 wakeCount, int32* mutex, int32 requeueCount);
+
 #ifdef __cplusplus
 }
 #endif
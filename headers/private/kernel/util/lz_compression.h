@@ -0,0 +1,33 @@
+/*
+ * Copyright 2013, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef _KERNEL_UTIL_LZ_COMPRESSION_H
+#define _KERNEL_UTIL_LZ_COMPRESSION_H
+
+
+#include <SupportDefs.h>
+
+
+// size of the scratch memory lz_compress() needs
+#define LZ_COMPRESS_WORKSPACE_SIZE	(4096 * sizeof(uint16))
+
+// maximum size of the data lz_compress() can handle at once
+#define LZ_MAX_INPUT_SIZE			65535
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+size_t lz_compress(const void* input, size_t inputSize, void* output,
+			size_t outputSize, void* workspace);
+ssize_t lz_decompress(const void* input, size_t inputSize, void* output,
+			size_t outputSize);
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif	/* _KERNEL_UTIL_LZ_COMPRESSION_H */
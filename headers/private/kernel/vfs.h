@@ -25,7 +25,7 @@
 
 
 #define DEFAULT_FD_TABLE_SIZE	256
-#define MAX_FD_TABLE_SIZE		8192
+#define MAX_FD_TABLE_SIZE		65536
 #define DEFAULT_NODE_MONITORS	4096
 #define MAX_NODE_MONITORS		65536
 
@@ -128,6 +128,7 @@ public:
 			status_t			SetMinimalCommitment(off_t commitment,
 									int priority);
 	virtual	status_t			Resize(off_t newSize, int priority);
+	virtual	status_t			Discard(off_t offset, off_t size);
 
 			status_t			FlushAndRemoveAllPages();
 
@@ -209,6 +210,10 @@ private:
 			void				_MergeWithOnlyConsumer();
 			void				_RemoveConsumer(VMCache* consumer);
 
+			bool				_FreePageRange(
+									VMCachePagesTree::Iterator it,
+									page_num_t* toPage = NULL);
+
 private:
 			int32				fRefCount;
 			mutex				fLock;
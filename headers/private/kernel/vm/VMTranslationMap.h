@@ -29,6 +29,7 @@ struct VMTranslationMap {
 	virtual	addr_t				MappedSize() const = 0;
 	virtual	size_t				MaxPagesNeededToMap(addr_t start,
 									addr_t end) const = 0;
+	virtual	size_t				LargePageSize() const;
 
 	virtual	status_t			Map(addr_t virtualAddress,
 									phys_addr_t physicalAddress,
@@ -72,6 +73,9 @@ struct VMTranslationMap {
 
 	virtual	void				Flush() = 0;
 
+	virtual	bool				BeginInvalidationBatch();
+	virtual	void				EndInvalidationBatch();
+
 protected:
 			void				PageUnmapped(VMArea* area,
 									page_num_t pageNumber, bool accessed,
@@ -54,6 +54,8 @@ void vm_page_schedule_write_page_range(struct VMCache *cache,
 	uint32 firstPage, uint32 endPage);
 
 void vm_page_unreserve_pages(vm_page_reservation* reservation);
+void vm_page_unreserve_pages_etc(vm_page_reservation* reservation,
+	uint32 count);
 void vm_page_reserve_pages(vm_page_reservation* reservation, uint32 count,
 	int priority);
 bool vm_page_try_reserve_pages(vm_page_reservation* reservation, uint32 count,
@@ -26,6 +26,12 @@ typedef struct select_sync {
 	sem_id				sem;
 	uint32				count;
 	struct select_info*	set;
+
+	// Optional hooks (used by event queues): if set, notify() is called
+	// instead of releasing the semaphore, and destroy() instead of deleting
+	// the sync object once its last reference is gone.
+	void				(*notify)(struct select_info* info);
+	void				(*destroy)(struct select_sync* sync);
 } select_sync;
 
 #define SELECT_FLAG(type) (1L << (type - 1))
@@ -40,6 +46,11 @@ extern void		put_select_sync(select_sync* sync);
 extern status_t	notify_select_events(select_info* info, uint16 events);
 extern void		notify_select_events_list(select_info* list, uint16 events);
 
+extern status_t	select_object(uint16 type, int32 object, select_info* info,
+					bool kernel);
+extern status_t	deselect_object(uint16 type, int32 object, select_info* info,
+					bool kernel);
+
 extern ssize_t	_user_wait_for_objects(object_wait_info* userInfos,
 					int numInfos, uint32 flags, bigtime_t timeout);
 
@@ -0,0 +1,35 @@
+/*
+ * Copyright 2013, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef _LIBROOT_EVENT_QUEUE_PRIVATE_H
+#define _LIBROOT_EVENT_QUEUE_PRIVATE_H
+
+
+#include <event_queue_defs.h>
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Creates a new event queue, and returns its file descriptor. The only
+   supported flag is O_CLOEXEC. */
+int		event_queue_create(int openFlags);
+
+/* Adds the objects to the queue, changes the events selected for them, or
+   removes them from the queue if their events are 0. */
+status_t	event_queue_select(int queue, event_wait_info* infos,
+			int numInfos);
+
+/* Waits until one or more of the queue's objects are ready, and returns
+   their number. Only ready objects are reported. */
+ssize_t	event_queue_wait(int queue, event_wait_info* infos, int numInfos,
+			uint32 flags, bigtime_t timeout);
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif	/* _LIBROOT_EVENT_QUEUE_PRIVATE_H */
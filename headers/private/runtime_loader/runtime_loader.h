@@ -121,6 +121,15 @@ typedef struct image_t {
 	elf_version_info	*versions;
 	uint32				num_versions;
 
+	// GNU hash table (DT_GNU_HASH), used instead of symhash, if available
+	uint32				gnu_hash_bucket_count;
+	uint32				gnu_hash_symbol_index;	// first hashed symbol
+	uint32				gnu_hash_bloom_size;	// in words, a power of 2
+	uint32				gnu_hash_bloom_shift;
+	uint32				*gnu_hash_bloom;
+	uint32				*gnu_hash_buckets;
+	uint32				*gnu_hash_chains;
+
 #ifdef __cplusplus
 	struct Elf32_Sym*	(*find_undefined_symbol)(struct image_t* rootImage,
 							struct image_t* image,
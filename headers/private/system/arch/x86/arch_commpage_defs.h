@@ -16,6 +16,11 @@
 									(COMMPAGE_ENTRY_FIRST_ARCH_SPECIFIC + 3)
 #define COMMPAGE_ENTRY_X86_SIGNAL_HANDLER_BEOS \
 									(COMMPAGE_ENTRY_FIRST_ARCH_SPECIFIC + 4)
+#define COMMPAGE_ENTRY_X86_STRLEN	(COMMPAGE_ENTRY_FIRST_ARCH_SPECIFIC + 5)
+#define COMMPAGE_ENTRY_X86_MEMCHR	(COMMPAGE_ENTRY_FIRST_ARCH_SPECIFIC + 6)
+#define COMMPAGE_ENTRY_X86_MEMCMP	(COMMPAGE_ENTRY_FIRST_ARCH_SPECIFIC + 7)
+#define COMMPAGE_ENTRY_X86_STRCHR	(COMMPAGE_ENTRY_FIRST_ARCH_SPECIFIC + 8)
+#define COMMPAGE_ENTRY_X86_STRCMP	(COMMPAGE_ENTRY_FIRST_ARCH_SPECIFIC + 9)
 
 #define ARCH_USER_COMMPAGE_ADDR (0xffff0000)
 
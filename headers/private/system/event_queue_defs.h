@@ -0,0 +1,28 @@
+/*
+ * Copyright 2013, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef _SYSTEM_EVENT_QUEUE_DEFS_H
+#define _SYSTEM_EVENT_QUEUE_DEFS_H
+
+
+#include <OS.h>
+
+
+/* Additional event_wait_info::events flags for event_queue_select(). Unlike
+   the B_EVENT_* flags, they are never reported back. */
+#define B_EVENT_LEVEL_TRIGGERED	0x4000	/* report as long as the object is
+										   ready, not only on changes */
+#define B_EVENT_ONE_SHOT		0x2000	/* remove the object once it has been
+										   reported */
+
+
+typedef struct event_wait_info {
+	int32		object;
+	uint16		type;
+	uint16		events;		/* events to select, or events that occurred */
+	void*		user_data;	/* passed back by event_queue_wait() */
+} event_wait_info;
+
+
+#endif	/* _SYSTEM_EVENT_QUEUE_DEFS_H */
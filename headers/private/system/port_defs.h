@@ -0,0 +1,46 @@
+/*
+ * Copyright 2013, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef _SYSTEM_PORT_DEFS_H
+#define _SYSTEM_PORT_DEFS_H
+
+
+#include <OS.h>
+
+
+/* maximum number of messages transferred by a single batched port call */
+#define PORT_MAX_MESSAGE_BATCH	64
+
+
+typedef struct port_message_data {
+	int32		code;
+	void*		buffer;
+	size_t		size;		/* size of the buffer, respectively of the
+							   message that has been read into it */
+} port_message_data;
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Writes up to count messages to the port. Only the first message may block;
+   returns the number of messages written. */
+ssize_t	write_port_messages_etc(port_id port,
+			const port_message_data* messages, int32 count, uint32 flags,
+			bigtime_t timeout);
+
+/* Reads up to count messages from the port. Only waiting for the first
+   message may block; a message is only read if it fits into its buffer.
+   Returns the number of messages read, or B_BUFFER_OVERFLOW if the first
+   message didn't fit. */
+ssize_t	read_port_messages_etc(port_id port, port_message_data* messages,
+			int32 count, uint32 flags, bigtime_t timeout);
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif	/* _SYSTEM_PORT_DEFS_H */
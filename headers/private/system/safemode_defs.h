@@ -16,6 +16,7 @@
 #define B_SAFEMODE_DISABLE_HYPER_THREADING	"disable_hyperthreading"
 #define B_SAFEMODE_FAIL_SAFE_VIDEO_MODE		"fail_safe_video_mode"
 #define B_SAFEMODE_4_GB_MEMORY_LIMIT		"4gb_memory_limit"
+#define B_SAFEMODE_SCHEDULER				"scheduler"
 
 #if DEBUG_SPINLOCK_LATENCIES
 #	define B_SAFEMODE_DISABLE_LATENCY_CHECK	"disable_latency_check"
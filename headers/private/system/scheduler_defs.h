@@ -62,4 +62,33 @@ struct scheduling_analysis {
 };
 
 
+// wakeup-to-run latency histograms: bucket 0 counts latencies below 1 us,
+// bucket i latencies in [2^(i-1), 2^i) us, the last one everything above
+#define SCHEDULER_LATENCY_BUCKETS	20
+
+
+struct scheduler_cpu_stats {
+	int32		cpu;
+	uint64		context_switches;
+	uint64		migrations;			// threads that last ran on another CPU
+	uint64		wakeups;
+	bigtime_t	total_latency;
+	bigtime_t	max_latency;
+	uint64		run_queue_samples;
+	uint64		total_run_queue_length;
+	uint32		max_run_queue_length;
+	uint64		latency_histogram[SCHEDULER_LATENCY_BUCKETS];
+};
+
+
+struct scheduler_thread_stats {
+	thread_id	thread;
+	uint64		migrations;
+	uint64		wakeups;
+	bigtime_t	total_latency;
+	bigtime_t	max_latency;
+	uint32		latency_histogram[SCHEDULER_LATENCY_BUCKETS];
+};
+
+
 #endif	/* _SYSTEM_SCHEDULER_DEFS_H */
@@ -0,0 +1,38 @@
+/*
+ * Copyright 2013, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef _SYSTEM_SLAB_DEFS_H
+#define _SYSTEM_SLAB_DEFS_H
+
+#include <OS.h>
+
+
+struct object_cache_stats {
+	char		name[32];
+	size_t		object_size;
+	size_t		usage;				// bytes allocated for slabs
+	size_t		used_objects;
+	size_t		total_objects;
+	uint32		flags;
+
+	// object depot
+	size_t		magazine_capacity;
+	size_t		full_magazines;
+	size_t		empty_magazines;
+	uint64		magazine_hits;		// allocations served by a CPU magazine
+	uint64		magazine_misses;	// allocations that had to use the slabs
+	uint64		magazine_frees;		// frees stored in a CPU magazine
+	uint64		depot_refills;		// full magazines taken from the depot
+	uint64		depot_exchanges;	// empty magazines taken from the depot
+	uint64		depot_contention;	// contended depot lock acquisitions
+	uint32		magazine_resizes;
+
+	// slabs
+	uint64		slab_allocations;	// objects allocated from the slabs
+	uint64		slabs_created;
+	uint64		lock_contention;	// contended cache lock acquisitions
+};
+
+
+#endif	/* _SYSTEM_SLAB_DEFS_H */
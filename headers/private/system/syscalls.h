@@ -22,14 +22,19 @@ extern "C" {
 struct attr_info;
 struct dirent;
 struct Elf32_Sym;
+struct event_wait_info;
 struct fd_info;
 struct fd_set;
 struct fs_info;
 struct iovec;
 struct msqid_ds;
 struct net_stat;
+struct object_cache_stats;
 struct pollfd;
+struct port_message_data;
 struct rlimit;
+struct scheduler_cpu_stats;
+struct scheduler_thread_stats;
 struct scheduling_analysis;
 struct _sem_t;
 struct sembuf;
@@ -73,6 +78,14 @@ extern status_t		_kern_get_safemode_option(const char *parameter,
 extern ssize_t		_kern_wait_for_objects(object_wait_info* infos, int numInfos,
 						uint32 flags, bigtime_t timeout);
 
+/* event queue functions */
+extern int			_kern_event_queue_create(int openFlags);
+extern status_t		_kern_event_queue_select(int queue,
+						struct event_wait_info* infos, int numInfos);
+extern ssize_t		_kern_event_queue_wait(int queue,
+						struct event_wait_info* infos, int numInfos,
+						uint32 flags, bigtime_t timeout);
+
 /* user mutex functions */
 extern status_t		_kern_mutex_lock(int32* mutex, const char* name,
 						uint32 flags, bigtime_t timeout);
@@ -80,6 +93,14 @@ extern status_t		_kern_mutex_unlock(int32* mutex, uint32 flags);
 extern status_t		_kern_mutex_switch_lock(int32* fromMutex, int32* toMutex,
 						const char* name, uint32 flags, bigtime_t timeout);
 
+/* address wait functions */
+extern status_t		_kern_address_wait(int32* address, int32 value,
+						uint32 bitset, uint32 flags, bigtime_t timeout);
+extern int32		_kern_address_wake(int32* address, int32 count,
+						uint32 bitset);
+extern int32		_kern_address_requeue(int32* address, int32 value,
+						int32 wakeCount, int32* mutex, int32 requeueCount);
+
 /* sem functions */
 extern sem_id		_kern_create_sem(int count, const char *name);
 extern status_t		_kern_delete_sem(sem_id id);
@@ -132,6 +153,10 @@ extern thread_id	_kern_load_image(const char* const* flatArgs,
 						size_t flatArgsSize, int32 argCount, int32 envCount,
 						int32 priority, uint32 flags, port_id errorPort,
 						uint32 errorToken);
+extern thread_id	_kern_load_image_etc(const char* path,
+						const char* const* flatArgs, size_t flatArgsSize,
+						int32 argCount, int32 envCount, int32 priority,
+						uint32 flags, port_id errorPort, uint32 errorToken);
 extern void __NO_RETURN _kern_exit_team(status_t returnValue);
 extern status_t		_kern_kill_team(team_id team);
 extern team_id		_kern_get_current_team();
@@ -460,6 +485,12 @@ extern status_t		_kern_write_port_etc(port_id port, int32 msgCode,
 extern status_t		_kern_writev_port_etc(port_id id, int32 msgCode,
 						const struct iovec *msgVecs, size_t vecCount,
 						size_t bufferSize, uint32 flags, bigtime_t timeout);
+extern ssize_t		_kern_write_port_messages_etc(port_id port,
+						const struct port_message_data *messages, int32 count,
+						uint32 flags, bigtime_t timeout);
+extern ssize_t		_kern_read_port_messages_etc(port_id port,
+						struct port_message_data *messages, int32 count,
+						uint32 flags, bigtime_t timeout);
 extern status_t		_kern_get_port_message_info_etc(port_id port,
 						port_message_info *info, size_t infoSize, uint32 flags,
 						bigtime_t timeout);
@@ -517,6 +548,13 @@ extern status_t		_kern_get_system_info_etc(int32 id, void *buffer,
 extern status_t		_kern_analyze_scheduling(bigtime_t from, bigtime_t until,
 						void* buffer, size_t size,
 						struct scheduling_analysis* analysis);
+extern status_t		_kern_get_scheduler_cpu_stats(int32 cpu,
+						struct scheduler_cpu_stats* stats, size_t size);
+extern status_t		_kern_get_scheduler_thread_stats(thread_id thread,
+						struct scheduler_thread_stats* stats, size_t size);
+extern status_t		_kern_get_object_cache_stats(
+						struct object_cache_stats* stats, size_t size,
+						int32* _count);
 
 /* Debug output */
 extern void			_kern_debug_output(const char *message);
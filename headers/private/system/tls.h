@@ -18,7 +18,10 @@ enum {
 	TLS_THREAD_ID_SLOT,
 	TLS_ERRNO_SLOT,
 	TLS_ON_EXIT_THREAD_SLOT,
+	TLS_MALLOC_SLOT,
+		// the thread's malloc() cache
 	TLS_USER_THREAD_SLOT,
+		// must be the last slot that is initialized by the kernel
 
 	// Note: these entries can safely be changed between
 	// releases; 3rd party code always calls tls_allocate()
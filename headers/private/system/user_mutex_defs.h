@@ -18,4 +18,14 @@
 #define B_USER_MUTEX_DISABLED	0x04
 
 
+// bitset passed to _kern_address_wait()/_kern_address_wake() to match any
+// waiter
+#define B_ADDRESS_WAIT_ALL_BITS	0xffffffff
+
+// returned by _kern_address_wait() when the waiter has been moved over to a
+// user mutex by _kern_address_requeue(), and that mutex has been handed over
+// to it; the caller owns the mutex then
+#define B_ADDRESS_WAIT_MUTEX_LOCKED	1
+
+
 #endif	/* _SYSTEM_USER_MUTEX_DEFS_H */
@@ -41,10 +41,16 @@
 #define B_KERNEL_AREA			0x4000
 	// Usable from userland according to its protection flags, but the area
 	// itself is not deletable, resizable, etc from userland.
+#define B_LARGE_PAGES_AREA		0x8000
+	// The memory of a fully locked anonymous area is allocated in physically
+	// contiguous, aligned chunks, so that it can be mapped with large pages,
+	// if the architecture supports them.
 
-#define B_USER_AREA_FLAGS		(B_USER_PROTECTION | B_OVERCOMMITTING_AREA)
+#define B_USER_AREA_FLAGS \
+	(B_USER_PROTECTION | B_OVERCOMMITTING_AREA | B_LARGE_PAGES_AREA)
 #define B_KERNEL_AREA_FLAGS \
-	(B_KERNEL_PROTECTION | B_USER_CLONEABLE_AREA | B_SHARED_AREA)
+	(B_KERNEL_PROTECTION | B_USER_CLONEABLE_AREA | B_SHARED_AREA \
+		| B_LARGE_PAGES_AREA)
 
 // mapping argument for several internal VM functions
 enum {
@@ -60,5 +66,10 @@ enum {
 
 #define MEMORY_TYPE_SHIFT		28
 
+// private addition to the posix_madvise() advice values: the contents of the
+// range are no longer needed, and its pages may be freed; the range remains
+// mapped, but its contents are undefined afterwards
+#define MADV_FREE				0x100
+
 
 #endif	/* _SYSTEM_VM_DEFS_H */
@@ -16,6 +16,12 @@
 #include "Utility.h"
 
 
+static const size_t kMaxPrefetchBlocks = 16;
+	// maximum number of blocks that are prefetched ahead of a traversal
+static const uint32 kMaxBuildLevels = 16;
+	// maximum height of a tree built by the TreeBuilder
+
+
 /*!	Simple array used for the duplicate handling in the B+Tree. This is an
 	on disk structure.
 */
@@ -214,6 +220,48 @@ private:
 };
 
 
+/*!	Builds a tree bottom-up from keys that are added in sorted order. The
+	leaves are filled completely one after the other, and every finished node
+	is added to its parent level. The last child of each level is held back,
+	as it will become the overflow link of its parent once that one is full,
+	or the tree is complete.
+	The tree must be empty; its root node is reused as the first leaf.
+*/
+class TreeBuilder {
+public:
+								TreeBuilder(BPlusTree* tree,
+									Transaction& transaction);
+
+			status_t			InitCheck() const;
+
+			status_t			Add(const uint8* key, uint16 keyLength,
+									off_t value);
+			status_t			Finish();
+
+private:
+			struct build_level {
+				off_t			offset;
+				off_t			childOffset;
+				uint16			childKeyLength;
+				uint8			childKey[BPLUSTREE_MAX_KEY_LENGTH];
+			};
+
+			bool				_Fits(const bplustree_node* node,
+									uint16 keyLength) const;
+			status_t			_AllocateNode(uint32 level, CachedNode& cached,
+									bplustree_node** _node);
+			status_t			_AddChild(uint32 level, const uint8* key,
+									uint16 keyLength, off_t offset);
+
+private:
+			BPlusTree*			fTree;
+			Transaction&		fTransaction;
+			CachedNode			fLeaf;
+			uint32				fLevelCount;
+			build_level			fLevels[kMaxBuildLevels];
+};
+
+
 // #pragma mark -
 
 
@@ -946,6 +994,35 @@ BPlusTree::_RemoveIterator(TreeIterator* iterator)
 }
 
 
+/*!	Asks the block cache to asynchronously read in the blocks following the
+	node at \a offset, as far as they belong to the same block_run of the
+	tree's stream. Since nodes are usually allocated in order, this reads
+	ahead of a sequential traversal of the leaf nodes.
+	The stream must be locked.
+*/
+void
+BPlusTree::_PrefetchNodes(off_t offset)
+{
+	off_t fileOffset;
+	block_run run;
+	if (offset >= fStream->Size()
+		|| fStream->FindBlockRun(offset, run, fileOffset) != B_OK)
+		return;
+
+	Volume* volume = fStream->GetVolume();
+	int32 blockOffset = (offset - fileOffset) >> volume->BlockShift();
+	if (blockOffset + 1 >= run.Length())
+		return;
+
+	size_t numBlocks = run.Length() - blockOffset - 1;
+	if (numBlocks > kMaxPrefetchBlocks)
+		numBlocks = kMaxPrefetchBlocks;
+
+	block_cache_prefetch(volume->BlockCache(),
+		volume->ToBlock(run) + blockOffset + 1, &numBlocks);
+}
+
+
 int32
 BPlusTree::_CompareKeys(const void* key1, int keyLength1, const void* key2,
 	int keyLength2)
@@ -978,6 +1055,41 @@ BPlusTree::_CompareKeys(const void* key1, int keyLength1, const void* key2,
 }
 
 
+int32
+BPlusTree::_CompareEntries(const key_and_value& a, const key_and_value& b)
+{
+	int32 compare = _CompareKeys(a.key, a.keyLength, b.key, b.keyLength);
+	if (compare != 0)
+		return compare;
+
+	if (a.value == b.value)
+		return 0;
+	return a.value < b.value ? -1 : 1;
+}
+
+
+void
+BPlusTree::_SiftDownEntry(key_and_value* entries, int32 index, int32 count)
+{
+	while (true) {
+		int32 child = 2 * index + 1;
+		if (child >= count)
+			return;
+
+		if (child + 1 < count
+			&& _CompareEntries(entries[child], entries[child + 1]) < 0)
+			child++;
+		if (_CompareEntries(entries[index], entries[child]) >= 0)
+			return;
+
+		key_and_value entry = entries[index];
+		entries[index] = entries[child];
+		entries[child] = entry;
+		index = child;
+	}
+}
+
+
 status_t
 BPlusTree::_FindKey(const bplustree_node* node, const uint8* key,
 	uint16 keyLength, uint16* _index, off_t* _next)
@@ -1758,6 +1870,96 @@ BPlusTree::Insert(Transaction& transaction, const uint8* key, uint16 keyLength,
 }
 
 
+/*!	Inserts a batch of keys into the tree, as part of the \a transaction.
+	The \a entries must be sorted by key, and by value for identical keys;
+	you can use SortEntries() for this.
+	If the tree is empty, it is built bottom-up from the entries, which
+	fills its nodes completely, and only touches each of them once.
+	Otherwise, the entries are inserted one by one.
+	You need to have the inode write locked.
+*/
+status_t
+BPlusTree::InsertSorted(Transaction& transaction,
+	const key_and_value* entries, int32 count)
+{
+	ASSERT_WRITE_LOCKED_INODE(fStream);
+
+	// check the entries before we change anything
+	for (int32 i = 0; i < count; i++) {
+		if (entries[i].keyLength < BPLUSTREE_MIN_KEY_LENGTH
+			|| entries[i].keyLength > BPLUSTREE_MAX_KEY_LENGTH)
+			RETURN_ERROR(B_BAD_VALUE);
+		if (i == 0)
+			continue;
+
+		int32 compare = _CompareKeys(entries[i - 1].key,
+			entries[i - 1].keyLength, entries[i].key, entries[i].keyLength);
+		if (compare > 0
+			|| (compare == 0 && entries[i - 1].value >= entries[i].value))
+			RETURN_ERROR(B_BAD_VALUE);
+		if (compare == 0 && !fAllowDuplicates)
+			return B_NAME_IN_USE;
+	}
+
+	if (count == 0)
+		return B_OK;
+
+	if (!IsEmpty()) {
+		for (int32 i = 0; i < count; i++) {
+			status_t status = Insert(transaction, entries[i].key,
+				entries[i].keyLength, entries[i].value);
+			if (status != B_OK)
+				return status;
+		}
+		return B_OK;
+	}
+
+	TreeBuilder* builder = new(std::nothrow) TreeBuilder(this, transaction);
+	if (builder == NULL)
+		return B_NO_MEMORY;
+
+	ObjectDeleter<TreeBuilder> builderDeleter(builder);
+
+	status_t status = builder->InitCheck();
+	for (int32 i = 0; status == B_OK && i < count; i++) {
+		status = builder->Add(entries[i].key, entries[i].keyLength,
+			entries[i].value);
+	}
+	if (status == B_OK)
+		status = builder->Finish();
+
+	RETURN_ERROR(status);
+}
+
+
+/*!	Sorts the \a entries for InsertSorted(), and removes identical
+	key/value pairs. Returns the number of remaining entries.
+*/
+int32
+BPlusTree::SortEntries(key_and_value* entries, int32 count)
+{
+	// a heap sort doesn't need any additional memory
+	for (int32 i = count / 2; i-- > 0;)
+		_SiftDownEntry(entries, i, count);
+
+	for (int32 i = count; i-- > 1;) {
+		key_and_value entry = entries[0];
+		entries[0] = entries[i];
+		entries[i] = entry;
+
+		_SiftDownEntry(entries, 0, i);
+	}
+
+	int32 last = 0;
+	for (int32 i = 1; i < count; i++) {
+		if (_CompareEntries(entries[last], entries[i]) != 0)
+			entries[++last] = entries[i];
+	}
+
+	return count > 0 ? last + 1 : 0;
+}
+
+
 /*!	Removes the duplicate index/value pair from the tree.
 	It's part of the private tree interface.
 */
@@ -2259,6 +2461,73 @@ BPlusTree::Find(const uint8* key, uint16 keyLength, off_t* _value)
 }
 
 
+/*!	Returns whether or not the tree contains the given key/value pair.
+	Unlike Find(), this also works for trees with duplicates.
+	You need to have the inode read or write locked.
+*/
+bool
+BPlusTree::Contains(const uint8* key, uint16 keyLength, off_t value)
+{
+	if (keyLength < BPLUSTREE_MIN_KEY_LENGTH
+		|| keyLength > BPLUSTREE_MAX_KEY_LENGTH
+		|| key == NULL)
+		return false;
+
+	ASSERT_READ_LOCKED_INODE(fStream);
+
+	Stack<node_and_key> stack;
+	if (_SeekDown(stack, key, keyLength) != B_OK)
+		return false;
+
+	node_and_key nodeAndKey;
+	CachedNode cached(this);
+	const bplustree_node* node;
+	if (!stack.Pop(&nodeAndKey)
+		|| (node = cached.SetTo(nodeAndKey.nodeOffset)) == NULL)
+		return false;
+
+	off_t link;
+	if (_FindKey(node, key, keyLength, NULL, &link) != B_OK)
+		return false;
+	if (!bplustree_node::IsDuplicate(link))
+		return link == value;
+
+	bool isFragment
+		= bplustree_node::LinkType(link) == BPLUSTREE_DUPLICATE_FRAGMENT;
+	off_t offset = bplustree_node::FragmentOffset(link);
+
+	while (offset != BPLUSTREE_NULL) {
+		const bplustree_node* duplicate = cached.SetTo(offset, false);
+		if (duplicate == NULL)
+			return false;
+
+		duplicate_array* array = isFragment
+			? duplicate->FragmentAt(bplustree_node::FragmentIndex(link))
+			: duplicate->DuplicateArray();
+		if (array->Find(value) >= 0)
+			return true;
+		if (isFragment)
+			break;
+
+		offset = duplicate->RightLink();
+	}
+	return false;
+}
+
+
+/*!	Returns whether or not the tree contains no keys at all.
+	You need to have the inode read or write locked.
+*/
+bool
+BPlusTree::IsEmpty()
+{
+	CachedNode cached(this);
+	const bplustree_node* root = cached.SetTo(fHeader.RootNode());
+
+	return root != NULL && root->IsLeaf() && root->NumKeys() == 0;
+}
+
+
 status_t
 BPlusTree::_ValidateChildren(TreeCheck& check, uint32 level, off_t offset,
 	const uint8* largestKey, uint16 largestKeyLength,
@@ -2637,6 +2906,9 @@ TreeIterator::Traverse(int8 direction, void* key, uint16* keyLength,
 			if (!node)
 				RETURN_ERROR(B_ERROR);
 
+			if (forward)
+				fTree->_PrefetchNodes(fCurrentNodeOffset);
+
 			// reset current key
 			fCurrentKey = forward ? 0 : node->NumKeys();
 		} else {
@@ -2974,6 +3246,228 @@ BitmapArray::Set(size_t index, bool set)
 // #pragma mark -
 
 
+TreeBuilder::TreeBuilder(BPlusTree* tree, Transaction& transaction)
+	:
+	fTree(tree),
+	fTransaction(transaction),
+	fLeaf(tree),
+	fLevelCount(1)
+{
+	fLevels[0].offset = tree->fHeader.RootNode();
+	fLevels[0].childOffset = BPLUSTREE_NULL;
+
+	fLeaf.SetToWritable(transaction, fLevels[0].offset);
+}
+
+
+status_t
+TreeBuilder::InitCheck() const
+{
+	return fLeaf.Node() != NULL ? B_OK : B_IO_ERROR;
+}
+
+
+/*!	Adds the key to the current leaf, or starts a new one if it's full.
+	Keys must be added in ascending order; if a key is added more than
+	once, its values are stored as duplicates.
+*/
+status_t
+TreeBuilder::Add(const uint8* key, uint16 keyLength, off_t value)
+{
+	bplustree_node* leaf = fLeaf.Node();
+	uint16 numKeys = leaf->NumKeys();
+
+	if (numKeys > 0) {
+		uint16 lastLength;
+		uint8* lastKey = leaf->KeyAt(numKeys - 1, &lastLength);
+		if (fTree->_CompareKeys(lastKey, lastLength, key, keyLength) == 0) {
+			return fTree->_InsertDuplicate(fTransaction, fLeaf, leaf,
+				numKeys - 1, value);
+		}
+
+		if (!_Fits(leaf, keyLength)) {
+			// the last key of the leaf is its key in the parent node
+			status_t status = _AddChild(1, lastKey, lastLength,
+				fLevels[0].offset);
+			if (status != B_OK)
+				return status;
+
+			CachedNode cached(fTree);
+			status = _AllocateNode(0, cached, &leaf);
+			if (status != B_OK)
+				return status;
+
+			cached.Unset();
+
+			leaf = fLeaf.SetToWritable(fTransaction, fLevels[0].offset);
+			if (leaf == NULL)
+				return B_IO_ERROR;
+		}
+	}
+
+	fTree->_InsertKey(leaf, leaf->NumKeys(), (uint8*)key, keyLength, value);
+	return B_OK;
+}
+
+
+/*!	Completes the last node of each level, and lets the tree header point
+	to the new root node.
+*/
+status_t
+TreeBuilder::Finish()
+{
+	if (fLevelCount > 1) {
+		const bplustree_node* leaf = fLeaf.Node();
+		uint16 keyLength;
+		uint8* key = leaf->KeyAt(leaf->NumKeys() - 1, &keyLength);
+
+		status_t status = _AddChild(1, key, keyLength, fLevels[0].offset);
+		if (status != B_OK)
+			return status;
+	}
+	fLeaf.Unset();
+
+	CachedNode cached(fTree);
+
+	// Note, completing a level may add another one on top of it
+	for (uint32 i = 1; i < fLevelCount; i++) {
+		build_level& current = fLevels[i];
+
+		bplustree_node* node = cached.SetToWritable(fTransaction,
+			current.offset);
+		if (node == NULL)
+			return B_IO_ERROR;
+
+		node->overflow_link = HOST_ENDIAN_TO_BFS_INT64(current.childOffset);
+		cached.Unset();
+
+		if (i + 1 < fLevelCount) {
+			status_t status = _AddChild(i + 1, current.childKey,
+				current.childKeyLength, current.offset);
+			if (status != B_OK)
+				return status;
+		}
+	}
+
+	bplustree_header* header = cached.SetToWritableHeader(fTransaction);
+	if (header == NULL)
+		return B_IO_ERROR;
+
+	header->root_node_pointer = HOST_ENDIAN_TO_BFS_INT64(
+		fLevels[fLevelCount - 1].offset);
+	header->max_number_of_levels = HOST_ENDIAN_TO_BFS_INT32(fLevelCount);
+	return B_OK;
+}
+
+
+bool
+TreeBuilder::_Fits(const bplustree_node* node, uint16 keyLength) const
+{
+	// this is the same test BPlusTree::Insert() uses
+	return int32(key_align(sizeof(bplustree_node) + node->AllKeyLength()
+		+ keyLength) + (node->NumKeys() + 1) * (sizeof(uint16)
+		+ sizeof(off_t))) < fTree->fNodeSize;
+}
+
+
+/*!	Allocates a new node for the specified level, and links it to the
+	previous node of that level.
+*/
+status_t
+TreeBuilder::_AllocateNode(uint32 level, CachedNode& cached,
+	bplustree_node** _node)
+{
+	bplustree_node* node;
+	off_t offset;
+	status_t status = cached.Allocate(fTransaction, &node, &offset);
+	if (status != B_OK)
+		return status;
+
+	off_t previous = fLevels[level].offset;
+	node->left_link = HOST_ENDIAN_TO_BFS_INT64(previous);
+
+	if (previous != BPLUSTREE_NULL) {
+		CachedNode cachedPrevious(fTree);
+		bplustree_node* previousNode = cachedPrevious.SetToWritable(
+			fTransaction, previous);
+		if (previousNode == NULL)
+			return B_IO_ERROR;
+
+		previousNode->right_link = HOST_ENDIAN_TO_BFS_INT64(offset);
+	}
+
+	fLevels[level].offset = offset;
+	*_node = node;
+	return B_OK;
+}
+
+
+/*!	Adds a child to the index node of the specified level. Since the last
+	child of an index node is referenced by its overflow link, the child
+	is held back until the next one arrives.
+*/
+status_t
+TreeBuilder::_AddChild(uint32 level, const uint8* key, uint16 keyLength,
+	off_t offset)
+{
+	if (level >= kMaxBuildLevels)
+		RETURN_ERROR(B_BAD_VALUE);
+
+	build_level& current = fLevels[level];
+
+	if (level == fLevelCount) {
+		current.offset = BPLUSTREE_NULL;
+		current.childOffset = BPLUSTREE_NULL;
+		fLevelCount++;
+	}
+
+	if (current.childOffset != BPLUSTREE_NULL) {
+		CachedNode cached(fTree);
+		bplustree_node* node = NULL;
+
+		if (current.offset != BPLUSTREE_NULL) {
+			node = cached.SetToWritable(fTransaction, current.offset);
+			if (node == NULL)
+				return B_IO_ERROR;
+
+			if (!_Fits(node, current.childKeyLength)) {
+				// The held back child completes this node; the next node
+				// starts out empty, and only holds back the new child
+				node->overflow_link = HOST_ENDIAN_TO_BFS_INT64(
+					current.childOffset);
+				cached.Unset();
+
+				status_t status = _AddChild(level + 1, current.childKey,
+					current.childKeyLength, current.offset);
+				if (status == B_OK)
+					status = _AllocateNode(level, cached, &node);
+				if (status != B_OK)
+					return status;
+
+				node = NULL;
+			}
+		} else {
+			status_t status = _AllocateNode(level, cached, &node);
+			if (status != B_OK)
+				return status;
+		}
+
+		if (node != NULL) {
+			fTree->_InsertKey(node, node->NumKeys(), current.childKey,
+				current.childKeyLength, current.childOffset);
+		}
+	}
+
+	memcpy(current.childKey, key, keyLength);
+	current.childKeyLength = keyLength;
+	current.childOffset = offset;
+	return B_OK;
+}
+
+
+// #pragma mark -
+
+
 bool
 duplicate_array::_FindInternal(off_t value, int32& index) const
 {
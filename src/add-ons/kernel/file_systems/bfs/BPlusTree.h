@@ -138,6 +138,7 @@ class TreeIterator;
 class CachedNode;
 class Inode;
 struct TreeCheck;
+class TreeBuilder;
 
 // needed for searching (utilizing a stack)
 struct node_and_key {
@@ -145,6 +146,13 @@ struct node_and_key {
 	uint16	keyIndex;
 };
 
+// needed for inserting many keys at once
+struct key_and_value {
+	const uint8*	key;
+	uint16			keyLength;
+	off_t			value;
+};
+
 
 class CachedNode {
 public:
@@ -246,11 +254,20 @@ public:
 			status_t			Insert(Transaction& transaction, double key,
 									off_t value);
 
+			status_t			InsertSorted(Transaction& transaction,
+									const key_and_value* entries,
+									int32 count);
+			int32				SortEntries(key_and_value* entries,
+									int32 count);
+
 			status_t			Replace(Transaction& transaction,
 									const uint8* key, uint16 keyLength,
 									off_t value);
 			status_t			Find(const uint8* key, uint16 keyLength,
 									off_t* value);
+			bool				Contains(const uint8* key, uint16 keyLength,
+									off_t value);
+			bool				IsEmpty();
 
 	static	int32				TypeCodeToKeyType(type_code code);
 	static	int32				ModeToKeyType(mode_t mode);
@@ -266,6 +283,10 @@ private:
 
 			int32				_CompareKeys(const void* key1, int keylength1,
 									const void* key2, int keylength2);
+			int32				_CompareEntries(const key_and_value& a,
+									const key_and_value& b);
+			void				_SiftDownEntry(key_and_value* entries,
+									int32 index, int32 count);
 			status_t			_FindKey(const bplustree_node* node,
 									const uint8* key, uint16 keyLength,
 									uint16* index = NULL, off_t* next = NULL);
@@ -301,6 +322,8 @@ private:
 			void				_AddIterator(TreeIterator* iterator);
 			void				_RemoveIterator(TreeIterator* iterator);
 
+			void				_PrefetchNodes(off_t offset);
+
 			status_t			_ValidateChildren(TreeCheck& check,
 									uint32 level, off_t offset,
 									const uint8* largestKey, uint16 keyLength,
@@ -315,6 +338,7 @@ private:
 			friend class TreeIterator;
 			friend class CachedNode;
 			friend class TreeCheck;
+			friend class TreeBuilder;
 
 			Inode*				fStream;
 			bplustree_header	fHeader;
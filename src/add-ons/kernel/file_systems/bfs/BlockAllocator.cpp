@@ -222,9 +222,24 @@ private:
 };
 
 
+struct free_extent {
+	int32	start;
+	int32	length;
+};
+
+// The extent index of a group starts out with room for kMinGroupExtents
+// entries, and grows as needed. An allocation group with more free extents
+// than one per kBitsPerGroupExtent bits (but at least kMinGroupExtents) is
+// considered too fragmented to be worth indexing; it is scanned in the
+// bitmap instead.
+static const int32 kMinGroupExtents = 64;
+static const int32 kBitsPerGroupExtent = 128;
+
+
 class AllocationGroup {
 public:
 	AllocationGroup();
+	~AllocationGroup();
 
 	void AddFreeRange(int32 start, int32 blocks);
 	bool IsFull() const { return fFreeBits == 0; }
@@ -236,9 +251,28 @@ public:
 	uint32 NumBlocks() const { return fNumBlocks; }
 	int32 Start() const { return fStart; }
 
+	void AddExtent(int32 start, int32 blocks);
+	void ResetExtents();
+	void InvalidateExtents(bool overflowed);
+	bool HasValidExtents() const { return fExtentsValid; }
+	bool CanRebuildExtents() const
+		{ return !fExtentsValid && fFreeBits >= fExtentsRetry; }
+	bool FindFreeExtent(int32 start, int32 maximum, int32& _start,
+		int32& _length) const;
+
+	int32 StreamHint(int32 length) const;
+	void SetStreamHint(int32 start, int32 length);
+
 private:
 	friend class BlockAllocator;
 
+	int32 _MaxExtents() const;
+	int32 _FindExtent(int32 start) const;
+	bool _InsertExtent(int32 index, int32 start, int32 length);
+	void _RemoveExtent(int32 index);
+	void _AllocateExtent(int32 start, int32 length);
+	void _FreeExtent(int32 start, int32 length);
+
 	uint32	fNumBits;
 	uint32	fNumBlocks;
 	int32	fStart;
@@ -248,6 +282,13 @@ private:
 	int32	fLargestStart;
 	int32	fLargestLength;
 	bool	fLargestValid;
+
+	free_extent* fExtents;
+	int32	fExtentCount;
+	int32	fExtentCapacity;
+	int32	fExtentsRetry;
+	bool	fExtentsValid;
+	int32	fStreamHint;
 };
 
 
@@ -377,11 +418,26 @@ AllocationGroup::AllocationGroup()
 	:
 	fFirstFree(-1),
 	fFreeBits(0),
-	fLargestValid(false)
+	fLargestValid(false),
+	fExtents(NULL),
+	fExtentCount(0),
+	fExtentCapacity(0),
+	fExtentsRetry(0),
+	fExtentsValid(false),
+	fStreamHint(0)
 {
 }
 
 
+AllocationGroup::~AllocationGroup()
+{
+	free(fExtents);
+}
+
+
+/*!	Adds a free range found while scanning the bitmap. The ranges must be
+	added in ascending order.
+*/
 void
 AllocationGroup::AddFreeRange(int32 start, int32 blocks)
 {
@@ -398,6 +454,259 @@ AllocationGroup::AddFreeRange(int32 start, int32 blocks)
 	}
 
 	fFreeBits += blocks;
+
+	AddExtent(start, blocks);
+}
+
+
+/*!	Appends a free extent to the index; like with AddFreeRange(), they must
+	be added in ascending order.
+*/
+void
+AllocationGroup::AddExtent(int32 start, int32 blocks)
+{
+	if (fExtentsValid && !_InsertExtent(fExtentCount, start, blocks))
+		InvalidateExtents(true);
+}
+
+
+/*!	Empties the extent index, and marks it valid, so that it can be filled
+	by a scan of the group's bitmap.
+*/
+void
+AllocationGroup::ResetExtents()
+{
+	fExtentCount = 0;
+	fExtentsValid = true;
+}
+
+
+/*!	Stops using the extent index of this group. If the group was just too
+	fragmented (\a overflowed is \c true), it will only be rebuilt once a
+	substantial number of blocks have been freed again; if the index got
+	out of sync with the bitmap, it may be rebuilt right away.
+*/
+void
+AllocationGroup::InvalidateExtents(bool overflowed)
+{
+	fExtentCount = 0;
+	fExtentsValid = false;
+	fExtentsRetry = overflowed ? fFreeBits + fNumBits / 8 : 0;
+}
+
+
+/*!	Finds room for \a maximum blocks at or after \a start in the extent
+	index. If \a start lies within a free extent, that one is returned in
+	any case, so that a stream can continue to grow in place. Otherwise,
+	the first extent that can hold \a maximum blocks, or the largest one
+	after \a start is returned.
+*/
+bool
+AllocationGroup::FindFreeExtent(int32 start, int32 maximum, int32& _start,
+	int32& _length) const
+{
+	int32 index = _FindExtent(start);
+	if (index >= 0) {
+		const free_extent& extent = fExtents[index];
+		if (extent.start + extent.length > start) {
+			_start = start;
+			_length = extent.start + extent.length - start;
+			return true;
+		}
+	}
+
+	int32 bestIndex = -1;
+	for (int32 i = index + 1; i < fExtentCount; i++) {
+		if (bestIndex < 0 || fExtents[i].length > fExtents[bestIndex].length)
+			bestIndex = i;
+		if (fExtents[i].length >= maximum)
+			break;
+	}
+	if (bestIndex < 0)
+		return false;
+
+	_start = fExtents[bestIndex].start;
+	_length = fExtents[bestIndex].length;
+	return true;
+}
+
+
+/*!	Returns where the data of a new stream with an initial size of
+	\a length blocks should be placed in this group. New streams are laid
+	out one after the other, larger ones with some space between them, so
+	that streams that are written concurrently don't end up interleaved.
+	Returns 0 if the group has no room left after the last stream.
+*/
+int32
+AllocationGroup::StreamHint(int32 length) const
+{
+	if (!fExtentsValid || fStreamHint == 0)
+		return 0;
+
+	int32 start;
+	int32 found;
+	if (FindFreeExtent(fStreamHint, length, start, found) && found >= length)
+		return fStreamHint;
+
+	return 0;
+}
+
+
+/*!	Sets where the next new stream should start, after the one that was
+	just started at \a start with \a length blocks.
+	Only streams of at least 1/kMinGroupExtents of the group get as much room
+	to grow as they got initially; smaller ones are packed one after the other.
+	This way, there can be no more than kMinGroupExtents / 2 gaps in a group,
+	and many small files don't fragment it beyond what its extent index can
+	hold.
+*/
+void
+AllocationGroup::SetStreamHint(int32 start, int32 length)
+{
+	if (length >= (int32)fNumBits / kMinGroupExtents)
+		start += length;
+	start += length;
+
+	fStreamHint = start < (int32)fNumBits ? start : 0;
+}
+
+
+/*!	Returns how many free extents the index of this group may hold. */
+int32
+AllocationGroup::_MaxExtents() const
+{
+	return max_c(kMinGroupExtents, (int32)fNumBits / kBitsPerGroupExtent);
+}
+
+
+/*!	Returns the index of the last extent that starts at or before \a start,
+	or -1 if there is none.
+*/
+int32
+AllocationGroup::_FindExtent(int32 start) const
+{
+	int32 low = 0;
+	int32 high = fExtentCount - 1;
+	int32 found = -1;
+
+	while (low <= high) {
+		int32 middle = (low + high) / 2;
+		if (fExtents[middle].start <= start) {
+			found = middle;
+			low = middle + 1;
+		} else
+			high = middle - 1;
+	}
+
+	return found;
+}
+
+
+bool
+AllocationGroup::_InsertExtent(int32 index, int32 start, int32 length)
+{
+	if (fExtentCount == fExtentCapacity) {
+		int32 maxExtents = _MaxExtents();
+		if (fExtentCapacity >= maxExtents)
+			return false;
+
+		int32 capacity = fExtentCapacity > 0
+			? min_c(fExtentCapacity * 2, maxExtents) : kMinGroupExtents;
+		free_extent* extents = (free_extent*)realloc(fExtents,
+			capacity * sizeof(free_extent));
+		if (extents == NULL)
+			return false;
+
+		fExtents = extents;
+		fExtentCapacity = capacity;
+	}
+
+	memmove(&fExtents[index + 1], &fExtents[index],
+		(fExtentCount - index) * sizeof(free_extent));
+	fExtents[index].start = start;
+	fExtents[index].length = length;
+	fExtentCount++;
+	return true;
+}
+
+
+void
+AllocationGroup::_RemoveExtent(int32 index)
+{
+	fExtentCount--;
+	memmove(&fExtents[index], &fExtents[index + 1],
+		(fExtentCount - index) * sizeof(free_extent));
+}
+
+
+/*!	Removes the specified range from the extent index. */
+void
+AllocationGroup::_AllocateExtent(int32 start, int32 length)
+{
+	if (!fExtentsValid)
+		return;
+
+	int32 index = _FindExtent(start);
+	if (index < 0
+		|| fExtents[index].start + fExtents[index].length < start + length) {
+		// we didn't know this range was free - the index is out of sync
+		InvalidateExtents(false);
+		return;
+	}
+
+	free_extent& extent = fExtents[index];
+	int32 end = extent.start + extent.length;
+
+	if (extent.start == start) {
+		extent.start += length;
+		extent.length -= length;
+		if (extent.length == 0)
+			_RemoveExtent(index);
+		return;
+	}
+
+	extent.length = start - extent.start;
+	if (start + length < end
+		&& !_InsertExtent(index + 1, start + length, end - start - length))
+		InvalidateExtents(true);
+}
+
+
+/*!	Adds the specified range to the extent index, and merges it with its
+	neighbours.
+*/
+void
+AllocationGroup::_FreeExtent(int32 start, int32 length)
+{
+	if (!fExtentsValid)
+		return;
+
+	int32 previous = _FindExtent(start);
+	int32 next = previous + 1;
+
+	if ((previous >= 0
+			&& fExtents[previous].start + fExtents[previous].length > start)
+		|| (next < fExtentCount && fExtents[next].start < start + length)) {
+		// the range is already known to be free
+		InvalidateExtents(false);
+		return;
+	}
+
+	bool mergePrevious = previous >= 0
+		&& fExtents[previous].start + fExtents[previous].length == start;
+	bool mergeNext = next < fExtentCount
+		&& fExtents[next].start == start + length;
+
+	if (mergePrevious && mergeNext) {
+		fExtents[previous].length += length + fExtents[next].length;
+		_RemoveExtent(next);
+	} else if (mergePrevious) {
+		fExtents[previous].length += length;
+	} else if (mergeNext) {
+		fExtents[next].start = start;
+		fExtents[next].length += length;
+	} else if (!_InsertExtent(next, start, length))
+		InvalidateExtents(true);
 }
 
 
@@ -418,6 +727,7 @@ AllocationGroup::Allocate(Transaction& transaction, uint16 start, int32 length)
 	if (start == fFirstFree)
 		fFirstFree = start + length;
 	fFreeBits -= length;
+	_AllocateExtent(start, length);
 
 	if (fLargestValid) {
 		bool cut = false;
@@ -486,6 +796,7 @@ AllocationGroup::Free(Transaction& transaction, uint16 start, int32 length)
 	if (fFirstFree > start)
 		fFirstFree = start;
 	fFreeBits += length;
+	_FreeExtent(start, length);
 
 	// The range to be freed cannot be part of the valid largest range
 	ASSERT(!fLargestValid || start + length <= fLargestStart
@@ -621,6 +932,8 @@ BlockAllocator::InitializeAndClearBitmap(Transaction& transaction)
 		fGroups[i].fFirstFree = fGroups[i].fLargestStart = 0;
 		fGroups[i].fFreeBits = fGroups[i].fLargestLength = fGroups[i].fNumBits;
 		fGroups[i].fLargestValid = true;
+		fGroups[i].ResetExtents();
+		fGroups[i].AddExtent(0, fGroups[i].fNumBits);
 
 		offset += fBlocksPerGroup;
 	}
@@ -675,6 +988,7 @@ BlockAllocator::_Initialize(BlockAllocator* allocator)
 			groups[i].fNumBlocks = blocks;
 		}
 		groups[i].fStart = offset;
+		groups[i].ResetExtents();
 
 		// finds all free ranges in this allocation group
 		int32 start = -1, range = 0;
@@ -768,6 +1082,8 @@ BlockAllocator::AllocateBlocks(Transaction& transaction, int32 groupIndex,
 	RecursiveLocker lock(fLock);
 
 	uint32 bitsPerFullBlock = fVolume->BlockSize() << 3;
+	int32 firstGroup = groupIndex;
+	uint16 firstStart = start;
 
 	// Find the block_run that can fulfill the request best
 	int32 bestGroup = -1;
@@ -783,6 +1099,31 @@ BlockAllocator::AllocateBlocks(Transaction& transaction, int32 groupIndex,
 		if (start >= group.NumBits() || group.IsFull())
 			continue;
 
+		if (group.HasValidExtents()
+			|| (group.CanRebuildExtents() && _RebuildExtents(group))) {
+			// The extent index knows all free ranges of this group, there
+			// is no need to look at the bitmap.
+			// If we can continue right where the caller wants us to, we
+			// do so, even if that gives us fewer blocks than elsewhere.
+			int32 extentStart;
+			int32 extentLength;
+			if (!group.FindFreeExtent(start, maximum, extentStart,
+					extentLength))
+				continue;
+
+			bool inPlace = start > 0 && extentStart == start
+				&& extentLength >= minimum;
+			if (inPlace || extentLength > bestLength) {
+				bestGroup = groupIndex;
+				bestStart = extentStart;
+				bestLength = extentLength;
+			}
+
+			if (inPlace || bestLength >= maximum)
+				break;
+			continue;
+		}
+
 		// The wanted maximum is smaller than the largest free block in the
 		// group or already smaller than the minimum
 
@@ -820,6 +1161,8 @@ BlockAllocator::AllocateBlocks(Transaction& transaction, int32 groupIndex,
 		int32 currentBit = start;
 		bool canFindGroupLargest = start == 0;
 
+		_PrefetchBitmap(group, block);
+
 		for (; block < group.NumBlocks(); block++) {
 			if (cached.SetTo(group, block) < B_OK)
 				RETURN_ERROR(B_ERROR);
@@ -915,6 +1258,16 @@ BlockAllocator::AllocateBlocks(Transaction& transaction, int32 groupIndex,
 		bestLength = round_down(bestLength, minimum);
 	}
 
+	if (fGroups[bestGroup].HasValidExtents()
+		&& !_IsFreeRange(fGroups[bestGroup], bestStart, bestLength)) {
+		// The extent index is out of sync with the bitmap (for example,
+		// because a transaction that freed blocks has been aborted); it will
+		// be rebuilt from the bitmap on the next try.
+		fGroups[bestGroup].InvalidateExtents(false);
+		return AllocateBlocks(transaction, firstGroup, firstStart, maximum,
+			minimum, run);
+	}
+
 	if (fGroups[bestGroup].Allocate(transaction, bestStart, bestLength) != B_OK)
 		RETURN_ERROR(B_IO_ERROR);
 
@@ -989,34 +1342,84 @@ BlockAllocator::Allocate(Transaction& transaction, Inode* inode,
 	// if necessary)
 	uint16 group = inode->BlockRun().AllocationGroup();
 	uint16 start = 0;
+	bool newStream = false;
+
+	RecursiveLocker lock(fLock);
 
 	// Are there already allocated blocks? (then just try to allocate near the
 	// last one)
 	if (inode->Size() > 0) {
-		const data_stream& data = inode->Node().data;
-		// TODO: we currently don't care for when the data stream
-		// is already grown into the indirect ranges
-		if (data.max_double_indirect_range == 0
-			&& data.max_indirect_range == 0) {
-			// Since size > 0, there must be a valid block run in this stream
-			int32 last = 0;
-			for (; last < NUM_DIRECT_BLOCKS - 1; last++)
-				if (data.direct[last + 1].IsZero())
-					break;
-
-			group = data.direct[last].AllocationGroup();
-			start = data.direct[last].Start() + data.direct[last].Length();
+		block_run last;
+		if (_LastBlockRun(inode, last) == B_OK) {
+			group = last.AllocationGroup();
+			start = last.Start() + last.Length();
 		}
 	} else if (inode->IsContainer() || inode->IsSymLink()) {
 		// directory and symbolic link data will go in the same allocation
 		// group as the inode is in but after the inode data
 		start = inode->BlockRun().Start();
 	} else {
-		// file data will start in the next allocation group
+		// file data will start in the next allocation group, after the
+		// streams that have been started there before
 		group = inode->BlockRun().AllocationGroup() + 1;
+		start = fGroups[group % fNumGroups].StreamHint(numBlocks);
+		newStream = true;
+	}
+
+	status_t status = AllocateBlocks(transaction, group, start, numBlocks,
+		minimum, run);
+	if (status == B_OK && newStream) {
+		fGroups[run.AllocationGroup()].SetStreamHint(run.Start(),
+			run.Length());
 	}
 
-	return AllocateBlocks(transaction, group, start, numBlocks, minimum, run);
+	return status;
+}
+
+
+/*!	Retrieves the last block_run of the inode's data stream, if it is
+	in the direct or indirect range.
+*/
+status_t
+BlockAllocator::_LastBlockRun(Inode* inode, block_run& run)
+{
+	const data_stream& data = inode->Node().data;
+
+	// TODO: we currently don't care for when the data stream
+	// is already grown into the double indirect range
+	if (data.max_double_indirect_range != 0)
+		return B_ENTRY_NOT_FOUND;
+
+	if (data.max_indirect_range == 0) {
+		// Since size > 0, there must be a valid block run in this stream
+		int32 last = 0;
+		for (; last < NUM_DIRECT_BLOCKS - 1; last++)
+			if (data.direct[last + 1].IsZero())
+				break;
+
+		run = data.direct[last];
+		return B_OK;
+	}
+
+	// find the last run in the indirect array, starting at its end
+	CachedBlock cached(fVolume);
+	off_t block = fVolume->ToBlock(data.indirect);
+	int32 runsPerBlock = fVolume->BlockSize() / sizeof(block_run);
+
+	for (int32 i = data.indirect.Length(); i-- > 0;) {
+		const block_run* runs = (const block_run*)cached.SetTo(block + i);
+		if (runs == NULL)
+			return B_IO_ERROR;
+
+		for (int32 j = runsPerBlock; j-- > 0;) {
+			if (!runs[j].IsZero()) {
+				run = runs[j];
+				return B_OK;
+			}
+		}
+	}
+
+	return B_ENTRY_NOT_FOUND;
 }
 
 
@@ -1085,6 +1488,162 @@ BlockAllocator::BitmapSize() const
 }
 
 
+/*!	Lets the block cache read in the bitmap blocks of \a group from \a block
+	on asynchronously, so that a following scan through the group doesn't
+	have to wait for each of them in turn.
+*/
+void
+BlockAllocator::_PrefetchBitmap(AllocationGroup& group, uint32 block) const
+{
+	if (block + 1 >= group.NumBlocks())
+		return;
+
+	size_t numBlocks = group.NumBlocks() - block;
+	block_cache_prefetch(fVolume->BlockCache(), group.Start() + block,
+		&numBlocks);
+}
+
+
+/*!	Checks the bitmap whether or not the specified range is completely
+	free.
+*/
+bool
+BlockAllocator::_IsFreeRange(AllocationGroup& group, int32 start,
+	int32 length) const
+{
+	AllocationBlock cached(fVolume);
+	uint32 bitsPerBlock = fVolume->BlockSize() << 3;
+	uint32 block = start / bitsPerBlock;
+	uint32 bit = start % bitsPerBlock;
+
+	while (length > 0) {
+		if (cached.SetTo(group, block) != B_OK)
+			return false;
+
+		for (; bit < cached.NumBlockBits() && length > 0; bit++, length--) {
+			if (cached.IsUsed(bit))
+				return false;
+		}
+
+		block++;
+		bit = 0;
+	}
+
+	return true;
+}
+
+
+/*!	Calls \a hook for every free range in the bitmap of \a group, in
+	ascending order.
+*/
+status_t
+BlockAllocator::_ScanFreeRanges(AllocationGroup& group, free_range_hook hook,
+	void* cookie) const
+{
+	AllocationBlock cached(fVolume);
+	int32 rangeStart = 0;
+	int32 rangeLength = 0;
+	int32 bit = 0;
+
+	_PrefetchBitmap(group, 0);
+
+	for (uint32 block = 0; block < group.NumBlocks(); block++) {
+		if (cached.SetTo(group, block) != B_OK)
+			RETURN_ERROR(B_IO_ERROR);
+
+		for (uint32 i = 0; i < cached.NumBlockBits(); i++, bit++) {
+			if (!cached.IsUsed(i)) {
+				if (rangeLength++ == 0)
+					rangeStart = bit;
+			} else if (rangeLength > 0) {
+				hook(cookie, rangeStart, rangeLength);
+				rangeLength = 0;
+			}
+		}
+	}
+
+	if (rangeLength > 0)
+		hook(cookie, rangeStart, rangeLength);
+
+	return B_OK;
+}
+
+
+/*static*/ void
+BlockAllocator::_AddExtent(void* _group, int32 start, int32 length)
+{
+	AllocationGroup* group = (AllocationGroup*)_group;
+	group->AddExtent(start, length);
+}
+
+
+/*!	Fills the extent index of \a group from its bitmap. Returns \c false if
+	the group turned out to be too fragmented to be indexed.
+*/
+bool
+BlockAllocator::_RebuildExtents(AllocationGroup& group)
+{
+	group.ResetExtents();
+
+	if (_ScanFreeRanges(group, &_AddExtent, &group) != B_OK)
+		group.InvalidateExtents(true);
+
+	return group.HasValidExtents();
+}
+
+
+/*static*/ void
+BlockAllocator::_AddFragmentationInfo(void* _info, int32 start, int32 length)
+{
+	fragmentation_info* info = (fragmentation_info*)_info;
+
+	info->free_blocks += length;
+	info->free_extents++;
+	if ((uint64)length > info->largest_free_extent)
+		info->largest_free_extent = length;
+
+	int32 bucket = 0;
+	while (bucket < BFS_FREE_EXTENT_BUCKETS - 1 && (length >> (bucket + 1)) != 0)
+		bucket++;
+
+	info->extents_by_size[bucket]++;
+}
+
+
+/*!	Collects statistics about how fragmented the free space of the volume
+	is. Free extents never span more than a single allocation group.
+*/
+status_t
+BlockAllocator::GetFragmentationInfo(fragmentation_info& info)
+{
+	memset(&info, 0, sizeof(fragmentation_info));
+
+	RecursiveLocker lock(fLock);
+
+	info.allocation_groups = fNumGroups;
+
+	for (int32 i = 0; i < fNumGroups; i++) {
+		AllocationGroup& group = fGroups[i];
+
+		if (group.HasValidExtents()) {
+			info.indexed_groups++;
+			for (int32 j = 0; j < group.fExtentCount; j++) {
+				_AddFragmentationInfo(&info, group.fExtents[j].start,
+					group.fExtents[j].length);
+			}
+			continue;
+		}
+
+		status_t status = _ScanFreeRanges(group, &_AddFragmentationInfo,
+			&info);
+		if (status != B_OK)
+			return status;
+	}
+
+	return B_OK;
+}
+
+
 #ifdef DEBUG_FRAGMENTER
 void
 BlockAllocator::Fragment()
@@ -1131,6 +1690,8 @@ BlockAllocator::_CheckGroup(int32 groupIndex) const
 	int32 largestLength = 0;
 	int32 currentBit = 0;
 
+	_PrefetchBitmap(group, 0);
+
 	for (uint32 block = 0; block < group.NumBlocks(); block++) {
 		if (cached.SetTo(group, block) < B_OK) {
 			panic("setting group block %d failed\n", (int)block);
@@ -2147,6 +2708,9 @@ BlockAllocator::Dump(int32 index)
 			group.fLargestValid ? "" : "  (invalid)");
 		kprintf("      largest length: %ld\n", group.fLargestLength);
 		kprintf("      free bits:      %ld\n", group.fFreeBits);
+		kprintf("      free extents:   %ld%s\n", group.fExtentCount,
+			group.fExtentsValid ? "" : "  (not indexed)");
+		kprintf("      stream hint:    %ld\n", group.fStreamHint);
 	}
 }
 
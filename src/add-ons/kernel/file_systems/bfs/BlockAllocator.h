@@ -18,6 +18,7 @@ struct disk_super_block;
 struct block_run;
 struct check_control;
 struct check_cookie;
+struct fragmentation_info;
 
 
 //#define DEBUG_ALLOCATION_GROUPS
@@ -59,6 +60,8 @@ public:
 
 			size_t			BitmapSize() const;
 
+			status_t		GetFragmentationInfo(fragmentation_info& info);
+
 #ifdef BFS_DEBUGGER_COMMANDS
 			void			Dump(int32 index);
 #endif
@@ -69,6 +72,17 @@ public:
 private:
 			status_t		_RemoveInvalidNode(Inode* parent, BPlusTree* tree,
 								Inode* inode, const char* name);
+			typedef void (*free_range_hook)(void* cookie, int32 start,
+								int32 length);
+
+			status_t		_LastBlockRun(Inode* inode, block_run& run);
+			void			_PrefetchBitmap(AllocationGroup& group,
+								uint32 block) const;
+			bool			_IsFreeRange(AllocationGroup& group, int32 start,
+								int32 length) const;
+			status_t		_ScanFreeRanges(AllocationGroup& group,
+								free_range_hook hook, void* cookie) const;
+			bool			_RebuildExtents(AllocationGroup& group);
 #ifdef DEBUG_ALLOCATION_GROUPS
 			void			_CheckGroup(int32 group) const;
 #endif
@@ -83,6 +97,10 @@ private:
 			status_t		_WriteBackCheckBitmap();
 
 	static	status_t		_Initialize(BlockAllocator* self);
+	static	void			_AddExtent(void* group, int32 start,
+								int32 length);
+	static	void			_AddFragmentationInfo(void* info, int32 start,
+								int32 length);
 
 private:
 			Volume*			fVolume;
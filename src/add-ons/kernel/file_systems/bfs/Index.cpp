@@ -14,6 +14,28 @@
 #include "BPlusTree.h"
 
 
+/*!	Reads the key of the given node for the index \a name, that is, the
+	first BPLUSTREE_MAX_KEY_LENGTH bytes of its attribute.
+*/
+static status_t
+read_index_key(Volume* volume, ino_t id, const char* name, uint8* key,
+	size_t* _length)
+{
+	Vnode vnode(volume, id);
+	Inode* inode;
+	status_t status = vnode.Get(&inode);
+	if (status != B_OK)
+		return status;
+	if (inode->IsDeleted())
+		return B_ENTRY_NOT_FOUND;
+
+	return inode->ReadAttribute(name, 0, 0, key, _length);
+}
+
+
+//	#pragma mark -
+
+
 Index::Index(Volume* volume)
 	:
 	fVolume(volume),
@@ -384,3 +406,87 @@ Index::UpdateLastModified(Transaction& transaction, Inode* inode,
 	return status;
 }
 
+
+/*!	Adds the nodes with the specified IDs to the index, using the current
+	value of their attribute as key. Nodes that don't have the attribute,
+	or that are already part of the index, are skipped.
+	If the index is still empty, the nodes are sorted and inserted in a
+	single transaction, which allows the tree to be built bottom-up; the
+	nodes that don't fit into it, and those for an index that is already
+	in use are inserted in smaller transactions.
+	This only works for attribute indices, not for "name", "size", and
+	"last_modified".
+*/
+status_t
+Index::InsertNodes(const ino_t* ids, uint32 count, uint32* _inserted)
+{
+	*_inserted = 0;
+
+	if (fNode == NULL)
+		return B_NO_INIT;
+	if (!strcmp(fName, "name") || !strcmp(fName, "size")
+		|| !strcmp(fName, "last_modified"))
+		return B_NOT_ALLOWED;
+
+	BPlusTree* tree = fNode->Tree();
+	if (tree == NULL)
+		return B_BAD_VALUE;
+	if (count == 0)
+		return B_OK;
+
+	key_and_value* entries = (key_and_value*)malloc(
+		count * (sizeof(key_and_value) + BPLUSTREE_MAX_KEY_LENGTH));
+	if (entries == NULL)
+		return B_NO_MEMORY;
+
+	MemoryDeleter entriesDeleter(entries);
+	uint8* keys = (uint8*)(entries + count);
+
+	// keep the transactions well below the size of the log
+	off_t maxBytes = (off_t)fVolume->Log().Length() * fVolume->BlockSize() / 4;
+	uint32 maxInserts = max_c(fVolume->Log().Length() / 16, 1);
+
+	uint32 index = 0;
+	while (index < count) {
+		Transaction transaction(fVolume, fNode->BlockNumber());
+		fNode->WriteLockInTransaction(transaction);
+
+		// The keys are read while the transaction is running, so that they
+		// cannot change before they are inserted
+		bool isEmpty = tree->IsEmpty();
+		uint32 end = isEmpty ? count : min_c(count, index + maxInserts);
+		int32 entryCount = 0;
+		off_t bytes = 0;
+
+		for (; index < end && bytes < maxBytes; index++) {
+			uint8* key = keys + entryCount * BPLUSTREE_MAX_KEY_LENGTH;
+			size_t length = BPLUSTREE_MAX_KEY_LENGTH;
+			if (read_index_key(fVolume, ids[index], fName, key, &length)
+					!= B_OK
+				|| length == 0
+				|| (!isEmpty && tree->Contains(key, length, ids[index])))
+				continue;
+
+			entries[entryCount].key = key;
+			entries[entryCount].keyLength = length;
+			entries[entryCount].value = ids[index];
+			entryCount++;
+
+			// approximate space needed in the tree, including a duplicate
+			bytes += length + sizeof(uint16) + 2 * sizeof(off_t);
+		}
+
+		entryCount = tree->SortEntries(entries, entryCount);
+
+		status_t status = tree->InsertSorted(transaction, entries,
+			entryCount);
+		if (status == B_OK)
+			status = transaction.Done();
+		if (status != B_OK)
+			RETURN_ERROR(status);
+
+		*_inserted += entryCount;
+	}
+
+	return B_OK;
+}
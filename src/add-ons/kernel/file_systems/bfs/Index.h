@@ -53,6 +53,9 @@ public:
 			status_t		UpdateLastModified(Transaction& transaction,
 								Inode* inode, bigtime_t modified = -1);
 
+			status_t		InsertNodes(const ino_t* ids, uint32 count,
+								uint32* _inserted);
+
 private:
 							Index(const Index& other);
 							Index& operator=(const Index& other);
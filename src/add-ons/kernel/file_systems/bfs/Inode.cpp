@@ -13,6 +13,12 @@
 #include "Index.h"
 
 
+// The journal is locked while a file's data is copied during defragmenting,
+// so we don't move larger files.
+static const off_t kMaxDefragmentSize = 64 * 1024 * 1024;
+static const off_t kDefragmentBufferSize = 64 * 1024;
+
+
 #if BFS_TRACING && !defined(BFS_SHELL) && !defined(_BOOT_MODE)
 namespace BFSInodeTracing {
 
@@ -345,6 +351,7 @@ Inode::Inode(Volume* volume, ino_t id)
 	// these two will help to maintain the indices
 	fOldSize = Size();
 	fOldLastModified = LastModified();
+	fLastTransaction = volume->GetJournal(0)->TransactionSequence();
 
 	if (IsContainer())
 		fTree = new BPlusTree(this);
@@ -391,6 +398,7 @@ Inode::Inode(Volume* volume, Transaction& transaction, ino_t id, mode_t mode,
 	// these two will help to maintain the indices
 	fOldSize = Size();
 	fOldLastModified = LastModified();
+	fLastTransaction = volume->GetJournal(0)->TransactionSequence();
 }
 
 
@@ -2301,6 +2309,173 @@ Inode::TrimPreallocation(Transaction& transaction)
 }
 
 
+/*!	Counts the fragments of the file's data; runs that are adjacent on disk
+	are counted as one.
+*/
+status_t
+Inode::CountBlockRuns(uint32& _count)
+{
+	int32 blockShift = fVolume->BlockShift();
+	off_t size = round_up(Size(), fVolume->BlockSize());
+	off_t lastEnd = -1;
+	off_t pos = 0;
+	uint32 count = 0;
+
+	while (pos < size) {
+		block_run run;
+		off_t offset;
+		status_t status = FindBlockRun(pos, run, offset);
+		if (status != B_OK)
+			return status;
+		if (run.IsZero())
+			RETURN_ERROR(B_BAD_DATA);
+
+		off_t start = fVolume->ToBlock(run) + ((pos - offset) >> blockShift);
+		if (start != lastEnd)
+			count++;
+
+		lastEnd = fVolume->ToBlock(run) + run.Length();
+		pos = offset + ((off_t)run.Length() << blockShift);
+	}
+
+	_count = count;
+	return B_OK;
+}
+
+
+/*!	Moves the file's data into as few contiguous runs as possible.
+	The data is copied into newly allocated runs first, and the stream is
+	only changed to use them afterwards, so that the file stays intact as
+	long as the transaction isn't done. The new runs must all fit into the
+	direct range, and there must be fewer of them than before; otherwise,
+	the file is left alone.
+	Since the journal is locked while the data is copied, files larger than
+	kMaxDefragmentSize are not moved.
+*/
+status_t
+Inode::Defragment(Transaction& transaction, uint32& _runsBefore,
+	uint32& _runsAfter)
+{
+	if (!IsFile())
+		return B_BAD_TYPE;
+
+	WriteLockInTransaction(transaction);
+
+	status_t status = CountBlockRuns(_runsBefore);
+	if (status != B_OK)
+		return status;
+
+	_runsAfter = _runsBefore;
+	if (_runsBefore <= 1)
+		return B_OK;
+	if (Size() > kMaxDefragmentSize)
+		return B_FILE_TOO_LARGE;
+
+	int32 blockShift = fVolume->BlockShift();
+	off_t size = round_up(Size(), fVolume->BlockSize());
+	off_t blocks = size >> blockShift;
+	if (blocks > fVolume->FreeBlocks())
+		return B_DEVICE_FULL;
+
+	// allocate the new runs
+
+	block_run runs[NUM_DIRECT_BLOCKS];
+	uint32 count = 0;
+	off_t remaining = blocks;
+	int32 group = BlockRun().AllocationGroup() + 1;
+
+	while (remaining > 0 && count < NUM_DIRECT_BLOCKS
+		&& count + 1 < _runsBefore) {
+		block_run run;
+		status = fVolume->Allocator().AllocateBlocks(transaction, group, 0,
+			min_c(remaining, MAX_BLOCK_RUN_LENGTH), 1, run);
+		if (status != B_OK)
+			break;
+
+		remaining -= run.Length();
+		group = run.AllocationGroup();
+
+		if (count > 0 && runs[count - 1].MergeableWith(run)) {
+			runs[count - 1].length = HOST_ENDIAN_TO_BFS_INT16(
+				runs[count - 1].Length() + run.Length());
+		} else
+			runs[count++] = run;
+	}
+
+	// copy the data over
+
+	uint8* buffer = NULL;
+	if (remaining == 0) {
+		buffer = (uint8*)malloc(kDefragmentBufferSize);
+		if (buffer == NULL)
+			status = B_NO_MEMORY;
+	}
+	MemoryDeleter bufferDeleter(buffer);
+
+	off_t pos = 0;
+	uint32 index = 0;
+	off_t runPosition = 0;
+
+	while (buffer != NULL && status == B_OK && pos < size) {
+		block_run run;
+		off_t offset;
+		status = FindBlockRun(pos, run, offset);
+		if (status != B_OK)
+			break;
+
+		off_t length = min_c(offset + ((off_t)run.Length() << blockShift),
+			size) - pos;
+		length = min_c(length, kDefragmentBufferSize);
+		length = min_c(length,
+			((off_t)runs[index].Length() << blockShift) - runPosition);
+
+		if (read_pos(fVolume->Device(), fVolume->ToOffset(run) + pos - offset,
+				buffer, length) != length
+			|| write_pos(fVolume->Device(),
+				fVolume->ToOffset(runs[index]) + runPosition, buffer, length)
+					!= length) {
+			status = B_IO_ERROR;
+			break;
+		}
+
+		pos += length;
+		runPosition += length;
+		if (runPosition == (off_t)runs[index].Length() << blockShift) {
+			index++;
+			runPosition = 0;
+		}
+	}
+
+	if (buffer == NULL || status != B_OK) {
+		// There wasn't enough contiguous space to improve anything, or we
+		// failed to copy the data - give the blocks back
+		for (uint32 i = 0; i < count; i++)
+			fVolume->Free(transaction, runs[i]);
+
+		return status;
+	}
+
+	// replace the data stream with the new runs
+
+	off_t fileSize = Size();
+	status = _ShrinkStream(transaction, 0);
+	if (status != B_OK)
+		return status;
+
+	data_stream* data = &Node().data;
+	memset(data, 0, sizeof(data_stream));
+	for (uint32 i = 0; i < count; i++)
+		data->direct[i] = runs[i];
+	data->max_direct_range = HOST_ENDIAN_TO_BFS_INT64(size);
+	data->size = HOST_ENDIAN_TO_BFS_INT64(fileSize);
+
+	file_map_invalidate(Map(), 0, fileSize);
+
+	_runsAfter = count;
+	return WriteBack(transaction);
+}
+
+
 //!	Frees the file's data stream and removes all attributes
 status_t
 Inode::Free(Transaction& transaction)
@@ -2342,8 +2517,18 @@ Inode::Free(Transaction& transaction)
 status_t
 Inode::Sync()
 {
-	if (FileCache())
-		return file_cache_sync(FileCache());
+	status_t status = B_OK;
+	if (FileCache()) {
+		status = file_cache_sync(FileCache());
+		if (status != B_OK)
+			return status;
+	}
+
+	// Only the log entry that contains our own changes needs to be written;
+	// any other blocks are left to the block cache.
+	status = fVolume->GetJournal(0)->FlushTransaction(fLastTransaction);
+	if (status != B_OK || FileCache())
+		return status;
 
 	// We may also want to flush the attribute's data stream to
 	// disk here... (do we?)
@@ -2354,7 +2539,6 @@ Inode::Sync()
 	InodeReadLocker locker(this);
 
 	data_stream* data = &Node().data;
-	status_t status = B_OK;
 
 	// flush direct range
 
@@ -2444,7 +2628,10 @@ Inode::TransactionDone(bool success)
 	if (!success) {
 		// revert any changes made to the cached bfs_inode
 		UpdateNodeFromDisk();
+		return;
 	}
+
+	fLastTransaction = fVolume->GetJournal(0)->TransactionSequence();
 }
 
 
@@ -148,6 +148,9 @@ public:
 			status_t			Append(Transaction& transaction, off_t bytes);
 			status_t			TrimPreallocation(Transaction& transaction);
 			bool				NeedsTrimming() const;
+			status_t			CountBlockRuns(uint32& _count);
+			status_t			Defragment(Transaction& transaction,
+									uint32& _runsBefore, uint32& _runsAfter);
 
 			status_t			Free(Transaction& transaction);
 			status_t			Sync();
@@ -261,6 +264,9 @@ private:
 			off_t				fOldLastModified;
 				// we need those values to ensure we will remove
 				// the correct keys from the indices
+			int64				fLastTransaction;
+				// the sequence number of the last transaction that changed
+				// this inode, so that Sync() knows what to put into the log
 
 			mutable recursive_lock fSmallDataLock;
 			SinglyLinkedList<AttributeIterator> fIterators;
@@ -404,16 +404,37 @@ Journal::Journal(Volume* volume)
 	fMaxTransactionSize(fLogSize / 2 - 5),
 	fUsed(0),
 	fUnwrittenTransactions(0),
+	fSequence(0),
+	fLoggedSequence(0),
+	fLogWriter(-1),
+	fLogWriteRequested(false),
 	fHasSubtransaction(false),
 	fSeparateSubTransactions(false)
 {
 	recursive_lock_init(&fLock, "bfs journal");
 	mutex_init(&fEntriesLock, "bfs journal entries");
+
+	// Large transactions are written to the log in the background; if we
+	// cannot start the log writer, they are written synchronously instead
+	fLogWriterSemaphore = create_sem(0, "bfs log writer");
+	if (fLogWriterSemaphore >= 0) {
+		fLogWriter = spawn_kernel_thread(&_LogWriter, "bfs log writer",
+			B_NORMAL_PRIORITY, this);
+		if (fLogWriter >= 0)
+			resume_thread(fLogWriter);
+	}
 }
 
 
 Journal::~Journal()
 {
+	if (fLogWriterSemaphore >= 0)
+		delete_sem(fLogWriterSemaphore);
+	if (fLogWriter >= 0) {
+		status_t result;
+		wait_for_thread(fLogWriter, &result);
+	}
+
 	FlushLogAndBlocks();
 
 	recursive_lock_destroy(&fLock);
@@ -691,6 +712,23 @@ Journal::_TransactionIdle(int32 transactionID, int32 event, void* _journal)
 }
 
 
+/*!	The log writer thread: writes the current transaction to the log
+	whenever _TransactionDone() found it large enough, so that the thread
+	that completed it does not have to wait for the log write.
+*/
+/*static*/ status_t
+Journal::_LogWriter(void* _journal)
+{
+	Journal* journal = (Journal*)_journal;
+
+	while (acquire_sem(journal->fLogWriterSemaphore) == B_OK) {
+		journal->_FlushLog(true, false);
+	}
+
+	return B_OK;
+}
+
+
 /*!	Writes the blocks that are part of current transaction into the log,
 	and ends the current transaction.
 	If the current transaction is too large to fit into the log, it will
@@ -721,6 +759,7 @@ Journal::_WriteTransactionToLog()
 	}
 
 	fHasSubtransaction = false;
+	fLogWriteRequested = false;
 
 	int32 blockShift = fVolume->BlockShift();
 	off_t logOffset = fVolume->ToBlock(fVolume->Log()) << blockShift;
@@ -750,10 +789,12 @@ Journal::_WriteTransactionToLog()
 			fTransactionID = cache_detach_sub_transaction(fVolume->BlockCache(),
 				fTransactionID, NULL, NULL);
 			fUnwrittenTransactions = 1;
+			atomic_set64(&fLoggedSequence, fSequence - 1);
 		} else {
 			cache_end_transaction(fVolume->BlockCache(), fTransactionID, NULL,
 				NULL);
 			fUnwrittenTransactions = 0;
+			atomic_set64(&fLoggedSequence, fSequence);
 		}
 		return B_OK;
 	}
@@ -881,6 +922,8 @@ Journal::_WriteTransactionToLog()
 		fTransactionID = cache_detach_sub_transaction(fVolume->BlockCache(),
 			fTransactionID, _TransactionWritten, logEntry);
 		fUnwrittenTransactions = 1;
+		atomic_set64(&fLoggedSequence, fSequence - 1);
+			// the detached sub-transaction is always the last one
 
 		if (status == B_OK && _TransactionSize() > fLogSize) {
 			// If the transaction is too large after writing, there is no way to
@@ -893,6 +936,7 @@ Journal::_WriteTransactionToLog()
 		cache_end_transaction(fVolume->BlockCache(), fTransactionID,
 			_TransactionWritten, logEntry);
 		fUnwrittenTransactions = 0;
+		atomic_set64(&fLoggedSequence, fSequence);
 	}
 
 	return status;
@@ -942,6 +986,47 @@ Journal::FlushLogAndBlocks()
 }
 
 
+/*!	Makes sure the transaction with the given sequence number (as returned
+	by TransactionSequence() after it was done) is in the log.
+	All other transactions that have been batched together with it are
+	written in the same log entry, so that concurrent callers usually find
+	their transaction already written once they got the lock. Unlike
+	FlushLogAndBlocks(), this neither writes back any blocks, nor flushes
+	the device.
+*/
+status_t
+Journal::FlushTransaction(int64 sequence)
+{
+	if (sequence <= atomic_get64(&fLoggedSequence))
+		return B_OK;
+
+	status_t status = recursive_lock_lock(&fLock);
+	if (status != B_OK)
+		return status;
+
+	if (recursive_lock_get_recursion(&fLock) > 1) {
+		// we cannot end the transaction we're part of
+		recursive_lock_unlock(&fLock);
+		return B_OK;
+	}
+
+	// If the current sub-transaction had to be detached, it still needs to
+	// be written in a log entry of its own
+	while (sequence > fLoggedSequence && fUnwrittenTransactions != 0
+		&& _TransactionSize() != 0) {
+		status = _WriteTransactionToLog();
+		if (status != B_OK) {
+			FATAL(("writing current log entry failed: %s\n",
+				strerror(status)));
+			break;
+		}
+	}
+
+	recursive_lock_unlock(&fLock);
+	return status;
+}
+
+
 status_t
 Journal::Lock(Transaction* owner, bool separateSubTransactions)
 {
@@ -1051,21 +1136,32 @@ Journal::_TransactionDone(bool success)
 		} else {
 			cache_abort_transaction(fVolume->BlockCache(), fTransactionID);
 			fUnwrittenTransactions = 0;
+			fLogWriteRequested = false;
 		}
 
 		return B_OK;
 	}
 
+	fSequence++;
+
 	// Up to a maximum size, we will just batch several
-	// transactions together to improve speed
+	// transactions together to improve speed. Beyond that, the log writer
+	// will write them out in the background, unless the transaction grows
+	// too large while it is waiting for us to release the lock.
 	uint32 size = _TransactionSize();
-	if (size < fMaxTransactionSize) {
+	if (size < fMaxTransactionSize
+		|| (fLogWriter >= 0 && size < fLogSize / 4 * 3)) {
 		// Flush the log from time to time, so that we have enough space
 		// for this transaction
 		if (size > FreeLogBlocks())
 			cache_sync_transaction(fVolume->BlockCache(), fTransactionID);
 
 		fUnwrittenTransactions++;
+
+		if (size >= fMaxTransactionSize && !fLogWriteRequested) {
+			fLogWriteRequested = true;
+			release_sem_etc(fLogWriterSemaphore, 1, B_DO_NOT_RESCHEDULE);
+		}
 		return B_OK;
 	}
 
@@ -1092,6 +1188,9 @@ Journal::Dump()
 	kprintf("  unwritten:            %ld\n", fUnwrittenTransactions);
 	kprintf("  timestamp:            %lld\n", fTimestamp);
 	kprintf("  transaction ID:       %ld\n", fTransactionID);
+	kprintf("  sequence:             %lld (logged %lld)\n", fSequence,
+		fLoggedSequence);
+	kprintf("  log writer:           %ld\n", fLogWriter);
 	kprintf("  has subtransaction:   %d\n", fHasSubtransaction);
 	kprintf("  separate sub-trans.:  %d\n", fSeparateSubTransactions);
 	kprintf("entries:\n");
@@ -36,8 +36,10 @@ public:
 			bool			CurrentTransactionTooLarge() const;
 
 			status_t		FlushLogAndBlocks();
+			status_t		FlushTransaction(int64 sequence);
 			Volume*			GetVolume() const { return fVolume; }
 			int32			TransactionID() const { return fTransactionID; }
+			int64			TransactionSequence() const { return fSequence; }
 
 	inline	uint32			FreeLogBlocks() const;
 
@@ -60,6 +62,7 @@ private:
 								int32 event, void* _logEntry);
 	static	void			_TransactionIdle(int32 transactionID, int32 event,
 								void* _journal);
+	static	status_t		_LogWriter(void* _journal);
 
 			Volume*			fVolume;
 			recursive_lock	fLock;
@@ -72,6 +75,11 @@ private:
 			LogEntryList	fEntries;
 			bigtime_t		fTimestamp;
 			int32			fTransactionID;
+			int64			fSequence;
+			int64			fLoggedSequence;
+			sem_id			fLogWriterSemaphore;
+			thread_id		fLogWriter;
+			bool			fLogWriteRequested;
 			bool			fHasSubtransaction;
 			bool			fSeparateSubTransactions;
 };
@@ -79,6 +79,20 @@ union value {
 	char	String[INODE_FILE_NAME_LENGTH];
 };
 
+// The query planner reads at most this many entries from the index of an
+// equation to find out how many nodes it will yield. If the range of the
+// equation ends before that, the count is exact, and the matching nodes are
+// remembered, so that the equation can later be checked without reading any
+// attributes.
+static const int32 kMaxProbeEntries = 256;
+
+// rough size of an index entry, used to estimate the number of entries of an
+// index from its size
+static const off_t kAverageIndexEntrySize = 32;
+
+// the estimate for equations that cannot be used to iterate over the result
+static const off_t kUnusableEntries = (off_t)1 << 60;
+
 
 /*!	Abstract base class for the operator/equation classes.
 */
@@ -97,8 +111,10 @@ public:
 							size_t size = 0) = 0;
 	virtual	void		Complement() = 0;
 
-	virtual	void		CalculateScore(Index& index) = 0;
-	virtual	int32		Score() const = 0;
+	virtual	void		EstimateEntries(Volume* volume, Index& index,
+							bool queryNonIndexed) = 0;
+	virtual	off_t		EstimatedEntries() const = 0;
+	virtual	int32		MatchCost() const = 0;
 
 	virtual	status_t	InitCheck() = 0;
 
@@ -141,10 +157,15 @@ public:
 			status_t	PrepareQuery(Volume* volume, Index& index,
 							TreeIterator** iterator, bool queryNonIndexed);
 			status_t	GetNextMatching(Volume* volume, TreeIterator* iterator,
-							struct dirent* dirent, size_t bufferSize);
+							struct dirent* dirent, size_t bufferSize,
+							Equation** previous, int32 previousCount);
+			status_t	MatchContext(Inode* inode);
 
-	virtual	void		CalculateScore(Index &index);
-	virtual	int32		Score() const { return fScore; }
+	virtual	void		EstimateEntries(Volume* volume, Index& index,
+							bool queryNonIndexed);
+	virtual	off_t		EstimatedEntries() const
+							{ return fEstimatedEntries; }
+	virtual	int32		MatchCost() const;
 
 #ifdef DEBUG
 	virtual	void		PrintToStream();
@@ -159,6 +180,7 @@ private:
 			bool		CompareTo(const uint8* value, uint16 size);
 			uint8*		Value() const { return (uint8*)&fValue; }
 			status_t	MatchEmptyString();
+			bool		IsKnownMatch(off_t id) const;
 
 			char*		fAttribute;
 			char*		fString;
@@ -168,8 +190,12 @@ private:
 			bool		fIsPattern;
 			bool		fIsSpecialTime;
 
-			int32		fScore;
 			bool		fHasIndex;
+
+			off_t		fEstimatedEntries;
+			off_t*		fMatches;
+			int32		fMatchCount;
+				// sorted IDs of all matching nodes, if known
 };
 
 
@@ -189,8 +215,10 @@ public:
 							size_t size = 0);
 	virtual	void		Complement();
 
-	virtual	void		CalculateScore(Index& index);
-	virtual	int32		Score() const;
+	virtual	void		EstimateEntries(Volume* volume, Index& index,
+							bool queryNonIndexed);
+	virtual	off_t		EstimatedEntries() const;
+	virtual	int32		MatchCost() const;
 
 	virtual	status_t	InitCheck();
 
@@ -475,7 +503,11 @@ Equation::Equation(char** expr)
 	fAttribute(NULL),
 	fString(NULL),
 	fType(0),
-	fIsPattern(false)
+	fIsPattern(false),
+	fHasIndex(false),
+	fEstimatedEntries(0),
+	fMatches(NULL),
+	fMatchCount(0)
 {
 	char* string = *expr;
 	char* start = string;
@@ -609,6 +641,7 @@ Equation::~Equation()
 {
 	free(fAttribute);
 	free(fString);
+	free(fMatches);
 }
 
 
@@ -794,7 +827,7 @@ Equation::MatchEmptyString()
 
 	status_t status = ConvertValue(B_STRING_TYPE);
 	if (status == B_OK)
-		status = CompareTo((const uint8*)"", fSize) ? MATCH_OK : NO_MATCH;
+		status = CompareTo((const uint8*)"", 0) ? MATCH_OK : NO_MATCH;
 
 	return status;
 }
@@ -808,6 +841,12 @@ status_t
 Equation::Match(Inode* inode, const char* attributeName, int32 type,
 	const uint8* key, size_t size)
 {
+	// if the index already told us which nodes match when the current pass
+	// was planned, we don't need to look at the attribute at all (but live
+	// queries need the current value)
+	if (attributeName == NULL && fMatches != NULL)
+		return IsKnownMatch(inode->ID()) ? MATCH_OK : NO_MATCH;
+
 	// get a pointer to the attribute in question
 	NodeGetter nodeGetter(inode->GetVolume());
 	union value value;
@@ -901,37 +940,158 @@ Equation::Match(Inode* inode, const char* attributeName, int32 type,
 }
 
 
+/*!	Estimates how many index entries this equation will yield when it is used
+	to iterate over the query result, and therefore how useful it is to do
+	so. The fewer entries, the better.
+
+	The estimate is exact if the range of the equation in its index is
+	small; in this case the IDs of all matching nodes are kept, too, so that
+	Match() won't have to read the attribute during this pass of the query.
+	Otherwise, the estimate is derived from the size of the index and the
+	operator.
+	This is called again on every Query::Rewind(), so that the IDs are never
+	older than the current pass.
+*/
 void
-Equation::CalculateScore(Index &index)
+Equation::EstimateEntries(Volume* volume, Index& index, bool queryNonIndexed)
 {
-	// As always, these values could be tuned and refined.
-	// And the code could also need some real world testing :-)
+	free(fMatches);
+	fMatches = NULL;
+	fMatchCount = 0;
+
+	TreeIterator* iterator = NULL;
+	status_t status = PrepareQuery(volume, index, &iterator, queryNonIndexed);
+	if (iterator == NULL) {
+		// this equation cannot be used to iterate at all
+		fEstimatedEntries = kUnusableEntries;
+		return;
+	}
+	ObjectDeleter<TreeIterator> iteratorDeleter(iterator);
+
+	off_t indexEntries = index.Node()->Size() / kAverageIndexEntrySize;
+	if (!fHasIndex) {
+		// we will have to iterate over all nodes
+		fEstimatedEntries = indexEntries;
+		return;
+	}
 
-	// do we have to operate on a "foreign" index?
-	if (fOp == OP_UNEQUAL || index.SetTo(fAttribute) < B_OK) {
-		fScore = 0;
+	if (status == B_ENTRY_NOT_FOUND && fOp == OP_EQUAL && !fIsPattern) {
+		// the value is not in the index
+		fEstimatedEntries = 0;
 		return;
 	}
 
-	// if we have a pattern, how much does it help our search?
-	if (fIsPattern)
-		fScore = getFirstPatternSymbol(fString) << 3;
-	else {
-		// Score by operator
-		if (fOp == OP_EQUAL)
-			// higher than pattern="255 chars+*"
-			fScore = 2048;
+	// Walk over the start of the range to see how many entries it contains
+
+	off_t* matches = (off_t*)malloc(kMaxProbeEntries * sizeof(off_t));
+	int32 matchCount = 0;
+	bool exact = false;
+
+	for (int32 i = 0; status == B_OK && i < kMaxProbeEntries; i++) {
+		union value indexValue;
+		uint16 keyLength;
+		uint16 duplicate;
+		off_t offset;
+
+		status = iterator->GetNextEntry(&indexValue, &keyLength,
+			(uint16)sizeof(indexValue), &offset, &duplicate);
+		if (status != B_OK) {
+			exact = status == B_ENTRY_NOT_FOUND;
+			break;
+		}
+
+		// the same checks as in GetNextMatching()
+		if (duplicate < 2 && !CompareTo((uint8*)&indexValue, keyLength)) {
+			if (fOp == OP_LESS_THAN
+				|| fOp == OP_LESS_THAN_OR_EQUAL
+				|| (fOp == OP_EQUAL && !fIsPattern)) {
+				exact = true;
+				break;
+			}
+
+			if (duplicate > 0)
+				iterator->SkipDuplicates();
+			continue;
+		}
+
+		if (matches != NULL)
+			matches[matchCount] = offset;
+		matchCount++;
+	}
+
+	if (!exact) {
+		off_t estimate = indexEntries;
+		if (fOp == OP_EQUAL && !fIsPattern)
+			estimate /= 16;
+		else if (fIsPattern && getFirstPatternSymbol(fString) > 0)
+			estimate /= 4;
+		else if (!fIsPattern)
+			estimate /= 2;
+
+		fEstimatedEntries = max_c(estimate, kMaxProbeEntries + 1);
+		free(matches);
+		return;
+	}
+
+	fEstimatedEntries = matchCount;
+
+	// Nodes without the attribute are not in the index, but they could still
+	// match an empty string; we can't use the index alone to check those.
+	if (matches == NULL || matchCount == 0 || MatchEmptyString() == MATCH_OK) {
+		free(matches);
+		return;
+	}
+
+	// sort the IDs, so that we can look them up quickly
+	for (int32 i = 1; i < matchCount; i++) {
+		off_t id = matches[i];
+		int32 j = i;
+		for (; j > 0 && matches[j - 1] > id; j--)
+			matches[j] = matches[j - 1];
+		matches[j] = id;
+	}
+
+	fMatches = matches;
+	fMatchCount = matchCount;
+}
+
+
+/*!	Returns the relative cost of Match(). Equations on the attributes that
+	are part of the inode itself are cheap, the ones that have to look up or
+	even read an attribute are not.
+*/
+int32
+Equation::MatchCost() const
+{
+	if (fMatches != NULL)
+		return 0;
+
+	if (!strcmp(fAttribute, "name") || !strcmp(fAttribute, "size")
+		|| !strcmp(fAttribute, "last_modified"))
+		return 1;
+
+	return 2;
+}
+
+
+bool
+Equation::IsKnownMatch(off_t id) const
+{
+	int32 first = 0;
+	int32 last = fMatchCount - 1;
+
+	while (first <= last) {
+		int32 middle = (first + last) / 2;
+		if (fMatches[middle] == id)
+			return true;
+
+		if (fMatches[middle] < id)
+			first = middle + 1;
 		else
-			// the pattern search is regarded cheaper when you have at
-			// least one character to set your index to
-			fScore = 5;
+			last = middle - 1;
 	}
 
-	// take index size into account (1024 is the current node size
-	// in our B+trees)
-	// 2048 * 2048 == 4194304 is the maximum score (for an empty
-	// tree, since the header + 1 node are already 2048 bytes)
-	fScore = fScore * ((2048 * 1024LL) / index.Node()->Size());
+	return false;
 }
 
 
@@ -1032,9 +1192,15 @@ Equation::PrepareQuery(Volume* /*volume*/, Index& index,
 }
 
 
+/*!	Returns the next node from \a iterator that matches the whole query.
+	\a previous are the equations that have already been used to iterate
+	over the result of this query; nodes that have already been returned
+	through one of them are skipped.
+*/
 status_t
 Equation::GetNextMatching(Volume* volume, TreeIterator* iterator,
-	struct dirent* dirent, size_t bufferSize)
+	struct dirent* dirent, size_t bufferSize, Equation** previous,
+	int32 previousCount)
 {
 	while (true) {
 		union value indexValue;
@@ -1084,38 +1250,20 @@ Equation::GetNextMatching(Volume* volume, TreeIterator* iterator,
 		// query will do something similar (and we don't have
 		// to do it for root, either).
 
-		// go up in the tree until a &&-operator is found, and check if the
-		// inode matches with the rest of the expression - we don't have to
-		// check ||-operators for that
-		Term* term = this;
+		// check if the inode matches with the rest of the expression
 		status = MATCH_OK;
 
 		if (!fHasIndex)
 			status = Match(inode);
-
-		while (term != NULL && status == MATCH_OK) {
-			Operator* parent = (Operator*)term->Parent();
-			if (parent == NULL)
-				break;
-
-			if (parent->Op() == OP_AND) {
-				// choose the other child of the parent
-				Term* other = parent->Right();
-				if (other == term)
-					other = parent->Left();
-
-				if (other == NULL) {
-					FATAL(("&&-operator has only one child... (parent = %p)\n",
-						parent));
-					break;
-				}
-				status = other->Match(inode);
-				if (status < 0) {
-					REPORT_ERROR(status);
-					status = NO_MATCH;
-				}
-			}
-			term = (Term*)parent;
+		if (status == MATCH_OK)
+			status = MatchContext(inode);
+
+		// if this query is the union of several index ranges, the node
+		// might have been part of an earlier one already
+		for (int32 i = 0; i < previousCount && status == MATCH_OK; i++) {
+			if (previous[i]->Match(inode) == MATCH_OK
+				&& previous[i]->MatchContext(inode) == MATCH_OK)
+				status = NO_MATCH;
 		}
 
 		if (status == MATCH_OK) {
@@ -1139,6 +1287,60 @@ Equation::GetNextMatching(Volume* volume, TreeIterator* iterator,
 }
 
 
+/*!	Checks whether \a inode matches all terms that are combined with this
+	equation via &&-operators -- ||-operators don't need to be checked, as
+	this equation already matches. The cheapest terms are checked first.
+*/
+status_t
+Equation::MatchContext(Inode* inode)
+{
+	Term* others[16];
+	int32 count = 0;
+
+	// go up in the tree and collect the other child of every &&-operator
+	for (Term* term = this; term->Parent() != NULL; term = term->Parent()) {
+		Operator* parent = (Operator*)term->Parent();
+		if (parent->Op() != OP_AND)
+			continue;
+
+		Term* other = parent->Right();
+		if (other == term)
+			other = parent->Left();
+
+		if (count < (int32)(sizeof(others) / sizeof(others[0]))) {
+			// keep them sorted by cost
+			int32 index = count++;
+			for (; index > 0
+					&& others[index - 1]->MatchCost() > other->MatchCost();
+					index--) {
+				others[index] = others[index - 1];
+			}
+			others[index] = other;
+			continue;
+		}
+
+		// too deeply nested, just check it right away
+		status_t status = other->Match(inode);
+		if (status != MATCH_OK) {
+			if (status < 0)
+				REPORT_ERROR(status);
+			return NO_MATCH;
+		}
+	}
+
+	for (int32 i = 0; i < count; i++) {
+		status_t status = others[i]->Match(inode);
+		if (status != MATCH_OK) {
+			if (status < 0)
+				REPORT_ERROR(status);
+			return NO_MATCH;
+		}
+	}
+
+	return MATCH_OK;
+}
+
+
 //	#pragma mark -
 
 
@@ -1165,30 +1367,19 @@ status_t
 Operator::Match(Inode* inode, const char* attribute, int32 type,
 	const uint8* key, size_t size)
 {
-	if (fOp == OP_AND) {
-		status_t status = fLeft->Match(inode, attribute, type, key, size);
-		if (status != MATCH_OK)
-			return status;
-
-		return fRight->Match(inode, attribute, type, key, size);
-	} else {
-		// choose the term with the better score for OP_OR
-		Term* first;
-		Term* second;
-		if (fRight->Score() > fLeft->Score()) {
-			first = fLeft;
-			second = fRight;
-		} else {
-			first = fRight;
-			second = fLeft;
-		}
+	// check the cheaper term first
+	Term* first = fLeft;
+	Term* second = fRight;
+	if (fRight->MatchCost() < fLeft->MatchCost()) {
+		first = fRight;
+		second = fLeft;
+	}
 
-		status_t status = first->Match(inode, attribute, type, key, size);
-		if (status != NO_MATCH)
-			return status;
+	status_t status = first->Match(inode, attribute, type, key, size);
+	if (fOp == OP_AND ? status != MATCH_OK : status != NO_MATCH)
+		return status;
 
-		return second->Match(inode, attribute, type, key, size);
-	}
+	return second->Match(inode, attribute, type, key, size);
 }
 
 
@@ -1206,29 +1397,32 @@ Operator::Complement()
 
 
 void
-Operator::CalculateScore(Index &index)
+Operator::EstimateEntries(Volume* volume, Index& index, bool queryNonIndexed)
 {
-	fLeft->CalculateScore(index);
-	fRight->CalculateScore(index);
+	fLeft->EstimateEntries(volume, index, queryNonIndexed);
+	fRight->EstimateEntries(volume, index, queryNonIndexed);
 }
 
 
-int32
-Operator::Score() const
+off_t
+Operator::EstimatedEntries() const
 {
-	if (fOp == OP_AND) {
-		// return the one with the better score
-		if (fRight->Score() > fLeft->Score())
-			return fRight->Score();
+	off_t left = fLeft->EstimatedEntries();
+	off_t right = fRight->EstimatedEntries();
 
-		return fLeft->Score();
-	}
+	// for OP_AND, we only need to iterate over the smaller one
+	if (fOp == OP_AND)
+		return min_c(left, right);
+
+	// for OP_OR, we have to iterate over both
+	return min_c(left + right, kUnusableEntries);
+}
 
-	// for OP_OR, be honest, and return the one with the worse score
-	if (fRight->Score() < fLeft->Score())
-		return fRight->Score();
 
-	return fLeft->Score();
+int32
+Operator::MatchCost() const
+{
+	return fLeft->MatchCost() + fRight->MatchCost();
 }
 
 
@@ -1494,10 +1688,6 @@ Query::Query(Volume* volume, Expression* expression, uint32 flags)
 	if (volume == NULL || expression == NULL || expression->Root() == NULL)
 		return;
 
-	// create index on the stack and delete it afterwards
-	fExpression->Root()->CalculateScore(fIndex);
-	fIndex.Unset();
-
 	Rewind();
 
 	if ((fFlags & B_LIVE_QUERY) != 0)
@@ -1518,11 +1708,18 @@ Query::Rewind()
 	// free previous stuff
 
 	fStack.MakeEmpty();
+	fPrevious.MakeEmpty();
 
 	delete fIterator;
 	fIterator = NULL;
 	fCurrent = NULL;
 
+	// (re-)plan the query, as the indices may have changed since the last
+	// pass, and release the index afterwards
+	fExpression->Root()->EstimateEntries(fVolume, fIndex,
+		(fFlags & B_QUERY_NON_INDEXED) != 0);
+	fIndex.Unset();
+
 	// put the whole expression on the stack
 
 	Stack<Term*> stack;
@@ -1537,9 +1734,10 @@ Query::Rewind()
 				stack.Push(op->Left());
 				stack.Push(op->Right());
 			} else {
-				// For OP_AND, we can use the scoring system to decide which
-				// path to add
-				if (op->Right()->Score() > op->Left()->Score())
+				// For OP_AND, we only need to iterate over the side that is
+				// expected to yield fewer entries
+				if (op->Right()->EstimatedEntries()
+						< op->Left()->EstimatedEntries())
 					stack.Push(op->Right());
 				else
 					stack.Push(op->Left());
@@ -1578,8 +1776,12 @@ Query::GetNextEntry(struct dirent* dirent, size_t size)
 			RETURN_ERROR(B_ERROR);
 
 		status_t status = fCurrent->GetNextMatching(fVolume, fIterator, dirent,
-			size);
+			size, fPrevious.Array(), fPrevious.CountItems());
 		if (status != B_OK) {
+			// Remember the equation, so that its results are not returned
+			// again by the next one
+			fPrevious.Push(fCurrent);
+
 			delete fIterator;
 			fIterator = NULL;
 			fCurrent = NULL;
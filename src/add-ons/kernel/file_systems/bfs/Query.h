@@ -70,6 +70,7 @@ private:
 			TreeIterator*	fIterator;
 			Index			fIndex;
 			Stack<Equation*> fStack;
+			Stack<Equation*> fPrevious;
 
 			uint32			fFlags;
 			port_id			fPort;
@@ -29,6 +29,59 @@ struct update_boot_block {
 	uint32			length;
 };
 
+/* ioctl to add existing nodes to an index, using the current value of
+ * their attribute - parameter is a struct reindex_control.
+ * Nodes without that attribute, or that are already part of the index
+ * are skipped.
+ */
+#define BFS_IOCTL_REINDEX			14205
+
+#define BFS_MAX_REINDEX_NODES		4096
+
+struct reindex_control {
+	char			index[B_FILE_NAME_LENGTH];
+	const ino_t*	nodes;
+	uint32			count;
+	uint32			inserted;
+};
+
+/* ioctl to retrieve statistics about the fragmentation of the free space
+ * of a volume - parameter is a struct fragmentation_info.
+ * Free extents are counted per allocation group.
+ */
+#define BFS_IOCTL_FRAGMENTATION_INFO	14206
+
+#define BFS_FREE_EXTENT_BUCKETS		17
+
+struct fragmentation_info {
+	uint64			free_blocks;
+	uint64			free_extents;
+	uint64			largest_free_extent;
+	uint64			extents_by_size[BFS_FREE_EXTENT_BUCKETS];
+		/* number of free extents with a length between 2^i and 2^(i+1) - 1
+		 * blocks */
+	uint32			allocation_groups;
+	uint32			indexed_groups;
+		/* groups whose free extents are known to the allocator without
+		 * scanning its bitmap */
+};
+
+/* ioctl to move the data of a file into as few contiguous runs as
+ * possible - it must be issued on the file itself, and its parameter is a
+ * struct defragment_control.
+ * With BFS_DEFRAGMENT_COUNT_ONLY set, the file is not changed, and only
+ * its number of runs is reported.
+ */
+#define BFS_IOCTL_DEFRAGMENT		14207
+
+#define BFS_DEFRAGMENT_COUNT_ONLY	1
+
+struct defragment_control {
+	uint32			flags;
+	uint32			runs_before;
+	uint32			runs_after;
+};
+
 /* ioctls to use the "chkbfs" feature from the outside
  * all calls use a struct check_result as single parameter
  */
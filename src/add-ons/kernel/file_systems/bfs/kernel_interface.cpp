@@ -584,6 +584,8 @@ bfs_lookup(fs_volume* _volume, fs_vnode* _directory, const char* file,
 	status = tree->Find((uint8*)file, (uint16)strlen(file), _vnodeID);
 	if (status != B_OK) {
 		//PRINT(("bfs_walk() could not find %Ld:\"%s\": %s\n", directory->BlockNumber(), file, strerror(status)));
+		if (status == B_ENTRY_NOT_FOUND)
+			entry_cache_add_missing(volume->ID(), directory->ID(), file);
 		return status;
 	}
 
@@ -689,6 +691,97 @@ bfs_ioctl(fs_volume* _volume, fs_vnode* _node, void* _cookie, uint32 cmd,
 
 			return volume->WriteSuperBlock();
 		}
+		case BFS_IOCTL_REINDEX:
+		{
+			if (volume->IsReadOnly())
+				return B_READ_ONLY_DEVICE;
+
+			// only root users are allowed to rewrite index entries
+			if (geteuid() != 0)
+				return B_NOT_ALLOWED;
+
+			reindex_control control;
+			if (bufferLength != sizeof(reindex_control))
+				return B_BAD_VALUE;
+			if (user_memcpy(&control, buffer, sizeof(reindex_control)) != B_OK)
+				return B_BAD_ADDRESS;
+			if (control.count == 0 || control.count > BFS_MAX_REINDEX_NODES)
+				return B_BAD_VALUE;
+
+			control.index[B_FILE_NAME_LENGTH - 1] = '\0';
+
+			ino_t* nodes = (ino_t*)malloc(control.count * sizeof(ino_t));
+			if (nodes == NULL)
+				return B_NO_MEMORY;
+
+			MemoryDeleter nodesDeleter(nodes);
+			if (user_memcpy(nodes, control.nodes,
+					control.count * sizeof(ino_t)) != B_OK)
+				return B_BAD_ADDRESS;
+
+			Index index(volume);
+			status_t status = index.SetTo(control.index);
+			if (status == B_OK) {
+				status = index.InsertNodes(nodes, control.count,
+					&control.inserted);
+			}
+			if (status == B_OK)
+				status = user_memcpy(buffer, &control, sizeof(reindex_control));
+
+			return status;
+		}
+		case BFS_IOCTL_FRAGMENTATION_INFO:
+		{
+			fragmentation_info info;
+			if (bufferLength != sizeof(fragmentation_info))
+				return B_BAD_VALUE;
+
+			status_t status = volume->Allocator().GetFragmentationInfo(info);
+			if (status == B_OK)
+				status = user_memcpy(buffer, &info, sizeof(fragmentation_info));
+
+			return status;
+		}
+		case BFS_IOCTL_DEFRAGMENT:
+		{
+			Inode* inode = (Inode*)_node->private_node;
+
+			defragment_control control;
+			if (bufferLength != sizeof(defragment_control))
+				return B_BAD_VALUE;
+			if (user_memcpy(&control, buffer, sizeof(defragment_control))
+					!= B_OK)
+				return B_BAD_ADDRESS;
+
+			status_t status;
+			if ((control.flags & BFS_DEFRAGMENT_COUNT_ONLY) != 0) {
+				InodeReadLocker locker(inode);
+				status = inode->CountBlockRuns(control.runs_before);
+				control.runs_after = control.runs_before;
+			} else {
+				if (volume->IsReadOnly())
+					return B_READ_ONLY_DEVICE;
+
+				// moving the data of a file requires it to be open for
+				// writing, unless we're root
+				file_cookie* cookie = (file_cookie*)_cookie;
+				if (inode->IsFile() && geteuid() != 0
+					&& (cookie->open_mode & O_RWMASK) == O_RDONLY)
+					return B_NOT_ALLOWED;
+
+				Transaction transaction(volume, inode->BlockNumber());
+				status = inode->Defragment(transaction, control.runs_before,
+					control.runs_after);
+				if (status == B_OK)
+					status = transaction.Done();
+			}
+			if (status == B_OK) {
+				status = user_memcpy(buffer, &control,
+					sizeof(defragment_control));
+			}
+
+			return status;
+		}
 
 #ifdef DEBUG_FRAGMENTER
 		case 56741:
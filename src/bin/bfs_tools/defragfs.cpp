@@ -0,0 +1,273 @@
+/*
+ * Copyright 2013, Haiku Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+//!	Moves the data of fragmented files on a mounted BFS volume together
+
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <OS.h>
+
+#include "bfs_control.h"
+
+
+struct fragmented_file {
+	char*	path;
+	off_t	size;
+	uint32	runs;
+};
+
+
+extern const char* __progname;
+static const char* kProgramName = __progname;
+
+static bool sDryRun = false;
+static bool sVerbose = false;
+
+static fragmented_file* sFiles;
+static int32 sFileCount;
+static int32 sFileCapacity;
+
+
+static void
+add_file(const char* path, off_t size, uint32 runs)
+{
+	if (sFileCount == sFileCapacity) {
+		int32 capacity = sFileCapacity > 0 ? sFileCapacity * 2 : 256;
+		fragmented_file* files = (fragmented_file*)realloc(sFiles,
+			capacity * sizeof(fragmented_file));
+		if (files == NULL) {
+			fprintf(stderr, "%s: out of memory.\n", kProgramName);
+			exit(1);
+		}
+
+		sFiles = files;
+		sFileCapacity = capacity;
+	}
+
+	fragmented_file& file = sFiles[sFileCount];
+	file.path = strdup(path);
+	if (file.path == NULL) {
+		fprintf(stderr, "%s: out of memory.\n", kProgramName);
+		exit(1);
+	}
+	file.size = size;
+	file.runs = runs;
+	sFileCount++;
+}
+
+
+/*!	Sorts the files with the most fragments first; among those with the
+	same number of fragments, larger files come first.
+*/
+static int
+compare_files(const void* _a, const void* _b)
+{
+	const fragmented_file* a = (const fragmented_file*)_a;
+	const fragmented_file* b = (const fragmented_file*)_b;
+
+	if (a->runs != b->runs)
+		return a->runs > b->runs ? -1 : 1;
+	if (a->size != b->size)
+		return a->size > b->size ? -1 : 1;
+
+	return strcmp(a->path, b->path);
+}
+
+
+static void
+scan_file(const char* path, const struct stat& stat)
+{
+	int fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		fprintf(stderr, "%s: could not open \"%s\": %s\n", kProgramName,
+			path, strerror(errno));
+		return;
+	}
+
+	defragment_control control;
+	control.flags = BFS_DEFRAGMENT_COUNT_ONLY;
+
+	if (ioctl(fd, BFS_IOCTL_DEFRAGMENT, &control, sizeof(control)) != 0) {
+		fprintf(stderr, "%s: could not examine \"%s\": %s\n", kProgramName,
+			path, strerror(errno));
+	} else if (control.runs_before > 1)
+		add_file(path, stat.st_size, control.runs_before);
+
+	close(fd);
+}
+
+
+static void
+scan_directory(const char* path, dev_t device)
+{
+	DIR* dir = opendir(path);
+	if (dir == NULL) {
+		fprintf(stderr, "%s: could not open directory \"%s\": %s\n",
+			kProgramName, path, strerror(errno));
+		return;
+	}
+
+	while (struct dirent* entry = readdir(dir)) {
+		if (!strcmp(entry->d_name, ".") || !strcmp(entry->d_name, ".."))
+			continue;
+
+		char entryPath[B_PATH_NAME_LENGTH];
+		if (snprintf(entryPath, sizeof(entryPath), "%s/%s", path,
+				entry->d_name) >= (int)sizeof(entryPath)) {
+			fprintf(stderr, "%s: path too long: \"%s/%s\"\n", kProgramName,
+				path, entry->d_name);
+			continue;
+		}
+
+		struct stat stat;
+		if (lstat(entryPath, &stat) != 0 || stat.st_dev != device)
+			continue;
+
+		if (S_ISDIR(stat.st_mode))
+			scan_directory(entryPath, device);
+		else if (S_ISREG(stat.st_mode))
+			scan_file(entryPath, stat);
+	}
+
+	closedir(dir);
+}
+
+
+static bool
+is_bfs(const char* path)
+{
+	int fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return false;
+
+	uint32 version;
+	bool isBFS = ioctl(fd, BFS_IOCTL_VERSION, &version, sizeof(version)) == 0;
+
+	close(fd);
+	return isBFS;
+}
+
+
+static void
+defragment_files()
+{
+	uint32 moved = 0;
+	uint32 runsBefore = 0;
+	uint32 runsAfter = 0;
+
+	for (int32 i = 0; i < sFileCount; i++) {
+		fragmented_file& file = sFiles[i];
+
+		if (sDryRun) {
+			printf("%6" B_PRIu32 "  %s\n", file.runs, file.path);
+			continue;
+		}
+
+		int fd = open(file.path, O_RDWR);
+		if (fd < 0) {
+			fprintf(stderr, "%s: could not open \"%s\": %s\n", kProgramName,
+				file.path, strerror(errno));
+			continue;
+		}
+
+		defragment_control control;
+		control.flags = 0;
+
+		if (ioctl(fd, BFS_IOCTL_DEFRAGMENT, &control, sizeof(control)) != 0) {
+			if (errno != B_FILE_TOO_LARGE || sVerbose) {
+				fprintf(stderr, "%s: could not defragment \"%s\": %s\n",
+					kProgramName, file.path, strerror(errno));
+			}
+		} else {
+			if (control.runs_after < control.runs_before)
+				moved++;
+
+			runsBefore += control.runs_before;
+			runsAfter += control.runs_after;
+
+			if (sVerbose) {
+				printf("%s: %" B_PRIu32 " -> %" B_PRIu32 " fragments\n",
+					file.path, control.runs_before, control.runs_after);
+			}
+		}
+
+		close(fd);
+	}
+
+	if (!sDryRun) {
+		printf("%" B_PRIu32 " of %" B_PRId32 " fragmented files moved, %"
+			B_PRIu32 " fragments left of %" B_PRIu32 ".\n", moved, sFileCount,
+			runsAfter, runsBefore);
+	}
+}
+
+
+static void
+usage()
+{
+	fprintf(stderr, "usage: %s [-n] [-v] <directory> ...\n"
+		"Moves the data of fragmented files on BFS volumes together, most\n"
+		"fragmented files first. Only the volume each directory is on is\n"
+		"examined.\n"
+		"  -n\tonly lists the fragmented files with their number of "
+			"fragments\n"
+		"  -v\tverbose output\n", kProgramName);
+	exit(1);
+}
+
+
+int
+main(int argc, char** argv)
+{
+	int option;
+	while ((option = getopt(argc, argv, "nvh")) != -1) {
+		switch (option) {
+			case 'n':
+				sDryRun = true;
+				break;
+			case 'v':
+				sVerbose = true;
+				break;
+			default:
+				usage();
+		}
+	}
+
+	if (optind >= argc)
+		usage();
+
+	for (int i = optind; i < argc; i++) {
+		struct stat stat;
+		if (::stat(argv[i], &stat) != 0 || !S_ISDIR(stat.st_mode)) {
+			fprintf(stderr, "%s: \"%s\" is not a directory.\n", kProgramName,
+				argv[i]);
+			return 1;
+		}
+		if (!is_bfs(argv[i])) {
+			fprintf(stderr, "%s: \"%s\" is not on a BFS volume.\n",
+				kProgramName, argv[i]);
+			return 1;
+		}
+
+		scan_directory(argv[i], stat.st_dev);
+	}
+
+	qsort(sFiles, sFileCount, sizeof(fragmented_file), &compare_files);
+	defragment_files();
+
+	for (int32 i = 0; i < sFileCount; i++)
+		free(sFiles[i].path);
+	free(sFiles);
+
+	return 0;
+}
@@ -10,6 +10,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 #include <Directory.h>
 #include <Entry.h>
@@ -22,6 +23,8 @@
 #include <fs_index.h>
 #include <fs_info.h>
 
+#include "bfs_control.h"
+
 
 extern const char *__progname;
 static const char *kProgramName = __progname;
@@ -32,6 +35,20 @@ char *gAttrPattern;
 bool gIsPattern = false;
 bool gFromVolume = false;	// copy indices from another volume
 BList gAttrList;				// list of indices of that volume
+BList gBatches;				// nodes to be added to an index directly
+
+
+/*!	On volumes that support it, the attributes don't need to be rewritten
+	to get the nodes into an index; they are collected, and passed to the
+	file system in batches instead.
+*/
+struct IndexBatch {
+	char	name[B_ATTR_NAME_LENGTH];
+	dev_t	device;
+	int		fd;
+	uint32	count;
+	ino_t	nodes[BFS_MAX_REINDEX_NODES];
+};
 
 
 class Attribute {
@@ -162,6 +179,120 @@ isAttrInList(char *name)
 }
 
 
+void
+flushBatch(IndexBatch *batch)
+{
+	if (batch->count == 0)
+		return;
+
+	reindex_control control;
+	strlcpy(control.index, batch->name, sizeof(control.index));
+	control.nodes = batch->nodes;
+	control.count = batch->count;
+	control.inserted = 0;
+
+	if (ioctl(batch->fd, BFS_IOCTL_REINDEX, &control, sizeof(control)) != 0) {
+		fprintf(stderr, "%s: could not add %lu nodes to index \"%s\": %s\n",
+			kProgramName, batch->count, batch->name, strerror(errno));
+	} else if (gVerbose) {
+		printf("index '%s': added %lu of %lu nodes\n", batch->name,
+			control.inserted, batch->count);
+	}
+
+	batch->count = 0;
+}
+
+
+IndexBatch *
+findBatch(dev_t device, const char *name, BNode *node)
+{
+	IndexBatch *batch;
+	for (int32 i = 0; (batch = (IndexBatch *)gBatches.ItemAt(i)) != NULL;
+			i++) {
+		if (batch->device != device)
+			continue;
+		if (batch->fd < 0) {
+			// the volume doesn't support batches
+			return NULL;
+		}
+		if (!strcmp(batch->name, name))
+			return batch;
+	}
+
+	batch = new(std::nothrow) IndexBatch;
+	if (batch == NULL || !gBatches.AddItem(batch)) {
+		fprintf(stderr, "%s: out of memory.\n", kProgramName);
+		exit(1);
+	}
+
+	strlcpy(batch->name, name, sizeof(batch->name));
+	batch->device = device;
+	batch->count = 0;
+
+	// the file descriptor is only used to get to the volume
+	batch->fd = node->Dup();
+
+	uint32 version;
+	if (batch->fd >= 0 && ioctl(batch->fd, BFS_IOCTL_VERSION, &version,
+			sizeof(version)) != 0) {
+		close(batch->fd);
+		batch->fd = -1;
+	}
+
+	return batch->fd >= 0 ? batch : NULL;
+}
+
+
+/*!	Adds the node to the batch of its volume for the index \a name, creating
+	the index first if necessary. Returns false if that's not possible, and
+	the attribute needs to be rewritten instead.
+*/
+bool
+addToBatch(BNode *node, const char *name)
+{
+	// these are not attribute indices
+	if (!strcmp(name, "name") || !strcmp(name, "size")
+		|| !strcmp(name, "last_modified"))
+		return false;
+
+	struct stat stat;
+	if (node->GetStat(&stat) != B_OK)
+		return false;
+
+	index_info indexInfo;
+	if (fs_stat_index(stat.st_dev, name, &indexInfo) != B_OK) {
+		attr_info info;
+		if (gFromVolume || node->GetAttrInfo(name, &info) != B_OK
+			|| fs_create_index(stat.st_dev, name, info.type, 0) != 0)
+			return false;
+	}
+
+	IndexBatch *batch = findBatch(stat.st_dev, name, node);
+	if (batch == NULL)
+		return false;
+
+	batch->nodes[batch->count++] = stat.st_ino;
+	if (batch->count == BFS_MAX_REINDEX_NODES)
+		flushBatch(batch);
+
+	return true;
+}
+
+
+void
+flushBatches()
+{
+	IndexBatch *batch;
+	while ((batch = (IndexBatch *)gBatches.RemoveItem(0L)) != NULL) {
+		if (batch->fd >= 0) {
+			flushBatch(batch);
+			close(batch->fd);
+		}
+		delete batch;
+	}
+}
+
+
 void
 handleFile(BEntry *entry, BNode *node)
 {
@@ -204,6 +335,12 @@ handleFile(BEntry *entry, BNode *node)
 		} else if (!nameMatchesPattern(attrName))
 			continue;
 
+		if (addToBatch(node, attrName)) {
+			if (gVerbose)
+				printf("%s: queued attribute '%s'\n", name, attrName);
+			continue;
+		}
+
 		attr = new(std::nothrow) Attribute(attrName);
 		if (attr == NULL) {
 			fprintf(stderr, "%s: out of memory.\n", kProgramName);
@@ -358,5 +495,6 @@ main(int argc, char **argv)
 			fprintf(stderr, "%s: could not find \"%s\".\n", kProgramName, *argv);
 	}
 
+	flushBatches();
 	return 0;
 }
@@ -0,0 +1,269 @@
+/*
+ * Copyright 2013, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <OS.h>
+
+#include <scheduler_defs.h>
+#include <syscalls.h>
+
+
+static struct option const kLongOptions[] = {
+	{"periodic", no_argument, 0, 'p'},
+	{"rate", required_argument, 0, 'r'},
+	{"thread", required_argument, 0, 't'},
+	{"help", no_argument, 0, 'h'},
+	{NULL}
+};
+
+extern const char *__progname;
+static const char *kProgramName = __progname;
+
+
+void
+usage(int status)
+{
+	fprintf(stderr, "usage: %s [-p] [-r <time>] [-t <thread>]\n"
+		" -p,--periodic\tDumps changes periodically every second.\n"
+		" -r,--rate\tDumps changes periodically every <time> milli seconds.\n"
+		" -t,--thread\tDumps the statistics of the given thread instead of\n"
+		"\t\tthe ones of all CPUs.\n",
+		kProgramName);
+
+	exit(status);
+}
+
+
+static const char*
+bucket_name(int32 bucket, char* buffer, size_t size)
+{
+	if (bucket == 0)
+		snprintf(buffer, size, "< 1 us");
+	else if (bucket == SCHEDULER_LATENCY_BUCKETS - 1)
+		snprintf(buffer, size, ">= %lu us", 1UL << (bucket - 1));
+	else
+		snprintf(buffer, size, "< %lu us", 1UL << bucket);
+
+	return buffer;
+}
+
+
+template<typename Type>
+static void
+print_histogram(const Type* histogram)
+{
+	Type total = 0;
+	int32 last = -1;
+	for (int32 i = 0; i < SCHEDULER_LATENCY_BUCKETS; i++) {
+		total += histogram[i];
+		if (histogram[i] != 0)
+			last = i;
+	}
+
+	if (total == 0)
+		return;
+
+	for (int32 i = 0; i <= last; i++) {
+		char name[32];
+		int stars = (int)(histogram[i] * 50 / total);
+		printf("  %12s %12" B_PRIu64 " %5.1f%% %.*s\n",
+			bucket_name(i, name, sizeof(name)), (uint64)histogram[i],
+			100.0 * histogram[i] / total, stars,
+			"**************************************************");
+	}
+}
+
+
+static void
+print_cpu_stats(const scheduler_cpu_stats& stats)
+{
+	printf("CPU %" B_PRId32 ":\n", stats.cpu);
+	printf("  context switches:\t%" B_PRIu64 "\n", stats.context_switches);
+	printf("  migrations:\t\t%" B_PRIu64 "\n", stats.migrations);
+	printf("  wakeups:\t\t%" B_PRIu64 "\n", stats.wakeups);
+	if (stats.wakeups > 0) {
+		printf("  average latency:\t%" B_PRId64 " us\n",
+			stats.total_latency / (bigtime_t)stats.wakeups);
+	}
+	printf("  max latency:\t\t%" B_PRId64 " us\n", stats.max_latency);
+	if (stats.run_queue_samples > 0) {
+		printf("  average run queue:\t%.2f\n",
+			(double)stats.total_run_queue_length / stats.run_queue_samples);
+	}
+	printf("  max run queue:\t%" B_PRIu32 "\n", stats.max_run_queue_length);
+
+	print_histogram(stats.latency_histogram);
+}
+
+
+static void
+print_thread_stats(const scheduler_thread_stats& stats)
+{
+	printf("thread %" B_PRId32 ":\n", stats.thread);
+	printf("  migrations:\t\t%" B_PRIu64 "\n", stats.migrations);
+	printf("  wakeups:\t\t%" B_PRIu64 "\n", stats.wakeups);
+	if (stats.wakeups > 0) {
+		printf("  average latency:\t%" B_PRId64 " us\n",
+			stats.total_latency / (bigtime_t)stats.wakeups);
+	}
+	printf("  max latency:\t\t%" B_PRId64 " us\n", stats.max_latency);
+
+	print_histogram(stats.latency_histogram);
+}
+
+
+static void
+dump_thread(thread_id thread, bool periodically, bigtime_t rate)
+{
+	scheduler_thread_stats stats;
+	status_t status = _kern_get_scheduler_thread_stats(thread, &stats,
+		sizeof(stats));
+	if (status != B_OK) {
+		fprintf(stderr, "%s: cannot get statistics of thread %" B_PRId32
+			": %s\n", kProgramName, thread, strerror(status));
+		exit(1);
+	}
+
+	print_thread_stats(stats);
+
+	if (!periodically)
+		return;
+
+	puts("\nmigrations     wakeups  avg latency  max latency");
+	scheduler_thread_stats lastStats = stats;
+
+	while (true) {
+		snooze(rate);
+
+		if (_kern_get_scheduler_thread_stats(thread, &stats, sizeof(stats))
+				!= B_OK) {
+			break;
+		}
+
+		uint64 wakeups = stats.wakeups - lastStats.wakeups;
+		bigtime_t latency = stats.total_latency - lastStats.total_latency;
+
+		printf("%10" B_PRIu64 "  %10" B_PRIu64 "  %11" B_PRId64 "  %11"
+			B_PRId64 "\n", stats.migrations - lastStats.migrations, wakeups,
+			wakeups > 0 ? latency / (bigtime_t)wakeups : 0,
+			stats.max_latency);
+
+		lastStats = stats;
+	}
+}
+
+
+static void
+dump_cpus(bool periodically, bigtime_t rate)
+{
+	system_info info;
+	get_system_info(&info);
+
+	int32 cpuCount = info.cpu_count;
+	scheduler_cpu_stats stats[cpuCount];
+	scheduler_cpu_stats lastStats[cpuCount];
+
+	for (int32 i = 0; i < cpuCount; i++) {
+		status_t status = _kern_get_scheduler_cpu_stats(i, &stats[i],
+			sizeof(scheduler_cpu_stats));
+		if (status != B_OK) {
+			fprintf(stderr, "%s: cannot get statistics of CPU %" B_PRId32
+				": %s\n", kProgramName, i, strerror(status));
+			exit(1);
+		}
+
+		print_cpu_stats(stats[i]);
+	}
+
+	if (!periodically)
+		return;
+
+	puts("\ncpu    switches  migrations     wakeups  avg latency  avg queue");
+	memcpy(lastStats, stats, sizeof(stats));
+
+	while (true) {
+		snooze(rate);
+
+		for (int32 i = 0; i < cpuCount; i++) {
+			_kern_get_scheduler_cpu_stats(i, &stats[i],
+				sizeof(scheduler_cpu_stats));
+
+			const scheduler_cpu_stats& current = stats[i];
+			const scheduler_cpu_stats& last = lastStats[i];
+
+			uint64 wakeups = current.wakeups - last.wakeups;
+			bigtime_t latency = current.total_latency - last.total_latency;
+			uint64 samples = current.run_queue_samples
+				- last.run_queue_samples;
+			uint64 queueLength = current.total_run_queue_length
+				- last.total_run_queue_length;
+
+			printf("%3" B_PRId32 "  %10" B_PRIu64 "  %10" B_PRIu64 "  %10"
+				B_PRIu64 "  %11" B_PRId64 "  %9.2f\n", i,
+				current.context_switches - last.context_switches,
+				current.migrations - last.migrations, wakeups,
+				wakeups > 0 ? latency / (bigtime_t)wakeups : 0,
+				samples > 0 ? (double)queueLength / samples : 0.0);
+		}
+
+		memcpy(lastStats, stats, sizeof(stats));
+	}
+}
+
+
+int
+main(int argc, char** argv)
+{
+	bool periodically = false;
+	bigtime_t rate = 1000000LL;
+	thread_id thread = -1;
+
+	int c;
+	while ((c = getopt_long(argc, argv, "pr:t:h", kLongOptions, NULL))
+			!= -1) {
+		switch (c) {
+			case 0:
+				break;
+			case 'p':
+				periodically = true;
+				break;
+			case 'r':
+				rate = atoi(optarg) * 1000LL;
+				if (rate <= 0) {
+					fprintf(stderr, "%s: Invalid rate: %s\n",
+						kProgramName, optarg);
+					return 1;
+				}
+				periodically = true;
+				break;
+			case 't':
+				thread = strtol(optarg, NULL, 0);
+				if (thread <= 0) {
+					fprintf(stderr, "%s: Invalid thread: %s\n",
+						kProgramName, optarg);
+					return 1;
+				}
+				break;
+			case 'h':
+				usage(0);
+				break;
+			default:
+				usage(1);
+				break;
+		}
+	}
+
+	if (thread > 0)
+		dump_thread(thread, periodically, rate);
+	else
+		dump_cpus(periodically, rate);
+
+	return 0;
+}
@@ -0,0 +1,209 @@
+/*
+ * Copyright 2013, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <OS.h>
+
+#include <slab_defs.h>
+#include <syscalls.h>
+
+
+static struct option const kLongOptions[] = {
+	{"contention", no_argument, 0, 'c'},
+	{"verbose", no_argument, 0, 'v'},
+	{"help", no_argument, 0, 'h'},
+	{NULL}
+};
+
+extern const char *__progname;
+static const char *kProgramName = __progname;
+
+
+void
+usage(int status)
+{
+	fprintf(stderr, "usage: %s [-cv] [<name> ...]\n"
+		"Prints the statistics of the kernel's object caches, optionally only\n"
+		"of those whose name contains one of the given names.\n"
+		" -c,--contention\tSorts by lock contention instead of memory usage.\n"
+		" -v,--verbose\t\tPrints all statistics of each cache.\n",
+		kProgramName);
+
+	exit(status);
+}
+
+
+static uint64
+contention(const object_cache_stats& stats)
+{
+	return stats.depot_contention + stats.lock_contention;
+}
+
+
+static int
+compare_usage(const void* _a, const void* _b)
+{
+	const object_cache_stats* a = (const object_cache_stats*)_a;
+	const object_cache_stats* b = (const object_cache_stats*)_b;
+
+	if (a->usage == b->usage)
+		return strcmp(a->name, b->name);
+	return a->usage > b->usage ? -1 : 1;
+}
+
+
+static int
+compare_contention(const void* _a, const void* _b)
+{
+	const object_cache_stats* a = (const object_cache_stats*)_a;
+	const object_cache_stats* b = (const object_cache_stats*)_b;
+
+	if (contention(*a) == contention(*b))
+		return compare_usage(_a, _b);
+	return contention(*a) > contention(*b) ? -1 : 1;
+}
+
+
+static double
+hit_rate(const object_cache_stats& stats)
+{
+	uint64 total = stats.magazine_hits + stats.magazine_misses;
+	if (total == 0)
+		return 0.0;
+
+	return 100.0 * stats.magazine_hits / total;
+}
+
+
+static bool
+matches(const object_cache_stats& stats, int argc, char** argv)
+{
+	if (optind >= argc)
+		return true;
+
+	for (int i = optind; i < argc; i++) {
+		if (strstr(stats.name, argv[i]) != NULL)
+			return true;
+	}
+
+	return false;
+}
+
+
+static void
+print_stats(const object_cache_stats& stats)
+{
+	printf("%s:\n", stats.name);
+	printf("  object size:\t\t%lu\n", stats.object_size);
+	printf("  usage:\t\t%lu KB\n", stats.usage / 1024);
+	printf("  objects:\t\t%lu used, %lu total\n", stats.used_objects,
+		stats.total_objects);
+	printf("  flags:\t\t0x%" B_PRIx32 "\n", stats.flags);
+	printf("  slab allocations:\t%" B_PRIu64 "\n", stats.slab_allocations);
+	printf("  slabs created:\t%" B_PRIu64 "\n", stats.slabs_created);
+	printf("  lock contention:\t%" B_PRIu64 "\n", stats.lock_contention);
+
+	if (stats.magazine_capacity == 0)
+		return;
+
+	printf("  magazine capacity:\t%lu (resized %" B_PRIu32 " times)\n",
+		stats.magazine_capacity, stats.magazine_resizes);
+	printf("  depot magazines:\t%lu full, %lu empty\n", stats.full_magazines,
+		stats.empty_magazines);
+	printf("  magazine hits:\t%" B_PRIu64 " (%.1f%%)\n", stats.magazine_hits,
+		hit_rate(stats));
+	printf("  magazine misses:\t%" B_PRIu64 "\n", stats.magazine_misses);
+	printf("  magazine frees:\t%" B_PRIu64 "\n", stats.magazine_frees);
+	printf("  depot refills:\t%" B_PRIu64 "\n", stats.depot_refills);
+	printf("  depot exchanges:\t%" B_PRIu64 "\n", stats.depot_exchanges);
+	printf("  depot contention:\t%" B_PRIu64 "\n", stats.depot_contention);
+}
+
+
+int
+main(int argc, char** argv)
+{
+	bool sortByContention = false;
+	bool verbose = false;
+
+	int c;
+	while ((c = getopt_long(argc, argv, "cvh", kLongOptions, NULL)) != -1) {
+		switch (c) {
+			case 0:
+				break;
+			case 'c':
+				sortByContention = true;
+				break;
+			case 'v':
+				verbose = true;
+				break;
+			case 'h':
+				usage(0);
+				break;
+			default:
+				usage(1);
+				break;
+		}
+	}
+
+	object_cache_stats* stats = NULL;
+	int32 count = 0;
+
+	while (true) {
+		int32 maxCount = count;
+		status_t status = _kern_get_object_cache_stats(stats,
+			sizeof(object_cache_stats), &count);
+		if (status != B_OK) {
+			fprintf(stderr, "%s: cannot get object cache statistics: %s\n",
+				kProgramName, strerror(status));
+			return 1;
+		}
+
+		if (count <= maxCount)
+			break;
+
+		// leave some room for caches that are created in the meantime
+		count += 16;
+		free(stats);
+		stats = (object_cache_stats*)malloc(count * sizeof(object_cache_stats));
+		if (stats == NULL) {
+			fprintf(stderr, "%s: out of memory\n", kProgramName);
+			return 1;
+		}
+	}
+
+	qsort(stats, count, sizeof(object_cache_stats),
+		sortByContention ? &compare_contention : &compare_usage);
+
+	if (!verbose) {
+		printf("%-32s %7s %8s %9s %9s %4s %6s %9s %9s\n", "name", "objsize",
+			"usage KB", "used", "total", "mag", "hits", "refills",
+			"contended");
+	}
+
+	for (int32 i = 0; i < count; i++) {
+		if (!matches(stats[i], argc, argv))
+			continue;
+
+		if (verbose) {
+			print_stats(stats[i]);
+			continue;
+		}
+
+		printf("%-32s %7lu %8lu %9lu %9lu %4lu %5.1f%% %9" B_PRIu64 " %9"
+			B_PRIu64 "\n", stats[i].name, stats[i].object_size,
+			stats[i].usage / 1024, stats[i].used_objects,
+			stats[i].total_objects, stats[i].magazine_capacity,
+			hit_rate(stats[i]), stats[i].depot_refills, contention(stats[i]));
+	}
+
+	free(stats);
+	return 0;
+}
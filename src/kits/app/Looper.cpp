@@ -18,6 +18,7 @@
 #include <DirectMessageTarget.h>
 #include <LooperList.h>
 #include <MessagePrivate.h>
+#include <port_defs.h>
 #include <TokenSpace.h>
 
 #include <Autolock.h>
@@ -53,6 +54,10 @@ static BLocker sDebugPrintLocker("BLooper debug print");
 #define FILTER_LIST_BLOCK_SIZE	5
 #define DATA_BLOCK_SIZE			5
 
+// reading pending messages from the port in batches
+static const int32 kPendingMessageBatch = 16;
+static const size_t kPendingMessageBufferSize = 1024;
+
 
 using BPrivate::gDefaultTokens;
 using BPrivate::gLooperList;
@@ -148,6 +153,7 @@ BLooper::~BLooper()
 
 	fDirectTarget->Release();
 	delete_port(fMsgPort);
+	free(fPendingMessageBuffers);
 
 	// Clean up our filters
 	SetCommonFilterList(NULL);
@@ -942,6 +948,7 @@ BLooper::_InitData(const char *name, int32 priority, int32 portCapacity)
 	fTerminating = false;
 	fMsgPort = -1;
 	fAtomicCount = 0;
+	fPendingMessageBuffers = NULL;
 
 	if (name == NULL)
 		name = "anonymous looper";
@@ -1067,6 +1074,67 @@ BLooper::ReadMessageFromPort(bigtime_t timeout)
 }
 
 
+/*!	Moves the messages that are waiting in the looper's port to its message
+	queue without blocking. They are read in batches, ie. a single syscall
+	reads several of them, instead of the two that ReadMessageFromPort()
+	needs for each one. The buffers are allocated on first use, and are kept
+	for the lifetime of the looper.
+*/
+void
+BLooper::_DequeuePendingMessages()
+{
+	int32 count = port_count(fMsgPort);
+	if (count <= 0)
+		return;
+
+	if (fPendingMessageBuffers == NULL) {
+		fPendingMessageBuffers = (uint8*)malloc(kPendingMessageBatch
+			* kPendingMessageBufferSize);
+	}
+	uint8* buffers = fPendingMessageBuffers;
+
+	while (count > 0) {
+		ssize_t read = B_BUFFER_OVERFLOW;
+
+		if (buffers != NULL) {
+			port_message_data messages[kPendingMessageBatch];
+			int32 batch = min_c(count, kPendingMessageBatch);
+			for (int32 i = 0; i < batch; i++) {
+				messages[i].buffer = buffers + i * kPendingMessageBufferSize;
+				messages[i].size = kPendingMessageBufferSize;
+			}
+
+			read = read_port_messages_etc(fMsgPort, messages, batch,
+				B_RELATIVE_TIMEOUT, 0);
+			for (int32 i = 0; i < read; i++) {
+				// empty messages only wake us up, there is nothing to
+				// unflatten (ReadRawFromPort() doesn't return a buffer
+				// for them either)
+				if (messages[i].size == 0)
+					continue;
+
+				BMessage* message = ConvertToMessage(messages[i].buffer,
+					messages[i].code);
+				if (message != NULL)
+					_AddMessagePriv(message);
+			}
+		}
+
+		if (read == B_BUFFER_OVERFLOW) {
+			// the next message doesn't fit into our buffers (or we don't
+			// have any)
+			BMessage* message = MessageFromPort(0);
+			if (message != NULL)
+				_AddMessagePriv(message);
+			read = 1;
+		} else if (read <= 0)
+			break;
+
+		count -= read;
+	}
+}
+
+
 BMessage*
 BLooper::ConvertToMessage(void* buffer, int32 code)
 {
@@ -1111,15 +1179,9 @@ BLooper::task_looper()
 		if (msg)
 			_AddMessagePriv(msg);
 
-		// Get message count from port
-		int32 msgCount = port_count(fMsgPort);
-		for (int32 i = 0; i < msgCount; ++i) {
-			// Read 'count' messages from port (so we will not block)
-			// We use zero as our timeout since we know there is stuff there
-			msg = MessageFromPort(0);
-			if (msg)
-				_AddMessagePriv(msg);
-		}
+		// Read the messages that are already waiting in the port (so we will
+		// not block)
+		_DequeuePendingMessages();
 
 		// loop: As long as there are messages in the queue and the port is
 		//		 empty... and we are not terminating, of course.
@@ -2997,14 +2997,7 @@ BWindow::_SetName(const char* title)
 void
 BWindow::_DequeueAll()
 {
-	//	Get message count from port
-	int32 count = port_count(fMsgPort);
-
-	for (int32 i = 0; i < count; i++) {
-		BMessage* message = MessageFromPort(0);
-		if (message != NULL)
-			fDirectTarget->Queue()->AddMessage(message);
-	}
+	_DequeuePendingMessages();
 }
 
 
@@ -3038,16 +3031,9 @@ BWindow::task_looper()
 		if (msg)
 			_AddMessagePriv(msg);
 
-		//	Get message count from port
-		int32 msgCount = port_count(fMsgPort);
-		for (int32 i = 0; i < msgCount; ++i) {
-			// Read 'count' messages from port (so we will not block)
-			// We use zero as our timeout since we know there is stuff there
-			msg = MessageFromPort(0);
-			// Add messages to queue
-			if (msg)
-				_AddMessagePriv(msg);
-		}
+		// Read the messages that are already waiting in the port (so we will
+		// not block)
+		_DequeuePendingMessages();
 
 		bool dispatchNextMessage = true;
 		while (!fTerminating && dispatchNextMessage) {
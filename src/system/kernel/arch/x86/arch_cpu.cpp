@@ -33,6 +33,7 @@
 #include "interrupts.h"
 #include "paging/X86PagingStructures.h"
 #include "paging/X86VMTranslationMap.h"
+#include "x86_string.h"
 
 
 #define DUMP_FEATURE_STRING 1
@@ -902,10 +903,10 @@ arch_cpu_init_post_modules(kernel_args *args)
 	}
 
 	// get optimized functions from the CPU module
-	if (sCpuModule != NULL && sCpuModule->get_optimized_functions != NULL) {
-		x86_optimized_functions functions;
-		memset(&functions, 0, sizeof(functions));
+	x86_optimized_functions functions;
+	memset(&functions, 0, sizeof(functions));
 
+	if (sCpuModule != NULL && sCpuModule->get_optimized_functions != NULL) {
 		sCpuModule->get_optimized_functions(&functions);
 
 		if (functions.memcpy != NULL) {
@@ -919,24 +920,8 @@ arch_cpu_init_post_modules(kernel_args *args)
 		}
 	}
 
-	// put the optimized functions into the commpage
-	size_t memcpyLen = (addr_t)gOptimizedFunctions.memcpy_end
-		- (addr_t)gOptimizedFunctions.memcpy;
-	fill_commpage_entry(COMMPAGE_ENTRY_X86_MEMCPY,
-		(const void*)gOptimizedFunctions.memcpy, memcpyLen);
-	size_t memsetLen = (addr_t)gOptimizedFunctions.memset_end
-		- (addr_t)gOptimizedFunctions.memset;
-	fill_commpage_entry(COMMPAGE_ENTRY_X86_MEMSET,
-		(const void*)gOptimizedFunctions.memset, memsetLen);
-
-	// add the functions to the commpage image
-	image_id image = get_commpage_image();
-	elf_add_memory_image_symbol(image, "commpage_memcpy",
-		((addr_t*)USER_COMMPAGE_ADDR)[COMMPAGE_ENTRY_X86_MEMCPY], memcpyLen,
-		B_SYMBOL_TYPE_TEXT);
-	elf_add_memory_image_symbol(image, "commpage_memset",
-		((addr_t*)USER_COMMPAGE_ADDR)[COMMPAGE_ENTRY_X86_MEMSET], memsetLen,
-		B_SYMBOL_TYPE_TEXT);
+	// put the userland string functions into the commpage
+	x86_initialize_commpage_string_functions(functions);
 
 	return B_OK;
 }
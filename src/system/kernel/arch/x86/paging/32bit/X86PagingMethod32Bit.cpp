@@ -249,7 +249,8 @@ X86PagingMethod32Bit::X86PagingMethod32Bit()
 	fKernelPhysicalPageDirectory(0),
 	fKernelVirtualPageDirectory(NULL),
 	fPhysicalPageMapper(NULL),
-	fKernelPhysicalPageMapper(NULL)
+	fKernelPhysicalPageMapper(NULL),
+	fLargePagesEnabled(false)
 {
 }
 
@@ -310,6 +311,12 @@ X86PagingMethod32Bit::Init(kernel_args* args,
 		x86_write_cr4(x86_read_cr4() | IA32_CR4_GLOBAL_PAGES);
 	}
 
+	// enable 4 MB pages if available
+	if (x86_check_feature(IA32_FEATURE_PSE, FEATURE_COMMON)) {
+		call_all_cpus_sync(&_EnableLargePages, NULL);
+		fLargePagesEnabled = true;
+	}
+
 	TRACE("X86PagingMethod32Bit::Init(): done\n");
 
 	*_physicalPageMapper = fPhysicalPageMapper;
@@ -448,7 +455,11 @@ X86PagingMethod32Bit::IsKernelPageAccessible(addr_t virtualAddress,
 	page_table_entry pageTableEntry;
 	index = VADDR_TO_PTENT(virtualAddress);
 
-	if ((pageDirectoryEntry & X86_PDE_PRESENT) != 0
+	if ((pageDirectoryEntry & (X86_PDE_PRESENT | X86_PDE_LARGE_PAGE))
+			== (X86_PDE_PRESENT | X86_PDE_LARGE_PAGE)) {
+		// a 4 MB page -- the relevant flags are defined to the same values
+		pageTableEntry = pageDirectoryEntry;
+	} else if ((pageDirectoryEntry & X86_PDE_PRESENT) != 0
 			&& fPhysicalPageMapper != NULL) {
 		void* handle;
 		addr_t virtualPageTable;
@@ -518,6 +529,13 @@ X86PagingMethod32Bit::PutPageTableEntryInTable(page_table_entry* entry,
 }
 
 
+/*static*/ void
+X86PagingMethod32Bit::_EnableLargePages(void* dummy, int cpu)
+{
+	x86_write_cr4(x86_read_cr4() | IA32_CR4_PSE);
+}
+
+
 /*static*/ void
 X86PagingMethod32Bit::_EarlyPreparePageTables(page_table_entry* pageTables,
 	addr_t address, size_t size)
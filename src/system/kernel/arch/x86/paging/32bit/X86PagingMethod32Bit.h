@@ -48,6 +48,8 @@ public:
 									{ return fPhysicalPageMapper; }
 	inline	TranslationMapPhysicalPageMapper* KernelPhysicalPageMapper() const
 									{ return fKernelPhysicalPageMapper; }
+	inline	bool				LargePagesEnabled() const
+									{ return fLargePagesEnabled; }
 
 	static	X86PagingMethod32Bit* Method();
 
@@ -80,6 +82,7 @@ private:
 			friend struct PhysicalPageSlotPool;
 
 private:
+	static	void				_EnableLargePages(void* dummy, int cpu);
 	static	void				_EarlyPreparePageTables(
 									page_table_entry* pageTables,
 									addr_t address, size_t size);
@@ -94,6 +97,7 @@ private:
 
 			X86PhysicalPageMapper* fPhysicalPageMapper;
 			TranslationMapPhysicalPageMapper* fKernelPhysicalPageMapper;
+			bool				fLargePagesEnabled;
 };
 
 
@@ -56,7 +56,9 @@ X86VMTranslationMap32Bit::~X86VMTranslationMap32Bit()
 		// cycle through and free all of the user space pgtables
 		for (uint32 i = VADDR_TO_PDENT(USER_BASE);
 				i <= VADDR_TO_PDENT(USER_BASE + (USER_SIZE - 1)); i++) {
-			if ((fPagingStructures->pgdir_virt[i] & X86_PDE_PRESENT) != 0) {
+			if ((fPagingStructures->pgdir_virt[i] & X86_PDE_PRESENT) != 0
+				&& (fPagingStructures->pgdir_virt[i] & X86_PDE_LARGE_PAGE)
+					== 0) {
 				addr_t address = fPagingStructures->pgdir_virt[i]
 					& X86_PDE_ADDRESS_MASK;
 				vm_page* page = vm_lookup_page(address / B_PAGE_SIZE);
@@ -68,6 +70,8 @@ X86VMTranslationMap32Bit::~X86VMTranslationMap32Bit()
 		}
 	}
 
+	FreeLargePageTables();
+
 	fPagingStructures->RemoveReference();
 }
 
@@ -135,6 +139,14 @@ X86VMTranslationMap32Bit::MaxPagesNeededToMap(addr_t start, addr_t end) const
 }
 
 
+size_t
+X86VMTranslationMap32Bit::LargePageSize() const
+{
+	return X86PagingMethod32Bit::Method()->LargePagesEnabled()
+		? kPageTableAlignment : 0;
+}
+
+
 status_t
 X86VMTranslationMap32Bit::Map(addr_t va, phys_addr_t pa, uint32 attributes,
 	uint32 memoryType, vm_page_reservation* reservation)
@@ -180,7 +192,8 @@ X86VMTranslationMap32Bit::Map(addr_t va, phys_addr_t pa, uint32 attributes,
 		}
 
 		fMapCount++;
-	}
+	} else if ((pd[index] & X86_PDE_LARGE_PAGE) != 0)
+		_DemoteLargePage(index);
 
 	// now, fill in the pentry
 	Thread* thread = thread_get_current_thread();
@@ -204,6 +217,12 @@ X86VMTranslationMap32Bit::Map(addr_t va, phys_addr_t pa, uint32 attributes,
 
 	fMapCount++;
 
+	// Areas are mapped in ascending order, so when the last entry of a page
+	// table has been filled in, it is a good time to check whether the table
+	// can be replaced by a large page.
+	if (index == 1023 && X86PagingMethod32Bit::Method()->LargePagesEnabled())
+		_PromotePageTable(VADDR_TO_PDENT(va));
+
 	return 0;
 }
 
@@ -228,6 +247,9 @@ X86VMTranslationMap32Bit::Unmap(addr_t start, addr_t end)
 			continue;
 		}
 
+		if ((pd[index] & X86_PDE_LARGE_PAGE) != 0)
+			_DemoteLargePage(index);
+
 		Thread* thread = thread_get_current_thread();
 		ThreadCPUPinner pinner(thread);
 
@@ -280,6 +302,9 @@ X86VMTranslationMap32Bit::DebugMarkRangePresent(addr_t start, addr_t end,
 			continue;
 		}
 
+		if ((pd[index] & X86_PDE_LARGE_PAGE) != 0)
+			_DemoteLargePage(index);
+
 		Thread* thread = thread_get_current_thread();
 		ThreadCPUPinner pinner(thread);
 
@@ -335,6 +360,9 @@ X86VMTranslationMap32Bit::UnmapPage(VMArea* area, addr_t address,
 	if ((pd[index] & X86_PDE_PRESENT) == 0)
 		return B_ENTRY_NOT_FOUND;
 
+	if ((pd[index] & X86_PDE_LARGE_PAGE) != 0)
+		_DemoteLargePage(index);
+
 	ThreadCPUPinner pinner(thread_get_current_thread());
 
 	page_table_entry* pt = (page_table_entry*)fPageMapper->GetPageTableAt(
@@ -411,6 +439,9 @@ X86VMTranslationMap32Bit::UnmapPages(VMArea* area, addr_t base, size_t size,
 			continue;
 		}
 
+		if ((pd[index] & X86_PDE_LARGE_PAGE) != 0)
+			_DemoteLargePage(index);
+
 		Thread* thread = thread_get_current_thread();
 		ThreadCPUPinner pinner(thread);
 
@@ -482,11 +513,12 @@ X86VMTranslationMap32Bit::UnmapPages(VMArea* area, addr_t base, size_t size,
 				DEBUG_PAGE_ACCESS_END(page);
 			}
 		}
-
-		Flush();
-			// flush explicitly, since we directly use the lock
 	} while (start != 0 && start < end);
 
+	Flush();
+		// flush explicitly, since we directly use the lock -- once for the
+		// whole range, so that other CPUs are only interrupted once
+
 	// TODO: As in UnmapPage() we can lose page dirty flags here. ATM it's not
 	// really critical here, as in all cases this method is used, the unmapped
 	// area range is unmapped for good (resized/cut) and the pages will likely
@@ -546,6 +578,9 @@ X86VMTranslationMap32Bit::UnmapArea(VMArea* area, bool deletingAddressSpace,
 				continue;
 			}
 
+			if ((pd[index] & X86_PDE_LARGE_PAGE) != 0)
+				_DemoteLargePage(index);
+
 			ThreadCPUPinner pinner(thread_get_current_thread());
 
 			page_table_entry* pt
@@ -620,14 +655,23 @@ X86VMTranslationMap32Bit::Query(addr_t va, phys_addr_t *_physical,
 		return B_OK;
 	}
 
-	Thread* thread = thread_get_current_thread();
-	ThreadCPUPinner pinner(thread);
+	page_table_entry entry;
+	if ((pd[index] & X86_PDE_LARGE_PAGE) != 0) {
+		// a large page -- the flags we're interested in are defined to the
+		// same values as the ones of page table entries
+		entry = pd[index];
+		*_physical = (entry & X86_PDE_LARGE_ADDRESS_MASK)
+			+ va % kPageTableAlignment;
+	} else {
+		Thread* thread = thread_get_current_thread();
+		ThreadCPUPinner pinner(thread);
 
-	page_table_entry* pt = (page_table_entry*)fPageMapper->GetPageTableAt(
-		pd[index] & X86_PDE_ADDRESS_MASK);
-	page_table_entry entry = pt[VADDR_TO_PTENT(va)];
+		page_table_entry* pt = (page_table_entry*)fPageMapper->GetPageTableAt(
+			pd[index] & X86_PDE_ADDRESS_MASK);
+		entry = pt[VADDR_TO_PTENT(va)];
 
-	*_physical = entry & X86_PDE_ADDRESS_MASK;
+		*_physical = entry & X86_PDE_ADDRESS_MASK;
+	}
 
 	// read in the page state flags
 	if ((entry & X86_PTE_USER) != 0) {
@@ -641,8 +685,6 @@ X86VMTranslationMap32Bit::Query(addr_t va, phys_addr_t *_physical,
 		| ((entry & X86_PTE_ACCESSED) != 0 ? PAGE_ACCESSED : 0)
 		| ((entry & X86_PTE_PRESENT) != 0 ? PAGE_PRESENT : 0);
 
-	pinner.Unlock();
-
 	TRACE("query_tmap: returning pa 0x%lx for va 0x%lx\n", *_physical, va);
 
 	return B_OK;
@@ -663,13 +705,22 @@ X86VMTranslationMap32Bit::QueryInterrupt(addr_t va, phys_addr_t *_physical,
 		return B_OK;
 	}
 
-	// map page table entry
-	page_table_entry* pt = (page_table_entry*)X86PagingMethod32Bit::Method()
-		->PhysicalPageMapper()->InterruptGetPageTableAt(
-			pd[index] & X86_PDE_ADDRESS_MASK);
-	page_table_entry entry = pt[VADDR_TO_PTENT(va)];
+	page_table_entry entry;
+	if ((pd[index] & X86_PDE_LARGE_PAGE) != 0) {
+		// a large page -- the flags we're interested in are defined to the
+		// same values as the ones of page table entries
+		entry = pd[index];
+		*_physical = (entry & X86_PDE_LARGE_ADDRESS_MASK)
+			+ va % kPageTableAlignment;
+	} else {
+		// map page table entry
+		page_table_entry* pt = (page_table_entry*)X86PagingMethod32Bit
+			::Method()->PhysicalPageMapper()->InterruptGetPageTableAt(
+				pd[index] & X86_PDE_ADDRESS_MASK);
+		entry = pt[VADDR_TO_PTENT(va)];
 
-	*_physical = entry & X86_PDE_ADDRESS_MASK;
+		*_physical = entry & X86_PDE_ADDRESS_MASK;
+	}
 
 	// read in the page state flags
 	if ((entry & X86_PTE_USER) != 0) {
@@ -718,6 +769,48 @@ X86VMTranslationMap32Bit::Protect(addr_t start, addr_t end, uint32 attributes,
 			continue;
 		}
 
+		if ((pd[index] & X86_PDE_LARGE_PAGE) != 0) {
+			if (start % kPageTableAlignment != 0
+				|| end - start < kPageTableAlignment - 1) {
+				// only a part of the large page is affected -- split it up
+				_DemoteLargePage(index);
+			} else {
+				// Set the new protection flags of the whole large page. Note,
+				// that the flags are defined to the same values as the ones
+				// of page table entries. We don't track the dirty state of
+				// large pages, so writable ones are always marked dirty.
+				page_directory_entry entry = pd[index];
+				while (true) {
+					page_directory_entry oldEntry
+						= X86PagingMethod32Bit::TestAndSetPageTableEntry(
+							&pd[index],
+							(entry & ~(X86_PTE_PROTECTION_MASK
+									| X86_PTE_MEMORY_TYPE_MASK))
+								| newProtectionFlags
+								| ((newProtectionFlags & X86_PTE_WRITABLE) != 0
+									? X86_PDE_LARGE_DIRTY : 0)
+								| X86PagingMethod32Bit
+									::MemoryTypeToPageTableEntryFlags(
+										memoryType),
+							entry);
+					if (oldEntry == entry)
+						break;
+					entry = oldEntry;
+				}
+
+				if (index >= (int)FIRST_KERNEL_PGDIR_ENT
+					&& index < (int)(FIRST_KERNEL_PGDIR_ENT
+						+ NUM_KERNEL_PGDIR_ENTS)) {
+					X86PagingStructures32Bit::UpdateAllPageDirs(index,
+						pd[index]);
+				}
+
+				InvalidatePage(start);
+				start += kPageTableAlignment;
+				continue;
+			}
+		}
+
 		Thread* thread = thread_get_current_thread();
 		ThreadCPUPinner pinner(thread);
 
@@ -774,6 +867,9 @@ X86VMTranslationMap32Bit::ClearFlags(addr_t va, uint32 flags)
 		return B_OK;
 	}
 
+	if ((pd[index] & X86_PDE_LARGE_PAGE) != 0)
+		_DemoteLargePage(index);
+
 	uint32 flagsToClear = ((flags & PAGE_MODIFIED) ? X86_PTE_DIRTY : 0)
 		| ((flags & PAGE_ACCESSED) ? X86_PTE_ACCESSED : 0);
 
@@ -815,6 +911,9 @@ X86VMTranslationMap32Bit::ClearAccessedAndModified(VMArea* area, addr_t address,
 	if ((pd[index] & X86_PDE_PRESENT) == 0)
 		return false;
 
+	if ((pd[index] & X86_PDE_LARGE_PAGE) != 0)
+		_DemoteLargePage(index);
+
 	ThreadCPUPinner pinner(thread_get_current_thread());
 
 	page_table_entry* pt = (page_table_entry*)fPageMapper->GetPageTableAt(
@@ -890,3 +989,131 @@ X86VMTranslationMap32Bit::PagingStructures() const
 {
 	return fPagingStructures;
 }
+
+
+/*!	Replaces the page table at page directory index \a index by a 4 MB page
+	mapping, if all of its entries map a suitably aligned, physically
+	contiguous range with the same attributes.
+	The page table itself is kept, so that the large page can be split up
+	again without having to allocate memory (cf. _DemoteLargePage()).
+	The map must be locked.
+*/
+void
+X86VMTranslationMap32Bit::_PromotePageTable(uint32 index)
+{
+	page_directory_entry* pd = fPagingStructures->pgdir_virt;
+	phys_addr_t pageTablePhysical = pd[index] & X86_PDE_ADDRESS_MASK;
+	addr_t address = (addr_t)index * kPageTableAlignment;
+
+	const page_table_entry flagsMask = X86_PTE_PRESENT
+		| X86_PTE_PROTECTION_MASK | X86_PTE_MEMORY_TYPE_MASK | X86_PTE_PAT
+		| X86_PTE_GLOBAL;
+
+	Thread* thread = thread_get_current_thread();
+	ThreadCPUPinner pinner(thread);
+
+	page_table_entry* pt = (page_table_entry*)fPageMapper->GetPageTableAt(
+		pageTablePhysical);
+
+	page_table_entry firstEntry = pt[0];
+	phys_addr_t physicalAddress = firstEntry & X86_PTE_ADDRESS_MASK;
+	if ((firstEntry & (X86_PTE_PRESENT | X86_PTE_PAT)) != X86_PTE_PRESENT
+		|| physicalAddress % kPageTableAlignment != 0) {
+		return;
+	}
+
+	for (uint32 i = 1; i < 1024; i++) {
+		if ((pt[i] & X86_PTE_ADDRESS_MASK) != physicalAddress + i * B_PAGE_SIZE
+			|| (pt[i] & flagsMask) != (firstEntry & flagsMask)) {
+			return;
+		}
+	}
+
+	// The pages that have been accessed might still be in a TLB. Since the
+	// translations don't change, invalidating them later is fine.
+	for (uint32 i = 0; i < 1024; i++) {
+		if ((pt[i] & X86_PTE_ACCESSED) != 0)
+			InvalidatePage(address + i * B_PAGE_SIZE);
+	}
+
+	pinner.Unlock();
+
+	// We don't track the accessed and dirty state of the individual pages
+	// anymore, so we mark them all accessed, and dirty, if writable. Note, that
+	// the flags are defined to the same values as the ones of page table
+	// entries.
+	page_directory_entry entry = physicalAddress
+		| (firstEntry & (flagsMask & ~X86_PTE_PAT))
+		| X86_PDE_LARGE_PAGE | X86_PDE_ACCESSED
+		| ((firstEntry & X86_PTE_WRITABLE) != 0 ? X86_PDE_LARGE_DIRTY : 0);
+	X86PagingMethod32Bit::SetPageTableEntry(&pd[index], entry);
+
+	// update any other page directories, if it maps kernel space
+	if (index >= FIRST_KERNEL_PGDIR_ENT
+		&& index < (FIRST_KERNEL_PGDIR_ENT + NUM_KERNEL_PGDIR_ENTS)) {
+		X86PagingStructures32Bit::UpdateAllPageDirs(index, entry);
+	}
+
+	SaveLargePageTable(vm_lookup_page(pageTablePhysical / B_PAGE_SIZE),
+		address);
+
+	TRACE("X86VMTranslationMap32Bit::_PromotePageTable(): %#" B_PRIxADDR
+		" -> %#" B_PRIxPHYSADDR "\n", address, physicalAddress);
+}
+
+
+/*!	Splits up the 4 MB page mapping at page directory index \a index into
+	page sized ones again, using the page table it replaced.
+	The map must be locked.
+*/
+void
+X86VMTranslationMap32Bit::_DemoteLargePage(uint32 index)
+{
+	page_directory_entry* pd = fPagingStructures->pgdir_virt;
+	addr_t address = (addr_t)index * kPageTableAlignment;
+
+	vm_page* page = RemoveLargePageTable(address);
+	if (page == NULL) {
+		panic("X86VMTranslationMap32Bit::_DemoteLargePage(): no page table "
+			"for large page at %#" B_PRIxADDR, address);
+		return;
+	}
+
+	phys_addr_t pageTablePhysical
+		= (phys_addr_t)page->physical_page_number * B_PAGE_SIZE;
+
+	// Fill in the page table according to the large page. The flags are
+	// defined to the same values, the PAT bit aside, which we don't use.
+	page_directory_entry largeEntry = pd[index];
+	page_table_entry flags = largeEntry & (X86_PTE_PRESENT
+		| X86_PTE_PROTECTION_MASK | X86_PTE_MEMORY_TYPE_MASK
+		| X86_PTE_ACCESSED | X86_PTE_DIRTY | X86_PTE_GLOBAL);
+	phys_addr_t physicalAddress = largeEntry & X86_PDE_LARGE_ADDRESS_MASK;
+
+	Thread* thread = thread_get_current_thread();
+	ThreadCPUPinner pinner(thread);
+
+	page_table_entry* pt = (page_table_entry*)fPageMapper->GetPageTableAt(
+		pageTablePhysical);
+	for (uint32 i = 0; i < 1024; i++)
+		pt[i] = (physicalAddress + i * B_PAGE_SIZE) | flags;
+
+	pinner.Unlock();
+
+	page_directory_entry entry;
+	X86PagingMethod32Bit::PutPageTableInPageDir(&entry, pageTablePhysical,
+		0);
+	X86PagingMethod32Bit::SetPageTableEntry(&pd[index], entry);
+
+	// update any other page directories, if it maps kernel space
+	if (index >= FIRST_KERNEL_PGDIR_ENT
+		&& index < (FIRST_KERNEL_PGDIR_ENT + NUM_KERNEL_PGDIR_ENTS)) {
+		X86PagingStructures32Bit::UpdateAllPageDirs(index, entry);
+	}
+
+	// invalidating any address within the large page removes it from the TLBs
+	InvalidatePage(address);
+
+	TRACE("X86VMTranslationMap32Bit::_DemoteLargePage(): %#" B_PRIxADDR "\n",
+		address);
+}
@@ -20,6 +20,7 @@ struct X86VMTranslationMap32Bit : X86VMTranslationMap {
 
 	virtual	size_t				MaxPagesNeededToMap(addr_t start,
 									addr_t end) const;
+	virtual	size_t				LargePageSize() const;
 
 	virtual	status_t			Map(addr_t virtualAddress,
 									phys_addr_t physicalAddress,
@@ -60,6 +61,10 @@ struct X86VMTranslationMap32Bit : X86VMTranslationMap {
 	inline	X86PagingStructures32Bit* PagingStructures32Bit() const
 									{ return fPagingStructures; }
 
+private:
+			void				_PromotePageTable(uint32 index);
+			void				_DemoteLargePage(uint32 index);
+
 private:
 			X86PagingStructures32Bit* fPagingStructures;
 };
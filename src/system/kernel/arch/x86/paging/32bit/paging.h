@@ -35,6 +35,13 @@
 #define X86_PDE_IGNORED5			0x00000800
 #define X86_PDE_ADDRESS_MASK		0xfffff000
 
+// additional page directory entry bits of 4 MB pages (with CR4.PSE set)
+#define X86_PDE_LARGE_DIRTY			0x00000040
+#define X86_PDE_LARGE_PAGE			0x00000080
+#define X86_PDE_LARGE_GLOBAL		0x00000100
+#define X86_PDE_LARGE_PAT			0x00001000
+#define X86_PDE_LARGE_ADDRESS_MASK	0xffc00000
+
 // page table entry bits
 #define X86_PTE_PRESENT				0x00000001
 #define X86_PTE_WRITABLE			0x00000002
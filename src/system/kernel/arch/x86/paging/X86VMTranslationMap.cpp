@@ -12,6 +12,8 @@
 
 #include <thread.h>
 #include <smp.h>
+#include <util/AutoLock.h>
+#include <vm/vm_page.h>
 
 #include "paging/X86PagingStructures.h"
 
@@ -27,7 +29,8 @@
 X86VMTranslationMap::X86VMTranslationMap()
 	:
 	fPageMapper(NULL),
-	fInvalidPagesCount(0)
+	fInvalidPagesCount(0),
+	fBatchingThread(NULL)
 {
 }
 
@@ -46,7 +49,8 @@ X86VMTranslationMap::Init(bool kernel)
 
 
 /*!	Acquires the map's recursive lock, and resets the invalidate pages counter
-	in case it's the first locking recursion.
+	in case it's the first locking recursion and no invalidation batch is
+	pending.
 */
 bool
 X86VMTranslationMap::Lock()
@@ -54,7 +58,7 @@ X86VMTranslationMap::Lock()
 	TRACE("%p->X86VMTranslationMap::Lock()\n", this);
 
 	recursive_lock_lock(&fLock);
-	if (recursive_lock_get_recursion(&fLock) == 1) {
+	if (recursive_lock_get_recursion(&fLock) == 1 && fBatchingThread == NULL) {
 		// we were the first one to grab the lock
 		TRACE("clearing invalidated page count\n");
 		fInvalidPagesCount = 0;
@@ -66,14 +70,15 @@ X86VMTranslationMap::Lock()
 
 /*!	Unlocks the map, and, if we are actually losing the recursive lock,
 	flush all pending changes of this map (ie. flush TLB caches as
-	needed).
+	needed) -- unless the calling thread has an invalidation batch pending.
 */
 void
 X86VMTranslationMap::Unlock()
 {
 	TRACE("%p->X86VMTranslationMap::Unlock()\n", this);
 
-	if (recursive_lock_get_recursion(&fLock) == 1) {
+	if (recursive_lock_get_recursion(&fLock) == 1
+		&& fBatchingThread != thread_get_current_thread()) {
 		// we're about to release it for the last time
 		Flush();
 	}
@@ -98,6 +103,20 @@ X86VMTranslationMap::Flush()
 	Thread* thread = thread_get_current_thread();
 	thread_pin_to_current_cpu(thread);
 
+	// The TLB of a CPU that doesn't use a user map's paging structures can't
+	// contain any of its entries, since they are not global, and loading the
+	// page directory flushes all others. So we only need to bother the CPUs
+	// running the address space, including this one. Since we're pinned, our
+	// own bit cannot change in the meantime.
+	int cpu = smp_get_current_cpu();
+	uint32 cpuMask = 0;
+	bool invalidateLocally = true;
+	if (!fIsKernelMap) {
+		cpuMask = PagingStructures()->active_on_cpus;
+		invalidateLocally = (cpuMask & ((uint32)1 << cpu)) != 0;
+		cpuMask &= ~((uint32)1 << cpu);
+	}
+
 	if (fInvalidPagesCount > PAGE_INVALIDATE_CACHE_SIZE) {
 		// invalidate all pages
 		TRACE("flush_tmap: %d pages to invalidate, invalidate all\n",
@@ -108,13 +127,12 @@ X86VMTranslationMap::Flush()
 			smp_send_broadcast_ici(SMP_MSG_GLOBAL_INVALIDATE_PAGES, 0, 0, 0,
 				NULL, SMP_MSG_FLAG_SYNC);
 		} else {
-			cpu_status state = disable_interrupts();
-			arch_cpu_user_TLB_invalidate();
-			restore_interrupts(state);
+			if (invalidateLocally) {
+				cpu_status state = disable_interrupts();
+				arch_cpu_user_TLB_invalidate();
+				restore_interrupts(state);
+			}
 
-			int cpu = smp_get_current_cpu();
-			uint32 cpuMask = PagingStructures()->active_on_cpus
-				& ~((uint32)1 << cpu);
 			if (cpuMask != 0) {
 				smp_send_multicast_ici(cpuMask, SMP_MSG_USER_INVALIDATE_PAGES,
 					0, 0, 0, NULL, SMP_MSG_FLAG_SYNC);
@@ -124,24 +142,97 @@ X86VMTranslationMap::Flush()
 		TRACE("flush_tmap: %d pages to invalidate, invalidate list\n",
 			fInvalidPagesCount);
 
-		arch_cpu_invalidate_TLB_list(fInvalidPages, fInvalidPagesCount);
+		if (invalidateLocally)
+			arch_cpu_invalidate_TLB_list(fInvalidPages, fInvalidPagesCount);
 
 		if (fIsKernelMap) {
 			smp_send_broadcast_ici(SMP_MSG_INVALIDATE_PAGE_LIST,
 				(uint32)fInvalidPages, fInvalidPagesCount, 0, NULL,
 				SMP_MSG_FLAG_SYNC);
-		} else {
-			int cpu = smp_get_current_cpu();
-			uint32 cpuMask = PagingStructures()->active_on_cpus
-				& ~((uint32)1 << cpu);
-			if (cpuMask != 0) {
-				smp_send_multicast_ici(cpuMask, SMP_MSG_INVALIDATE_PAGE_LIST,
-					(uint32)fInvalidPages, fInvalidPagesCount, 0, NULL,
-					SMP_MSG_FLAG_SYNC);
-			}
+		} else if (cpuMask != 0) {
+			smp_send_multicast_ici(cpuMask, SMP_MSG_INVALIDATE_PAGE_LIST,
+				(uint32)fInvalidPages, fInvalidPagesCount, 0, NULL,
+				SMP_MSG_FLAG_SYNC);
 		}
 	}
 	fInvalidPagesCount = 0;
 
 	thread_unpin_from_current_cpu(thread);
 }
+
+
+/*!	Defers the flushes of the calling thread's Unlock() calls until
+	EndInvalidationBatch(). Only one thread can have a batch pending; if
+	another one already has, \c false is returned and nothing is deferred.
+*/
+bool
+X86VMTranslationMap::BeginInvalidationBatch()
+{
+	RecursiveLocker locker(fLock);
+
+	if (fBatchingThread != NULL)
+		return false;
+
+	fBatchingThread = thread_get_current_thread();
+	return true;
+}
+
+
+void
+X86VMTranslationMap::EndInvalidationBatch()
+{
+	RecursiveLocker locker(fLock);
+
+	ASSERT(fBatchingThread == thread_get_current_thread());
+	fBatchingThread = NULL;
+
+	Flush();
+}
+
+
+/*!	Keeps the page table \a page, that has been replaced by a large page
+	mapping at \a address, so that the large page can be split up again
+	without having to allocate memory.
+	The page table pages are wired and thus not in any page queue, so we can
+	use their queue link; the address is stored in the unused cache offset.
+	The map must be locked.
+*/
+void
+X86VMTranslationMap::SaveLargePageTable(vm_page* page, addr_t address)
+{
+	page->cache_offset = address / B_PAGE_SIZE;
+	fLargePageTables.Add(page);
+}
+
+
+/*!	Returns the page table that has been saved for the large page mapping at
+	\a address, or \c NULL, if there is none.
+	The map must be locked.
+*/
+vm_page*
+X86VMTranslationMap::RemoveLargePageTable(addr_t address)
+{
+	// There are usually only very few large pages per map, so a linear search
+	// is fine.
+	for (PageTableList::Iterator it = fLargePageTables.GetIterator();
+			vm_page* page = it.Next();) {
+		if (page->cache_offset == address / B_PAGE_SIZE) {
+			it.Remove();
+			page->cache_offset = 0;
+			return page;
+		}
+	}
+
+	return NULL;
+}
+
+
+void
+X86VMTranslationMap::FreeLargePageTables()
+{
+	while (vm_page* page = fLargePageTables.RemoveHead()) {
+		page->cache_offset = 0;
+		DEBUG_PAGE_ACCESS_START(page);
+		vm_page_set_state(page, PAGE_STATE_FREE);
+	}
+}
@@ -6,12 +6,15 @@
 #define KERNEL_ARCH_X86_X86_VM_TRANSLATION_MAP_H
 
 
+#include <util/DoublyLinkedList.h>
 #include <vm/VMTranslationMap.h>
+#include <vm/vm_types.h>
 
 
 #define PAGE_INVALIDATE_CACHE_SIZE 64
 
 
+struct Thread;
 struct X86PagingStructures;
 class TranslationMapPhysicalPageMapper;
 
@@ -29,15 +32,30 @@ struct X86VMTranslationMap : VMTranslationMap {
 
 	virtual	void				Flush();
 
+	virtual	bool				BeginInvalidationBatch();
+	virtual	void				EndInvalidationBatch();
+
 	virtual	X86PagingStructures* PagingStructures() const = 0;
 
 	inline	void				InvalidatePage(addr_t address);
 
+protected:
+			typedef DoublyLinkedList<vm_page,
+				DoublyLinkedListMemberGetLink<vm_page, &vm_page::queue_link> >
+					PageTableList;
+
+			void				SaveLargePageTable(vm_page* page,
+									addr_t address);
+			vm_page*			RemoveLargePageTable(addr_t address);
+			void				FreeLargePageTables();
+
 protected:
 			TranslationMapPhysicalPageMapper* fPageMapper;
 			int					fInvalidPagesCount;
 			addr_t				fInvalidPages[PAGE_INVALIDATE_CACHE_SIZE];
 			bool				fIsKernelMap;
+			Thread*				fBatchingThread;
+			PageTableList		fLargePageTables;
 };
 
 
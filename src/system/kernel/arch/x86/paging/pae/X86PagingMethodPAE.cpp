@@ -718,7 +718,11 @@ X86PagingMethodPAE::IsKernelPageAccessible(addr_t virtualAddress,
 
 	// map the page table and get the entry
 	pae_page_table_entry pageTableEntry = 0;
-	if ((pageDirEntry & X86_PAE_PDE_PRESENT) != 0) {
+	if ((pageDirEntry & (X86_PAE_PDE_PRESENT | X86_PAE_PDE_LARGE_PAGE))
+			== (X86_PAE_PDE_PRESENT | X86_PAE_PDE_LARGE_PAGE)) {
+		// a 2 MB page -- the relevant flags are defined to the same values
+		pageTableEntry = pageDirEntry;
+	} else if ((pageDirEntry & X86_PAE_PDE_PRESENT) != 0) {
 		void* handle;
 		addr_t virtualPageTable;
 		status_t error = fPhysicalPageMapper->GetPageDebug(
@@ -61,7 +61,8 @@ X86VMTranslationMapPAE::~X86VMTranslationMapPAE()
 			continue;
 
 		for (uint32 i = 0; i < kPAEPageDirEntryCount; i++) {
-			if ((pageDir[i] & X86_PAE_PDE_PRESENT) != 0) {
+			if ((pageDir[i] & X86_PAE_PDE_PRESENT) != 0
+				&& (pageDir[i] & X86_PAE_PDE_LARGE_PAGE) == 0) {
 				phys_addr_t address = pageDir[i] & X86_PAE_PDE_ADDRESS_MASK;
 				vm_page* page = vm_lookup_page(address / B_PAGE_SIZE);
 				if (page == NULL)
@@ -76,6 +77,8 @@ X86VMTranslationMapPAE::~X86VMTranslationMapPAE()
 		}
 	}
 
+	FreeLargePageTables();
+
 	fPagingStructures->RemoveReference();
 }
 
@@ -182,6 +185,13 @@ X86VMTranslationMapPAE::MaxPagesNeededToMap(addr_t start, addr_t end) const
 }
 
 
+size_t
+X86VMTranslationMapPAE::LargePageSize() const
+{
+	return kPAEPageTableRange;
+}
+
+
 status_t
 X86VMTranslationMapPAE::Map(addr_t virtualAddress, phys_addr_t physicalAddress,
 	uint32 attributes, uint32 memoryType, vm_page_reservation* reservation)
@@ -214,7 +224,8 @@ X86VMTranslationMapPAE::Map(addr_t virtualAddress, phys_addr_t physicalAddress,
 						? B_WRITE_AREA : B_KERNEL_WRITE_AREA));
 
 		fMapCount++;
-	}
+	} else if ((*pageDirEntry & X86_PAE_PDE_LARGE_PAGE) != 0)
+		_DemoteLargePage(pageDirEntry, virtualAddress);
 
 	// now, fill in the page table entry
 	Thread* thread = thread_get_current_thread();
@@ -240,6 +251,12 @@ X86VMTranslationMapPAE::Map(addr_t virtualAddress, phys_addr_t physicalAddress,
 
 	fMapCount++;
 
+	// Areas are mapped in ascending order, so when the last entry of a page
+	// table has been filled in, it is a good time to check whether the table
+	// can be replaced by a large page.
+	if (entry == pageTable + kPAEPageTableEntryCount - 1)
+		_PromotePageTable(pageDirEntry, virtualAddress);
+
 	return 0;
 }
 
@@ -265,6 +282,9 @@ X86VMTranslationMapPAE::Unmap(addr_t start, addr_t end)
 			continue;
 		}
 
+		if ((*pageDirEntry & X86_PAE_PDE_LARGE_PAGE) != 0)
+			_DemoteLargePage(pageDirEntry, start);
+
 		Thread* thread = thread_get_current_thread();
 		ThreadCPUPinner pinner(thread);
 
@@ -320,6 +340,9 @@ X86VMTranslationMapPAE::DebugMarkRangePresent(addr_t start, addr_t end,
 			continue;
 		}
 
+		if ((*pageDirEntry & X86_PAE_PDE_LARGE_PAGE) != 0)
+			_DemoteLargePage(pageDirEntry, start);
+
 		Thread* thread = thread_get_current_thread();
 		ThreadCPUPinner pinner(thread);
 
@@ -379,6 +402,9 @@ X86VMTranslationMapPAE::UnmapPage(VMArea* area, addr_t address,
 	if ((*pageDirEntry & X86_PAE_PDE_PRESENT) == 0)
 		return B_ENTRY_NOT_FOUND;
 
+	if ((*pageDirEntry & X86_PAE_PDE_LARGE_PAGE) != 0)
+		_DemoteLargePage(pageDirEntry, address);
+
 	ThreadCPUPinner pinner(thread_get_current_thread());
 
 	pae_page_table_entry* pageTable
@@ -456,6 +482,9 @@ X86VMTranslationMapPAE::UnmapPages(VMArea* area, addr_t base, size_t size,
 			continue;
 		}
 
+		if ((*pageDirEntry & X86_PAE_PDE_LARGE_PAGE) != 0)
+			_DemoteLargePage(pageDirEntry, start);
+
 		Thread* thread = thread_get_current_thread();
 		ThreadCPUPinner pinner(thread);
 
@@ -529,11 +558,12 @@ X86VMTranslationMapPAE::UnmapPages(VMArea* area, addr_t base, size_t size,
 				DEBUG_PAGE_ACCESS_END(page);
 			}
 		}
-
-		Flush();
-			// flush explicitly, since we directly use the lock
 	} while (start != 0 && start < end);
 
+	Flush();
+		// flush explicitly, since we directly use the lock -- once for the
+		// whole range, so that other CPUs are only interrupted once
+
 	// TODO: As in UnmapPage() we can lose page dirty flags here. ATM it's not
 	// really critical here, as in all cases this method is used, the unmapped
 	// area range is unmapped for good (resized/cut) and the pages will likely
@@ -593,6 +623,9 @@ X86VMTranslationMapPAE::UnmapArea(VMArea* area, bool deletingAddressSpace,
 				continue;
 			}
 
+			if ((*pageDirEntry & X86_PAE_PDE_LARGE_PAGE) != 0)
+				_DemoteLargePage(pageDirEntry, address);
+
 			ThreadCPUPinner pinner(thread_get_current_thread());
 
 			pae_page_table_entry* pageTable
@@ -670,19 +703,28 @@ X86VMTranslationMapPAE::Query(addr_t virtualAddress,
 		return B_OK;
 	}
 
-	// get the page table entry
-	Thread* thread = thread_get_current_thread();
-	ThreadCPUPinner pinner(thread);
+	pae_page_table_entry entry;
+	if ((*pageDirEntry & X86_PAE_PDE_LARGE_PAGE) != 0) {
+		// a large page -- the flags we're interested in are defined to the
+		// same values as the ones of page table entries
+		entry = *pageDirEntry;
+		*_physicalAddress = (entry & X86_PAE_PDE_LARGE_ADDRESS_MASK)
+			+ virtualAddress % kPAEPageTableRange;
+	} else {
+		// get the page table entry
+		Thread* thread = thread_get_current_thread();
+		ThreadCPUPinner pinner(thread);
 
-	pae_page_table_entry* pageTable
-		= (pae_page_table_entry*)fPageMapper->GetPageTableAt(
-			*pageDirEntry & X86_PAE_PDE_ADDRESS_MASK);
-	pae_page_table_entry entry
-		= pageTable[virtualAddress / B_PAGE_SIZE % kPAEPageTableEntryCount];
+		pae_page_table_entry* pageTable
+			= (pae_page_table_entry*)fPageMapper->GetPageTableAt(
+				*pageDirEntry & X86_PAE_PDE_ADDRESS_MASK);
+		entry = pageTable[
+			virtualAddress / B_PAGE_SIZE % kPAEPageTableEntryCount];
 
-	pinner.Unlock();
+		pinner.Unlock();
 
-	*_physicalAddress = entry & X86_PAE_PTE_ADDRESS_MASK;
+		*_physicalAddress = entry & X86_PAE_PTE_ADDRESS_MASK;
+	}
 
 	// translate the page state flags
 	if ((entry & X86_PAE_PTE_USER) != 0) {
@@ -720,15 +762,24 @@ X86VMTranslationMapPAE::QueryInterrupt(addr_t virtualAddress,
 		return B_OK;
 	}
 
-	// get the page table entry
-	pae_page_table_entry* pageTable
-		= (pae_page_table_entry*)X86PagingMethodPAE::Method()
-			->PhysicalPageMapper()->InterruptGetPageTableAt(
-				*pageDirEntry & X86_PAE_PDE_ADDRESS_MASK);
-	pae_page_table_entry entry
-		= pageTable[virtualAddress / B_PAGE_SIZE % kPAEPageTableEntryCount];
+	pae_page_table_entry entry;
+	if ((*pageDirEntry & X86_PAE_PDE_LARGE_PAGE) != 0) {
+		// a large page -- the flags we're interested in are defined to the
+		// same values as the ones of page table entries
+		entry = *pageDirEntry;
+		*_physicalAddress = (entry & X86_PAE_PDE_LARGE_ADDRESS_MASK)
+			+ virtualAddress % kPAEPageTableRange;
+	} else {
+		// get the page table entry
+		pae_page_table_entry* pageTable
+			= (pae_page_table_entry*)X86PagingMethodPAE::Method()
+				->PhysicalPageMapper()->InterruptGetPageTableAt(
+					*pageDirEntry & X86_PAE_PDE_ADDRESS_MASK);
+		entry = pageTable[
+			virtualAddress / B_PAGE_SIZE % kPAEPageTableEntryCount];
 
-	*_physicalAddress = entry & X86_PAE_PTE_ADDRESS_MASK;
+		*_physicalAddress = entry & X86_PAE_PTE_ADDRESS_MASK;
+	}
 
 	// translate the page state flags
 	if ((entry & X86_PAE_PTE_USER) != 0) {
@@ -780,6 +831,42 @@ X86VMTranslationMapPAE::Protect(addr_t start, addr_t end, uint32 attributes,
 			continue;
 		}
 
+		if ((*pageDirEntry & X86_PAE_PDE_LARGE_PAGE) != 0) {
+			if (start % kPAEPageTableRange != 0
+				|| end - start < kPAEPageTableRange - 1) {
+				// only a part of the large page is affected -- split it up
+				_DemoteLargePage(pageDirEntry, start);
+			} else {
+				// Set the new protection flags of the whole large page. Note,
+				// that the flags are defined to the same values as the ones
+				// of page table entries. We don't track the dirty state of
+				// large pages, so writable ones are always marked dirty.
+				pae_page_directory_entry entry = *pageDirEntry;
+				while (true) {
+					pae_page_directory_entry oldEntry
+						= X86PagingMethodPAE::TestAndSetPageTableEntry(
+							pageDirEntry,
+							(entry & ~(X86_PAE_PTE_PROTECTION_MASK
+									| X86_PAE_PTE_MEMORY_TYPE_MASK))
+								| newProtectionFlags
+								| ((newProtectionFlags & X86_PAE_PTE_WRITABLE)
+										!= 0
+									? X86_PAE_PDE_LARGE_DIRTY : 0)
+								| X86PagingMethodPAE
+									::MemoryTypeToPageTableEntryFlags(
+										memoryType),
+							entry);
+					if (oldEntry == entry)
+						break;
+					entry = oldEntry;
+				}
+
+				InvalidatePage(start);
+				start += kPAEPageTableRange;
+				continue;
+			}
+		}
+
 		Thread* thread = thread_get_current_thread();
 		ThreadCPUPinner pinner(thread);
 
@@ -840,6 +927,9 @@ X86VMTranslationMapPAE::ClearFlags(addr_t address, uint32 flags)
 		return B_OK;
 	}
 
+	if ((*pageDirEntry & X86_PAE_PDE_LARGE_PAGE) != 0)
+		_DemoteLargePage(pageDirEntry, address);
+
 	uint64 flagsToClear = ((flags & PAGE_MODIFIED) ? X86_PAE_PTE_DIRTY : 0)
 		| ((flags & PAGE_ACCESSED) ? X86_PAE_PTE_ACCESSED : 0);
 
@@ -882,6 +972,9 @@ X86VMTranslationMapPAE::ClearAccessedAndModified(VMArea* area, addr_t address,
 	if ((*pageDirEntry & X86_PAE_PDE_PRESENT) == 0)
 		return false;
 
+	if ((*pageDirEntry & X86_PAE_PDE_LARGE_PAGE) != 0)
+		_DemoteLargePage(pageDirEntry, address);
+
 	ThreadCPUPinner pinner(thread_get_current_thread());
 
 	pae_page_table_entry* entry
@@ -958,4 +1051,124 @@ X86VMTranslationMapPAE::PagingStructures() const
 }
 
 
+/*!	Replaces the page table referred to by \a pageDirEntry by a 2 MB page
+	mapping, if all of its entries map a suitably aligned, physically
+	contiguous range with the same attributes.
+	The page table itself is kept, so that the large page can be split up
+	again without having to allocate memory (cf. _DemoteLargePage()).
+	The map must be locked.
+*/
+void
+X86VMTranslationMapPAE::_PromotePageTable(
+	pae_page_directory_entry* pageDirEntry, addr_t address)
+{
+	address = ROUNDDOWN(address, kPAEPageTableRange);
+	phys_addr_t physicalPageTable = *pageDirEntry & X86_PAE_PDE_ADDRESS_MASK;
+
+	const pae_page_table_entry flagsMask = X86_PAE_PTE_PRESENT
+		| X86_PAE_PTE_PROTECTION_MASK | X86_PAE_PTE_MEMORY_TYPE_MASK
+		| X86_PAE_PTE_PAT | X86_PAE_PTE_GLOBAL | X86_PAE_PTE_NOT_EXECUTABLE;
+
+	Thread* thread = thread_get_current_thread();
+	ThreadCPUPinner pinner(thread);
+
+	pae_page_table_entry* pageTable
+		= (pae_page_table_entry*)fPageMapper->GetPageTableAt(
+			physicalPageTable);
+
+	pae_page_table_entry firstEntry = pageTable[0];
+	phys_addr_t physicalAddress = firstEntry & X86_PAE_PTE_ADDRESS_MASK;
+	if ((firstEntry & (X86_PAE_PTE_PRESENT | X86_PAE_PTE_PAT))
+			!= X86_PAE_PTE_PRESENT
+		|| physicalAddress % kPAEPageTableRange != 0) {
+		return;
+	}
+
+	for (uint32 i = 1; i < kPAEPageTableEntryCount; i++) {
+		if ((pageTable[i] & X86_PAE_PTE_ADDRESS_MASK)
+				!= physicalAddress + i * B_PAGE_SIZE
+			|| (pageTable[i] & flagsMask) != (firstEntry & flagsMask)) {
+			return;
+		}
+	}
+
+	// The pages that have been accessed might still be in a TLB. Since the
+	// translations don't change, invalidating them later is fine.
+	for (uint32 i = 0; i < kPAEPageTableEntryCount; i++) {
+		if ((pageTable[i] & X86_PAE_PTE_ACCESSED) != 0)
+			InvalidatePage(address + i * B_PAGE_SIZE);
+	}
+
+	pinner.Unlock();
+
+	// We don't track the accessed and dirty state of the individual pages
+	// anymore, so we mark them all accessed, and dirty, if writable. Note, that
+	// the flags are defined to the same values as the ones of page table
+	// entries.
+	X86PagingMethodPAE::SetPageTableEntry(pageDirEntry, physicalAddress
+		| (firstEntry & (flagsMask & ~X86_PAE_PTE_PAT))
+		| X86_PAE_PDE_LARGE_PAGE | X86_PAE_PDE_ACCESSED
+		| ((firstEntry & X86_PAE_PTE_WRITABLE) != 0
+			? X86_PAE_PDE_LARGE_DIRTY : 0));
+
+	SaveLargePageTable(vm_lookup_page(physicalPageTable / B_PAGE_SIZE),
+		address);
+
+	TRACE("X86VMTranslationMapPAE::_PromotePageTable(): %#" B_PRIxADDR
+		" -> %#" B_PRIxPHYSADDR "\n", address, physicalAddress);
+}
+
+
+/*!	Splits up the 2 MB page mapping referred to by \a pageDirEntry into page
+	sized ones again, using the page table it replaced.
+	The map must be locked.
+*/
+void
+X86VMTranslationMapPAE::_DemoteLargePage(
+	pae_page_directory_entry* pageDirEntry, addr_t address)
+{
+	address = ROUNDDOWN(address, kPAEPageTableRange);
+
+	vm_page* page = RemoveLargePageTable(address);
+	if (page == NULL) {
+		panic("X86VMTranslationMapPAE::_DemoteLargePage(): no page table for "
+			"large page at %#" B_PRIxADDR, address);
+		return;
+	}
+
+	phys_addr_t physicalPageTable
+		= (phys_addr_t)page->physical_page_number * B_PAGE_SIZE;
+
+	// Fill in the page table according to the large page. The flags are
+	// defined to the same values, the PAT bit aside, which we don't use.
+	pae_page_directory_entry largeEntry = *pageDirEntry;
+	pae_page_table_entry flags = largeEntry & (X86_PAE_PTE_PRESENT
+		| X86_PAE_PTE_PROTECTION_MASK | X86_PAE_PTE_MEMORY_TYPE_MASK
+		| X86_PAE_PTE_ACCESSED | X86_PAE_PTE_DIRTY | X86_PAE_PTE_GLOBAL
+		| X86_PAE_PTE_NOT_EXECUTABLE);
+	phys_addr_t physicalAddress = largeEntry & X86_PAE_PDE_LARGE_ADDRESS_MASK;
+
+	Thread* thread = thread_get_current_thread();
+	ThreadCPUPinner pinner(thread);
+
+	pae_page_table_entry* pageTable
+		= (pae_page_table_entry*)fPageMapper->GetPageTableAt(
+			physicalPageTable);
+	for (uint32 i = 0; i < kPAEPageTableEntryCount; i++)
+		pageTable[i] = (physicalAddress + i * B_PAGE_SIZE) | flags;
+
+	pinner.Unlock();
+
+	pae_page_directory_entry entry;
+	X86PagingMethodPAE::PutPageTableInPageDir(&entry, physicalPageTable, 0);
+	X86PagingMethodPAE::SetPageTableEntry(pageDirEntry, entry);
+
+	// invalidating any address within the large page removes it from the TLBs
+	InvalidatePage(address);
+
+	TRACE("X86VMTranslationMapPAE::_DemoteLargePage(): %#" B_PRIxADDR "\n",
+		address);
+}
+
+
 #endif	// B_HAIKU_PHYSICAL_BITS == 64
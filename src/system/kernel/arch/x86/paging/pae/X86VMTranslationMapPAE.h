@@ -7,6 +7,7 @@
 
 
 #include "paging/X86VMTranslationMap.h"
+#include "paging/pae/paging.h"
 
 
 #if B_HAIKU_PHYSICAL_BITS == 64
@@ -23,6 +24,7 @@ struct X86VMTranslationMapPAE : X86VMTranslationMap {
 
 	virtual	size_t				MaxPagesNeededToMap(addr_t start,
 									addr_t end) const;
+	virtual	size_t				LargePageSize() const;
 
 	virtual	status_t			Map(addr_t virtualAddress,
 									phys_addr_t physicalAddress,
@@ -63,6 +65,14 @@ struct X86VMTranslationMapPAE : X86VMTranslationMap {
 	inline	X86PagingStructuresPAE* PagingStructuresPAE() const
 									{ return fPagingStructures; }
 
+private:
+			void				_PromotePageTable(
+									pae_page_directory_entry* pageDirEntry,
+									addr_t address);
+			void				_DemoteLargePage(
+									pae_page_directory_entry* pageDirEntry,
+									addr_t address);
+
 private:
 			X86PagingStructuresPAE* fPagingStructures;
 };
@@ -34,6 +34,12 @@
 #define X86_PAE_PDE_ADDRESS_MASK		0x000ffffffffff000LL
 #define X86_PAE_PDE_NOT_EXECUTABLE		0x8000000000000000LL
 
+// additional page directory entry bits of 2 MB pages
+#define X86_PAE_PDE_LARGE_DIRTY			0x0000000000000040LL
+#define X86_PAE_PDE_LARGE_GLOBAL		0x0000000000000100LL
+#define X86_PAE_PDE_LARGE_PAT			0x0000000000001000LL
+#define X86_PAE_PDE_LARGE_ADDRESS_MASK	0x000fffffffe00000LL
+
 // page table entry bits
 #define X86_PAE_PTE_PRESENT				0x0000000000000001LL
 #define X86_PAE_PTE_WRITABLE			0x0000000000000002LL
@@ -0,0 +1,133 @@
+/*
+ * Copyright 2013, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include "x86_string.h"
+
+#include <KernelExport.h>
+
+#include <commpage.h>
+#include <cpu.h>
+#include <elf.h>
+#include <smp.h>
+
+
+//#define TRACE_X86_STRING
+#ifdef TRACE_X86_STRING
+#	define TRACE(x...) dprintf(x)
+#else
+#	define TRACE(x...) do {} while (false)
+#endif
+
+
+struct string_function {
+	int32		commpage_index;
+	const char*	commpage_symbol_name;
+	const char*	generic_name;
+	const char*	sse2_name;
+};
+
+
+static const string_function kStringFunctions[] = {
+	{ COMMPAGE_ENTRY_X86_MEMCPY, "commpage_memcpy", "memcpy_generic",
+		"x86_sse2_memcpy" },
+	{ COMMPAGE_ENTRY_X86_MEMSET, "commpage_memset", "memset_generic",
+		"x86_sse2_memset" },
+	{ COMMPAGE_ENTRY_X86_STRLEN, "commpage_strlen", "x86_generic_strlen",
+		"x86_sse2_strlen" },
+	{ COMMPAGE_ENTRY_X86_MEMCHR, "commpage_memchr", "x86_generic_memchr",
+		"x86_sse2_memchr" },
+	{ COMMPAGE_ENTRY_X86_MEMCMP, "commpage_memcmp", "x86_generic_memcmp",
+		"x86_sse2_memcmp" },
+	{ COMMPAGE_ENTRY_X86_STRCHR, "commpage_strchr", "x86_generic_strchr",
+		"x86_sse2_strchr" },
+	{ COMMPAGE_ENTRY_X86_STRCMP, "commpage_strcmp", "x86_generic_strcmp",
+		"x86_sse2_strcmp" },
+};
+
+
+static bool
+all_cpus_have_feature(enum x86_feature_type type, int feature)
+{
+	int cpuCount = smp_get_num_cpus();
+	for (int i = 0; i < cpuCount; i++) {
+		if (!(gCPU[i].arch.feature[type] & feature))
+			return false;
+	}
+
+	return true;
+}
+
+
+static void
+add_commpage_string_function(int32 commpageIndex,
+	const char* commpageSymbolName, const void* code, size_t size)
+{
+	fill_commpage_entry(commpageIndex, code, size);
+
+	// add the function to the commpage image
+	elf_add_memory_image_symbol(get_commpage_image(), commpageSymbolName,
+		((addr_t*)USER_COMMPAGE_ADDR)[commpageIndex], size,
+		B_SYMBOL_TYPE_TEXT);
+}
+
+
+/*!	Puts the userland string functions into the commpage, where libroot
+	jumps to. The SSE2 versions are used when all CPUs support SSE2, and the
+	kernel has enabled saving the XMM registers, unless the CPU module
+	provides its own memcpy() and memset().
+*/
+void
+x86_initialize_commpage_string_functions(
+	const x86_optimized_functions& cpuModuleFunctions)
+{
+	extern bool gHasSSE;
+	bool useSSE2 = gHasSSE
+		&& all_cpus_have_feature(FEATURE_COMMON, IA32_FEATURE_SSE2);
+
+	TRACE("x86_initialize_commpage_string_functions(): using %s string "
+		"functions\n", useSSE2 ? "SSE2" : "generic");
+
+	for (size_t i = 0;
+			i < sizeof(kStringFunctions) / sizeof(kStringFunctions[0]); i++) {
+		const string_function& function = kStringFunctions[i];
+
+		// functions provided by the CPU module take precedence
+		if (function.commpage_index == COMMPAGE_ENTRY_X86_MEMCPY
+			&& cpuModuleFunctions.memcpy != NULL) {
+			add_commpage_string_function(function.commpage_index,
+				function.commpage_symbol_name,
+				(const void*)cpuModuleFunctions.memcpy,
+				(addr_t)cpuModuleFunctions.memcpy_end
+					- (addr_t)cpuModuleFunctions.memcpy);
+			continue;
+		}
+		if (function.commpage_index == COMMPAGE_ENTRY_X86_MEMSET
+			&& cpuModuleFunctions.memset != NULL) {
+			add_commpage_string_function(function.commpage_index,
+				function.commpage_symbol_name,
+				(const void*)cpuModuleFunctions.memset,
+				(addr_t)cpuModuleFunctions.memset_end
+					- (addr_t)cpuModuleFunctions.memset);
+			continue;
+		}
+
+		// look up the kernel symbol -- we need the size of the function
+		const char* name = useSSE2 ? function.sse2_name : function.generic_name;
+		elf_symbol_info symbolInfo;
+		if (elf_lookup_kernel_symbol(name, &symbolInfo) != B_OK) {
+			panic("x86_initialize_commpage_string_functions(): Failed to "
+				"find string function \"%s\"!", name);
+			continue;
+		}
+
+		TRACE("commpage string function %s: %p, %lu bytes\n", name,
+			(void*)symbolInfo.address, symbolInfo.size);
+
+		add_commpage_string_function(function.commpage_index,
+			function.commpage_symbol_name, (const void*)symbolInfo.address,
+			symbolInfo.size);
+	}
+}
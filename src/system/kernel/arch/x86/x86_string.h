@@ -0,0 +1,16 @@
+/*
+ * Copyright 2013, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef _KERNEL_ARCH_X86_STRING_H
+#define _KERNEL_ARCH_X86_STRING_H
+
+
+#include <arch_cpu.h>
+
+
+void	x86_initialize_commpage_string_functions(
+			const x86_optimized_functions& cpuModuleFunctions);
+
+
+#endif	// _KERNEL_ARCH_X86_STRING_H
@@ -10,6 +10,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+#include <sys/uio.h>
 
 #include <KernelExport.h>
 #include <fs_cache.h>
@@ -30,7 +31,7 @@
 
 // TODO: this is a naive but growing implementation to test the API:
 //	block reading/writing is not at all optimized for speed, it will
-//	just read and write single blocks.
+//	just read and write single blocks, unless asked to prefetch.
 // TODO: the retrieval/copy of the original data could be delayed until the
 //		new data must be written, ie. in low memory situations.
 
@@ -47,6 +48,8 @@
 
 static const bigtime_t kTransactionIdleTime = 2000000LL;
 	// a transaction is considered idle after 2 seconds of inactivity
+static const size_t kMaxPrefetchBlocks = 32;
+	// maximum number of blocks that are read in with a single prefetch I/O
 
 
 struct cache_transaction;
@@ -174,6 +177,15 @@ typedef DoublyLinkedList<cache_listener,
 	DoublyLinkedListMemberGetLink<cache_listener,
 		&cache_listener::link> > ListenerList;
 
+struct prefetch_request : DoublyLinkedListLinkImpl<prefetch_request> {
+	block_cache*	cache;
+	off_t			block_number;
+	size_t			count;
+	cached_block*	blocks[kMaxPrefetchBlocks];
+};
+
+typedef DoublyLinkedList<prefetch_request> PrefetchRequestList;
+
 
 struct cache_transaction {
 	cache_transaction();
@@ -683,6 +695,11 @@ static DoublyLinkedListLink<block_cache> sMarkCache;
 	// TODO: this only works if the link is the first entry of block_cache
 static object_cache* sBlockCache;
 
+static mutex sPrefetchLock = MUTEX_INITIALIZER("block cache prefetch");
+static ConditionVariable sPrefetchCondition;
+static PrefetchRequestList sPrefetchRequests;
+static thread_id sPrefetcherThread;
+
 
 //	#pragma mark - notifications/listener
 
@@ -2420,6 +2437,90 @@ dump_block_data(int argc, char** argv)
 #endif	// DEBUG_BLOCK_CACHE
 
 
+//	#pragma mark - prefetching
+
+
+/*!	Finishes a prefetch request after its I/O has been done: the blocks that
+	could be read in are made available as unused blocks, all others are
+	removed from the cache again.
+	\a bytesRead is the result of the scatter/gather read of the request.
+*/
+static void
+finish_prefetch_request(prefetch_request* request, ssize_t bytesRead)
+{
+	block_cache* cache = request->cache;
+	MutexLocker locker(&cache->lock);
+
+	size_t blocksRead = bytesRead > 0 ? bytesRead / cache->block_size : 0;
+	int32 now = system_time() / 1000000L;
+
+	for (size_t i = 0; i < request->count; i++) {
+		cached_block* block = request->blocks[i];
+		mark_block_unbusy_reading(cache, block);
+
+		if (i >= blocksRead || block->discard) {
+			// Anyone waiting for this block will retry, and read it in itself
+			if (i >= blocksRead) {
+				TB(Error(cache, block->block_number, "prefetch failed",
+					bytesRead));
+			}
+			cache->RemoveBlock(block);
+			continue;
+		}
+
+		TB(Read(cache, block));
+
+		if (block->ref_count == 0 && block->transaction == NULL
+			&& block->previous_transaction == NULL) {
+			block->last_accessed = now;
+			block->unused = true;
+			cache->unused_blocks.Add(block);
+			cache->unused_block_count++;
+		}
+	}
+}
+
+
+/*!	Background thread that reads in the blocks of the queued prefetch
+	requests, one scatter/gather I/O per request.
+*/
+static status_t
+block_prefetcher(void* /*data*/)
+{
+	while (true) {
+		MutexLocker locker(sPrefetchLock);
+
+		prefetch_request* request = sPrefetchRequests.RemoveHead();
+		if (request == NULL) {
+			ConditionVariableEntry entry;
+			sPrefetchCondition.Add(&entry);
+			locker.Unlock();
+
+			entry.Wait();
+			continue;
+		}
+
+		locker.Unlock();
+
+		block_cache* cache = request->cache;
+		iovec vecs[kMaxPrefetchBlocks];
+		for (size_t i = 0; i < request->count; i++) {
+			vecs[i].iov_base = request->blocks[i]->current_data;
+			vecs[i].iov_len = cache->block_size;
+		}
+
+		ssize_t bytesRead = readv_pos(cache->fd,
+			request->block_number * cache->block_size, vecs, request->count);
+
+		finish_prefetch_request(request, bytesRead);
+		delete request;
+	}
+
+	// never can get here
+	return B_OK;
+}
+
+
 /*!	Traverses through the block_cache list, and returns one cache after the
 	other. The cache returned is automatically locked when you get it, and
 	unlocked with the next call to this function. Ignores caches that are in
@@ -2622,6 +2723,15 @@ block_cache_init(void)
 	if (sNotifierWriterThread >= B_OK)
 		resume_thread(sNotifierWriterThread);
 
+	new (&sPrefetchRequests) PrefetchRequestList;
+		// manually call constructor
+	sPrefetchCondition.Init(&sPrefetchRequests, "block cache prefetch");
+
+	sPrefetcherThread = spawn_kernel_thread(&block_prefetcher,
+		"block prefetcher", B_NORMAL_PRIORITY, NULL);
+	if (sPrefetcherThread >= B_OK)
+		resume_thread(sPrefetcherThread);
+
 #if DEBUG_BLOCK_CACHE
 	add_debugger_command_etc("block_caches", &dump_caches,
 		"dumps all block caches", "\n", 0);
@@ -3529,6 +3639,98 @@ block_cache_get(void* _cache, off_t blockNumber)
 }
 
 
+/*!	Schedules the blocks starting at \a blockNumber to be read into the cache
+	asynchronously.
+	Blocks at the start of the range that are already cached are skipped;
+	from there on, only the contiguous run of blocks that are not yet in the
+	cache is prefetched, and read in with a single scatter/gather I/O.
+	The blocks are marked busy while the read is pending, so that anyone
+	requesting them in the mean time will wait for the I/O to complete
+	instead of issuing its own read.
+
+	\param _numBlocks On input, the number of blocks that should be
+		prefetched; on output, the number of blocks that are actually being
+		read in. This may be less, as prefetching stops at the first cached
+		block following the missing ones, and at most
+		\c kMaxPrefetchBlocks are read at once.
+*/
+status_t
+block_cache_prefetch(void* _cache, off_t blockNumber, size_t* _numBlocks)
+{
+	block_cache* cache = (block_cache*)_cache;
+	size_t numBlocks = *_numBlocks;
+	*_numBlocks = 0;
+
+	if (blockNumber < 0 || blockNumber >= cache->max_blocks)
+		return B_BAD_VALUE;
+
+	if (sPrefetcherThread < B_OK)
+		return B_NOT_SUPPORTED;
+
+	// Don't add to the memory pressure
+	if (low_resource_state(B_KERNEL_RESOURCE_PAGES | B_KERNEL_RESOURCE_MEMORY
+			| B_KERNEL_RESOURCE_ADDRESS_SPACE) != B_NO_LOW_RESOURCE)
+		return B_NO_MEMORY;
+
+	if (numBlocks > kMaxPrefetchBlocks)
+		numBlocks = kMaxPrefetchBlocks;
+	if (numBlocks > cache->max_blocks - blockNumber)
+		numBlocks = cache->max_blocks - blockNumber;
+	if (numBlocks == 0)
+		return B_OK;
+
+	MutexLocker locker(&cache->lock);
+
+	// skip the blocks that are already in the cache
+	while (numBlocks > 0 && hash_lookup(cache->hash, &blockNumber) != NULL) {
+		blockNumber++;
+		numBlocks--;
+	}
+	if (numBlocks == 0)
+		return B_OK;
+
+	prefetch_request* request = new(std::nothrow) prefetch_request;
+	if (request == NULL)
+		return B_NO_MEMORY;
+
+	request->cache = cache;
+	request->block_number = blockNumber;
+	request->count = 0;
+
+	for (size_t i = 0; i < numBlocks; i++) {
+		off_t number = blockNumber + i;
+		if (hash_lookup(cache->hash, &number) != NULL)
+			break;
+
+		cached_block* block = cache->NewBlock(number);
+		if (block == NULL)
+			break;
+
+		hash_insert_grow(cache->hash, block);
+		mark_block_busy_reading(cache, block);
+
+		request->blocks[request->count++] = block;
+	}
+
+	locker.Unlock();
+
+	if (request->count == 0) {
+		delete request;
+		return B_OK;
+	}
+
+	*_numBlocks = request->count;
+	TRACE(("block_cache_prefetch(): prefetch %" B_PRIuSIZE " blocks at %"
+		B_PRIdOFF "\n", request->count, blockNumber));
+
+	MutexLocker prefetchLocker(sPrefetchLock);
+	sPrefetchRequests.Add(request);
+	sPrefetchCondition.NotifyOne();
+
+	return B_OK;
+}
+
+
 /*!	Changes the internal status of a writable block to \a dirty. This can be
 	helpful in case you realize you don't need to change that block anymore
 	for whatever reason.
@@ -6,6 +6,7 @@
 
 #include "vnode_store.h"
 
+#include <limits.h>
 #include <unistd.h>
 #include <stdlib.h>
 #include <string.h>
@@ -19,6 +20,7 @@
 #include <low_resource_manager.h>
 #include <thread.h>
 #include <util/AutoLock.h>
+#include <util/DoublyLinkedList.h>
 #include <util/kernel_cpp.h>
 #include <vfs.h>
 #include <vm/vm.h>
@@ -42,6 +44,14 @@
 #define BYPASS_IO_SIZE		65536
 #define LAST_ACCESSES		3
 
+// maximum number of prefetch requests waiting for the prefetcher
+#define MAX_QUEUED_PREFETCHES	64
+
+// read-ahead window limits
+#define MIN_READ_AHEAD_SIZE		(MAX_IO_VECS * B_PAGE_SIZE)
+#define DEFAULT_READ_AHEAD_SIZE	(2 * 1024 * 1024)
+#define MAX_READ_AHEAD_SIZE		(64 * 1024 * 1024)
+
 struct file_cache_ref {
 	VMCache			*cache;
 	struct vnode	*vnode;
@@ -52,6 +62,13 @@ struct file_cache_ref {
 	int32			last_access_index;
 	uint16			disabled_count;
 
+	off_t			read_ahead_next;
+		// where the next read is expected, if the access is sequential
+	off_t			read_ahead_end;
+		// end of the range that has already been scheduled for read-ahead
+	size_t			read_ahead_size;
+		// current size of the read-ahead window, 0 if there is none
+
 	inline void SetLastAccess(int32 index, off_t access, bool isWrite)
 	{
 		// we remember writes as negative offsets
@@ -97,6 +114,16 @@ private:
 #endif
 };
 
+struct prefetch_request : DoublyLinkedListLinkImpl<prefetch_request> {
+	dev_t			device;
+	ino_t			node;
+	off_t			offset;
+	off_t			end;
+	uint32			priority;
+};
+
+typedef DoublyLinkedList<prefetch_request> PrefetchRequestList;
+
 typedef status_t (*cache_func)(file_cache_ref* ref, void* cookie, off_t offset,
 	int32 pageOffset, addr_t buffer, size_t bufferSize, bool useBuffer,
 	vm_page_reservation* reservation, size_t reservePages);
@@ -113,6 +140,15 @@ static const size_t kZeroVecSize = kZeroVecCount * B_PAGE_SIZE;
 static phys_addr_t sZeroPage;	// physical address
 static generic_io_vec sZeroVecs[kZeroVecCount];
 
+static mutex sPrefetchLock = MUTEX_INITIALIZER("file cache prefetch");
+static ConditionVariable sPrefetchCondition;
+static prefetch_request sPrefetchRequestPool[MAX_QUEUED_PREFETCHES];
+static PrefetchRequestList sFreePrefetchRequests;
+static PrefetchRequestList sPrefetchQueues[CACHE_PREFETCH_PRIORITIES];
+	// one queue per priority class, CACHE_PREFETCH_LAUNCH first
+static thread_id sPrefetcherThread = -1;
+static size_t sMaxReadAheadSize = DEFAULT_READ_AHEAD_SIZE;
+
 
 //	#pragma mark -
 
@@ -282,6 +318,62 @@ push_access(file_cache_ref* ref, off_t offset, generic_size_t bytes,
 }
 
 
+/*!	Updates the read-ahead state of \a ref for a read of \a size bytes at
+	\a offset, and schedules reading ahead of it if needed.
+	The read-ahead window starts out with MIN_READ_AHEAD_SIZE once a read
+	continues where the previous one ended, and doubles with every further
+	sequential read up to sMaxReadAheadSize. A non-sequential read quarters
+	it, so that occasional seeks in a stream don't reset it completely.
+	The next window is scheduled as soon as the reader has consumed half of
+	the range read ahead so far, so that it doesn't have to wait for it.
+	The cache must be locked.
+*/
+static void
+read_ahead(file_cache_ref* ref, off_t offset, size_t size)
+{
+	off_t fileSize = ref->cache->virtual_end;
+	off_t end = offset + size;
+
+	if (offset == ref->read_ahead_next) {
+		if (ref->read_ahead_size == 0)
+			ref->read_ahead_size = MIN_READ_AHEAD_SIZE;
+		else if (ref->read_ahead_end - end < (off_t)ref->read_ahead_size / 2)
+			ref->read_ahead_size *= 2;
+
+		if (ref->read_ahead_size > sMaxReadAheadSize)
+			ref->read_ahead_size = sMaxReadAheadSize;
+	} else {
+		ref->read_ahead_size /= 4;
+		if (ref->read_ahead_size < MIN_READ_AHEAD_SIZE)
+			ref->read_ahead_size = 0;
+		ref->read_ahead_end = 0;
+	}
+
+	ref->read_ahead_next = end;
+
+	if (ref->read_ahead_size == 0 || end >= fileSize
+		|| ref->read_ahead_end - end >= (off_t)ref->read_ahead_size / 2)
+		return;
+
+	off_t start = max_c(ref->read_ahead_end, end);
+	off_t stop = min_c(end + (off_t)ref->read_ahead_size, fileSize);
+	if (start >= stop)
+		return;
+
+	ref->read_ahead_end = stop;
+
+	dev_t device;
+	ino_t node;
+	vfs_vnode_to_node_ref(ref->vnode, &device, &node);
+
+	TRACE(("%p: read ahead %Ld - %Ld, window %" B_PRIuSIZE "\n", ref, start,
+		stop, ref->read_ahead_size));
+
+	cache_prefetch_etc(device, node, start, stop - start,
+		CACHE_PREFETCH_READAHEAD);
+}
+
+
 static void
 reserve_pages(file_cache_ref* ref, vm_page_reservation* reservation,
 	size_t reservePages, bool isWrite)
@@ -752,6 +844,9 @@ cache_io(void* _cacheRef, void* cookie, off_t offset, addr_t buffer,
 
 	AutoLocker<VMCache> locker(cache);
 
+	if (!doWrite && useBuffer)
+		read_ahead(ref, offset + pageOffset, size);
+
 	while (bytesLeft > 0) {
 		// Periodically reevaluate the low memory situation and select the
 		// read/write hook accordingly
@@ -929,12 +1024,178 @@ file_cache_control(const char* subsystem, uint32 function, void* buffer,
 
 			return status;
 		}
+
+		case CACHE_SET_READ_AHEAD_LIMIT:
+		{
+			if (geteuid() != 0)
+				return B_NOT_ALLOWED;
+
+			size_t limit;
+			if (bufferSize != sizeof(size_t))
+				return B_BAD_VALUE;
+			if (!IS_USER_ADDRESS(buffer)
+				|| user_memcpy(&limit, buffer, sizeof(size_t)) < B_OK)
+				return B_BAD_ADDRESS;
+
+			// read_ahead() caps the window at this size; a limit of 0 turns
+			// read-ahead off
+			if (limit > MAX_READ_AHEAD_SIZE)
+				limit = MAX_READ_AHEAD_SIZE;
+			sMaxReadAheadSize = ROUNDUP(limit, B_PAGE_SIZE);
+			return B_OK;
+		}
 	}
 
 	return B_BAD_HANDLER;
 }
 
 
+//	#pragma mark - prefetcher
+
+
+/*!	Adds the range to an already queued request for the same node, if it
+	overlaps or directly adjoins it. A launch request absorbing a read-ahead
+	request moves it into the launch queue.
+	\a sPrefetchLock must be held.
+	Returns \c true if the range could be merged.
+*/
+static bool
+merge_prefetch_request(dev_t device, ino_t node, off_t offset, off_t end,
+	uint32 priority)
+{
+	for (uint32 i = 0; i < CACHE_PREFETCH_PRIORITIES; i++) {
+		PrefetchRequestList::Iterator iterator
+			= sPrefetchQueues[i].GetIterator();
+		while (prefetch_request* request = iterator.Next()) {
+			if (request->device != device || request->node != node
+				|| offset > request->end || end < request->offset)
+				continue;
+
+			request->offset = min_c(request->offset, offset);
+			request->end = max_c(request->end, end);
+
+			if (priority < request->priority) {
+				iterator.Remove();
+				request->priority = priority;
+				sPrefetchQueues[priority].Add(request);
+			}
+			return true;
+		}
+	}
+
+	return false;
+}
+
+
+/*!	Removes all queued prefetch requests with the given \a priority or a
+	lower one.
+	\a sPrefetchLock must be held.
+*/
+static void
+cancel_prefetch_requests(uint32 priority)
+{
+	for (uint32 i = priority; i < CACHE_PREFETCH_PRIORITIES; i++) {
+		while (prefetch_request* request = sPrefetchQueues[i].RemoveHead())
+			sFreePrefetchRequests.Add(request);
+	}
+}
+
+
+static void
+prefetch_low_resource_handler(void* /*data*/, uint32 resources, int32 level)
+{
+	MutexLocker locker(sPrefetchLock);
+
+	switch (level) {
+		case B_NO_LOW_RESOURCE:
+			return;
+		case B_LOW_RESOURCE_NOTE:
+			// read-ahead can easily be redone later
+			cancel_prefetch_requests(CACHE_PREFETCH_READAHEAD);
+			break;
+		case B_LOW_RESOURCE_WARNING:
+		case B_LOW_RESOURCE_CRITICAL:
+			cancel_prefetch_requests(CACHE_PREFETCH_LAUNCH);
+			break;
+	}
+}
+
+
+/*!	Background thread that carries out the queued prefetch requests, the
+	launch requests first.
+*/
+static status_t
+file_cache_prefetcher(void* /*data*/)
+{
+	while (true) {
+		MutexLocker locker(sPrefetchLock);
+
+		prefetch_request* request = NULL;
+		for (uint32 i = 0; i < CACHE_PREFETCH_PRIORITIES; i++) {
+			request = sPrefetchQueues[i].RemoveHead();
+			if (request != NULL)
+				break;
+		}
+
+		if (request == NULL) {
+			ConditionVariableEntry entry;
+			sPrefetchCondition.Add(&entry);
+			locker.Unlock();
+
+			entry.Wait();
+			continue;
+		}
+
+		prefetch_request copy = *request;
+		sFreePrefetchRequests.Add(request);
+		locker.Unlock();
+
+		if (low_resource_state(B_KERNEL_RESOURCE_PAGES)
+				!= B_NO_LOW_RESOURCE) {
+			// the low resource handler will cancel the rest of the queue
+			continue;
+		}
+
+		struct vnode* vnode;
+		if (vfs_get_vnode(copy.device, copy.node, true, &vnode) != B_OK)
+			continue;
+
+		off_t size = copy.end - copy.offset;
+		cache_prefetch_vnode(vnode, copy.offset,
+			size > (off_t)SIZE_MAX ? SIZE_MAX : (size_t)size);
+		vfs_put_vnode(vnode);
+	}
+
+	// never can get here
+	return B_OK;
+}
+
+
+static status_t
+init_prefetcher()
+{
+	new(&sFreePrefetchRequests) PrefetchRequestList;
+	for (uint32 i = 0; i < CACHE_PREFETCH_PRIORITIES; i++)
+		new(&sPrefetchQueues[i]) PrefetchRequestList;
+		// manually call constructors
+
+	for (uint32 i = 0; i < MAX_QUEUED_PREFETCHES; i++)
+		sFreePrefetchRequests.Add(&sPrefetchRequestPool[i]);
+
+	sPrefetchCondition.Init(&sPrefetchQueues, "file cache prefetch");
+
+	sPrefetcherThread = spawn_kernel_thread(&file_cache_prefetcher,
+		"file cache prefetcher", B_NORMAL_PRIORITY, NULL);
+	if (sPrefetcherThread < B_OK)
+		return sPrefetcherThread;
+
+	resume_thread(sPrefetcherThread);
+
+	return register_low_resource_handler(&prefetch_low_resource_handler,
+		NULL, B_KERNEL_RESOURCE_PAGES | B_KERNEL_RESOURCE_MEMORY, 0);
+}
+
+
 //	#pragma mark - private kernel API
 
 
@@ -1019,20 +1280,64 @@ cache_prefetch_vnode(struct vnode* vnode, off_t offset, size_t size)
 }
 
 
+/*!	Schedules the specified range of the node to be read into the file cache
+	by the prefetcher thread, and returns immediately.
+	Ranges that overlap with an already queued request are merged into it.
+	If the queue is full, a launch request replaces the oldest read-ahead
+	request; otherwise, the new request is dropped.
+*/
 extern "C" void
-cache_prefetch(dev_t mountID, ino_t vnodeID, off_t offset, size_t size)
+cache_prefetch_etc(dev_t mountID, ino_t vnodeID, off_t offset, size_t size,
+	uint32 priority)
 {
-	// ToDo: schedule prefetch
+	TRACE(("cache_prefetch_etc(vnode %ld:%Ld, priority %lu)\n", mountID,
+		vnodeID, priority));
+
+	if (size == 0 || offset < 0 || priority >= CACHE_PREFETCH_PRIORITIES)
+		return;
 
-	TRACE(("cache_prefetch(vnode %ld:%Ld)\n", mountID, vnodeID));
+	if (sPrefetcherThread < 0) {
+		// the prefetcher isn't running - do it synchronously
+		struct vnode* vnode;
+		if (vfs_get_vnode(mountID, vnodeID, true, &vnode) != B_OK)
+			return;
 
-	// get the vnode for the object, this also grabs a ref to it
-	struct vnode* vnode;
-	if (vfs_get_vnode(mountID, vnodeID, true, &vnode) != B_OK)
+		cache_prefetch_vnode(vnode, offset, size);
+		vfs_put_vnode(vnode);
 		return;
+	}
+
+	off_t end = (uint64)size >= (uint64)(OFF_MAX - offset)
+		? OFF_MAX : offset + (off_t)size;
+
+	MutexLocker locker(sPrefetchLock);
 
-	cache_prefetch_vnode(vnode, offset, size);
-	vfs_put_vnode(vnode);
+	if (merge_prefetch_request(mountID, vnodeID, offset, end, priority))
+		return;
+
+	prefetch_request* request = sFreePrefetchRequests.RemoveHead();
+	if (request == NULL && priority < CACHE_PREFETCH_READAHEAD)
+		request = sPrefetchQueues[CACHE_PREFETCH_READAHEAD].RemoveHead();
+	if (request == NULL) {
+		TRACE(("cache_prefetch_etc(): queue full, dropping request\n"));
+		return;
+	}
+
+	request->device = mountID;
+	request->node = vnodeID;
+	request->offset = offset;
+	request->end = end;
+	request->priority = priority;
+
+	sPrefetchQueues[priority].Add(request);
+	sPrefetchCondition.NotifyOne();
+}
+
+
+extern "C" void
+cache_prefetch(dev_t mountID, ino_t vnodeID, off_t offset, size_t size)
+{
+	cache_prefetch_etc(mountID, vnodeID, offset, size, CACHE_PREFETCH_LAUNCH);
 }
 
 
@@ -1112,6 +1417,10 @@ file_cache_init(void)
 	}
 
 	register_generic_syscall(CACHE_SYSCALLS, file_cache_control, 1, 0);
+
+	if (init_prefetcher() != B_OK)
+		dprintf("file_cache: could not start prefetcher!\n");
+
 	return B_OK;
 }
 
@@ -1132,6 +1441,9 @@ file_cache_create(dev_t mountID, ino_t vnodeID, off_t size)
 	memset(ref->last_access, 0, sizeof(ref->last_access));
 	ref->last_access_index = 0;
 	ref->disabled_count = 0;
+	ref->read_ahead_next = -1;
+	ref->read_ahead_end = 0;
+	ref->read_ahead_size = 0;
 
 	// TODO: delay VMCache creation until data is
 	//	requested/written for the first time? Listing lots of
@@ -24,6 +24,7 @@
 #include <vm/VMCache.h>
 
 #include "kernel_debug_config.h"
+#include "vnode_store.h"
 
 
 //#define TRACE_FILE_MAP
@@ -602,7 +603,20 @@ file_map_create(dev_t mountID, ino_t vnodeID, off_t size)
 	if (vfs_lookup_vnode(mountID, vnodeID, &vnode) != B_OK)
 		return NULL;
 
-	return new(std::nothrow) FileMap(vnode, size);
+	FileMap* map = new(std::nothrow) FileMap(vnode, size);
+	if (map == NULL)
+		return NULL;
+
+	// let the page writer know where the file's pages end up on disk
+	VMCache* cache;
+	if (vfs_get_vnode_cache(vnode, &cache, false) == B_OK) {
+		cache->Lock();
+		((VMVnodeCache*)cache)->SetFileMap(map);
+		cache->Unlock();
+		cache->ReleaseRef();
+	}
+
+	return map;
 }
 
 
@@ -614,6 +628,16 @@ file_map_delete(void* _map)
 		return;
 
 	TRACE("file_map_delete(map = %p)\n", map);
+
+	VMCache* cache;
+	if (vfs_get_vnode_cache(map->Vnode(), &cache, false) == B_OK) {
+		cache->Lock();
+		if (((VMVnodeCache*)cache)->FileMap() == map)
+			((VMVnodeCache*)cache)->SetFileMap(NULL);
+		cache->Unlock();
+		cache->ReleaseRef();
+	}
+
 	delete map;
 }
 
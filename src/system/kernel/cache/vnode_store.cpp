@@ -26,6 +26,7 @@ VMVnodeCache::Init(struct vnode* vnode, uint32 allocationFlags)
 
 	fVnode = vnode;
 	fFileCacheRef = NULL;
+	fFileMap = NULL;
 	fVnodeDeleted = false;
 
 	vfs_vnode_to_node_ref(fVnode, &fDevice, &fInode);
@@ -46,6 +46,11 @@ public:
 			file_cache_ref*		FileCacheRef() const
 									{ return fFileCacheRef; }
 
+			void				SetFileMap(void* map)
+									{ fFileMap = map; }
+			void*				FileMap() const
+									{ return fFileMap; }
+
 			void				VnodeDeleted()	{ fVnodeDeleted = true; }
 
 protected:
@@ -54,6 +59,7 @@ protected:
 private:
 			struct vnode*		fVnode;
 			file_cache_ref*		fFileCacheRef;
+			void*				fFileMap;
 			ino_t				fInode;
 			dev_t				fDevice;
 	volatile bool				fVnodeDeleted;
@@ -0,0 +1,678 @@
+/*
+ * Copyright 2013, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Persistent event queues.
+
+	In contrast to wait_for_objects(), select(), and poll(), the objects to
+	wait for are registered with the queue only once, and stay selected until
+	they are removed again. Waiting thus only costs in proportion to the
+	number of objects that are actually ready, not to the number of objects
+	that are watched.
+
+	Every registered object is represented by an EventQueueEntry, which is
+	the select_info that is passed to the object's select() hook. Each entry
+	has its own select_sync, so that objects that keep a reference to it
+	(FDs and threads) can outlive the registration, or even the queue; the
+	entry is only freed when the last reference to its sync is gone.
+	Notifications append the entry to the queue's ready list, and release the
+	queue's semaphore that event_queue_wait() blocks on.
+*/
+
+
+#include <event_queue.h>
+
+#include <new>
+
+#include <fcntl.h>
+#include <stdlib.h>
+
+#include <AutoDeleter.h>
+#include <event_queue_defs.h>
+#include <fs/fd.h>
+#include <kernel.h>
+#include <lock.h>
+#include <Referenceable.h>
+#include <sem.h>
+#include <syscall_restart.h>
+#include <team.h>
+#include <util/AutoLock.h>
+#include <util/DoublyLinkedList.h>
+#include <util/OpenHashTable.h>
+#include <wait_for_objects.h>
+
+
+//#define TRACE_EVENT_QUEUE
+#ifdef TRACE_EVENT_QUEUE
+#	define TRACE(x) dprintf x
+#else
+#	define TRACE(x) ;
+#endif
+
+
+// the maximum number of events a single event_queue_wait() call returns
+static const int kMaxWaitInfos = 1024;
+
+static const uint16 kEventQueueFlags = B_EVENT_LEVEL_TRIGGERED
+	| B_EVENT_ONE_SHOT;
+
+
+class EventQueue;
+
+
+struct EventQueueEntry : select_info,
+		DoublyLinkedListLinkImpl<EventQueueEntry> {
+	EventQueue*			queue;
+	EventQueueEntry*	hash_next;
+	select_sync			own_sync;
+	int32				object;
+	uint16				type;
+	uint16				requested_events;
+	void*				user_data;
+	uint32				dequeue_generation;
+	bool				queued;
+	bool				deleted;
+};
+
+
+struct EventQueueEntryKey {
+	int32	object;
+	uint16	type;
+
+	EventQueueEntryKey(int32 object, uint16 type)
+		:
+		object(object),
+		type(type)
+	{
+	}
+};
+
+
+struct EventQueueEntryHashDefinition {
+	typedef EventQueueEntryKey	KeyType;
+	typedef	EventQueueEntry		ValueType;
+
+	size_t HashKey(const EventQueueEntryKey& key) const
+	{
+		return (size_t)key.object ^ ((size_t)key.type << 24);
+	}
+
+	size_t Hash(const EventQueueEntry* value) const
+	{
+		return HashKey(EventQueueEntryKey(value->object, value->type));
+	}
+
+	bool Compare(const EventQueueEntryKey& key,
+		const EventQueueEntry* value) const
+	{
+		return value->object == key.object && value->type == key.type;
+	}
+
+	EventQueueEntry*& GetLink(EventQueueEntry* value) const
+	{
+		return value->hash_next;
+	}
+};
+
+
+typedef BOpenHashTable<EventQueueEntryHashDefinition> EventQueueEntryTable;
+typedef DoublyLinkedList<EventQueueEntry> EventQueueEntryList;
+
+
+class EventQueue : public BReferenceable {
+public:
+								EventQueue();
+	virtual						~EventQueue();
+
+			status_t			Init();
+
+			team_id				Team() const { return fTeam; }
+
+			status_t			Select(int32 object, uint16 type,
+									uint16 events, void* userData);
+			ssize_t				Wait(event_wait_info* infos, int numInfos,
+									uint32 flags, bigtime_t timeout);
+			void				Close();
+
+private:
+	static	void				_Notify(select_info* info);
+	static	void				_Destroy(select_sync* sync);
+
+			status_t			_Select(int32 object, uint16 type,
+									uint16 events, void* userData);
+
+			EventQueueEntry*	_CreateEntry(int32 object, uint16 type,
+									uint16 events, void* userData);
+			void				_Remove(EventQueueEntry* entry);
+			void				_Deactivate(EventQueueEntry* entry,
+									bool deselect);
+			void				_Enqueue(EventQueueEntry* entry);
+			ssize_t				_DequeueEvents(event_wait_info* infos,
+									int numInfos);
+
+private:
+			mutex				fLock;
+				// guards the entries, serializes Select() and Wait()
+			spinlock			fReadyLock;
+				// guards the ready list and the entries' queued/deleted flags
+			sem_id				fSem;
+			team_id				fTeam;
+			uint32				fDequeueGeneration;
+			bool				fClosed;
+			EventQueueEntryTable fEntries;
+			EventQueueEntryList	fReadyList;
+};
+
+
+EventQueue::EventQueue()
+	:
+	fSem(-1),
+	fTeam(team_get_current_team_id()),
+	fDequeueGeneration(0),
+	fClosed(false)
+{
+	mutex_init(&fLock, "event queue");
+	B_INITIALIZE_SPINLOCK(&fReadyLock);
+}
+
+
+EventQueue::~EventQueue()
+{
+	if (!fClosed && fSem >= 0)
+		delete_sem(fSem);
+
+	mutex_destroy(&fLock);
+}
+
+
+status_t
+EventQueue::Init()
+{
+	status_t status = fEntries.Init();
+	if (status != B_OK)
+		return status;
+
+	fSem = create_sem(0, "event queue");
+	return fSem >= 0 ? B_OK : fSem;
+}
+
+
+/*!	Adds the object to the queue, or changes the events selected for it, if
+	it has already been added before. If \a events is 0, the object is
+	removed from the queue instead.
+	If selecting the object with the new events fails, a previous
+	registration is left untouched.
+*/
+status_t
+EventQueue::Select(int32 object, uint16 type, uint16 events, void* userData)
+{
+	MutexLocker locker(fLock);
+
+	if (fClosed)
+		return B_FILE_ERROR;
+
+	return _Select(object, type, events, userData);
+}
+
+
+ssize_t
+EventQueue::Wait(event_wait_info* infos, int numInfos, uint32 flags,
+	bigtime_t timeout)
+{
+	while (true) {
+		MutexLocker locker(fLock);
+
+		if (fClosed)
+			return B_FILE_ERROR;
+
+		ssize_t count = _DequeueEvents(infos, numInfos);
+		if (count > 0)
+			return count;
+
+		locker.Unlock();
+
+		// The semaphore is released once for every entry that is added to
+		// the ready list, but the entry may already have been dequeued by
+		// another waiter, so we may wake up without anything to report.
+		status_t status = acquire_sem_etc(fSem, 1, B_CAN_INTERRUPT | flags,
+			timeout);
+		if (status != B_OK)
+			return status == B_BAD_SEM_ID ? B_FILE_ERROR : status;
+	}
+}
+
+
+/*!	Called when the queue's FD is closed. Removes all objects from the queue,
+	and wakes up all waiters.
+	If the queue is closed by another team than the one that created it (it
+	may have been inherited by fork()), the FDs that have been added are not
+	ours to deselect; their entries are just deactivated, and are freed once
+	the FDs are closed in the owning team.
+*/
+void
+EventQueue::Close()
+{
+	MutexLocker locker(fLock);
+
+	fClosed = true;
+	bool ownerTeam = team_get_current_team_id() == fTeam;
+
+	EventQueueEntry* entry = fEntries.Clear(true);
+	while (entry != NULL) {
+		EventQueueEntry* next = entry->hash_next;
+		_Deactivate(entry, entry->type != B_OBJECT_TYPE_FD || ownerTeam);
+		entry = next;
+	}
+
+	delete_sem(fSem);
+}
+
+
+/*static*/ void
+EventQueue::_Notify(select_info* info)
+{
+	EventQueueEntry* entry = static_cast<EventQueueEntry*>(info);
+	entry->queue->_Enqueue(entry);
+}
+
+
+/*static*/ void
+EventQueue::_Destroy(select_sync* sync)
+{
+	EventQueueEntry* entry = static_cast<EventQueueEntry*>(sync->set);
+	EventQueue* queue = entry->queue;
+
+	delete entry;
+	queue->ReleaseReference();
+}
+
+
+/*!	fLock must be held.
+*/
+status_t
+EventQueue::_Select(int32 object, uint16 type, uint16 events, void* userData)
+{
+	EventQueueEntry* oldEntry
+		= fEntries.Lookup(EventQueueEntryKey(object, type));
+
+	if (events == 0) {
+		if (oldEntry == NULL)
+			return B_ENTRY_NOT_FOUND;
+
+		_Remove(oldEntry);
+		return B_OK;
+	}
+
+	EventQueueEntry* entry = _CreateEntry(object, type, events, userData);
+	if (entry == NULL)
+		return B_NO_MEMORY;
+
+	status_t status = select_object(type, object, entry, false);
+	if (status != B_OK) {
+		_Deactivate(entry, false);
+		return status;
+	}
+
+	if (oldEntry != NULL)
+		_Remove(oldEntry);
+
+	status = fEntries.Insert(entry);
+	if (status != B_OK)
+		_Deactivate(entry, true);
+
+	return status;
+}
+
+
+EventQueueEntry*
+EventQueue::_CreateEntry(int32 object, uint16 type, uint16 events,
+	void* userData)
+{
+	EventQueueEntry* entry = new(std::nothrow) EventQueueEntry;
+	if (entry == NULL)
+		return NULL;
+
+	entry->next = NULL;
+	entry->sync = &entry->own_sync;
+	entry->events = 0;
+	entry->selected_events = (events & ~kEventQueueFlags)
+		| B_EVENT_INVALID | B_EVENT_ERROR | B_EVENT_DISCONNECTED;
+
+	// the queue's reference to the sync, surrendered in _Deactivate()
+	entry->own_sync.ref_count = 1;
+	entry->own_sync.sem = -1;
+	entry->own_sync.count = 1;
+	entry->own_sync.set = entry;
+	entry->own_sync.notify = &_Notify;
+	entry->own_sync.destroy = &_Destroy;
+
+	entry->queue = this;
+	entry->hash_next = NULL;
+	entry->object = object;
+	entry->type = type;
+	entry->requested_events = events;
+	entry->user_data = userData;
+	entry->dequeue_generation = 0;
+	entry->queued = false;
+	entry->deleted = false;
+
+	AcquireReference();
+	return entry;
+}
+
+
+void
+EventQueue::_Remove(EventQueueEntry* entry)
+{
+	fEntries.RemoveUnchecked(entry);
+	_Deactivate(entry, true);
+}
+
+
+/*!	Makes sure the entry is no longer reported, and surrenders the queue's
+	reference to it. The entry must not be in the hash table anymore.
+	fLock must be held.
+*/
+void
+EventQueue::_Deactivate(EventQueueEntry* entry, bool deselect)
+{
+	InterruptsSpinLocker locker(fReadyLock);
+	entry->deleted = true;
+	if (entry->queued) {
+		fReadyList.Remove(entry);
+		entry->queued = false;
+	}
+	locker.Unlock();
+
+	if (deselect)
+		deselect_object(entry->type, entry->object, entry, false);
+
+	put_select_sync(&entry->own_sync);
+}
+
+
+/*!	Called by the notification hook, in any context.
+*/
+void
+EventQueue::_Enqueue(EventQueueEntry* entry)
+{
+	InterruptsSpinLocker locker(fReadyLock);
+
+	if (entry->queued || entry->deleted)
+		return;
+
+	entry->queued = true;
+	fReadyList.Add(entry);
+
+	locker.Unlock();
+
+	release_sem_etc(fSem, 1, B_DO_NOT_RESCHEDULE);
+}
+
+
+/*!	Removes up to \a numInfos entries from the ready list, and fills in
+	\a infos with their events. Every entry is reported at most once per call.
+	Entries that have become invalid, or that were added with
+	B_EVENT_ONE_SHOT, are removed from the queue. Entries that were added
+	with B_EVENT_LEVEL_TRIGGERED are selected again, so that they are
+	reported again by the next call if their object is still ready.
+	fLock must be held.
+*/
+ssize_t
+EventQueue::_DequeueEvents(event_wait_info* infos, int numInfos)
+{
+	uint32 generation = ++fDequeueGeneration;
+	ssize_t count = 0;
+
+	while (count < numInfos) {
+		InterruptsSpinLocker locker(fReadyLock);
+
+		EventQueueEntry* entry = fReadyList.Head();
+		if (entry == NULL || entry->dequeue_generation == generation) {
+			// nothing left, or only entries that have been notified again
+			// since we reported them
+			break;
+		}
+
+		fReadyList.Remove(entry);
+		entry->queued = false;
+		entry->dequeue_generation = generation;
+
+		// any event after this point will queue the entry again
+		uint16 events = atomic_and(&entry->events, 0)
+			& entry->selected_events;
+
+		locker.Unlock();
+
+		if (events == 0)
+			continue;
+
+		infos[count].object = entry->object;
+		infos[count].type = entry->type;
+		infos[count].events = events;
+		infos[count].user_data = entry->user_data;
+		count++;
+
+		if ((events & B_EVENT_INVALID) != 0
+			|| (entry->requested_events & B_EVENT_ONE_SHOT) != 0) {
+			_Remove(entry);
+		}
+	}
+
+	// An object's select_info must not be reused, as it might still be in use
+	// by whoever is about to notify it (a closing FD, or an exiting thread).
+	// Level-triggered objects are therefore selected again with a new entry
+	// that replaces the old one. If that fails, the old entry will still
+	// report the object becoming invalid.
+	for (ssize_t i = 0; i < count; i++) {
+		EventQueueEntry* entry = fEntries.Lookup(
+			EventQueueEntryKey(infos[i].object, infos[i].type));
+		if (entry != NULL
+			&& (entry->requested_events & B_EVENT_LEVEL_TRIGGERED) != 0) {
+			_Select(entry->object, entry->type, entry->requested_events,
+				entry->user_data);
+		}
+	}
+
+	return count;
+}
+
+
+// #pragma mark - FD ops
+
+
+static status_t
+event_queue_close(file_descriptor* descriptor)
+{
+	EventQueue* queue = (EventQueue*)descriptor->cookie;
+	queue->Close();
+	return B_OK;
+}
+
+
+static void
+event_queue_free(file_descriptor* descriptor)
+{
+	EventQueue* queue = (EventQueue*)descriptor->cookie;
+	queue->ReleaseReference();
+}
+
+
+static struct fd_ops sEventQueueFDOps = {
+	NULL,	// fd_read
+	NULL,	// fd_write
+	NULL,	// fd_seek
+	NULL,	// fd_ioctl
+	NULL,	// fd_set_flags
+	NULL,	// fd_select
+	NULL,	// fd_deselect
+	NULL,	// fd_read_dir
+	NULL,	// fd_rewind_dir
+	NULL,	// fd_read_stat
+	NULL,	// fd_write_stat
+	&event_queue_close,
+	&event_queue_free
+};
+
+
+/*!	Returns the event queue of the given FD with a reference, or \c NULL, if
+	the FD is not an event queue owned by the current team.
+*/
+static EventQueue*
+get_event_queue(int fd, status_t& _error)
+{
+	file_descriptor* descriptor = get_fd(get_current_io_context(false), fd);
+	if (descriptor == NULL) {
+		_error = B_FILE_ERROR;
+		return NULL;
+	}
+
+	EventQueue* queue = NULL;
+	if (descriptor->type != FDTYPE_EVENT_QUEUE)
+		_error = B_BAD_VALUE;
+	else if (((EventQueue*)descriptor->cookie)->Team()
+			!= team_get_current_team_id()) {
+		_error = B_NOT_ALLOWED;
+	} else {
+		queue = (EventQueue*)descriptor->cookie;
+		queue->AcquireReference();
+	}
+
+	put_fd(descriptor);
+	return queue;
+}
+
+
+// #pragma mark - syscalls
+
+
+int
+_user_event_queue_create(int openFlags)
+{
+	EventQueue* queue = new(std::nothrow) EventQueue;
+	if (queue == NULL)
+		return B_NO_MEMORY;
+	BReference<EventQueue> queueReference(queue, true);
+
+	status_t status = queue->Init();
+	if (status != B_OK)
+		return status;
+
+	file_descriptor* descriptor = alloc_fd();
+	if (descriptor == NULL)
+		return B_NO_MEMORY;
+
+	descriptor->type = FDTYPE_EVENT_QUEUE;
+	descriptor->ops = &sEventQueueFDOps;
+	descriptor->cookie = queue;
+	descriptor->open_mode = O_RDWR;
+
+	io_context* context = get_current_io_context(false);
+	int fd = new_fd(context, descriptor);
+	if (fd < 0) {
+		free(descriptor);
+		return fd;
+	}
+
+	mutex_lock(&context->io_mutex);
+	fd_set_close_on_exec(context, fd, (openFlags & O_CLOEXEC) != 0);
+	mutex_unlock(&context->io_mutex);
+
+	// the descriptor owns the reference now
+	queueReference.Detach();
+
+	TRACE(("event queue %p created: fd %d\n", queue, fd));
+	return fd;
+}
+
+
+/*!	Adds the objects to the queue, changes their selected events, or, if
+	their events are 0, removes them from the queue again.
+	The events of the objects that could not be selected are set to
+	B_EVENT_INVALID; in that case the error of the first of those is
+	returned.
+*/
+status_t
+_user_event_queue_select(int queueFD, event_wait_info* userInfos,
+	int numInfos)
+{
+	if (numInfos < 0 || numInfos > kMaxWaitInfos)
+		return B_BAD_VALUE;
+	if (numInfos == 0)
+		return B_OK;
+
+	if (userInfos == NULL || !IS_USER_ADDRESS(userInfos))
+		return B_BAD_ADDRESS;
+
+	status_t error;
+	EventQueue* queue = get_event_queue(queueFD, error);
+	if (queue == NULL)
+		return error;
+	BReference<EventQueue> queueReference(queue, true);
+
+	size_t bytes = sizeof(event_wait_info) * numInfos;
+	event_wait_info* infos = (event_wait_info*)malloc(bytes);
+	if (infos == NULL)
+		return B_NO_MEMORY;
+	MemoryDeleter infosDeleter(infos);
+
+	if (user_memcpy(infos, userInfos, bytes) != B_OK)
+		return B_BAD_ADDRESS;
+
+	status_t result = B_OK;
+	for (int i = 0; i < numInfos; i++) {
+		status_t status = queue->Select(infos[i].object, infos[i].type,
+			infos[i].events, infos[i].user_data);
+
+		infos[i].events = status == B_OK ? 0 : B_EVENT_INVALID;
+		if (status != B_OK && result == B_OK)
+			result = status;
+	}
+
+	if (user_memcpy(userInfos, infos, bytes) != B_OK)
+		return B_BAD_ADDRESS;
+
+	return result;
+}
+
+
+ssize_t
+_user_event_queue_wait(int queueFD, event_wait_info* userInfos, int numInfos,
+	uint32 flags, bigtime_t timeout)
+{
+	syscall_restart_handle_timeout_pre(flags, timeout);
+
+	if (numInfos <= 0)
+		return B_BAD_VALUE;
+	if (numInfos > kMaxWaitInfos)
+		numInfos = kMaxWaitInfos;
+
+	if (userInfos == NULL || !IS_USER_ADDRESS(userInfos))
+		return B_BAD_ADDRESS;
+
+	status_t error;
+	EventQueue* queue = get_event_queue(queueFD, error);
+	if (queue == NULL)
+		return error;
+	BReference<EventQueue> queueReference(queue, true);
+
+	event_wait_info* infos = (event_wait_info*)malloc(
+		sizeof(event_wait_info) * numInfos);
+	if (infos == NULL)
+		return B_NO_MEMORY;
+	MemoryDeleter infosDeleter(infos);
+
+	ssize_t result = queue->Wait(infos, numInfos, flags, timeout);
+	if (result < 0)
+		return syscall_restart_handle_timeout_post(result, timeout);
+
+	if (user_memcpy(userInfos, infos, sizeof(event_wait_info) * result)
+			!= B_OK) {
+		// the events are lost now, but there is not much we can do
+		return B_BAD_ADDRESS;
+	}
+
+	return result;
+}
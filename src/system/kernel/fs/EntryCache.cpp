@@ -8,41 +8,23 @@
 
 #include <new>
 
+#include <KernelExport.h>
 
-static const int32 kEntriesPerGeneration = 1024;
+#include <util/AutoLock.h>
 
-static const int32 kEntryNotInArray = -1;
-static const int32 kEntryRemoved = -2;
 
+/*!	Lookups don't take any lock. They walk the hash chains with interrupts
+	disabled, and writers (serialized by fLock) publish new entries only after
+	they are fully initialized. An entry that is removed from the table is not
+	freed right away, since a concurrent lookup might still look at it; it is
+	retired instead, and freed once every CPU has run with interrupts enabled
+	since, which ensures that no lookup can reach it anymore.
 
-// #pragma mark - EntryCacheGeneration
-
-
-EntryCacheGeneration::EntryCacheGeneration()
-	:
-	next_index(0),
-	entries(NULL)
-{
-}
-
-
-EntryCacheGeneration::~EntryCacheGeneration()
-{
-	delete[] entries;
-}
-
-
-status_t
-EntryCacheGeneration::Init()
-{
-	entries = new(std::nothrow) EntryCacheEntry*[kEntriesPerGeneration];
-	if (entries == NULL)
-		return B_NO_MEMORY;
-
-	memset(entries, 0, sizeof(EntryCacheEntry*) * kEntriesPerGeneration);
-
-	return B_OK;
-}
+	Instead of generations, entries are aged individually following the clock
+	algorithm: lookups mark an entry referenced, and when the cache is full,
+	the oldest unreferenced entries are evicted, while referenced ones get a
+	second chance.
+*/
 
 
 // #pragma mark - EntryCache
@@ -50,77 +32,90 @@ EntryCacheGeneration::Init()
 
 EntryCache::EntryCache()
 	:
-	fCurrentGeneration(0)
+	fTable(NULL),
+	fEntryCount(0),
+	fRetiredCount(0)
 {
-	rw_lock_init(&fLock, "entry cache");
+	mutex_init(&fLock, "entry cache");
 
-	new(&fEntries) EntryTable;
+	new(&fEntries) EntryList;
+	new(&fRetiredEntries) EntryList;
 }
 
 
 EntryCache::~EntryCache()
 {
 	// delete entries
-	EntryCacheEntry* entry = fEntries.Clear(true);
-	while (entry != NULL) {
-		EntryCacheEntry* next = entry->hash_link;
+	while (EntryCacheEntry* entry = fEntries.RemoveHead())
 		free(entry);
-		entry = next;
-	}
+	while (EntryCacheEntry* entry = fRetiredEntries.RemoveHead())
+		free(entry);
+
+	delete[] fTable;
 
-	rw_lock_destroy(&fLock);
+	mutex_destroy(&fLock);
 }
 
 
 status_t
 EntryCache::Init()
 {
-	status_t error = fEntries.Init();
-	if (error != B_OK)
-		return error;
-
-	for (int32 i = 0; i < kGenerationCount; i++) {
-		error = fGenerations[i].Init();
-		if (error != B_OK)
-			return error;
-	}
+	fTable = new(std::nothrow) EntryCacheEntry*[kBucketCount];
+	if (fTable == NULL)
+		return B_NO_MEMORY;
+
+	memset((void*)fTable, 0, sizeof(EntryCacheEntry*) * kBucketCount);
 
 	return B_OK;
 }
 
 
 status_t
-EntryCache::Add(ino_t dirID, const char* name, ino_t nodeID)
+EntryCache::Add(ino_t dirID, const char* name, ino_t nodeID, bool missing)
 {
 	EntryCacheKey key(dirID, name);
 
-	WriteLocker _(fLock);
+	MutexLocker _(fLock);
 
-	EntryCacheEntry* entry = fEntries.Lookup(key);
-	if (entry != NULL) {
-		entry->node_id = nodeID;
-		if (entry->generation != fCurrentGeneration) {
-			if (entry->index >= 0) {
-				fGenerations[entry->generation].entries[entry->index] = NULL;
-				_AddEntryToCurrentGeneration(entry);
-			}
-		}
+	EntryCacheEntry* existing = _Lookup(key);
+	if (existing != NULL && existing->node_id == nodeID
+		&& existing->missing == missing) {
+		existing->referenced = 1;
 		return B_OK;
 	}
 
-	entry = (EntryCacheEntry*)malloc(sizeof(EntryCacheEntry) + strlen(name));
+	// Entries are never changed once they are visible to lookups, so we
+	// always create a new one, and replace the old one with it, if any.
+	EntryCacheEntry* entry
+		= (EntryCacheEntry*)malloc(sizeof(EntryCacheEntry) + strlen(name));
 	if (entry == NULL)
 		return B_NO_MEMORY;
 
 	entry->node_id = nodeID;
 	entry->dir_id = dirID;
-	entry->generation = fCurrentGeneration;
-	entry->index = kEntryNotInArray;
+	entry->hash = key.hash;
+	entry->referenced = 0;
+	entry->missing = missing;
 	strcpy(entry->name, name);
 
-	fEntries.Insert(entry);
+	if (existing != NULL)
+		_RemoveEntry(existing);
+	else if (fEntryCount >= kMaxEntries)
+		_EvictEntries();
+
+	EntryCacheEntry* volatile& bucket
+		= fTable[key.hash & (kBucketCount - 1)];
+	entry->hash_link = bucket;
+
+	// make sure the entry is complete before lookups can see it
+	memory_write_barrier();
+	bucket = entry;
 
-	_AddEntryToCurrentGeneration(entry);
+	fEntries.Add(entry);
+	fEntryCount++;
+
+	if (fRetiredCount >= kMaxRetiredEntries)
+		_ReclaimRetiredEntries();
 
 	return B_OK;
 }
@@ -131,75 +126,43 @@ EntryCache::Remove(ino_t dirID, const char* name)
 {
 	EntryCacheKey key(dirID, name);
 
-	WriteLocker writeLocker(fLock);
+	MutexLocker _(fLock);
 
-	EntryCacheEntry* entry = fEntries.Lookup(key);
+	EntryCacheEntry* entry = _Lookup(key);
 	if (entry == NULL)
 		return B_ENTRY_NOT_FOUND;
 
-	fEntries.Remove(entry);
+	_RemoveEntry(entry);
 
-	if (entry->index >= 0) {
-		// remove the entry from its generation and delete it
-		fGenerations[entry->generation].entries[entry->index] = NULL;
-		free(entry);
-	} else {
-		// We can't free it, since another thread is about to try to move it
-		// to another generation. We mark it removed and the other thread will
-		// take care of deleting it.
-		entry->index = kEntryRemoved;
-	}
+	if (fRetiredCount >= kMaxRetiredEntries)
+		_ReclaimRetiredEntries();
 
 	return B_OK;
 }
 
 
+/*!	Looks up the entry \a name in the directory \a dirID. If it is cached,
+	\c true is returned, and \a _missing tells whether the entry is known not
+	to exist; otherwise \a _nodeID is set to the ID of the node it refers to.
+*/
 bool
-EntryCache::Lookup(ino_t dirID, const char* name, ino_t& _nodeID)
+EntryCache::Lookup(ino_t dirID, const char* name, ino_t& _nodeID,
+	bool& _missing)
 {
 	EntryCacheKey key(dirID, name);
 
-	ReadLocker readLocker(fLock);
+	InterruptsLocker _;
 
-	EntryCacheEntry* entry = fEntries.Lookup(key);
+	EntryCacheEntry* entry = _Lookup(key);
 	if (entry == NULL)
 		return false;
 
-	int32 oldGeneration = atomic_set(&entry->generation, fCurrentGeneration);
-	if (oldGeneration == fCurrentGeneration || entry->index < 0) {
-		// The entry is already in the current generation or is being moved to
-		// it by another thread.
-		_nodeID = entry->node_id;
-		return true;
-	}
-
-	// remove from old generation array
-	fGenerations[oldGeneration].entries[entry->index] = NULL;
-	entry->index = kEntryNotInArray;
-
-	// add to the current generation
-	int32 index = atomic_add(&fGenerations[oldGeneration].next_index, 1);
-	if (index < kEntriesPerGeneration) {
-		fGenerations[fCurrentGeneration].entries[index] = entry;
-		entry->index = index;
-		_nodeID = entry->node_id;
-		return true;
-	}
-
-	// The current generation is full, so we probably need to clear the oldest
-	// one to make room. We need the write lock for that.
-	readLocker.Unlock();
-	WriteLocker writeLocker(fLock);
-
-	if (entry->index == kEntryRemoved) {
-		// the entry has been removed in the meantime
-		free(entry);
-		return false;
-	}
-
-	_AddEntryToCurrentGeneration(entry);
+	// only write if necessary, so that the entry's cache line can be shared
+	if (entry->referenced == 0)
+		entry->referenced = 1;
 
 	_nodeID = entry->node_id;
+	_missing = entry->missing;
 	return true;
 }
 
@@ -207,9 +170,10 @@ EntryCache::Lookup(ino_t dirID, const char* name, ino_t& _nodeID)
 const char*
 EntryCache::DebugReverseLookup(ino_t nodeID, ino_t& _dirID)
 {
-	for (EntryTable::Iterator it = fEntries.GetIterator();
+	for (EntryList::Iterator it = fEntries.GetIterator();
 			EntryCacheEntry* entry = it.Next();) {
-		if (nodeID == entry->node_id && strcmp(entry->name, ".") != 0
+		if (nodeID == entry->node_id && !entry->missing
+				&& strcmp(entry->name, ".") != 0
 				&& strcmp(entry->name, "..") != 0) {
 			_dirID = entry->dir_id;
 			return entry->name;
@@ -220,34 +184,91 @@ EntryCache::DebugReverseLookup(ino_t nodeID, ino_t& _dirID)
 }
 
 
-void
-EntryCache::_AddEntryToCurrentGeneration(EntryCacheEntry* entry)
+/*!	Either fLock must be held, or interrupts must be disabled.
+*/
+EntryCacheEntry*
+EntryCache::_Lookup(const EntryCacheKey& key) const
 {
-	// the generation might not be full yet
-	int32 index = fGenerations[fCurrentGeneration].next_index++;
-	if (index < kEntriesPerGeneration) {
-		fGenerations[fCurrentGeneration].entries[index] = entry;
-		entry->generation = fCurrentGeneration;
-		entry->index = index;
-		return;
+	EntryCacheEntry* entry = fTable[key.hash & (kBucketCount - 1)];
+	while (entry != NULL) {
+		if (entry->hash == key.hash && entry->dir_id == key.dir_id
+			&& strcmp(entry->name, key.name) == 0) {
+			return entry;
+		}
+
+		entry = entry->hash_link;
 	}
 
-	// we have to clear the oldest generation
-	int32 newGeneration = (fCurrentGeneration + 1) % kGenerationCount;
-	for (int32 i = 0; i < kEntriesPerGeneration; i++) {
-		EntryCacheEntry* otherEntry = fGenerations[newGeneration].entries[i];
-		if (otherEntry == NULL)
+	return NULL;
+}
+
+
+/*!	Removes the entry from the table, and retires it.
+	fLock must be held.
+*/
+void
+EntryCache::_RemoveEntry(EntryCacheEntry* entry)
+{
+	EntryCacheEntry* volatile* link
+		= &fTable[entry->hash & (kBucketCount - 1)];
+	while (*link != entry)
+		link = &(*link)->hash_link;
+
+	// We leave the entry's hash link alone, so that lookups that are currently
+	// looking at it can continue to walk the chain.
+	*link = entry->hash_link;
+
+	fEntries.Remove(entry);
+	fEntryCount--;
+
+	fRetiredEntries.Add(entry);
+	fRetiredCount++;
+}
+
+
+/*!	Makes room for at least one entry.
+	fLock must be held.
+*/
+void
+EntryCache::_EvictEntries()
+{
+	// every entry gets at most one second chance, even if it's looked up
+	// again while we're at it
+	int32 secondChances = fEntryCount;
+
+	while (fEntryCount >= kMaxEntries) {
+		EntryCacheEntry* entry = fEntries.Head();
+
+		if (entry->referenced != 0 && secondChances-- > 0) {
+			entry->referenced = 0;
+			fEntries.Remove(entry);
+			fEntries.Add(entry);
 			continue;
+		}
 
-		fGenerations[newGeneration].entries[i] = NULL;
-		fEntries.Remove(otherEntry);
-		free(otherEntry);
+		_RemoveEntry(entry);
 	}
+}
+
 
-	// set the new generation and add the entry
-	fCurrentGeneration = newGeneration;
-	fGenerations[newGeneration].next_index = 1;
-	fGenerations[newGeneration].entries[0] = entry;
-	entry->generation = newGeneration;
-	entry->index = 0;
+/*!	Frees all retired entries.
+	fLock must be held.
+*/
+void
+EntryCache::_ReclaimRetiredEntries()
+{
+	// Once every CPU has run the (empty) function, all lookups that might
+	// have seen the retired entries are done.
+	call_all_cpus_sync(&_SyncWithLookups, NULL);
+
+	while (EntryCacheEntry* entry = fRetiredEntries.RemoveHead())
+		free(entry);
+
+	fRetiredCount = 0;
+}
+
+
+/*static*/ void
+EntryCache::_SyncWithLookups(void* cookie, int cpu)
+{
 }
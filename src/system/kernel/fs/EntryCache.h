@@ -8,9 +8,9 @@
 
 #include <stdlib.h>
 
-#include <util/AutoLock.h>
+#include <lock.h>
+#include <util/DoublyLinkedList.h>
 #include <util/khash.h>
-#include <util/OpenHashTable.h>
 
 
 struct EntryCacheKey {
@@ -30,55 +30,17 @@ struct EntryCacheKey {
 };
 
 
-struct EntryCacheEntry {
-			EntryCacheEntry*	hash_link;
+struct EntryCacheEntry : DoublyLinkedListLinkImpl<EntryCacheEntry> {
+			EntryCacheEntry* volatile hash_link;
 			ino_t				node_id;
 			ino_t				dir_id;
-			vint32				generation;
-			vint32				index;
+			size_t				hash;
+			vint32				referenced;
+			bool				missing;
 			char				name[1];
 };
 
 
-struct EntryCacheGeneration {
-			vint32				next_index;
-			EntryCacheEntry**	entries;
-
-								EntryCacheGeneration();
-								~EntryCacheGeneration();
-
-			status_t			Init();
-};
-
-
-struct EntryCacheHashDefinition {
-	typedef EntryCacheKey	KeyType;
-	typedef EntryCacheEntry	ValueType;
-
-	uint32 HashKey(const EntryCacheKey& key) const
-	{
-		return key.hash;
-	}
-
-	size_t Hash(const EntryCacheEntry* value) const
-	{
-		return (uint32)value->dir_id ^ (uint32)(value->dir_id >> 32)
-			^ hash_hash_string(value->name);
-	}
-
-	bool Compare(const EntryCacheKey& key, const EntryCacheEntry* value) const
-	{
-		return value->dir_id == key.dir_id
-			&& strcmp(value->name, key.name) == 0;
-	}
-
-	EntryCacheEntry*& GetLink(EntryCacheEntry* value) const
-	{
-		return value->hash_link;
-	}
-};
-
-
 class EntryCache {
 public:
 								EntryCache();
@@ -87,30 +49,40 @@ public:
 			status_t			Init();
 
 			status_t			Add(ino_t dirID, const char* name,
-									ino_t nodeID);
+									ino_t nodeID, bool missing = false);
 
 			status_t			Remove(ino_t dirID, const char* name);
 
 			bool				Lookup(ino_t dirID, const char* name,
-									ino_t& nodeID);
+									ino_t& nodeID, bool& missing);
 
 			const char*			DebugReverseLookup(ino_t nodeID, ino_t& _dirID);
 
 private:
-	static	const int32			kGenerationCount = 8;
+	static	const int32			kMaxEntries = 8192;
+	static	const int32			kBucketCount = 4096;
+									// must be a power of two
+	static	const int32			kMaxRetiredEntries = 128;
 
-			typedef BOpenHashTable<EntryCacheHashDefinition> EntryTable;
 			typedef DoublyLinkedList<EntryCacheEntry> EntryList;
 
 private:
-			void				_AddEntryToCurrentGeneration(
-									EntryCacheEntry* entry);
+			EntryCacheEntry*	_Lookup(const EntryCacheKey& key) const;
+			void				_RemoveEntry(EntryCacheEntry* entry);
+			void				_EvictEntries();
+			void				_ReclaimRetiredEntries();
+
+	static	void				_SyncWithLookups(void* cookie, int cpu);
 
 private:
-			rw_lock				fLock;
-			EntryTable			fEntries;
-			EntryCacheGeneration fGenerations[kGenerationCount];
-			int32				fCurrentGeneration;
+			mutex				fLock;
+			EntryCacheEntry* volatile* fTable;
+			EntryList			fEntries;
+				// in the order of the clock hand, oldest first
+			EntryList			fRetiredEntries;
+				// removed, but lookups might still see them
+			int32				fEntryCount;
+			int32				fRetiredCount;
 };
 
 
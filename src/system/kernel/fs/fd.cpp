@@ -550,6 +550,24 @@ deselect_select_infos(file_descriptor* descriptor, select_info* infos)
 }
 
 
+/*!	Deselects all select infos that are still attached to the given slot of
+	the I/O context, and notifies them with B_EVENT_INVALID.
+	This is only needed when the context is destroyed: nobody can wait in
+	select()/poll() on its FDs anymore, but event queues may still have
+	infos registered.
+	The context's io_mutex must be held.
+*/
+void
+deselect_fd_select_infos(io_context* context, int fd)
+{
+	select_info* infos = context->select_infos[fd];
+	context->select_infos[fd] = NULL;
+
+	if (infos != NULL && context->fds[fd] != NULL)
+		deselect_select_infos(context->fds[fd], infos);
+}
+
+
 status_t
 select_fd(int32 fd, struct select_info* info, bool kernel)
 {
@@ -598,8 +616,10 @@ select_fd(int32 fd, struct select_info* info, bool kernel)
 	locker.Lock();
 	if (context->fds[fd] != descriptor) {
 		// Someone close()d the index in the meantime. deselect() all
-		// events.
+		// events. deselect_select_infos() surrenders a sync reference, which
+		// we didn't acquire yet.
 		info->next = NULL;
+		atomic_add(&info->sync->ref_count, 1);
 		deselect_select_infos(descriptor, info);
 
 		// Release our open reference of the descriptor.
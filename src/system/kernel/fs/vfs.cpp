@@ -2073,9 +2073,13 @@ static status_t
 lookup_dir_entry(struct vnode* dir, const char* name, struct vnode** _vnode)
 {
 	ino_t id;
+	bool missing;
 
-	if (dir->mount->entry_cache.Lookup(dir->id, name, id))
+	if (dir->mount->entry_cache.Lookup(dir->id, name, id, missing)) {
+		if (missing)
+			return B_ENTRY_NOT_FOUND;
 		return get_vnode(dir->device, id, _vnode, true, false);
+	}
 
 	status_t status = FS_CALL(dir, lookup, name, &id);
 	if (status != B_OK)
@@ -3976,6 +3980,21 @@ entry_cache_add(dev_t mountID, ino_t dirID, const char* name, ino_t nodeID)
 }
 
 
+extern "C" status_t
+entry_cache_add_missing(dev_t mountID, ino_t dirID, const char* name)
+{
+	// lookup mount -- the caller is required to make sure that the mount
+	// won't go away
+	MutexLocker locker(sMountMutex);
+	struct fs_mount* mount = find_mount(mountID);
+	if (mount == NULL)
+		return B_BAD_VALUE;
+	locker.Unlock();
+
+	return mount->entry_cache.Add(dirID, name, -1, true);
+}
+
+
 extern "C" status_t
 entry_cache_remove(dev_t mountID, ino_t dirID, const char* name)
 {
@@ -4861,6 +4880,7 @@ vfs_free_io_context(io_context* context)
 
 	for (i = 0; i < context->table_size; i++) {
 		if (struct file_descriptor* descriptor = context->fds[i]) {
+			deselect_fd_select_infos(context, i);
 			close_fd(descriptor);
 			put_fd(descriptor);
 		}
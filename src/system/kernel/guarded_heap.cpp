@@ -11,6 +11,7 @@
 #include <elf.h>
 #include <debug.h>
 #include <heap.h>
+#include <kernel.h>
 #include <malloc.h>
 #include <slab/Slab.h>
 #include <tracing.h>
@@ -926,6 +927,13 @@ object_cache_set_minimum_reserve(object_cache* cache, size_t objectCount)
 }
 
 
+status_t
+object_cache_set_magazine_capacity(object_cache* cache, size_t capacity)
+{
+	return B_NOT_SUPPORTED;
+}
+
+
 void*
 object_cache_alloc(object_cache* cache, uint32 flags)
 {
@@ -954,6 +962,18 @@ object_cache_get_usage(object_cache* cache, size_t* _allocatedMemory)
 }
 
 
+status_t
+_user_get_object_cache_stats(object_cache_stats* userStats, size_t size,
+	int32* _userCount)
+{
+	int32 count = 0;
+	if (_userCount == NULL || !IS_USER_ADDRESS(_userCount))
+		return B_BAD_ADDRESS;
+
+	return user_memcpy(_userCount, &count, sizeof(int32));
+}
+
+
 void
 slab_init(kernel_args* args)
 {
@@ -7,11 +7,14 @@
 #include <user_mutex.h>
 #include <user_mutex_defs.h>
 
+#include <new>
+
 #include <condition_variable.h>
 #include <kernel.h>
 #include <lock.h>
 #include <smp.h>
 #include <syscall_restart.h>
+#include <team.h>
 #include <util/AutoLock.h>
 #include <util/OpenHashTable.h>
 #include <vm/vm.h>
@@ -25,6 +28,18 @@ struct UserMutexEntry : public DoublyLinkedListLinkImpl<UserMutexEntry> {
 	addr_t				address;
 	ConditionVariable	condition;
 	bool				locked;
+	uint32				bitset;
+		// 0 for user mutex waiters, the bits the waiter can be woken up with
+		// for address waiters
+	bool				queued;
+		// address waiters only: whether the entry is still in the table
+	team_id				team;
+		// address waiters only: the team of the waiting thread
+	vint32*				mutex;
+		// address waiters only: the mutex the entry has been requeued to, if
+		// any; it is then treated like any other waiter of that mutex
+	VMPageWiringInfo*	requeueWiring;
+		// the wiring of the page of the mutex the entry has been requeued to
 	UserMutexEntryList	otherEntries;
 	UserMutexEntry*		hashNext;
 };
@@ -120,6 +135,11 @@ user_mutex_lock_locked(vint32* mutex, addr_t physicalAddress, const char* name,
 	UserMutexEntry entry;
 	entry.address = physicalAddress;
 	entry.locked = false;
+	entry.bitset = 0;
+	entry.queued = true;
+	entry.team = -1;
+	entry.mutex = NULL;
+	entry.requeueWiring = NULL;
 	add_user_mutex_entry(&entry);
 
 	// wait
@@ -177,6 +197,257 @@ user_mutex_unlock_locked(vint32* mutex, addr_t physicalAddress, uint32 flags)
 }
 
 
+/*!	Removes and wakes up to \a count address waiters waiting on
+	\a physicalAddress whose bitset intersects with \a bitset, in the order
+	they started waiting. Returns the number of threads woken up.
+*/
+static int32
+address_wake_locked(addr_t physicalAddress, int32 count, uint32 bitset)
+{
+	UserMutexEntry* entry = sUserMutexTable.Lookup(physicalAddress);
+	if (entry == NULL)
+		return 0;
+
+	// The first entry is the one in the table, all others are queued in its
+	// list in FIFO order. Removing the first entry moves the others over to
+	// the next one, but doesn't change their links, so the iterator stays
+	// valid.
+	UserMutexEntryList::Iterator it = entry->otherEntries.GetIterator();
+	int32 woken = 0;
+
+	while (entry != NULL && woken < count) {
+		UserMutexEntry* next = it.Next();
+
+		if ((entry->bitset & bitset) != 0) {
+			remove_user_mutex_entry(entry);
+			entry->queued = false;
+			entry->condition.NotifyOne();
+			woken++;
+		}
+
+		entry = next;
+	}
+
+	return woken;
+}
+
+
+static status_t
+address_wait(int32* address, int32 value, uint32 bitset, uint32 flags,
+	bigtime_t timeout)
+{
+	// wire the page and get the physical address
+	VMPageWiringInfo wiringInfo;
+	status_t error = vm_wire_page(B_CURRENT_TEAM, (addr_t)address, true,
+		&wiringInfo);
+	if (error != B_OK)
+		return error;
+
+	UserMutexEntry entry;
+
+	{
+		MutexLocker locker(sUserMutexTableLock);
+
+		// Only wait if the value is still the expected one. Anyone changing
+		// it and waking us up has to acquire the table lock in order to do
+		// so, so we can't miss the wakeup.
+		if (*(vint32*)address != value) {
+			locker.Unlock();
+			vm_unwire_page(&wiringInfo);
+			return B_WOULD_BLOCK;
+		}
+
+		entry.address = wiringInfo.physicalAddress;
+		entry.locked = false;
+		entry.bitset = bitset;
+		entry.queued = true;
+		entry.team = team_get_current_team_id();
+		entry.mutex = NULL;
+		entry.requeueWiring = NULL;
+		add_user_mutex_entry(&entry);
+
+		ConditionVariableEntry waitEntry;
+		entry.condition.Init((void*)wiringInfo.physicalAddress,
+			"address wait");
+		entry.condition.Add(&waitEntry);
+
+		locker.Unlock();
+		error = waitEntry.Wait(flags, timeout);
+		locker.Lock();
+
+		if (entry.queued) {
+			// timeout or interrupt, or we have been requeued to a mutex --
+			// we're still queued
+			if (!remove_user_mutex_entry(&entry) && entry.mutex != NULL) {
+				// no one is waiting for the mutex anymore -- clear the
+				// waiting flag
+				atomic_and(entry.mutex, ~(int32)B_USER_MUTEX_WAITING);
+			}
+		} else
+			error = B_OK;
+
+		if (entry.locked) {
+			// the mutex we have been requeued to has been handed over to us,
+			// maybe just in time
+			error = B_ADDRESS_WAIT_MUTEX_LOCKED;
+		}
+	}
+
+	// unwire the pages
+	if (entry.requeueWiring != NULL) {
+		vm_unwire_page(entry.requeueWiring);
+		delete entry.requeueWiring;
+	}
+	vm_unwire_page(&wiringInfo);
+
+	return error;
+}
+
+
+static int32
+address_wake(int32* address, int32 count, uint32 bitset)
+{
+	// wire the page and get the physical address
+	VMPageWiringInfo wiringInfo;
+	status_t error = vm_wire_page(B_CURRENT_TEAM, (addr_t)address, true,
+		&wiringInfo);
+	if (error != B_OK)
+		return error;
+
+	int32 woken;
+	{
+		MutexLocker locker(sUserMutexTableLock);
+		woken = address_wake_locked(wiringInfo.physicalAddress, count, bitset);
+	}
+
+	vm_unwire_page(&wiringInfo);
+
+	return woken;
+}
+
+
+/*!	Moves up to \a count address waiters waiting on \a physicalAddress over
+	to \a mutex, without waking them up. From then on, they are treated like
+	any other waiter of the mutex: unlocking the mutex hands it over to them.
+	If the mutex isn't locked, it is locked on behalf of the first waiter,
+	which is woken up right away.
+	Waiters of other teams cannot access the mutex, and are woken up instead.
+	Returns the number of threads that have been woken up or requeued.
+*/
+static int32
+address_requeue_locked(addr_t physicalAddress, int32 count, vint32* mutex,
+	addr_t mutexPhysicalAddress)
+{
+	team_id team = team_get_current_team_id();
+	bool mutexWaiting = false;
+	int32 moved = 0;
+
+	UserMutexEntry* entry;
+	while (moved < count
+		&& (entry = sUserMutexTable.Lookup(physicalAddress)) != NULL) {
+		remove_user_mutex_entry(entry);
+		moved++;
+
+		VMPageWiringInfo* requeueWiring = NULL;
+		if (entry->team == team && (*mutex & B_USER_MUTEX_DISABLED) == 0) {
+			// The waiter only has the page it started waiting on wired, so
+			// we need to keep the mutex wired on its behalf, for as long as
+			// it is waiting.
+			requeueWiring = new(std::nothrow) VMPageWiringInfo;
+			if (requeueWiring != NULL && vm_wire_page(B_CURRENT_TEAM,
+					(addr_t)mutex, true, requeueWiring) != B_OK) {
+				delete requeueWiring;
+				requeueWiring = NULL;
+			}
+		}
+
+		if (requeueWiring == NULL) {
+			// we can't requeue this one -- just wake it up
+			entry->queued = false;
+			entry->condition.NotifyOne();
+			continue;
+		}
+
+		if (!mutexWaiting) {
+			// make sure the mutex's owner will unlock it via the kernel
+			int32 oldValue = atomic_or(mutex,
+				B_USER_MUTEX_LOCKED | B_USER_MUTEX_WAITING);
+			mutexWaiting = true;
+
+			if ((oldValue & (B_USER_MUTEX_LOCKED | B_USER_MUTEX_WAITING))
+					== 0) {
+				// the mutex wasn't locked -- it is now, on behalf of the
+				// waiter
+				vm_unwire_page(requeueWiring);
+				delete requeueWiring;
+
+				entry->queued = false;
+				entry->locked = true;
+				entry->condition.NotifyOne();
+				continue;
+			}
+		}
+
+		entry->address = mutexPhysicalAddress;
+		entry->bitset = 0;
+		entry->mutex = mutex;
+		entry->requeueWiring = requeueWiring;
+		add_user_mutex_entry(entry);
+	}
+
+	if (mutexWaiting && sUserMutexTable.Lookup(mutexPhysicalAddress) == NULL) {
+		// no one is waiting for the mutex -- clear the waiting flag again
+		atomic_and(mutex, ~(int32)B_USER_MUTEX_WAITING);
+	}
+
+	return moved;
+}
+
+
+static int32
+address_requeue(int32* address, int32 value, int32 wakeCount, int32* mutex,
+	int32 requeueCount)
+{
+	// wire the pages and get the physical addresses
+	VMPageWiringInfo wiringInfo;
+	status_t error = vm_wire_page(B_CURRENT_TEAM, (addr_t)address, true,
+		&wiringInfo);
+	if (error != B_OK)
+		return error;
+
+	VMPageWiringInfo mutexWiringInfo;
+	error = vm_wire_page(B_CURRENT_TEAM, (addr_t)mutex, true,
+		&mutexWiringInfo);
+	if (error != B_OK) {
+		vm_unwire_page(&wiringInfo);
+		return error;
+	}
+
+	int32 result;
+	{
+		MutexLocker locker(sUserMutexTableLock);
+
+		if (*(vint32*)address != value)
+			result = B_WOULD_BLOCK;
+		else if (mutexWiringInfo.physicalAddress
+				== wiringInfo.physicalAddress)
+			result = B_BAD_VALUE;
+		else {
+			result = address_wake_locked(wiringInfo.physicalAddress,
+				wakeCount, B_ADDRESS_WAIT_ALL_BITS);
+			result += address_requeue_locked(wiringInfo.physicalAddress,
+				requeueCount, mutex, mutexWiringInfo.physicalAddress);
+		}
+	}
+
+	// unwire the pages
+	vm_unwire_page(&mutexWiringInfo);
+	vm_unwire_page(&wiringInfo);
+
+	return result;
+}
+
+
 static status_t
 user_mutex_lock(int32* mutex, const char* name, uint32 flags, bigtime_t timeout)
 {
@@ -304,3 +575,53 @@ _user_mutex_switch_lock(int32* fromMutex, int32* toMutex, const char* name,
 	return user_mutex_switch_lock(fromMutex, toMutex, name,
 		flags | B_CAN_INTERRUPT, timeout);
 }
+
+
+status_t
+_user_address_wait(int32* address, int32 value, uint32 bitset, uint32 flags,
+	bigtime_t timeout)
+{
+	if (address == NULL || !IS_USER_ADDRESS(address)
+			|| (addr_t)address % 4 != 0) {
+		return B_BAD_ADDRESS;
+	}
+	if (bitset == 0)
+		return B_BAD_VALUE;
+
+	syscall_restart_handle_timeout_pre(flags, timeout);
+
+	status_t error = address_wait(address, value, bitset,
+		flags | B_CAN_INTERRUPT, timeout);
+
+	return syscall_restart_handle_timeout_post(error, timeout);
+}
+
+
+int32
+_user_address_wake(int32* address, int32 count, uint32 bitset)
+{
+	if (address == NULL || !IS_USER_ADDRESS(address)
+			|| (addr_t)address % 4 != 0) {
+		return B_BAD_ADDRESS;
+	}
+	if (bitset == 0 || count < 0)
+		return B_BAD_VALUE;
+
+	return address_wake(address, count, bitset);
+}
+
+
+int32
+_user_address_requeue(int32* address, int32 value, int32 wakeCount,
+	int32* mutex, int32 requeueCount)
+{
+	if (address == NULL || !IS_USER_ADDRESS(address)
+			|| (addr_t)address % 4 != 0 || mutex == NULL
+			|| !IS_USER_ADDRESS(mutex) || (addr_t)mutex % 4 != 0) {
+		return B_BAD_ADDRESS;
+	}
+	if (wakeCount < 0 || requeueCount < 0)
+		return B_BAD_VALUE;
+
+	return address_requeue(address, value, wakeCount, mutex, requeueCount);
+}
@@ -21,11 +21,13 @@
 #include <OS.h>
 
 #include <AutoDeleter.h>
+#include <Referenceable.h>
 
 #include <arch/int.h>
 #include <heap.h>
 #include <kernel.h>
 #include <Notifications.h>
+#include <port_defs.h>
 #include <sem.h>
 #include <syscall_restart.h>
 #include <team.h>
@@ -46,18 +48,24 @@
 
 // Locking:
 // * sPortsLock: Protects the sPorts hash table, Team::port_list, and
-//   Port::owner.
-// * Port::lock: Protects all Port members save team_link, hash_link, and lock.
-//   id is immutable.
+//   Port::owner. It is a read-write lock; looking up a port only needs a
+//   read lock, so that lookups don't contend with each other.
+// * Port::lock: Protects all Port members save team_link, hash_link, lock,
+//   and the reference count. id is immutable. deleted is only set with both
+//   sPortsLock write-locked and Port::lock held.
 // * sPortQuotaLock: Protects sTotalSpaceInUse, sAreaChangeCounter,
 //   sWaitingForSpace and the critical section of creating/adding areas for the
 //   port heap in the grow case. It also has to be held when reading
 //   sWaitingForSpace to determine whether or not to notify the
 //   sNoSpaceCondition condition variable.
 //
-// The locking order is sPortsLock -> Port::lock. A port must be looked up
-// in sPorts and locked with sPortsLock held. Afterwards sPortsLock can be
-// dropped, unless any field guarded by sPortsLock is accessed.
+// The locking order is sPortsLock -> Port::lock. A port is looked up in
+// sPorts with sPortsLock read-locked, and a reference to it is acquired before
+// sPortsLock is dropped again. The reference keeps the Port object, and thus
+// its lock, alive, so the port can be locked without holding sPortsLock, and
+// it can be re-locked after waiting without looking it up again. Once locked,
+// Port::deleted tells whether the port is still in use.
+// The hash table owns a reference to each port it contains.
 
 
 struct port_message;
@@ -78,7 +86,7 @@ struct port_message : DoublyLinkedListLinkImpl<port_message> {
 typedef DoublyLinkedList<port_message> MessageList;
 
 
-struct Port {
+struct Port : BReferenceable {
 	struct list_link	team_link;
 	Port*				hash_link;
 	port_id				id;
@@ -93,6 +101,7 @@ struct Port {
 		// messages read from port since creation
 	select_info*		select_infos;
 	MessageList			messages;
+	bool				deleted;
 
 	Port(team_id owner, int32 queueLength, char* name)
 		:
@@ -101,7 +110,8 @@ struct Port {
 		read_count(0),
 		write_count(queueLength),
 		total_count(0),
-		select_infos(NULL)
+		select_infos(NULL),
+		deleted(false)
 	{
 		// id is initialized when the caller adds the port to the hash table
 
@@ -348,7 +358,7 @@ static int32 sAreaChangeCounter;
 static int32 sWaitingForSpace;
 static port_id sNextPortID = 1;
 static bool sPortsActive = false;
-static mutex sPortsLock = MUTEX_INITIALIZER("ports list");
+static rw_lock sPortsLock = RW_LOCK_INITIALIZER("ports list");
 static mutex sPortQuotaLock = MUTEX_INITIALIZER("port quota");
 
 static PortNotificationService sNotificationService;
@@ -498,18 +508,54 @@ notify_port_select_events(Port* port, uint16 events)
 }
 
 
+/*!	Looks up the port with the given ID, and returns it locked. \a reference
+	is set to a reference to the port, which has to be kept as long as the
+	port is used, including while it is unlocked for waiting.
+	Returns \c NULL, if there is no such port.
+*/
 static Port*
-get_locked_port(port_id id)
+get_locked_port(port_id id, BReference<Port>& reference)
 {
-	MutexLocker portsLocker(sPortsLock);
+	{
+		ReadLocker portsLocker(sPortsLock);
+		reference.SetTo(sPorts.Lookup(id));
+	}
+
+	Port* port = reference.Get();
+	if (port == NULL)
+		return NULL;
+
+	mutex_lock(&port->lock);
+
+	if (port->deleted) {
+		// the port has been deleted before we got the lock
+		mutex_unlock(&port->lock);
+		reference.Unset();
+		return NULL;
+	}
 
-	Port* port = sPorts.Lookup(id);
-	if (port != NULL)
-		mutex_lock(&port->lock);
 	return port;
 }
 
 
+/*!	Re-locks a port the caller has a reference to after having waited with
+	the port unlocked. Returns \c false if the port has been deleted in the
+	meantime; \a locker is unlocked then.
+*/
+static bool
+relock_port(Port* port, MutexLocker& locker)
+{
+	locker.SetTo(port->lock, false);
+
+	if (port->deleted) {
+		locker.Unlock();
+		return false;
+	}
+
+	return true;
+}
+
+
 /*!	You need to own the port's lock when calling this function */
 static inline bool
 is_port_closed(Port* port)
@@ -558,17 +604,17 @@ get_port_message(int32 code, size_t bufferSize, uint32 flags, bigtime_t timeout,
 			sWaitingForSpace++;
 			quotaLocker.Unlock();
 
-			port_id portID = port.id;
 			mutex_unlock(&port.lock);
 
 			status_t status = entry.Wait(flags, timeout);
 
-			// re-lock the port and the quota
-			Port* newPort = get_locked_port(portID);
+			// re-lock the port and the quota -- the caller has a reference
+			// to the port, so it's still there, but might have been deleted
+			mutex_lock(&port.lock);
 			quotaLocker.Lock();
 			sWaitingForSpace--;
 
-			if (newPort != &port || is_port_closed(&port)) {
+			if (port.deleted || is_port_closed(&port)) {
 				// the port is no longer usable
 				return B_BAD_PORT_ID;
 			}
@@ -688,6 +734,137 @@ uninit_port_locked(Port* port)
 }
 
 
+/*!	Waits until the port has a message to read.
+	The port must be locked by \a locker, and the caller must have a reference
+	to it. If the port is gone when this function returns, B_BAD_PORT_ID is
+	returned.
+*/
+static status_t
+wait_for_port_message(Port* port, MutexLocker& locker, uint32 flags,
+	bigtime_t timeout)
+{
+	port_id id = port->id;
+
+	while (port->read_count == 0) {
+		if ((flags & B_RELATIVE_TIMEOUT) != 0 && timeout <= 0)
+			return B_WOULD_BLOCK;
+
+		// We need to wait for a message to appear
+		ConditionVariableEntry entry;
+		port->read_condition.Add(&entry);
+
+		locker.Unlock();
+
+		// block if no message, or, if B_TIMEOUT flag set, block with timeout
+		status_t status = entry.Wait(flags, timeout);
+
+		// re-lock
+		if (!relock_port(port, locker)
+			|| (is_port_closed(port) && port->messages.IsEmpty())) {
+			// the port is no longer there
+			T(Read(id, 0, 0, 0, B_BAD_PORT_ID));
+			return B_BAD_PORT_ID;
+		}
+
+		if (status != B_OK) {
+			T(Read(port, 0, status));
+			return status;
+		}
+	}
+
+	return B_OK;
+}
+
+
+/*!	Gives up a slot reserved with reserve_port_slot() again, and lets
+	someone else try and fail.
+	The port must be locked.
+*/
+static void
+release_port_slot(Port* port)
+{
+	port->write_count++;
+	notify_port_select_events(port, B_EVENT_WRITE);
+	port->write_condition.NotifyOne();
+}
+
+
+/*!	Reserves a slot in the port's queue for a new message, and waits for one
+	to become available, if necessary.
+	The port must be locked by \a locker, and the caller must have a reference
+	to it. If the port is gone when this function returns, B_BAD_PORT_ID is
+	returned. On error, no slot is reserved.
+*/
+static status_t
+reserve_port_slot(Port* port, MutexLocker& locker, uint32 flags,
+	bigtime_t timeout)
+{
+	if (port->write_count > 0) {
+		port->write_count--;
+		return B_OK;
+	}
+
+	if ((flags & B_RELATIVE_TIMEOUT) != 0 && timeout <= 0)
+		return B_WOULD_BLOCK;
+
+	port_id id = port->id;
+	port->write_count--;
+
+	// We need to block in order to wait for a free message slot
+	ConditionVariableEntry entry;
+	port->write_condition.Add(&entry);
+
+	locker.Unlock();
+
+	status_t status = entry.Wait(flags, timeout);
+
+	// re-lock
+	if (!relock_port(port, locker) || is_port_closed(port)) {
+		// the port is no longer there
+		T(Write(id, 0, 0, 0, 0, B_BAD_PORT_ID));
+		return B_BAD_PORT_ID;
+	}
+
+	if (status != B_OK) {
+		T(Write(id, port->read_count, port->write_count, 0, 0, status));
+		release_port_slot(port);
+	}
+
+	return status;
+}
+
+
+static status_t
+fill_port_message(port_message* message, const iovec* msgVecs,
+	size_t vecCount, size_t bufferSize, bool userCopy)
+{
+	// sender credentials
+	message->sender = geteuid();
+	message->sender_group = getegid();
+	message->sender_team = team_get_current_team_id();
+
+	size_t offset = 0;
+	for (uint32 i = 0; i < vecCount && bufferSize > 0; i++) {
+		size_t bytes = msgVecs[i].iov_len;
+		if (bytes > bufferSize)
+			bytes = bufferSize;
+
+		if (userCopy) {
+			status_t status = user_memcpy(message->buffer + offset,
+				msgVecs[i].iov_base, bytes);
+			if (status != B_OK)
+				return status;
+		} else
+			memcpy(message->buffer + offset, msgVecs[i].iov_base, bytes);
+
+		bufferSize -= bytes;
+		offset += bytes;
+	}
+
+	return B_OK;
+}
+
+
 //	#pragma mark - private kernel API
 
 
@@ -698,7 +875,7 @@ delete_owned_ports(Team* team)
 {
 	TRACE(("delete_owned_ports(owner = %ld)\n", team->id));
 
-	MutexLocker portsLocker(sPortsLock);
+	WriteLocker portsLocker(sPortsLock);
 
 	// move the ports from the team's port list to a local list
 	struct list queue;
@@ -710,6 +887,7 @@ delete_owned_ports(Team* team)
 	while (port != NULL) {
 		MutexLocker locker(port->lock);
 		sPorts.Remove(port);
+		port->deleted = true;
 		uninit_port_locked(port);
 		sUsedPorts--;
 
@@ -718,9 +896,10 @@ delete_owned_ports(Team* team)
 
 	portsLocker.Unlock();
 
-	// delete the ports
+	// release the hash table's references -- the ports are deleted as soon as
+	// no one else uses them anymore
 	while (Port* port = (Port*)list_remove_head_item(&queue))
-		delete port;
+		port->ReleaseReference();
 }
 
 
@@ -829,7 +1008,7 @@ create_port(int32 queueLength, const char* name)
 	}
 	ObjectDeleter<Port> portDeleter(port);
 
-	MutexLocker locker(sPortsLock);
+	WriteLocker locker(sPortsLock);
 
 	// check the ports limit
 	if (sUsedPorts >= sMaxPorts)
@@ -846,7 +1025,8 @@ create_port(int32 queueLength, const char* name)
 			sNextPortID = 1;
 	} while (sPorts.Lookup(port->id) != NULL);
 
-	// insert port in table and team list
+	// insert port in table and team list -- the table gets the initial
+	// reference
 	sPorts.Insert(port);
 	list_add_item(&team->port_list, &port->team_link);
 	portDeleter.Detach();
@@ -874,7 +1054,8 @@ close_port(port_id id)
 		return B_BAD_PORT_ID;
 
 	// get the port
-	Port* port = get_locked_port(id);
+	BReference<Port> portReference;
+	Port* port = get_locked_port(id, portReference);
 	if (port == NULL) {
 		TRACE(("close_port: invalid port_id %ld\n", id));
 		return B_BAD_PORT_ID;
@@ -907,7 +1088,7 @@ delete_port(port_id id)
 	Port* port;
 	MutexLocker locker;
 	{
-		MutexLocker portsLocker(sPortsLock);
+		WriteLocker portsLocker(sPortsLock);
 
 		port = sPorts.Lookup(id);
 		if (port == NULL) {
@@ -922,6 +1103,7 @@ delete_port(port_id id)
 
 		locker.SetTo(port->lock, false);
 
+		port->deleted = true;
 		uninit_port_locked(port);
 	}
 
@@ -929,7 +1111,9 @@ delete_port(port_id id)
 
 	locker.Unlock();
 
-	delete port;
+	// release the hash table's reference -- the port is deleted once no one
+	// waiting on it uses it anymore
+	port->ReleaseReference();
 
 	return B_OK;
 }
@@ -942,7 +1126,8 @@ select_port(int32 id, struct select_info* info, bool kernel)
 		return B_BAD_PORT_ID;
 
 	// get the port
-	Port* port = get_locked_port(id);
+	BReference<Port> portReference;
+	Port* port = get_locked_port(id, portReference);
 	if (port == NULL)
 		return B_BAD_PORT_ID;
 	MutexLocker locker(port->lock, true);
@@ -990,7 +1175,8 @@ deselect_port(int32 id, struct select_info* info, bool kernel)
 		return B_OK;
 
 	// get the port
-	Port* port = get_locked_port(id);
+	BReference<Port> portReference;
+	Port* port = get_locked_port(id, portReference);
 	if (port == NULL)
 		return B_BAD_PORT_ID;
 	MutexLocker locker(port->lock, true);
@@ -1019,7 +1205,7 @@ find_port(const char* name)
 	if (name == NULL)
 		return B_BAD_VALUE;
 
-	MutexLocker portsLocker(sPortsLock);
+	ReadLocker portsLocker(sPortsLock);
 
 	for (PortHashTable::Iterator it = sPorts.GetIterator();
 		Port* port = it.Next();) {
@@ -1042,7 +1228,8 @@ _get_port_info(port_id id, port_info* info, size_t size)
 		return B_BAD_PORT_ID;
 
 	// get the port
-	Port* port = get_locked_port(id);
+	BReference<Port> portReference;
+	Port* port = get_locked_port(id, portReference);
 	if (port == NULL) {
 		TRACE(("get_port_info: invalid port_id %ld\n", id));
 		return B_BAD_PORT_ID;
@@ -1074,7 +1261,7 @@ _get_next_port_info(team_id teamID, int32* _cookie, struct port_info* info,
 	BReference<Team> teamReference(team, true);
 
 	// iterate through the team's port list
-	MutexLocker portsLocker(sPortsLock);
+	ReadLocker portsLocker(sPortsLock);
 
 	int32 stopIndex = *_cookie;
 	int32 index = 0;
@@ -1132,7 +1319,8 @@ _get_port_message_info_etc(port_id id, port_message_info* info,
 		| B_ABSOLUTE_TIMEOUT;
 
 	// get the port
-	Port* port = get_locked_port(id);
+	BReference<Port> portReference;
+	Port* port = get_locked_port(id, portReference);
 	if (port == NULL)
 		return B_BAD_PORT_ID;
 	MutexLocker locker(port->lock, true);
@@ -1162,14 +1350,7 @@ _get_port_message_info_etc(port_id id, port_message_info* info,
 		}
 
 		// re-lock
-		Port* newPort = get_locked_port(id);
-		if (newPort == NULL) {
-			T(Info(id, 0, 0, 0, B_BAD_PORT_ID));
-			return B_BAD_PORT_ID;
-		}
-		locker.SetTo(newPort->lock, true);
-
-		if (newPort != port
+		if (!relock_port(port, locker)
 			|| (is_port_closed(port) && port->messages.IsEmpty())) {
 			// the port is no longer there
 			T(Info(id, 0, 0, 0, B_BAD_PORT_ID));
@@ -1205,7 +1386,8 @@ port_count(port_id id)
 		return B_BAD_PORT_ID;
 
 	// get the port
-	Port* port = get_locked_port(id);
+	BReference<Port> portReference;
+	Port* port = get_locked_port(id, portReference);
 	if (port == NULL) {
 		TRACE(("port_count: invalid port_id %ld\n", id));
 		return B_BAD_PORT_ID;
@@ -1241,7 +1423,8 @@ read_port_etc(port_id id, int32* _code, void* buffer, size_t bufferSize,
 		| B_ABSOLUTE_TIMEOUT;
 
 	// get the port
-	Port* port = get_locked_port(id);
+	BReference<Port> portReference;
+	Port* port = get_locked_port(id, portReference);
 	if (port == NULL)
 		return B_BAD_PORT_ID;
 	MutexLocker locker(port->lock, true);
@@ -1252,39 +1435,9 @@ read_port_etc(port_id id, int32* _code, void* buffer, size_t bufferSize,
 		return B_BAD_PORT_ID;
 	}
 
-	while (port->read_count == 0) {
-		if ((flags & B_RELATIVE_TIMEOUT) != 0 && timeout <= 0)
-			return B_WOULD_BLOCK;
-
-		// We need to wait for a message to appear
-		ConditionVariableEntry entry;
-		port->read_condition.Add(&entry);
-
-		locker.Unlock();
-
-		// block if no message, or, if B_TIMEOUT flag set, block with timeout
-		status_t status = entry.Wait(flags, timeout);
-
-		// re-lock
-		Port* newPort = get_locked_port(id);
-		if (newPort == NULL) {
-			T(Read(id, 0, 0, 0, B_BAD_PORT_ID));
-			return B_BAD_PORT_ID;
-		}
-		locker.SetTo(newPort->lock, true);
-
-		if (newPort != port
-			|| (is_port_closed(port) && port->messages.IsEmpty())) {
-			// the port is no longer there
-			T(Read(id, 0, 0, 0, B_BAD_PORT_ID));
-			return B_BAD_PORT_ID;
-		}
-
-		if (status != B_OK) {
-			T(Read(port, 0, status));
-			return status;
-		}
-	}
+	status_t status = wait_for_port_message(port, locker, flags, timeout);
+	if (status != B_OK)
+		return status;
 
 	// determine tail & get the length of the message
 	port_message* message = port->messages.Head();
@@ -1371,7 +1524,8 @@ writev_port_etc(port_id id, int32 msgCode, const iovec* msgVecs,
 	port_message* message = NULL;
 
 	// get the port
-	Port* port = get_locked_port(id);
+	BReference<Port> portReference;
+	Port* port = get_locked_port(id, portReference);
 	if (port == NULL) {
 		TRACE(("write_port_etc: invalid port_id %ld\n", id));
 		return B_BAD_PORT_ID;
@@ -1383,38 +1537,9 @@ writev_port_etc(port_id id, int32 msgCode, const iovec* msgVecs,
 		return B_BAD_PORT_ID;
 	}
 
-	if (port->write_count <= 0) {
-		if ((flags & B_RELATIVE_TIMEOUT) != 0 && timeout <= 0)
-			return B_WOULD_BLOCK;
-
-		port->write_count--;
-
-		// We need to block in order to wait for a free message slot
-		ConditionVariableEntry entry;
-		port->write_condition.Add(&entry);
-
-		locker.Unlock();
-
-		status = entry.Wait(flags, timeout);
-
-		// re-lock
-		Port* newPort = get_locked_port(id);
-		if (newPort == NULL) {
-			T(Write(id, 0, 0, 0, 0, B_BAD_PORT_ID));
-			return B_BAD_PORT_ID;
-		}
-		locker.SetTo(newPort->lock, true);
-
-		if (newPort != port || is_port_closed(port)) {
-			// the port is no longer there
-			T(Write(id, 0, 0, 0, 0, B_BAD_PORT_ID));
-			return B_BAD_PORT_ID;
-		}
-
-		if (status != B_OK)
-			goto error;
-	} else
-		port->write_count--;
+	status = reserve_port_slot(port, locker, flags, timeout);
+	if (status != B_OK)
+		return status;
 
 	status = get_port_message(msgCode, bufferSize, flags, timeout,
 		&message, *port);
@@ -1428,34 +1553,11 @@ writev_port_etc(port_id id, int32 msgCode, const iovec* msgVecs,
 		goto error;
 	}
 
-	// sender credentials
-	message->sender = geteuid();
-	message->sender_group = getegid();
-	message->sender_team = team_get_current_team_id();
-
-	if (bufferSize > 0) {
-		size_t offset = 0;
-		for (uint32 i = 0; i < vecCount; i++) {
-			size_t bytes = msgVecs[i].iov_len;
-			if (bytes > bufferSize)
-				bytes = bufferSize;
-
-			if (userCopy) {
-				status_t status = user_memcpy(message->buffer + offset,
-					msgVecs[i].iov_base, bytes);
-				if (status != B_OK) {
-					put_port_message(message);
-					goto error;
-				}
-			} else
-				memcpy(message->buffer + offset, msgVecs[i].iov_base, bytes);
-
-			bufferSize -= bytes;
-			if (bufferSize == 0)
-				break;
-
-			offset += bytes;
-		}
+	status = fill_port_message(message, msgVecs, vecCount, bufferSize,
+		userCopy);
+	if (status != B_OK) {
+		put_port_message(message);
+		goto error;
 	}
 
 	port->messages.Add(message);
@@ -1472,14 +1574,194 @@ error:
 	// Give up our slot in the queue again, and let someone else
 	// try and fail
 	T(Write(id, port->read_count, port->write_count, 0, 0, status));
-	port->write_count++;
-	notify_port_select_events(port, B_EVENT_WRITE);
-	port->write_condition.NotifyOne();
+	release_port_slot(port);
 
 	return status;
 }
 
 
+/*!	Writes up to \a count messages to the port with a single lookup and
+	wakeup. Only reserving a slot for the first message may block; the
+	remaining messages are only written as long as the port has free slots.
+	Returns the number of messages written.
+*/
+ssize_t
+write_port_messages_etc(port_id id, const port_message_data* messages,
+	int32 count, uint32 flags, bigtime_t timeout)
+{
+	if (!sPortsActive || id < 0)
+		return B_BAD_PORT_ID;
+	if (messages == NULL || count <= 0)
+		return B_BAD_VALUE;
+
+	for (int32 i = 0; i < count; i++) {
+		if (messages[i].size > PORT_MAX_MESSAGE_SIZE)
+			return B_BAD_VALUE;
+	}
+
+	bool userCopy = (flags & PORT_FLAG_USE_USER_MEMCPY) != 0;
+
+	// mask irrelevant flags (for acquire_sem() usage)
+	flags &= B_CAN_INTERRUPT | B_KILL_CAN_INTERRUPT | B_RELATIVE_TIMEOUT
+		| B_ABSOLUTE_TIMEOUT;
+	if ((flags & B_RELATIVE_TIMEOUT) != 0
+		&& timeout != B_INFINITE_TIMEOUT && timeout > 0) {
+		// Make the timeout absolute, since we have more than one step where
+		// we might have to wait
+		flags = (flags & ~B_RELATIVE_TIMEOUT) | B_ABSOLUTE_TIMEOUT;
+		timeout += system_time();
+	}
+
+	// get the port
+	BReference<Port> portReference;
+	Port* port = get_locked_port(id, portReference);
+	if (port == NULL)
+		return B_BAD_PORT_ID;
+	MutexLocker locker(port->lock, true);
+
+	if (is_port_closed(port))
+		return B_BAD_PORT_ID;
+
+	status_t status = B_OK;
+	int32 written = 0;
+
+	for (; written < count; written++) {
+		if (written > 0) {
+			// don't wait for anything after the first message
+			flags = (flags & ~B_ABSOLUTE_TIMEOUT) | B_RELATIVE_TIMEOUT;
+			timeout = 0;
+		}
+
+		status = reserve_port_slot(port, locker, flags, timeout);
+		if (status != B_OK)
+			break;
+
+		port_message* message;
+		status = get_port_message(messages[written].code,
+			messages[written].size, flags, timeout, &message, *port);
+		if (status == B_BAD_PORT_ID) {
+			// the port had to be unlocked and is now no longer there
+			return B_BAD_PORT_ID;
+		}
+		if (status != B_OK) {
+			release_port_slot(port);
+			break;
+		}
+
+		iovec vec = { messages[written].buffer, messages[written].size };
+		status = fill_port_message(message, &vec, 1, vec.iov_len, userCopy);
+		if (status != B_OK) {
+			put_port_message(message);
+			release_port_slot(port);
+			break;
+		}
+
+		port->messages.Add(message);
+		port->read_count++;
+
+		T(Write(id, port->read_count, port->write_count, message->code,
+			message->size, B_OK));
+	}
+
+	if (written == 0)
+		return status;
+
+	notify_port_select_events(port, B_EVENT_READ);
+	if (written == 1)
+		port->read_condition.NotifyOne();
+	else
+		port->read_condition.NotifyAll();
+
+	return written;
+}
+
+
+/*!	Reads up to \a count messages from the port with a single lookup and
+	wakeup. Only waiting for the first message may block. A message is only
+	removed from the port if it fits into the buffer provided for it; the
+	size of each message read is returned in its port_message_data::size.
+	Returns the number of messages read, or B_BUFFER_OVERFLOW if the first
+	message did not fit.
+*/
+ssize_t
+read_port_messages_etc(port_id id, port_message_data* messages, int32 count,
+	uint32 flags, bigtime_t timeout)
+{
+	if (!sPortsActive || id < 0)
+		return B_BAD_PORT_ID;
+	if (messages == NULL || count <= 0 || timeout < 0)
+		return B_BAD_VALUE;
+
+	bool userCopy = (flags & PORT_FLAG_USE_USER_MEMCPY) != 0;
+
+	flags &= B_CAN_INTERRUPT | B_KILL_CAN_INTERRUPT | B_RELATIVE_TIMEOUT
+		| B_ABSOLUTE_TIMEOUT;
+
+	// get the port
+	BReference<Port> portReference;
+	Port* port = get_locked_port(id, portReference);
+	if (port == NULL)
+		return B_BAD_PORT_ID;
+	MutexLocker locker(port->lock, true);
+
+	if (is_port_closed(port) && port->messages.IsEmpty())
+		return B_BAD_PORT_ID;
+
+	status_t status = wait_for_port_message(port, locker, flags, timeout);
+	if (status != B_OK)
+		return status;
+
+	MessageList readMessages;
+	int32 read = 0;
+
+	while (read < count && port->read_count > 0) {
+		port_message* message = port->messages.Head();
+		if (message->size > messages[read].size)
+			break;
+
+		port->messages.RemoveHead();
+		port->total_count++;
+		port->write_count++;
+		port->read_count--;
+
+		T(Read(id, port->read_count, port->write_count, message->code,
+			message->size));
+
+		readMessages.Add(message);
+		read++;
+	}
+
+	if (read == 0) {
+		// we didn't take the message we might have been woken up for
+		port->read_condition.NotifyOne();
+		return B_BUFFER_OVERFLOW;
+	}
+
+	notify_port_select_events(port, B_EVENT_WRITE);
+	if (read == 1)
+		port->write_condition.NotifyOne();
+	else
+		port->write_condition.NotifyAll();
+
+	locker.Unlock();
+
+	for (int32 i = 0; i < read; i++) {
+		port_message* message = readMessages.RemoveHead();
+
+		ssize_t size = copy_port_message(message, &messages[i].code,
+			messages[i].buffer, messages[i].size, userCopy);
+		if (size < 0)
+			status = size;
+		else
+			messages[i].size = size;
+
+		put_port_message(message);
+	}
+
+	return status == B_OK ? read : status;
+}
+
+
 status_t
 set_port_owner(port_id id, team_id newTeamID)
 {
@@ -1495,7 +1777,7 @@ set_port_owner(port_id id, team_id newTeamID)
 	BReference<Team> teamReference(team, true);
 
 	// get the port
-	MutexLocker portsLocker(sPortsLock);
+	WriteLocker portsLocker(sPortsLock);
 	Port* port = sPorts.Lookup(id);
 	if (port == NULL) {
 		TRACE(("set_port_owner: invalid port_id %ld\n", id));
@@ -1715,6 +1997,78 @@ _user_writev_port_etc(port_id port, int32 messageCode, const iovec *userVecs,
 }
 
 
+ssize_t
+_user_write_port_messages_etc(port_id port,
+	const port_message_data *userMessages, int32 count, uint32 flags,
+	bigtime_t timeout)
+{
+	syscall_restart_handle_timeout_pre(flags, timeout);
+
+	if (userMessages == NULL || count <= 0)
+		return B_BAD_VALUE;
+	if (!IS_USER_ADDRESS(userMessages))
+		return B_BAD_ADDRESS;
+	if (count > PORT_MAX_MESSAGE_BATCH)
+		count = PORT_MAX_MESSAGE_BATCH;
+
+	port_message_data messages[PORT_MAX_MESSAGE_BATCH];
+	if (user_memcpy(messages, userMessages, sizeof(port_message_data) * count)
+			!= B_OK) {
+		return B_BAD_ADDRESS;
+	}
+
+	for (int32 i = 0; i < count; i++) {
+		if (messages[i].buffer == NULL && messages[i].size != 0)
+			return B_BAD_VALUE;
+		if (messages[i].buffer != NULL && !IS_USER_ADDRESS(messages[i].buffer))
+			return B_BAD_ADDRESS;
+	}
+
+	ssize_t written = write_port_messages_etc(port, messages, count,
+		flags | PORT_FLAG_USE_USER_MEMCPY | B_CAN_INTERRUPT, timeout);
+
+	return syscall_restart_handle_timeout_post(written, timeout);
+}
+
+
+ssize_t
+_user_read_port_messages_etc(port_id port, port_message_data *userMessages,
+	int32 count, uint32 flags, bigtime_t timeout)
+{
+	syscall_restart_handle_timeout_pre(flags, timeout);
+
+	if (userMessages == NULL || count <= 0)
+		return B_BAD_VALUE;
+	if (!IS_USER_ADDRESS(userMessages))
+		return B_BAD_ADDRESS;
+	if (count > PORT_MAX_MESSAGE_BATCH)
+		count = PORT_MAX_MESSAGE_BATCH;
+
+	port_message_data messages[PORT_MAX_MESSAGE_BATCH];
+	if (user_memcpy(messages, userMessages, sizeof(port_message_data) * count)
+			!= B_OK) {
+		return B_BAD_ADDRESS;
+	}
+
+	for (int32 i = 0; i < count; i++) {
+		if (messages[i].buffer == NULL && messages[i].size != 0)
+			return B_BAD_VALUE;
+		if (messages[i].buffer != NULL && !IS_USER_ADDRESS(messages[i].buffer))
+			return B_BAD_ADDRESS;
+	}
+
+	ssize_t read = read_port_messages_etc(port, messages, count,
+		flags | PORT_FLAG_USE_USER_MEMCPY | B_CAN_INTERRUPT, timeout);
+
+	if (read > 0 && user_memcpy(userMessages, messages,
+			sizeof(port_message_data) * read) != B_OK) {
+		return B_BAD_ADDRESS;
+	}
+
+	return syscall_restart_handle_timeout_post(read, timeout);
+}
+
+
 status_t
 _user_get_port_message_info_etc(port_id port, port_message_info *userInfo,
 	size_t infoSize, uint32 flags, bigtime_t timeout)
@@ -5,14 +5,18 @@
  */
 
 
+#include <string.h>
+
 #include <kscheduler.h>
 #include <listeners.h>
+#include <safemode.h>
 #include <smp.h>
 
 #include "scheduler_affine.h"
 #include "scheduler_simple.h"
 #include "scheduler_simple_smp.h"
 #include "scheduler_tracing.h"
+#include "scheduler_work_stealing.h"
 
 
 struct scheduler_ops* gScheduler;
@@ -68,18 +72,30 @@ scheduler_init(void)
 		cpuCount != 1 ? "s" : "");
 
 	if (cpuCount > 1) {
-#if 0
-		dprintf("scheduler_init: using affine scheduler\n");
-		scheduler_affine_init();
-#else
-		dprintf("scheduler_init: using simple SMP scheduler\n");
-		scheduler_simple_smp_init();
-#endif
+		char scheduler[32];
+		size_t length = sizeof(scheduler);
+		if (get_safemode_option(B_SAFEMODE_SCHEDULER, scheduler, &length)
+				!= B_OK) {
+			scheduler[0] = '\0';
+		}
+
+		if (strcmp(scheduler, "affine") == 0) {
+			dprintf("scheduler_init: using affine scheduler\n");
+			scheduler_affine_init();
+		} else if (strcmp(scheduler, "work_stealing") == 0) {
+			dprintf("scheduler_init: using work stealing scheduler\n");
+			scheduler_work_stealing_init();
+		} else {
+			dprintf("scheduler_init: using simple SMP scheduler\n");
+			scheduler_simple_smp_init();
+		}
 	} else {
 		dprintf("scheduler_init: using simple scheduler\n");
 		scheduler_simple_init();
 	}
 
+	scheduler_stats_init();
+
 	// Disable rescheduling until the basic kernel initialization is done and
 	// CPUs are ready to enable interrupts.
 	sRescheduleFunction = gScheduler->reschedule;
@@ -0,0 +1,201 @@
+/*
+ * Copyright 2013, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Always-on scheduling statistics: wakeup-to-run latency histograms per CPU
+	and per thread, run queue length samples, and migration counters.
+	They are collected by a scheduler listener, and thus work with every
+	scheduler implementation.
+*/
+
+
+#include <new>
+
+#include <string.h>
+
+#include <cpu.h>
+#include <kernel.h>
+#include <kscheduler.h>
+#include <listeners.h>
+#include <scheduler_defs.h>
+#include <smp.h>
+#include <thread.h>
+#include <util/AutoLock.h>
+
+
+class SchedulerStatsListener : public SchedulerListener {
+public:
+	virtual	void				ThreadEnqueuedInRunQueue(Thread* thread);
+	virtual	void				ThreadRemovedFromRunQueue(Thread* thread);
+	virtual	void				ThreadScheduled(Thread* oldThread,
+									Thread* newThread);
+};
+
+
+static SchedulerStatsListener sListener;
+static scheduler_cpu_stats sCPUStats[B_MAX_CPU_COUNT];
+static int32 sReadyThreads;
+	// the number of non-idle threads in the run queue(s)
+
+
+static inline int32
+latency_bucket(bigtime_t latency)
+{
+	int32 bucket = 0;
+	while (latency > 0 && bucket < SCHEDULER_LATENCY_BUCKETS - 1) {
+		latency >>= 1;
+		bucket++;
+	}
+
+	return bucket;
+}
+
+
+// #pragma mark - SchedulerStatsListener
+
+
+void
+SchedulerStatsListener::ThreadEnqueuedInRunQueue(Thread* thread)
+{
+	if (thread_is_idle_thread(thread))
+		return;
+
+	sReadyThreads++;
+
+	// We only measure the time a thread has to wait after it has been woken
+	// up, not when the running thread is put back into the queue.
+	if (thread->ready_time == 0 && thread != thread_get_current_thread())
+		thread->ready_time = system_time();
+}
+
+
+void
+SchedulerStatsListener::ThreadRemovedFromRunQueue(Thread* thread)
+{
+	if (!thread_is_idle_thread(thread))
+		sReadyThreads--;
+}
+
+
+void
+SchedulerStatsListener::ThreadScheduled(Thread* oldThread, Thread* newThread)
+{
+	int32 cpu = smp_get_current_cpu();
+	scheduler_cpu_stats& cpuStats = sCPUStats[cpu];
+
+	if (newThread != oldThread)
+		cpuStats.context_switches++;
+
+	if (thread_is_idle_thread(newThread))
+		return;
+
+	sReadyThreads--;
+
+	// sample the run queue length
+	uint32 queueLength = sReadyThreads > 0 ? sReadyThreads : 0;
+	cpuStats.run_queue_samples++;
+	cpuStats.total_run_queue_length += queueLength;
+	if (queueLength > cpuStats.max_run_queue_length)
+		cpuStats.max_run_queue_length = queueLength;
+
+	scheduler_thread_stats& threadStats = newThread->scheduler_stats;
+
+	if (newThread->previous_cpu != NULL
+		&& newThread->previous_cpu != &gCPU[cpu]) {
+		cpuStats.migrations++;
+		threadStats.migrations++;
+	}
+
+	if (newThread->ready_time == 0)
+		return;
+
+	bigtime_t latency = system_time() - newThread->ready_time;
+	newThread->ready_time = 0;
+
+	int32 bucket = latency_bucket(latency);
+
+	cpuStats.wakeups++;
+	cpuStats.total_latency += latency;
+	if (latency > cpuStats.max_latency)
+		cpuStats.max_latency = latency;
+	cpuStats.latency_histogram[bucket]++;
+
+	threadStats.wakeups++;
+	threadStats.total_latency += latency;
+	if (latency > threadStats.max_latency)
+		threadStats.max_latency = latency;
+	threadStats.latency_histogram[bucket]++;
+}
+
+
+// #pragma mark - kernel private
+
+
+void
+scheduler_stats_init(void)
+{
+	// manually call constructor
+	new(&sListener) SchedulerStatsListener;
+
+	for (int32 i = 0; i < B_MAX_CPU_COUNT; i++)
+		sCPUStats[i].cpu = i;
+
+	scheduler_add_listener(&sListener);
+}
+
+
+// #pragma mark - syscalls
+
+
+status_t
+_user_get_scheduler_cpu_stats(int32 cpu, scheduler_cpu_stats* userStats,
+	size_t size)
+{
+	if (cpu < 0 || cpu >= smp_get_num_cpus())
+		return B_BAD_VALUE;
+	if (size != sizeof(scheduler_cpu_stats))
+		return B_BAD_VALUE;
+	if (userStats == NULL || !IS_USER_ADDRESS(userStats))
+		return B_BAD_ADDRESS;
+
+	scheduler_cpu_stats stats;
+
+	InterruptsSpinLocker locker(gSchedulerLock);
+	memcpy(&stats, &sCPUStats[cpu], sizeof(stats));
+	locker.Unlock();
+
+	return user_memcpy(userStats, &stats, sizeof(stats));
+}
+
+
+status_t
+_user_get_scheduler_thread_stats(thread_id id,
+	scheduler_thread_stats* userStats, size_t size)
+{
+	if (size != sizeof(scheduler_thread_stats))
+		return B_BAD_VALUE;
+	if (userStats == NULL || !IS_USER_ADDRESS(userStats))
+		return B_BAD_ADDRESS;
+
+	// get the thread
+	Thread* thread;
+	if (id < 0) {
+		thread = thread_get_current_thread();
+		thread->AcquireReference();
+	} else {
+		thread = Thread::Get(id);
+		if (thread == NULL)
+			return B_BAD_THREAD_ID;
+	}
+	BReference<Thread> threadReference(thread, true);
+
+	scheduler_thread_stats stats;
+
+	InterruptsSpinLocker locker(gSchedulerLock);
+	memcpy(&stats, &thread->scheduler_stats, sizeof(stats));
+	locker.Unlock();
+
+	return user_memcpy(userStats, &stats, sizeof(stats));
+}
@@ -0,0 +1,786 @@
+/*
+ * Copyright 2013, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*! The work stealing SMP thread scheduler.
+
+	Every CPU has its own run queue, with one FIFO per priority, and a bitmap
+	of the priorities that have threads queued. A ready thread is queued on
+	the CPU it ran on last, as long as its caches are still likely to be warm
+	there and that CPU isn't much busier than the others; otherwise it goes to
+	the least loaded CPU.
+	A CPU whose run queue runs empty steals a thread from the busiest other
+	CPU before it goes idle. In addition, every CPU periodically pulls threads
+	from the busiest CPU, if the loads differ by more than one thread.
+	Threads that ran recently are only migrated if there's nothing else.
+	A disabled CPU only runs the threads pinned to it, and hands all others
+	over to the enabled CPUs the next time it reschedules.
+
+	All run queues are protected by the scheduler lock.
+*/
+
+
+#include <OS.h>
+
+#include <cpu.h>
+#include <debug.h>
+#include <int.h>
+#include <kernel.h>
+#include <kscheduler.h>
+#include <listeners.h>
+#include <scheduler_defs.h>
+#include <smp.h>
+#include <thread.h>
+#include <timer.h>
+
+#include "scheduler_common.h"
+#include "scheduler_tracing.h"
+
+
+//#define TRACE_SCHEDULER
+#ifdef TRACE_SCHEDULER
+#	define TRACE(x) dprintf_no_syslog x
+#else
+#	define TRACE(x) ;
+#endif
+
+
+const bigtime_t kThreadQuantum = 3000;
+const bigtime_t kCacheHotTime = 5000;
+	// a thread that ran on a CPU less than this ago is considered cache hot
+const bigtime_t kLoadBalanceInterval = 50000;
+
+const int32 kPriorityCount = THREAD_MAX_SET_PRIORITY + 1;
+const int32 kPriorityBitmapSize = (kPriorityCount + 31) / 32;
+
+
+struct work_stealing_thread_data {
+	void Init()
+	{
+		queue_cpu = -1;
+		queue_priority = -1;
+		last_run_time = 0;
+	}
+
+	int32		queue_cpu;
+		// the CPU whose run queue the thread is in, if any
+	int32		queue_priority;
+		// the priority list the thread is queued in
+	bigtime_t	last_run_time;
+		// the time the thread was last unscheduled
+};
+
+
+struct run_queue {
+	Thread*		heads[kPriorityCount];
+	Thread*		tails[kPriorityCount];
+	uint32		bitmap[kPriorityBitmapSize];
+	int32		count;
+	bigtime_t	last_balance_time;
+} __attribute__((aligned(64)));
+
+
+static run_queue sRunQueues[B_MAX_CPU_COUNT];
+static Thread* sIdleThreads;
+static int32 sCPUCount = 1;
+static int32 sNextCPUForSelection = 0;
+
+static int32 sStolenThreads;
+static int32 sBalancedThreads;
+
+
+static inline work_stealing_thread_data*
+thread_data(Thread* thread)
+{
+	return (work_stealing_thread_data*)thread->scheduler_data;
+}
+
+
+static int
+_rand(void)
+{
+	static int next = 0;
+
+	if (next == 0)
+		next = system_time();
+
+	next = next * 1103515245 + 12345;
+	return (next >> 16) & 0x7FFF;
+}
+
+
+static inline bool
+is_cache_hot(Thread* thread, bigtime_t now)
+{
+	return now - thread_data(thread)->last_run_time < kCacheHotTime;
+}
+
+
+/*!	Returns the number of threads the CPU is busy with, including the one
+	it is currently running.
+*/
+static inline int32
+cpu_load(int32 cpu)
+{
+	int32 load = sRunQueues[cpu].count;
+	if (!thread_is_idle_thread(gCPU[cpu].running_thread))
+		load++;
+	return load;
+}
+
+
+/*!	Returns the highest priority that has threads queued, or -1 if the run
+	queue is empty.
+*/
+static int32
+highest_priority(const run_queue& queue, int32 belowPriority = kPriorityCount)
+{
+	if (belowPriority <= 0)
+		return -1;
+
+	for (int32 i = (belowPriority - 1) / 32; i >= 0; i--) {
+		uint32 bits = queue.bitmap[i];
+		if (i == (belowPriority - 1) / 32 && belowPriority % 32 != 0)
+			bits &= (1UL << (belowPriority % 32)) - 1;
+		if (bits != 0)
+			return i * 32 + 31 - __builtin_clz(bits);
+	}
+
+	return -1;
+}
+
+
+static void
+run_queue_append(int32 cpu, Thread* thread, int32 priority)
+{
+	run_queue& queue = sRunQueues[cpu];
+
+	T(EnqueueThread(thread, queue.tails[priority], NULL));
+
+	thread->queue_next = NULL;
+	if (queue.tails[priority] != NULL)
+		queue.tails[priority]->queue_next = thread;
+	else
+		queue.heads[priority] = thread;
+	queue.tails[priority] = thread;
+
+	queue.bitmap[priority / 32] |= 1UL << (priority % 32);
+	queue.count++;
+
+	thread_data(thread)->queue_cpu = cpu;
+	thread_data(thread)->queue_priority = priority;
+}
+
+
+static void
+run_queue_remove(Thread* thread)
+{
+	work_stealing_thread_data* data = thread_data(thread);
+	run_queue& queue = sRunQueues[data->queue_cpu];
+	int32 priority = data->queue_priority;
+
+	Thread* previous = NULL;
+	Thread* item = queue.heads[priority];
+	while (item != NULL && item != thread) {
+		previous = item;
+		item = item->queue_next;
+	}
+
+	ASSERT(item == thread);
+
+	if (previous != NULL)
+		previous->queue_next = thread->queue_next;
+	else
+		queue.heads[priority] = thread->queue_next;
+	if (queue.tails[priority] == thread)
+		queue.tails[priority] = previous;
+
+	if (queue.heads[priority] == NULL)
+		queue.bitmap[priority / 32] &= ~(1UL << (priority % 32));
+	queue.count--;
+
+	thread->queue_next = NULL;
+	data->queue_cpu = -1;
+	data->queue_priority = -1;
+}
+
+
+static int
+dump_run_queue(int argc, char **argv)
+{
+	for (int32 i = 0; i < sCPUCount; i++) {
+		run_queue& queue = sRunQueues[i];
+		kprintf("Run queue for cpu %ld (%ld threads)\n", i, queue.count);
+		if (queue.count == 0)
+			continue;
+
+		kprintf("thread      id      priority  name\n");
+		for (int32 priority = kPriorityCount - 1; priority >= 0; priority--) {
+			for (Thread* thread = queue.heads[priority]; thread != NULL;
+					thread = thread->queue_next) {
+				kprintf("%p  %-7ld %-8ld  %s\n", thread, thread->id,
+					thread->priority, thread->name);
+			}
+		}
+	}
+
+	kprintf("\nstolen threads: %ld, balanced threads: %ld\n", sStolenThreads,
+		sBalancedThreads);
+	return 0;
+}
+
+
+/*!	Chooses the CPU a ready thread should be queued on.
+*/
+static int32
+select_cpu(Thread* thread)
+{
+	cpu_ent* previousCPU = thread->previous_cpu;
+
+	if (thread->pinned_to_cpu > 0)
+		return previousCPU->cpu_num;
+
+	if (previousCPU != NULL && !previousCPU->disabled
+		&& thread_is_idle_thread(previousCPU->running_thread)
+		&& sRunQueues[previousCPU->cpu_num].count == 0) {
+		// the CPU it ran on last has nothing to do
+		return previousCPU->cpu_num;
+	}
+
+	// find the least loaded CPU, preferring idle ones
+	int32 targetCPU = -1;
+	int32 targetLoad = 0;
+
+	int32 cpu = sNextCPUForSelection;
+	for (int32 i = 0; i < sCPUCount; i++, cpu++) {
+		if (cpu >= sCPUCount)
+			cpu = 0;
+
+		if (gCPU[cpu].disabled)
+			continue;
+
+		int32 load = cpu_load(cpu);
+		if (targetCPU < 0 || load < targetLoad) {
+			targetCPU = cpu;
+			targetLoad = load;
+		}
+	}
+
+	if (++sNextCPUForSelection >= sCPUCount)
+		sNextCPUForSelection = 0;
+
+	// stay where our caches are, unless that CPU is clearly busier
+	if (previousCPU != NULL && !previousCPU->disabled
+		&& is_cache_hot(thread, system_time())
+		&& cpu_load(previousCPU->cpu_num) <= targetLoad + 1) {
+		return previousCPU->cpu_num;
+	}
+
+	if (targetCPU < 0) {
+		// all CPUs are disabled -- can only happen for the boot CPU
+		targetCPU = smp_get_current_cpu();
+	}
+
+	return targetCPU;
+}
+
+
+/*!	Enqueues the thread into the run queue.
+	Note: thread lock must be held when entering this function
+*/
+static void
+enqueue_in_run_queue(Thread *thread)
+{
+	thread->state = thread->next_state = B_THREAD_READY;
+
+	if (thread->priority == B_IDLE_PRIORITY) {
+		thread->queue_next = sIdleThreads;
+		sIdleThreads = thread;
+		thread->next_priority = thread->priority;
+		return;
+	}
+
+	int32 targetCPU = select_cpu(thread);
+	run_queue_append(targetCPU, thread, thread->next_priority);
+
+	thread->next_priority = thread->priority;
+
+	// notify listeners
+	NotifySchedulerListeners(&SchedulerListener::ThreadEnqueuedInRunQueue,
+		thread);
+
+	// If the target CPU runs a thread with a lower priority, tell it to
+	// reschedule.
+	int32 targetPriority = gCPU[targetCPU].running_thread->priority;
+	if (thread->priority > targetPriority) {
+		if (targetCPU == smp_get_current_cpu()) {
+			gCPU[targetCPU].invoke_scheduler = true;
+			gCPU[targetCPU].invoke_scheduler_if_idle = false;
+		} else if (targetPriority == B_IDLE_PRIORITY) {
+			smp_send_ici(targetCPU, SMP_MSG_RESCHEDULE_IF_IDLE, 0, 0, 0, NULL,
+				SMP_MSG_FLAG_ASYNC);
+		} else {
+			smp_send_ici(targetCPU, SMP_MSG_RESCHEDULE, 0, 0, 0, NULL,
+				SMP_MSG_FLAG_ASYNC);
+		}
+	}
+}
+
+
+/*!	Returns the thread that should run next from the given CPU's queue,
+	without dequeuing it, or \c NULL if the queue is empty.
+	Higher priority threads are favored, but lower priority ones get a chance,
+	too, the more likely the closer their priorities are.
+*/
+static Thread*
+select_from_run_queue(int32 cpu)
+{
+	run_queue& queue = sRunQueues[cpu];
+
+	int32 priority = highest_priority(queue);
+	if (priority < 0)
+		return NULL;
+
+	while (priority < B_FIRST_REAL_TIME_PRIORITY) {
+		int32 lowerPriority = highest_priority(queue, priority);
+		if (lowerPriority < 0)
+			break;
+
+		int32 priorityDiff = priority - lowerPriority;
+		if (priorityDiff > 15)
+			break;
+
+		// skip normal threads sometimes
+		// (twice as probable per priority level)
+		if ((_rand() >> (15 - priorityDiff)) != 0)
+			break;
+
+		priority = lowerPriority;
+	}
+
+	return queue.heads[priority];
+}
+
+
+/*!	Looks for a thread in the given CPU's queue that may be migrated to
+	another CPU. Threads that are not cache hot are preferred, unless
+	\a onlyCold is \c true, in which case only those are considered.
+*/
+static Thread*
+find_migratable_thread(int32 cpu, bigtime_t now, bool onlyCold)
+{
+	run_queue& queue = sRunQueues[cpu];
+	Thread* hotThread = NULL;
+
+	int32 priority = highest_priority(queue);
+	while (priority >= 0) {
+		for (Thread* thread = queue.heads[priority]; thread != NULL;
+				thread = thread->queue_next) {
+			// ignore pinned threads, and ones that are still running
+			if (thread->pinned_to_cpu > 0 || thread->cpu != NULL)
+				continue;
+
+			if (!is_cache_hot(thread, now))
+				return thread;
+
+			if (hotThread == NULL)
+				hotThread = thread;
+		}
+
+		priority = highest_priority(queue, priority);
+	}
+
+	return onlyCold ? NULL : hotThread;
+}
+
+
+/*!	Returns the CPU with the most queued threads, or -1 if no other CPU has
+	more than \a minCount threads queued.
+*/
+static int32
+find_busiest_cpu(int32 currentCPU, int32 minCount)
+{
+	int32 busiestCPU = -1;
+	int32 busiestCount = minCount;
+
+	for (int32 i = 0; i < sCPUCount; i++) {
+		if (i == currentCPU)
+			continue;
+
+		if (sRunQueues[i].count > busiestCount) {
+			busiestCPU = i;
+			busiestCount = sRunQueues[i].count;
+		}
+	}
+
+	return busiestCPU;
+}
+
+
+/*!	Called when the current CPU has nothing left to do. Takes a thread from
+	the busiest other CPU and returns it, already dequeued.
+*/
+static Thread*
+steal_thread(int32 currentCPU)
+{
+	int32 victimCPU = find_busiest_cpu(currentCPU, 0);
+	if (victimCPU < 0)
+		return NULL;
+
+	Thread* thread = find_migratable_thread(victimCPU, system_time(), false);
+	if (thread == NULL)
+		return NULL;
+
+	TRACE(("cpu %ld steals thread %ld from cpu %ld\n", currentCPU, thread->id,
+		victimCPU));
+
+	run_queue_remove(thread);
+	sStolenThreads++;
+	return thread;
+}
+
+
+/*!	Evens out the load between the current and the busiest CPU, by moving
+	threads that are not cache hot to the current CPU.
+*/
+static void
+balance_load(int32 currentCPU, bigtime_t now)
+{
+	run_queue& queue = sRunQueues[currentCPU];
+	queue.last_balance_time = now;
+
+	int32 busiestCPU = find_busiest_cpu(currentCPU, queue.count + 1);
+	if (busiestCPU < 0)
+		return;
+
+	int32 toMove = (sRunQueues[busiestCPU].count - queue.count) / 2;
+	while (toMove-- > 0) {
+		Thread* thread = find_migratable_thread(busiestCPU, now, true);
+		if (thread == NULL)
+			break;
+
+		int32 priority = thread_data(thread)->queue_priority;
+		run_queue_remove(thread);
+		run_queue_append(currentCPU, thread, priority);
+		sBalancedThreads++;
+	}
+}
+
+
+/*!	Moves the threads that are not pinned to the given disabled CPU over to
+	the enabled ones. Other CPUs would only steal them when they have nothing
+	else to do, and they could starve if all of them are busy.
+*/
+static void
+evacuate_run_queue(int32 cpu)
+{
+	run_queue& queue = sRunQueues[cpu];
+
+	// Dequeue the threads first, so that they keep their order, and can't be
+	// found again in case they end up in this queue after all.
+	Thread* head = NULL;
+	Thread* tail = NULL;
+
+	for (int32 priority = highest_priority(queue); priority >= 0;
+			priority = highest_priority(queue, priority)) {
+		Thread* thread = queue.heads[priority];
+		while (thread != NULL) {
+			Thread* next = thread->queue_next;
+
+			// leave pinned threads, and ones that are still running alone
+			if (thread->pinned_to_cpu == 0 && thread->cpu == NULL) {
+				T(RemoveThread(thread));
+				NotifySchedulerListeners(
+					&SchedulerListener::ThreadRemovedFromRunQueue, thread);
+
+				run_queue_remove(thread);
+				thread->next_priority = priority;
+
+				if (tail != NULL)
+					tail->queue_next = thread;
+				else
+					head = thread;
+				tail = thread;
+			}
+
+			thread = next;
+		}
+	}
+
+	while (head != NULL) {
+		Thread* thread = head;
+		head = thread->queue_next;
+
+		enqueue_in_run_queue(thread);
+	}
+}
+
+
+/*!	Sets the priority of a thread.
+	Note: thread lock must be held when entering this function
+*/
+static void
+set_thread_priority(Thread *thread, int32 priority)
+{
+	if (priority == thread->priority)
+		return;
+
+	if (thread->state != B_THREAD_READY
+		|| thread->priority == B_IDLE_PRIORITY) {
+		thread->priority = priority;
+		return;
+	}
+
+	// The thread is in the run queue. We need to remove it and re-insert it at
+	// a new position.
+
+	T(RemoveThread(thread));
+
+	// notify listeners
+	NotifySchedulerListeners(&SchedulerListener::ThreadRemovedFromRunQueue,
+		thread);
+
+	run_queue_remove(thread);
+
+	// set priority and re-insert
+	thread->priority = thread->next_priority = priority;
+	enqueue_in_run_queue(thread);
+}
+
+
+static bigtime_t
+estimate_max_scheduling_latency(Thread* thread)
+{
+	// TODO: This is probably meant to be called periodically to return the
+	// current estimate depending on the system usage; we return fixed estimates
+	// per thread priority, though.
+
+	if (thread->priority >= B_REAL_TIME_DISPLAY_PRIORITY)
+		return kThreadQuantum / 4;
+	if (thread->priority >= B_DISPLAY_PRIORITY)
+		return kThreadQuantum;
+
+	return 2 * kThreadQuantum;
+}
+
+
+static int32
+reschedule_event(timer *unused)
+{
+	// This function is called as a result of the timer event set by the
+	// scheduler. Make sure the reschedule() is invoked.
+	thread_get_current_thread()->cpu->invoke_scheduler = true;
+	thread_get_current_thread()->cpu->invoke_scheduler_if_idle = false;
+	thread_get_current_thread()->cpu->preempted = 1;
+	return B_HANDLED_INTERRUPT;
+}
+
+
+/*!	Runs the scheduler.
+	Note: expects thread spinlock to be held
+*/
+static void
+reschedule(void)
+{
+	Thread *oldThread = thread_get_current_thread();
+	int32 currentCPU = oldThread->cpu->cpu_num;
+
+	// check whether we're only supposed to reschedule, if the current thread
+	// is idle
+	if (oldThread->cpu->invoke_scheduler) {
+		oldThread->cpu->invoke_scheduler = false;
+		if (oldThread->cpu->invoke_scheduler_if_idle
+			&& oldThread->priority != B_IDLE_PRIORITY) {
+			oldThread->cpu->invoke_scheduler_if_idle = false;
+			return;
+		}
+	}
+
+	TRACE(("reschedule(): cpu %ld, cur_thread = %ld\n", currentCPU,
+		oldThread->id));
+
+	bigtime_t now = system_time();
+	if (oldThread->scheduler_data != NULL)
+		thread_data(oldThread)->last_run_time = now;
+
+	oldThread->state = oldThread->next_state;
+	switch (oldThread->next_state) {
+		case B_THREAD_RUNNING:
+		case B_THREAD_READY:
+			TRACE(("enqueueing thread %ld into run q. pri = %ld\n",
+				oldThread->id, oldThread->priority));
+			enqueue_in_run_queue(oldThread);
+			break;
+		case B_THREAD_SUSPENDED:
+			TRACE(("reschedule(): suspending thread %ld\n", oldThread->id));
+			break;
+		case THREAD_STATE_FREE_ON_RESCHED:
+			break;
+		default:
+			TRACE(("not enqueueing thread %ld into run q. next_state = %ld\n",
+				oldThread->id, oldThread->next_state));
+			break;
+	}
+
+	Thread* nextThread = NULL;
+
+	if (oldThread->cpu->disabled) {
+		// CPU is disabled - only service threads that are pinned to it, and
+		// hand the others over to the other CPUs
+		evacuate_run_queue(currentCPU);
+
+		run_queue& queue = sRunQueues[currentCPU];
+		for (int32 priority = highest_priority(queue);
+				nextThread == NULL && priority >= 0;
+				priority = highest_priority(queue, priority)) {
+			for (Thread* thread = queue.heads[priority]; thread != NULL;
+					thread = thread->queue_next) {
+				if (thread->pinned_to_cpu > 0) {
+					nextThread = thread;
+					break;
+				}
+			}
+		}
+
+		if (nextThread != NULL)
+			run_queue_remove(nextThread);
+	} else {
+		if (now >= sRunQueues[currentCPU].last_balance_time
+				+ kLoadBalanceInterval) {
+			balance_load(currentCPU, now);
+		}
+
+		nextThread = select_from_run_queue(currentCPU);
+		if (nextThread != NULL)
+			run_queue_remove(nextThread);
+		else
+			nextThread = steal_thread(currentCPU);
+	}
+
+	if (nextThread == NULL) {
+		// nothing to do, grab an idle thread
+		nextThread = sIdleThreads;
+		if (nextThread != NULL)
+			sIdleThreads = nextThread->queue_next;
+	}
+
+	if (nextThread == NULL)
+		panic("reschedule(): run queue is empty!\n");
+
+	T(ScheduleThread(nextThread, oldThread));
+
+	// notify listeners
+	NotifySchedulerListeners(&SchedulerListener::ThreadScheduled, oldThread,
+		nextThread);
+
+	nextThread->state = B_THREAD_RUNNING;
+	nextThread->next_state = B_THREAD_READY;
+	oldThread->was_yielded = false;
+
+	// track kernel time (user time is tracked in thread_at_kernel_entry())
+	scheduler_update_thread_times(oldThread, nextThread);
+
+	// track CPU activity
+	if (!thread_is_idle_thread(oldThread)) {
+		oldThread->cpu->active_time
+			+= (oldThread->kernel_time - oldThread->cpu->last_kernel_time)
+				+ (oldThread->user_time - oldThread->cpu->last_user_time);
+	}
+
+	if (!thread_is_idle_thread(nextThread)) {
+		oldThread->cpu->last_kernel_time = nextThread->kernel_time;
+		oldThread->cpu->last_user_time = nextThread->user_time;
+	}
+
+	if (nextThread != oldThread || oldThread->cpu->preempted) {
+		bigtime_t quantum = kThreadQuantum;	// TODO: calculate quantum?
+		timer* quantumTimer = &oldThread->cpu->quantum_timer;
+
+		if (!oldThread->cpu->preempted)
+			cancel_timer(quantumTimer);
+
+		oldThread->cpu->preempted = 0;
+		add_timer(quantumTimer, &reschedule_event, quantum,
+			B_ONE_SHOT_RELATIVE_TIMER | B_TIMER_ACQUIRE_SCHEDULER_LOCK);
+
+		if (nextThread != oldThread)
+			scheduler_switch_thread(oldThread, nextThread);
+	}
+}
+
+
+static status_t
+on_thread_create(Thread* thread, bool idleThread)
+{
+	// we don't need a data structure for the idle threads
+	if (idleThread) {
+		thread->scheduler_data = NULL;
+		return B_OK;
+	}
+
+	work_stealing_thread_data* data
+		= new(std::nothrow) work_stealing_thread_data;
+	if (data == NULL)
+		return B_NO_MEMORY;
+
+	data->Init();
+	thread->scheduler_data = (scheduler_thread_data*)data;
+	return B_OK;
+}
+
+
+static void
+on_thread_init(Thread* thread)
+{
+	if (thread->scheduler_data != NULL)
+		thread_data(thread)->Init();
+}
+
+
+static void
+on_thread_destroy(Thread* thread)
+{
+	delete thread_data(thread);
+}
+
+
+/*!	This starts the scheduler. Must be run in the context of the initial idle
+	thread. Interrupts must be disabled and will be disabled when returning.
+*/
+static void
+start(void)
+{
+	SpinLocker schedulerLocker(gSchedulerLock);
+
+	reschedule();
+}
+
+
+static scheduler_ops kWorkStealingOps = {
+	enqueue_in_run_queue,
+	reschedule,
+	set_thread_priority,
+	estimate_max_scheduling_latency,
+	on_thread_create,
+	on_thread_init,
+	on_thread_destroy,
+	start
+};
+
+
+// #pragma mark -
+
+
+void
+scheduler_work_stealing_init()
+{
+	sCPUCount = smp_get_num_cpus();
+
+	gScheduler = &kWorkStealingOps;
+	memset(sRunQueues, 0, sizeof(sRunQueues));
+
+	add_debugger_command_etc("run_queue", &dump_run_queue,
+		"List threads in run queue", "\nLists threads in run queue", 0);
+}
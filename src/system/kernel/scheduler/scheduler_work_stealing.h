@@ -0,0 +1,12 @@
+/*
+ * Copyright 2013, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef KERNEL_SCHEDULER_WORK_STEALING_H
+#define KERNEL_SCHEDULER_WORK_STEALING_H
+
+
+void scheduler_work_stealing_init();
+
+
+#endif	// KERNEL_SCHEDULER_WORK_STEALING_H
@@ -75,11 +75,16 @@ ObjectCache::Init(const char* name, size_t objectSize, size_t alignment,
 	maintenance_pending = false;
 	maintenance_in_progress = false;
 	maintenance_resize = false;
+	maintenance_resize_depot = false;
 	maintenance_delete = false;
 
 	usage = 0;
 	this->maximum = maximum;
 
+	slab_allocations = 0;
+	slabs_created = 0;
+	lock_contention = 0;
+
 	this->flags = flags;
 
 	resize_request = NULL;
@@ -65,6 +65,11 @@ struct ObjectCache : DoublyLinkedListLinkImpl<ObjectCache> {
 			size_t				maximum;
 			uint32				flags;
 
+			// statistics, protected by lock
+			uint64				slab_allocations;
+			uint64				slabs_created;
+			uint64				lock_contention;
+
 			ResizeRequest*		resize_request;
 
 			ObjectCacheResizeEntry* resize_entry_can_wait;
@@ -74,6 +79,7 @@ struct ObjectCache : DoublyLinkedListLinkImpl<ObjectCache> {
 			bool				maintenance_pending;
 			bool				maintenance_in_progress;
 			bool				maintenance_resize;
+			bool				maintenance_resize_depot;
 			bool				maintenance_delete;
 
 			void*				cookie;
@@ -109,6 +115,7 @@ public:
 			void*				ObjectAtIndex(slab* source, int32 index) const;
 
 			bool				Lock()	{ return mutex_lock(&lock) == B_OK; }
+			void				LockCounted();
 			void				Unlock()	{ mutex_unlock(&lock); }
 
 			status_t			AllocatePages(void** pages, uint32 flags);
@@ -153,6 +160,19 @@ lower_boundary(const void* object, size_t byteCount)
 }
 
 
+/*!	Locks the cache, and counts whether someone else was holding the lock at
+	the same time.
+*/
+inline void
+ObjectCache::LockCounted()
+{
+	if (mutex_trylock(&lock) != B_OK) {
+		mutex_lock(&lock);
+		lock_contention++;
+	}
+}
+
+
 static inline bool
 check_cache_quota(ObjectCache* cache)
 {
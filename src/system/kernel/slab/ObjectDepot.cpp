@@ -13,6 +13,7 @@
 
 #include <int.h>
 #include <slab/Slab.h>
+#include <slab_defs.h>
 #include <smp.h>
 #include <util/AutoLock.h>
 
@@ -42,9 +43,24 @@ public:
 struct depot_cpu_store {
 	DepotMagazine*	loaded;
 	DepotMagazine*	previous;
+
+	// statistics, only touched by the CPU itself
+	uint64			hits;
+	uint64			misses;
+	uint64			frees;
 };
 
 
+static const size_t kMaxMagazineCapacity = 256;
+
+// Every kContentionCheckInterval exchanges with the depot, we check how many
+// of them had to wait for the depot lock. If that were more than one in
+// kContentionRatio, the magazines are grown, so that the CPUs need to go to
+// the depot less often (cf. Bonwick's paper).
+static const uint32 kContentionCheckInterval = 256;
+static const uint32 kContentionRatio = 16;
+
+
 RANGE_MARKER_FUNCTION_BEGIN(SlabObjectDepot)
 
 
@@ -131,16 +147,55 @@ empty_magazine(object_depot* depot, DepotMagazine* magazine, uint32 flags)
 }
 
 
+/*!	Acquires the depot's inner lock, and keeps track of how often others
+	are holding it at the same time.
+*/
+static void
+lock_depot(object_depot* depot)
+{
+	if (try_acquire_spinlock(&depot->inner_lock))
+		return;
+
+	acquire_spinlock(&depot->inner_lock);
+	depot->contention++;
+	depot->recent_contention++;
+}
+
+
+/*!	Must be called with the depot's inner lock held for every exchange of
+	magazines with the depot.
+*/
+static void
+check_contention(object_depot* depot)
+{
+	if (++depot->recent_exchanges < kContentionCheckInterval)
+		return;
+
+	if (depot->recent_contention * kContentionRatio > depot->recent_exchanges
+		&& depot->magazine_capacity < kMaxMagazineCapacity) {
+		atomic_test_and_set(&depot->resize_state, DEPOT_RESIZE_NEEDED,
+			DEPOT_RESIZE_NONE);
+	}
+
+	depot->recent_exchanges = 0;
+	depot->recent_contention = 0;
+}
+
+
 static bool
 exchange_with_full(object_depot* depot, DepotMagazine*& magazine)
 {
 	ASSERT(magazine->IsEmpty());
 
-	SpinLocker _(depot->inner_lock);
+	lock_depot(depot);
+	SpinLocker _(depot->inner_lock, true);
+
+	check_contention(depot);
 
 	if (depot->full == NULL)
 		return false;
 
+	depot->refills++;
 	depot->full_count--;
 	depot->empty_count++;
 
@@ -156,11 +211,15 @@ exchange_with_empty(object_depot* depot, DepotMagazine*& magazine,
 {
 	ASSERT(magazine == NULL || magazine->IsFull());
 
-	SpinLocker _(depot->inner_lock);
+	lock_depot(depot);
+	SpinLocker _(depot->inner_lock, true);
+
+	check_contention(depot);
 
 	if (depot->empty == NULL)
 		return false;
 
+	depot->exchanges++;
 	depot->empty_count--;
 
 	if (magazine != NULL) {
@@ -206,7 +265,15 @@ object_depot_init(object_depot* depot, size_t capacity, size_t maxCount,
 	depot->empty = NULL;
 	depot->full_count = depot->empty_count = 0;
 	depot->max_count = maxCount;
-	depot->magazine_capacity = capacity;
+	depot->magazine_capacity = std::min(capacity, kMaxMagazineCapacity);
+
+	depot->refills = 0;
+	depot->exchanges = 0;
+	depot->contention = 0;
+	depot->resizes = 0;
+	depot->recent_exchanges = 0;
+	depot->recent_contention = 0;
+	depot->resize_state = DEPOT_RESIZE_NONE;
 
 	rw_lock_init(&depot->outer_lock, "object depot");
 	B_INITIALIZE_SPINLOCK(&depot->inner_lock);
@@ -222,6 +289,9 @@ object_depot_init(object_depot* depot, size_t capacity, size_t maxCount,
 	for (int i = 0; i < cpuCount; i++) {
 		depot->stores[i].loaded = NULL;
 		depot->stores[i].previous = NULL;
+		depot->stores[i].hits = 0;
+		depot->stores[i].misses = 0;
+		depot->stores[i].frees = 0;
 	}
 
 	depot->cookie = cookie;
@@ -257,19 +327,25 @@ object_depot_obtain(object_depot* depot)
 	// if it's not empty, or from the previous magazine if it's full
 	// and finally from the Slab if the magazine depot has no full magazines.
 
-	if (store->loaded == NULL)
+	if (store->loaded == NULL) {
+		store->misses++;
 		return NULL;
+	}
 
 	while (true) {
-		if (!store->loaded->IsEmpty())
+		if (!store->loaded->IsEmpty()) {
+			store->hits++;
 			return store->loaded->Pop();
+		}
 
 		if (store->previous
 			&& (store->previous->IsFull()
 				|| exchange_with_full(depot, store->previous))) {
 			std::swap(store->previous, store->loaded);
-		} else
+		} else {
+			store->misses++;
 			return NULL;
+		}
 	}
 }
 
@@ -288,8 +364,10 @@ object_depot_store(object_depot* depot, void* object, uint32 flags)
 	// we return the object directly to the slab.
 
 	while (true) {
-		if (store->loaded != NULL && store->loaded->Push(object))
+		if (store->loaded != NULL && store->loaded->Push(object)) {
+			store->frees++;
 			return;
+		}
 
 		DepotMagazine* freeMagazine = NULL;
 		if ((store->previous != NULL && store->previous->IsEmpty())
@@ -355,12 +433,17 @@ object_depot_make_empty(object_depot* depot, uint32 flags)
 
 	// detach the depot's full and empty magazines
 
+	InterruptsSpinLocker interruptsLocker(depot->inner_lock);
+
 	DepotMagazine* fullMagazines = depot->full;
 	depot->full = NULL;
+	depot->full_count = 0;
 
 	DepotMagazine* emptyMagazines = depot->empty;
 	depot->empty = NULL;
+	depot->empty_count = 0;
 
+	interruptsLocker.Unlock();
 	writeLocker.Unlock();
 
 	// free all magazines
@@ -376,6 +459,77 @@ object_depot_make_empty(object_depot* depot, uint32 flags)
 }
 
 
+/*!	Sets the number of objects a magazine can hold. Since the magazines
+	currently in use cannot be changed, the depot is emptied.
+*/
+status_t
+object_depot_set_magazine_capacity(object_depot* depot, size_t capacity,
+	uint32 flags)
+{
+	if (capacity == 0 || capacity > kMaxMagazineCapacity)
+		return B_BAD_VALUE;
+
+	{
+		WriteLocker writeLocker(depot->outer_lock);
+		InterruptsSpinLocker _(depot->inner_lock);
+
+		if (depot->magazine_capacity != capacity)
+			depot->resizes++;
+
+		// from now on, only magazines with the new capacity are allocated
+		depot->magazine_capacity = capacity;
+		depot->recent_exchanges = 0;
+		depot->recent_contention = 0;
+		depot->resize_state = DEPOT_RESIZE_NONE;
+	}
+
+	object_depot_make_empty(depot, flags);
+	return B_OK;
+}
+
+
+/*!	Doubles the capacity of the depot's magazines, as requested by
+	check_contention().
+*/
+void
+object_depot_grow_magazines(object_depot* depot, uint32 flags)
+{
+	size_t capacity = std::min(depot->magazine_capacity * 2,
+		kMaxMagazineCapacity);
+
+	object_depot_set_magazine_capacity(depot, capacity, flags);
+}
+
+
+void
+object_depot_get_stats(object_depot* depot, object_cache_stats* stats)
+{
+	ReadLocker readLocker(depot->outer_lock);
+
+	stats->magazine_hits = 0;
+	stats->magazine_misses = 0;
+	stats->magazine_frees = 0;
+
+	// The per-CPU counters are read unlocked; they are statistics only.
+	int cpuCount = smp_get_num_cpus();
+	for (int i = 0; i < cpuCount; i++) {
+		stats->magazine_hits += depot->stores[i].hits;
+		stats->magazine_misses += depot->stores[i].misses;
+		stats->magazine_frees += depot->stores[i].frees;
+	}
+
+	InterruptsSpinLocker _(depot->inner_lock);
+
+	stats->magazine_capacity = depot->magazine_capacity;
+	stats->full_magazines = depot->full_count;
+	stats->empty_magazines = depot->empty_count;
+	stats->depot_refills = depot->refills;
+	stats->depot_exchanges = depot->exchanges;
+	stats->depot_contention = depot->contention;
+	stats->magazine_resizes = depot->resizes;
+}
+
+
 #if PARANOID_KERNEL_FREE
 
 bool
@@ -420,6 +574,10 @@ dump_object_depot(object_depot* depot)
 	kprintf("  empty:    %p, count %lu\n", depot->empty, depot->empty_count);
 	kprintf("  max full: %lu\n", depot->max_count);
 	kprintf("  capacity: %lu\n", depot->magazine_capacity);
+	kprintf("  refills:  %" B_PRIu64 ", exchanges %" B_PRIu64 "\n",
+		depot->refills, depot->exchanges);
+	kprintf("  contention: %" B_PRIu64 ", resizes %" B_PRIu32 "\n",
+		depot->contention, depot->resizes);
 	kprintf("  stores:\n");
 
 	int cpuCount = smp_get_num_cpus();
@@ -427,6 +585,9 @@ dump_object_depot(object_depot* depot)
 	for (int i = 0; i < cpuCount; i++) {
 		kprintf("  [%d] loaded:   %p\n", i, depot->stores[i].loaded);
 		kprintf("      previous: %p\n", depot->stores[i].previous);
+		kprintf("      hits %" B_PRIu64 ", misses %" B_PRIu64 ", frees %"
+			B_PRIu64 "\n", depot->stores[i].hits, depot->stores[i].misses,
+			depot->stores[i].frees);
 	}
 }
 
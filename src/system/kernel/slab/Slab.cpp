@@ -21,6 +21,7 @@
 #include <kernel.h>
 #include <low_resource_manager.h>
 #include <slab/ObjectDepot.h>
+#include <slab_defs.h>
 #include <smp.h>
 #include <tracing.h>
 #include <util/AutoLock.h>
@@ -300,6 +301,9 @@ dump_cache_info(int argc, char* argv[])
 	kprintf("maximum:           %lu\n", cache->maximum);
 	kprintf("flags:             0x%lx\n", cache->flags);
 	kprintf("cookie:            %p\n", cache->cookie);
+	kprintf("slab allocations:  %" B_PRIu64 "\n", cache->slab_allocations);
+	kprintf("slabs created:     %" B_PRIu64 "\n", cache->slabs_created);
+	kprintf("lock contention:   %" B_PRIu64 "\n", cache->lock_contention);
 	kprintf("resize entry don't wait: %p\n", cache->resize_entry_dont_wait);
 	kprintf("resize entry can wait:   %p\n", cache->resize_entry_can_wait);
 
@@ -886,6 +890,31 @@ increase_object_reserve(ObjectCache* cache)
 }
 
 
+/*!	Lets the maintainer grow the cache's magazines, if the depot has asked
+	for it, because its lock is contended too often.
+*/
+static inline void
+check_depot_resize(ObjectCache* cache)
+{
+	if (cache->depot.resize_state != DEPOT_RESIZE_NEEDED
+		|| atomic_test_and_set(&cache->depot.resize_state,
+			DEPOT_RESIZE_SCHEDULED, DEPOT_RESIZE_NEEDED)
+				!= DEPOT_RESIZE_NEEDED) {
+		return;
+	}
+
+	MutexLocker locker(sMaintenanceLock);
+
+	cache->maintenance_resize_depot = true;
+
+	if (!cache->maintenance_pending) {
+		cache->maintenance_pending = true;
+		sMaintenanceQueue.Add(cache);
+		sMaintenanceCondition.NotifyAll();
+	}
+}
+
+
 /*!	Makes sure that \a objectCount objects can be allocated.
 */
 static status_t
@@ -947,6 +976,7 @@ object_cache_reserve_internal(ObjectCache* cache, size_t objectCount,
 
 		cache->usage += cache->slab_size;
 		cache->total_objects += newSlab->size;
+		cache->slabs_created++;
 
 		cache->empty.Add(newSlab);
 		cache->empty_count++;
@@ -1046,7 +1076,7 @@ object_cache_low_memory(void* dummy, uint32 resources, int32 level)
 
 		cache->maintenance_in_progress = false;
 
-		if (cache->maintenance_resize)
+		if (cache->maintenance_resize || cache->maintenance_resize_depot)
 			sMaintenanceQueue.Add(cache);
 		else
 			cache->maintenance_pending = false;
@@ -1054,6 +1084,28 @@ object_cache_low_memory(void* dummy, uint32 resources, int32 level)
 }
 
 
+static void
+get_object_cache_stats(ObjectCache* cache, object_cache_stats& stats)
+{
+	memset(&stats, 0, sizeof(stats));
+
+	if ((cache->flags & CACHE_NO_DEPOT) == 0)
+		object_depot_get_stats(&cache->depot, &stats);
+
+	MutexLocker _(cache->lock);
+
+	strlcpy(stats.name, cache->name, sizeof(stats.name));
+	stats.object_size = cache->object_size;
+	stats.usage = cache->usage;
+	stats.used_objects = cache->used_count;
+	stats.total_objects = cache->total_objects;
+	stats.flags = cache->flags;
+	stats.slab_allocations = cache->slab_allocations;
+	stats.slabs_created = cache->slabs_created;
+	stats.lock_contention = cache->lock_contention;
+}
+
+
 static status_t
 object_cache_maintainer(void*)
 {
@@ -1081,15 +1133,18 @@ object_cache_maintainer(void*)
 
 		while (true) {
 			bool resizeRequested = cache->maintenance_resize;
+			bool depotResizeRequested = cache->maintenance_resize_depot;
 			bool deleteRequested = cache->maintenance_delete;
 
-			if (!resizeRequested && !deleteRequested) {
+			if (!resizeRequested && !depotResizeRequested
+				&& !deleteRequested) {
 				cache->maintenance_pending = false;
 				cache->maintenance_in_progress = false;
 				break;
 			}
 
 			cache->maintenance_resize = false;
+			cache->maintenance_resize_depot = false;
 			cache->maintenance_in_progress = true;
 
 			locker.Unlock();
@@ -1099,6 +1154,11 @@ object_cache_maintainer(void*)
 				break;
 			}
 
+			// grow the magazines -- this returns all cached objects to the
+			// slabs, so we must not hold the cache lock
+			if (depotResizeRequested)
+				object_depot_grow_magazines(&cache->depot, 0);
+
 			// resize the cache, if necessary
 
 			MutexLocker cacheLocker(cache->lock);
@@ -1214,6 +1274,16 @@ object_cache_set_minimum_reserve(object_cache* cache, size_t objectCount)
 }
 
 
+status_t
+object_cache_set_magazine_capacity(object_cache* cache, size_t capacity)
+{
+	if ((cache->flags & CACHE_NO_DEPOT) != 0)
+		return B_NOT_SUPPORTED;
+
+	return object_depot_set_magazine_capacity(&cache->depot, capacity, 0);
+}
+
+
 void*
 object_cache_alloc(object_cache* cache, uint32 flags)
 {
@@ -1223,9 +1293,12 @@ object_cache_alloc(object_cache* cache, uint32 flags)
 			add_alloc_tracing_entry(cache, flags, object);
 			return fill_allocated_block(object, cache->object_size);
 		}
+
+		check_depot_resize(cache);
 	}
 
-	MutexLocker locker(cache->lock);
+	cache->LockCounted();
+	MutexLocker locker(cache->lock, true);
 	slab* source = NULL;
 
 	while (true) {
@@ -1253,6 +1326,7 @@ object_cache_alloc(object_cache* cache, uint32 flags)
 	object_link* link = _pop(source->free);
 	source->count--;
 	cache->used_count++;
+	cache->slab_allocations++;
 
 	if (cache->total_objects - cache->used_count < cache->min_object_reserve)
 		increase_object_reserve(cache);
@@ -1309,10 +1383,12 @@ object_cache_free(object_cache* cache, void* object, uint32 flags)
 
 	if ((cache->flags & CACHE_NO_DEPOT) == 0) {
 		object_depot_store(&cache->depot, object, flags);
+		check_depot_resize(cache);
 		return;
 	}
 
-	MutexLocker _(cache->lock);
+	cache->LockCounted();
+	MutexLocker _(cache->lock, true);
 	cache->ReturnObjectToSlab(cache->ObjectSlab(object), object, flags);
 }
 
@@ -1338,6 +1414,56 @@ object_cache_get_usage(object_cache* cache, size_t* _allocatedMemory)
 }
 
 
+// #pragma mark - syscalls
+
+
+/*!	Copies the statistics of up to \c *_userCount object caches to
+	\a userStats, and returns the total number of caches in \a _userCount.
+	Since caches may come and go in the meantime, the result is only a
+	snapshot.
+*/
+status_t
+_user_get_object_cache_stats(object_cache_stats* userStats, size_t size,
+	int32* _userCount)
+{
+	if (size != sizeof(object_cache_stats))
+		return B_BAD_VALUE;
+
+	int32 maxCount;
+	if (_userCount == NULL || !IS_USER_ADDRESS(_userCount)
+		|| user_memcpy(&maxCount, _userCount, sizeof(int32)) != B_OK) {
+		return B_BAD_ADDRESS;
+	}
+	if (maxCount > 0 && (userStats == NULL || !IS_USER_ADDRESS(userStats)))
+		return B_BAD_ADDRESS;
+
+	MutexLocker listLocker(sObjectCacheListLock);
+	int32 count = sObjectCaches.Count();
+	listLocker.Unlock();
+
+	for (int32 index = 0; index < std::min(count, maxCount); index++) {
+		// We must not touch userland memory while holding the lock.
+		object_cache_stats stats;
+
+		listLocker.Lock();
+
+		ObjectCache* cache = sObjectCaches.Head();
+		for (int32 i = 0; cache != NULL && i < index; i++)
+			cache = sObjectCaches.GetNext(cache);
+		if (cache == NULL)
+			break;
+
+		get_object_cache_stats(cache, stats);
+		listLocker.Unlock();
+
+		if (user_memcpy(userStats + index, &stats, sizeof(stats)) != B_OK)
+			return B_BAD_ADDRESS;
+	}
+
+	return user_memcpy(_userCount, &count, sizeof(int32));
+}
+
+
 void
 slab_init(kernel_args* args)
 {
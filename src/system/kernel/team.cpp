@@ -52,6 +52,7 @@
 #include <vfs.h>
 #include <vm/vm.h>
 #include <vm/VMAddressSpace.h>
+#include <vm/VMTranslationMap.h>
 #include <util/AutoLock.h>
 
 #include "TeamThreadTables.h"
@@ -1584,10 +1585,13 @@ team_create_thread_start(void* args)
 }
 
 
+/*!	Creates a new team running the executable at \a path, or at the first
+	argument, if \a path is \c NULL.
+*/
 static thread_id
-load_image_internal(char**& _flatArgs, size_t flatArgsSize, int32 argCount,
-	int32 envCount, int32 priority, team_id parentID, uint32 flags,
-	port_id errorPort, uint32 errorToken)
+load_image_internal(const char* path, char**& _flatArgs, size_t flatArgsSize,
+	int32 argCount, int32 envCount, int32 priority, team_id parentID,
+	uint32 flags, port_id errorPort, uint32 errorToken)
 {
 	char** flatArgs = _flatArgs;
 	thread_id thread;
@@ -1600,7 +1604,8 @@ load_image_internal(char**& _flatArgs, size_t flatArgsSize, int32 argCount,
 	if (flatArgs == NULL || argCount == 0)
 		return B_BAD_VALUE;
 
-	const char* path = flatArgs[0];
+	if (path == NULL)
+		path = flatArgs[0];
 
 	TRACE(("load_image_internal: name '%s', args = %p, argCount = %ld\n",
 		path, flatArgs, argCount));
@@ -1939,6 +1944,8 @@ fork_team(void)
 	thread_id threadID;
 	status_t status;
 	int32 cookie;
+	VMTranslationMap* parentMap;
+	bool invalidationBatch;
 
 	TRACE(("fork_team(): team %ld\n", parentTeam->id));
 
@@ -2026,6 +2033,11 @@ fork_team(void)
 	// TODO: should be able to handle stack areas differently (ie. don't have
 	// them copy-on-write)
 
+	// Write-protecting the parent's areas would otherwise interrupt all CPUs
+	// running other threads of the parent once per area.
+	parentMap = parentTeam->address_space->TranslationMap();
+	invalidationBatch = parentMap->BeginInvalidationBatch();
+
 	cookie = 0;
 	while (get_next_area_info(B_CURRENT_TEAM, &cookie, &info) == B_OK) {
 		if (info.area == parentTeam->user_data_area) {
@@ -2049,6 +2061,9 @@ fork_team(void)
 		}
 	}
 
+	if (invalidationBatch)
+		parentMap->EndInvalidationBatch();
+
 	if (status < B_OK)
 		goto err4;
 
@@ -3587,8 +3602,8 @@ load_image_etc(int32 argCount, const char* const* args,
 
 	*slot++ = NULL;
 
-	thread_id thread = load_image_internal(flatArgs, size, argCount, envCount,
-		B_NORMAL_PRIORITY, parentID, B_WAIT_TILL_LOADED, -1, 0);
+	thread_id thread = load_image_internal(NULL, flatArgs, size, argCount,
+		envCount, B_NORMAL_PRIORITY, parentID, B_WAIT_TILL_LOADED, -1, 0);
 
 	free(flatArgs);
 		// load_image_internal() unset our variable if it took over ownership
@@ -4088,7 +4103,7 @@ _user_load_image(const char* const* userFlatArgs, size_t flatArgsSize,
 	if (error != B_OK)
 		return error;
 
-	thread_id thread = load_image_internal(flatArgs, _ALIGN(flatArgsSize),
+	thread_id thread = load_image_internal(NULL, flatArgs, _ALIGN(flatArgsSize),
 		argCount, envCount, priority, B_CURRENT_TEAM, flags, errorPort,
 		errorToken);
 
@@ -4099,6 +4114,39 @@ _user_load_image(const char* const* userFlatArgs, size_t flatArgsSize,
 }
 
 
+thread_id
+_user_load_image_etc(const char* userPath, const char* const* userFlatArgs,
+	size_t flatArgsSize, int32 argCount, int32 envCount, int32 priority,
+	uint32 flags, port_id errorPort, uint32 errorToken)
+{
+	TRACE(("_user_load_image_etc: argc = %ld\n", argCount));
+
+	if (argCount < 1)
+		return B_BAD_VALUE;
+
+	char path[B_PATH_NAME_LENGTH];
+	if (!IS_USER_ADDRESS(userPath)
+		|| user_strlcpy(path, userPath, sizeof(path)) < B_OK)
+		return B_BAD_ADDRESS;
+
+	// copy and relocate the flat arguments
+	char** flatArgs;
+	status_t error = copy_user_process_args(userFlatArgs, flatArgsSize,
+		argCount, envCount, flatArgs);
+	if (error != B_OK)
+		return error;
+
+	thread_id thread = load_image_internal(path, flatArgs,
+		_ALIGN(flatArgsSize), argCount, envCount, priority, B_CURRENT_TEAM,
+		flags, errorPort, errorToken);
+
+	free(flatArgs);
+		// load_image_internal() unset our variable if it took over ownership
+
+	return thread;
+}
+
+
 void
 _user_exit_team(status_t returnValue)
 {
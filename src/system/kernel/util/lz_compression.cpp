@@ -0,0 +1,241 @@
+/*
+ * Copyright 2013, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include <util/lz_compression.h>
+
+#include <string.h>
+
+
+/*!	A small and fast LZ77 compressor, meant to compress pages before they
+	are kept in memory instead of being written to disk. It trades
+	compression ratio for speed, and uses no memory besides the given
+	workspace, so it can be used in low memory situations.
+
+	The compressed data is a sequence of blocks, each one consisting of a
+	token byte, a number of literals, and a back reference into the data
+	already decompressed. The upper four bits of the token are the number of
+	literals, the lower four bits the length of the match minus
+	\c kMinMatch. A nibble of 15 means that more length bytes follow, each
+	of them being added, until one is less than 255. The literals are
+	followed by the little endian 16 bit offset of the match, and the
+	additional match length bytes, if any. The last block only consists of
+	the token and the literals.
+*/
+
+
+static const size_t kMinMatch = 4;
+static const size_t kLastLiterals = 5;
+static const uint32 kHashBits = 12;
+static const size_t kMaxOffset = 65535;
+
+
+static inline uint32
+read32(const uint8* data)
+{
+	uint32 value;
+	memcpy(&value, data, sizeof(value));
+	return value;
+}
+
+
+static inline uint32
+hash_sequence(uint32 sequence)
+{
+	return (sequence * 2654435761U) >> (32 - kHashBits);
+}
+
+
+static inline uint8*
+write_length(uint8* output, size_t length)
+{
+	while (length >= 255) {
+		*output++ = 255;
+		length -= 255;
+	}
+	*output++ = (uint8)length;
+	return output;
+}
+
+
+/*!	Writes one block, and returns the new output position, or \c NULL, if it
+	didn't fit.
+*/
+static uint8*
+write_block(uint8* output, uint8* outputEnd, const uint8* literals,
+	size_t literalCount, size_t offset, size_t matchLength)
+{
+	// check the worst case size first
+	size_t size = 1 + literalCount + literalCount / 255 + 1;
+	if (offset != 0)
+		size += 2 + matchLength / 255 + 1;
+	if (size > (size_t)(outputEnd - output))
+		return NULL;
+
+	uint8* token = output++;
+	*token = (literalCount < 15 ? literalCount : 15) << 4;
+	if (literalCount >= 15)
+		output = write_length(output, literalCount - 15);
+
+	memcpy(output, literals, literalCount);
+	output += literalCount;
+
+	if (offset == 0)
+		return output;
+
+	*output++ = offset & 0xff;
+	*output++ = offset >> 8;
+
+	*token |= matchLength < 15 ? matchLength : 15;
+	if (matchLength >= 15)
+		output = write_length(output, matchLength - 15);
+
+	return output;
+}
+
+
+static bool
+read_length(const uint8*& input, const uint8* inputEnd, size_t& length)
+{
+	uint8 byte;
+	do {
+		if (input == inputEnd)
+			return false;
+		byte = *input++;
+		length += byte;
+	} while (byte == 255);
+
+	return true;
+}
+
+
+/*!	Compresses \a inputSize bytes from \a input to \a output.
+	\a workspace must point to at least \c LZ_COMPRESS_WORKSPACE_SIZE bytes.
+	\return The size of the compressed data, or \c 0, if it would not fit into
+		\a outputSize bytes. Pass a smaller output size than the input size
+		to only accept data that compresses well enough.
+*/
+size_t
+lz_compress(const void* _input, size_t inputSize, void* _output,
+	size_t outputSize, void* workspace)
+{
+	if (inputSize > LZ_MAX_INPUT_SIZE)
+		return 0;
+
+	const uint8* input = (const uint8*)_input;
+	const uint8* inputEnd = input + inputSize;
+	uint8* output = (uint8*)_output;
+	uint8* outputEnd = output + outputSize;
+
+	uint16* table = (uint16*)workspace;
+	memset(table, 0, LZ_COMPRESS_WORKSPACE_SIZE);
+
+	const uint8* anchor = input;
+
+	if (inputSize >= kMinMatch + kLastLiterals) {
+		const uint8* matchLimit = inputEnd - kLastLiterals;
+		const uint8* position = input;
+
+		while (position + kMinMatch <= matchLimit) {
+			uint32 sequence = read32(position);
+			uint32 hash = hash_sequence(sequence);
+			const uint8* candidate = input + table[hash];
+			table[hash] = position - input;
+
+			if (candidate >= position
+				|| (size_t)(position - candidate) > kMaxOffset
+				|| read32(candidate) != sequence) {
+				// Skip faster through data that doesn't seem to compress.
+				position += 1 + ((position - anchor) >> 6);
+				continue;
+			}
+
+			const uint8* matchEnd = position + kMinMatch;
+			const uint8* reference = candidate + kMinMatch;
+			while (matchEnd < matchLimit && *matchEnd == *reference) {
+				matchEnd++;
+				reference++;
+			}
+
+			output = write_block(output, outputEnd, anchor, position - anchor,
+				position - candidate, matchEnd - position - kMinMatch);
+			if (output == NULL)
+				return 0;
+
+			anchor = position = matchEnd;
+		}
+	}
+
+	output = write_block(output, outputEnd, anchor, inputEnd - anchor, 0, 0);
+	if (output == NULL)
+		return 0;
+
+	return output - (uint8*)_output;
+}
+
+
+/*!	Decompresses data compressed by lz_compress().
+	\return The size of the decompressed data, or \c B_BAD_DATA, if the data
+		is corrupt or wouldn't fit into \a outputSize bytes.
+*/
+ssize_t
+lz_decompress(const void* _input, size_t inputSize, void* _output,
+	size_t outputSize)
+{
+	const uint8* input = (const uint8*)_input;
+	const uint8* inputEnd = input + inputSize;
+	uint8* output = (uint8*)_output;
+	uint8* outputEnd = output + outputSize;
+
+	while (input < inputEnd) {
+		uint8 token = *input++;
+
+		size_t literalCount = token >> 4;
+		if (literalCount == 15 && !read_length(input, inputEnd, literalCount))
+			return B_BAD_DATA;
+
+		if (literalCount > (size_t)(inputEnd - input)
+			|| literalCount > (size_t)(outputEnd - output)) {
+			return B_BAD_DATA;
+		}
+
+		memcpy(output, input, literalCount);
+		input += literalCount;
+		output += literalCount;
+
+		if (input == inputEnd) {
+			// this was the last block
+			break;
+		}
+
+		if (inputEnd - input < 2)
+			return B_BAD_DATA;
+
+		size_t offset = input[0] | ((size_t)input[1] << 8);
+		input += 2;
+		if (offset == 0 || offset > (size_t)(output - (uint8*)_output))
+			return B_BAD_DATA;
+
+		size_t matchLength = token & 0xf;
+		if (matchLength == 15 && !read_length(input, inputEnd, matchLength))
+			return B_BAD_DATA;
+		matchLength += kMinMatch;
+
+		if (matchLength > (size_t)(outputEnd - output))
+			return B_BAD_DATA;
+
+		const uint8* reference = output - offset;
+		if (offset >= matchLength) {
+			memcpy(output, reference, matchLength);
+			output += matchLength;
+		} else {
+			// the match overlaps the data it produces
+			while (matchLength-- > 0)
+				*output++ = *reference++;
+		}
+	}
+
+	return output - (uint8*)_output;
+}
@@ -33,6 +33,7 @@
 #include <tracing.h>
 #include <util/AutoLock.h>
 #include <util/DoublyLinkedList.h>
+#include <util/lz_compression.h>
 #include <util/OpenHashTable.h>
 #include <util/RadixBitmap.h>
 #include <vfs.h>
@@ -68,6 +69,16 @@
 #define SWAP_BLOCK_SHIFT 5		/* 1 << SWAP_BLOCK_SHIFT == SWAP_BLOCK_PAGES */
 #define SWAP_BLOCK_MASK  (SWAP_BLOCK_PAGES - 1)
 
+// Pages kept in the compressed swap store get swap slots from this index on,
+// so that the swap blocks don't need to tell them apart from swap file slots.
+// The swap files' slots start at 0 and are never going to reach it.
+#define COMPRESSED_SWAP_FIRST_SLOT	((swap_addr_t)1 << 31)
+
+// pages that don't compress to at most this size are written to a swap file
+#define COMPRESSED_SWAP_MAX_PAGE_SIZE	(B_PAGE_SIZE * 3 / 4)
+
+#define COMPRESSED_SWAP_SIZE_CLASSES	7
+
 
 struct swap_file : DoublyLinkedListLinkImpl<swap_file> {
 	int				fd;
@@ -139,6 +150,44 @@ static mutex sAvailSwapSpaceLock;
 
 static object_cache* sSwapBlockCache;
 
+// The compressed data is stored in objects of the smallest fitting size
+// class.
+static const size_t kCompressedSwapClassSizes[COMPRESSED_SWAP_SIZE_CLASSES] = {
+	256, 512, 768, 1024, 1536, 2048, COMPRESSED_SWAP_MAX_PAGE_SIZE
+};
+
+struct compressed_swap_page {
+	void*			data;
+	uint16			size;
+	uint8			size_class;
+};
+
+struct compressed_swap_store {
+	mutex					lock;
+	radix_bitmap*			bmp;
+	compressed_swap_page*	pages;
+	swap_addr_t				slot_count;
+	object_cache*			caches[COMPRESSED_SWAP_SIZE_CLASSES];
+
+	size_t					max_size;
+	size_t					used_size;
+		// size of the objects the compressed data is stored in
+	size_t					compressed_size;
+
+	void*					workspace;
+	uint8*					page_buffer;
+	uint8*					compressed_buffer;
+
+	// statistics
+	uint64					stored;
+	uint64					loaded;
+	uint64					incompressible;
+	uint64					full;
+};
+
+static compressed_swap_store sCompressedSwap;
+static bool sCompressedSwapEnabled = false;
+
 
 #if SWAP_TRACING
 namespace SwapTracing {
@@ -238,10 +287,187 @@ dump_swap_info(int argc, char** argv)
 	kprintf("used:      %9lu\n", totalSwapPages - freeSwapPages);
 	kprintf("free:      %9lu\n", freeSwapPages);
 
+	kprintf("\n");
+	swap_dump_compressed_store();
+
 	return 0;
 }
 
 
+// #pragma mark - compressed swap store
+
+
+static inline bool
+is_compressed_swap_slot(swap_addr_t slotIndex)
+{
+	return slotIndex != SWAP_SLOT_NONE
+		&& slotIndex >= COMPRESSED_SWAP_FIRST_SLOT;
+}
+
+
+/*!	Tries to keep the page at \a address compressed in memory.
+	\return The swap slot the page has been stored at, or \c SWAP_SLOT_NONE,
+		if the store is not enabled, is full, or the page doesn't compress
+		well enough. In these cases the page has to go to a swap file.
+*/
+static swap_addr_t
+compressed_swap_store_page(generic_addr_t address, uint32 flags)
+{
+	if (!sCompressedSwapEnabled)
+		return SWAP_SLOT_NONE;
+
+	MutexLocker locker(sCompressedSwap.lock);
+
+	if ((flags & B_PHYSICAL_IO_REQUEST) != 0) {
+		if (vm_memcpy_from_physical(sCompressedSwap.page_buffer, address,
+				B_PAGE_SIZE, false) != B_OK) {
+			return SWAP_SLOT_NONE;
+		}
+	} else
+		memcpy(sCompressedSwap.page_buffer, (void*)address, B_PAGE_SIZE);
+
+	size_t size = lz_compress(sCompressedSwap.page_buffer, B_PAGE_SIZE,
+		sCompressedSwap.compressed_buffer, COMPRESSED_SWAP_MAX_PAGE_SIZE,
+		sCompressedSwap.workspace);
+	if (size == 0) {
+		sCompressedSwap.incompressible++;
+		return SWAP_SLOT_NONE;
+	}
+
+	uint32 sizeClass = 0;
+	while (kCompressedSwapClassSizes[sizeClass] < size)
+		sizeClass++;
+
+	if (sCompressedSwap.used_size + kCompressedSwapClassSizes[sizeClass]
+			> sCompressedSwap.max_size) {
+		sCompressedSwap.full++;
+		return SWAP_SLOT_NONE;
+	}
+
+	radix_slot_t slot = radix_bitmap_alloc(sCompressedSwap.bmp, 1);
+	if (slot == RADIX_SLOT_NONE) {
+		sCompressedSwap.full++;
+		return SWAP_SLOT_NONE;
+	}
+
+	void* data = object_cache_alloc(sCompressedSwap.caches[sizeClass],
+		CACHE_DONT_WAIT_FOR_MEMORY | CACHE_DONT_LOCK_KERNEL_SPACE);
+	if (data == NULL) {
+		radix_bitmap_dealloc(sCompressedSwap.bmp, slot, 1);
+		sCompressedSwap.full++;
+		return SWAP_SLOT_NONE;
+	}
+
+	memcpy(data, sCompressedSwap.compressed_buffer, size);
+
+	compressed_swap_page& page = sCompressedSwap.pages[slot];
+	page.data = data;
+	page.size = size;
+	page.size_class = sizeClass;
+
+	sCompressedSwap.used_size += kCompressedSwapClassSizes[sizeClass];
+	sCompressedSwap.compressed_size += size;
+	sCompressedSwap.stored++;
+
+	return COMPRESSED_SWAP_FIRST_SLOT + slot;
+}
+
+
+static status_t
+compressed_swap_load_page(swap_addr_t slotIndex, generic_addr_t address,
+	uint32 flags)
+{
+	MutexLocker locker(sCompressedSwap.lock);
+
+	compressed_swap_page& page
+		= sCompressedSwap.pages[slotIndex - COMPRESSED_SWAP_FIRST_SLOT];
+	ssize_t size = lz_decompress(page.data, page.size,
+		sCompressedSwap.page_buffer, B_PAGE_SIZE);
+	if (size != B_PAGE_SIZE) {
+		panic("compressed_swap_load_page(): slot %" B_PRIu32 " is corrupt",
+			slotIndex);
+		return B_BAD_DATA;
+	}
+
+	if ((flags & B_PHYSICAL_IO_REQUEST) != 0) {
+		status_t status = vm_memcpy_to_physical(address,
+			sCompressedSwap.page_buffer, B_PAGE_SIZE, false);
+		if (status != B_OK)
+			return status;
+	} else
+		memcpy((void*)address, sCompressedSwap.page_buffer, B_PAGE_SIZE);
+
+	sCompressedSwap.loaded++;
+	return B_OK;
+}
+
+
+static void
+compressed_swap_free_page(swap_addr_t slotIndex)
+{
+	MutexLocker locker(sCompressedSwap.lock);
+
+	radix_slot_t slot = slotIndex - COMPRESSED_SWAP_FIRST_SLOT;
+	compressed_swap_page& page = sCompressedSwap.pages[slot];
+
+	object_cache_free(sCompressedSwap.caches[page.size_class], page.data,
+		CACHE_DONT_WAIT_FOR_MEMORY | CACHE_DONT_LOCK_KERNEL_SPACE);
+	sCompressedSwap.used_size -= kCompressedSwapClassSizes[page.size_class];
+	sCompressedSwap.compressed_size -= page.size;
+	page.data = NULL;
+
+	radix_bitmap_dealloc(sCompressedSwap.bmp, slot, 1);
+}
+
+
+static status_t
+compressed_swap_init(size_t maxSize)
+{
+	swap_addr_t slotCount = maxSize / kCompressedSwapClassSizes[0];
+	if (slotCount == 0)
+		return B_BAD_VALUE;
+
+	sCompressedSwap.bmp = radix_bitmap_create(slotCount);
+	sCompressedSwap.pages = (compressed_swap_page*)malloc(
+		sizeof(compressed_swap_page) * slotCount);
+	sCompressedSwap.workspace = malloc(LZ_COMPRESS_WORKSPACE_SIZE);
+	sCompressedSwap.page_buffer = (uint8*)malloc(B_PAGE_SIZE);
+	sCompressedSwap.compressed_buffer
+		= (uint8*)malloc(COMPRESSED_SWAP_MAX_PAGE_SIZE);
+	if (sCompressedSwap.bmp == NULL || sCompressedSwap.pages == NULL
+		|| sCompressedSwap.workspace == NULL
+		|| sCompressedSwap.page_buffer == NULL
+		|| sCompressedSwap.compressed_buffer == NULL) {
+		if (sCompressedSwap.bmp != NULL)
+			radix_bitmap_destroy(sCompressedSwap.bmp);
+		free(sCompressedSwap.pages);
+		free(sCompressedSwap.workspace);
+		free(sCompressedSwap.page_buffer);
+		free(sCompressedSwap.compressed_buffer);
+		return B_NO_MEMORY;
+	}
+
+	for (uint32 i = 0; i < COMPRESSED_SWAP_SIZE_CLASSES; i++) {
+		char name[32];
+		snprintf(name, sizeof(name), "compressed swap %" B_PRIuSIZE,
+			kCompressedSwapClassSizes[i]);
+		sCompressedSwap.caches[i] = create_object_cache(name,
+			kCompressedSwapClassSizes[i], sizeof(void*), NULL, NULL, NULL);
+		if (sCompressedSwap.caches[i] == NULL) {
+			panic("compressed_swap_init(): can't create object cache");
+			return B_NO_MEMORY;
+		}
+	}
+
+	mutex_init(&sCompressedSwap.lock, "compressed swap");
+	sCompressedSwap.slot_count = slotCount;
+	sCompressedSwap.max_size = maxSize;
+	sCompressedSwapEnabled = true;
+
+	return B_OK;
+}
+
+
 static swap_addr_t
 swap_slot_alloc(uint32 count)
 {
@@ -314,6 +540,13 @@ swap_slot_dealloc(swap_addr_t slotIndex, uint32 count)
 	if (slotIndex == SWAP_SLOT_NONE)
 		return;
 
+	if (is_compressed_swap_slot(slotIndex)) {
+		// compressed pages are always allocated one by one
+		ASSERT(count == 1);
+		compressed_swap_free_page(slotIndex);
+		return;
+	}
+
 	mutex_lock(&sSwapFileListLock);
 	swap_file* swapFile = find_swap_file(slotIndex);
 	slotIndex -= swapFile->first_slot;
@@ -469,58 +702,18 @@ status_t
 VMAnonymousCache::Resize(off_t newSize, int priority)
 {
 	// If the cache size shrinks, drop all swap pages beyond the new size.
-	if (fAllocatedSwapSize > 0) {
-		page_num_t oldPageCount = (virtual_end + B_PAGE_SIZE - 1) >> PAGE_SHIFT;
-		swap_block* swapBlock = NULL;
-
-		for (page_num_t pageIndex = (newSize + B_PAGE_SIZE - 1) >> PAGE_SHIFT;
-				pageIndex < oldPageCount && fAllocatedSwapSize > 0;
-				pageIndex++) {
-			WriteLocker locker(sSwapHashLock);
-
-			// Get the swap slot index for the page.
-			swap_addr_t blockIndex = pageIndex & SWAP_BLOCK_MASK;
-			if (swapBlock == NULL || blockIndex == 0) {
-				swap_hash_key key = { this, pageIndex };
-				swapBlock = sSwapHashTable.Lookup(key);
-
-				if (swapBlock == NULL) {
-					pageIndex = ROUNDUP(pageIndex + 1, SWAP_BLOCK_PAGES);
-					continue;
-				}
-			}
+	_FreeSwapPageRange(newSize + B_PAGE_SIZE - 1,
+		virtual_end + B_PAGE_SIZE - 1);
 
-			swap_addr_t slotIndex = swapBlock->swap_slots[blockIndex];
-			vm_page* page;
-			if (slotIndex != SWAP_SLOT_NONE
-				&& ((page = LookupPage((off_t)pageIndex * B_PAGE_SIZE)) == NULL
-					|| !page->busy)) {
-					// TODO: We skip (i.e. leak) swap space of busy pages, since
-					// there could be I/O going on (paging in/out). Waiting is
-					// not an option as 1. unlocking the cache means that new
-					// swap pages could be added in a range we've already
-					// cleared (since the cache still has the old size) and 2.
-					// we'd risk a deadlock in case we come from the file cache
-					// and the FS holds the node's write-lock. We should mark
-					// the page invalid and let the one responsible clean up.
-					// There's just no such mechanism yet.
-				swap_slot_dealloc(slotIndex, 1);
-				fAllocatedSwapSize -= B_PAGE_SIZE;
+	return VMCache::Resize(newSize, priority);
+}
 
-				swapBlock->swap_slots[blockIndex] = SWAP_SLOT_NONE;
-				if (--swapBlock->used == 0) {
-					// All swap pages have been freed -- we can discard the swap
-					// block.
-					sSwapHashTable.RemoveUnchecked(swapBlock);
-					object_cache_free(sSwapBlockCache, swapBlock,
-						CACHE_DONT_WAIT_FOR_MEMORY
-							| CACHE_DONT_LOCK_KERNEL_SPACE);
-				}
-			}
-		}
-	}
 
-	return VMCache::Resize(newSize, priority);
+status_t
+VMAnonymousCache::Discard(off_t offset, off_t size)
+{
+	_FreeSwapPageRange(offset, offset + size);
+	return VMCache::Discard(offset, size);
 }
 
 
@@ -577,6 +770,34 @@ VMAnonymousCache::Read(off_t offset, const generic_io_vec* vecs, size_t count,
 
 	for (uint32 i = 0, j = 0; i < count; i = j) {
 		swap_addr_t startSlotIndex = _SwapBlockGetAddress(pageIndex + i);
+
+		if (is_compressed_swap_slot(startSlotIndex)) {
+			// pages in the compressed store are read one by one
+			j = i + 1;
+
+			T(ReadPage(this, pageIndex + i, startSlotIndex));
+
+			status_t status = compressed_swap_load_page(startSlotIndex,
+				vecs[i].base, flags);
+			if (status != B_OK)
+				return status;
+
+			// The page is back in memory, so its compressed copy would only
+			// take up space in the store. Free it, and mark the page
+			// modified, so that it will be written out again before it is
+			// freed.
+			AutoLocker<VMCache> locker(this);
+			off_t pageOffset = (off_t)(pageIndex + i) << PAGE_SHIFT;
+			if (vm_page* page = LookupPage(pageOffset)) {
+				page->modified = true;
+
+				swap_slot_dealloc(startSlotIndex, 1);
+				_SwapBlockFree(pageIndex + i, 1);
+				fAllocatedSwapSize -= B_PAGE_SIZE;
+			}
+			continue;
+		}
+
 		for (j = i + 1; j < count; j++) {
 			swap_addr_t slotIndex = _SwapBlockGetAddress(pageIndex + j);
 			if (slotIndex != startSlotIndex + j - i)
@@ -612,11 +833,17 @@ VMAnonymousCache::Write(off_t offset, const generic_io_vec* vecs, size_t count,
 	page_num_t totalPages = 0;
 	for (uint32 i = 0; i < count; i++) {
 		page_num_t pageCount = (vecs[i].length + B_PAGE_SIZE - 1) >> PAGE_SHIFT;
-		swap_addr_t slotIndex = _SwapBlockGetAddress(pageIndex + totalPages);
-		if (slotIndex != SWAP_SLOT_NONE) {
-			swap_slot_dealloc(slotIndex, pageCount);
-			_SwapBlockFree(pageIndex + totalPages, pageCount);
-			fAllocatedSwapSize -= pageCount * B_PAGE_SIZE;
+
+		// The pages' slots might not be contiguous -- some of them might be
+		// in the compressed store -- so free them one by one.
+		for (page_num_t j = 0; j < pageCount; j++) {
+			swap_addr_t slotIndex
+				= _SwapBlockGetAddress(pageIndex + totalPages + j);
+			if (slotIndex != SWAP_SLOT_NONE) {
+				swap_slot_dealloc(slotIndex, 1);
+				_SwapBlockFree(pageIndex + totalPages + j, 1);
+				fAllocatedSwapSize -= B_PAGE_SIZE;
+			}
 		}
 
 		totalPages += pageCount;
@@ -636,10 +863,29 @@ VMAnonymousCache::Write(off_t offset, const generic_io_vec* vecs, size_t count,
 		page_num_t pageCount = (vecs[i].length + B_PAGE_SIZE - 1) >> PAGE_SHIFT;
 
 		generic_addr_t vectorBase = vecs[i].base;
-		generic_size_t vectorLength = vecs[i].length;
 		page_num_t n = pageCount;
 
-		for (page_num_t j = 0; j < pageCount; j += n) {
+		for (page_num_t j = 0; j < pageCount;
+				j += n, vectorBase += (generic_addr_t)n * B_PAGE_SIZE) {
+			n = min_c(n, pageCount - j);
+
+			if (sCompressedSwapEnabled) {
+				// Try to keep the page in the compressed store. The pages
+				// that don't fit are written to the swap file one by one, so
+				// that every page gets its chance.
+				n = 1;
+
+				swap_addr_t slotIndex = compressed_swap_store_page(vectorBase,
+					flags);
+				if (slotIndex != SWAP_SLOT_NONE) {
+					T(WritePage(this, pageIndex + totalPages + j, slotIndex));
+
+					_SwapBlockBuild(pageIndex + totalPages + j, slotIndex, 1);
+					pagesLeft--;
+					continue;
+				}
+			}
+
 			swap_addr_t slotIndex;
 			// try to allocate n slots, if fail, try to allocate n/2
 			while ((slotIndex = swap_slot_alloc(n)) == SWAP_SLOT_NONE && n >= 2)
@@ -648,7 +894,7 @@ VMAnonymousCache::Write(off_t offset, const generic_io_vec* vecs, size_t count,
 			if (slotIndex == SWAP_SLOT_NONE)
 				panic("VMAnonymousCache::Write(): can't allocate swap space\n");
 
-			T(WritePage(this, pageIndex, slotIndex));
+			T(WritePage(this, pageIndex + totalPages + j, slotIndex));
 				// TODO: Assumes that only one page is written.
 
 			swap_file* swapFile = find_swap_file(slotIndex);
@@ -671,13 +917,8 @@ VMAnonymousCache::Write(off_t offset, const generic_io_vec* vecs, size_t count,
 				return status;
 			}
 
-			_SwapBlockBuild(pageIndex + totalPages, slotIndex, n);
+			_SwapBlockBuild(pageIndex + totalPages + j, slotIndex, n);
 			pagesLeft -= n;
-
-			if (n != pageCount) {
-				vectorBase = vectorBase + n * B_PAGE_SIZE;
-				vectorLength -= n * B_PAGE_SIZE;
-			}
 		}
 
 		totalPages += pageCount;
@@ -703,7 +944,7 @@ VMAnonymousCache::WriteAsync(off_t offset, const generic_io_vec* vecs,
 	swap_addr_t slotIndex = _SwapBlockGetAddress(pageIndex);
 	bool newSlot = slotIndex == SWAP_SLOT_NONE;
 
-	// If the page doesn't have any swap space yet, allocate it.
+	// If the page doesn't have any swap space yet, account for it.
 	if (newSlot) {
 		AutoLocker<VMCache> locker(this);
 		if (fAllocatedSwapSize + B_PAGE_SIZE > fCommittedSwapSize) {
@@ -712,10 +953,36 @@ VMAnonymousCache::WriteAsync(off_t offset, const generic_io_vec* vecs,
 		}
 
 		fAllocatedSwapSize += B_PAGE_SIZE;
+	}
 
-		slotIndex = swap_slot_alloc(1);
+	// Try to keep the page in the compressed store, first. If that works, we
+	// are done already.
+	swap_addr_t compressedSlotIndex = compressed_swap_store_page(vecs[0].base,
+		flags);
+	if (compressedSlotIndex != SWAP_SLOT_NONE) {
+		if (!newSlot) {
+			swap_slot_dealloc(slotIndex, 1);
+			_SwapBlockFree(pageIndex, 1);
+		}
+		_SwapBlockBuild(pageIndex, compressedSlotIndex, 1);
+
+		T(WritePage(this, pageIndex, compressedSlotIndex));
+
+		_callback->IOFinished(B_OK, false, numBytes);
+		return B_OK;
+	}
+
+	if (is_compressed_swap_slot(slotIndex)) {
+		// The page doesn't compress well enough anymore -- move it to the
+		// swap file. It is already accounted for.
+		swap_slot_dealloc(slotIndex, 1);
+		_SwapBlockFree(pageIndex, 1);
+		newSlot = true;
 	}
 
+	if (newSlot)
+		slotIndex = swap_slot_alloc(1);
+
 	// create our callback
 	WriteCallback* callback = (flags & B_VIP_IO_REQUEST) != 0
  		? new(malloc_flags(HEAP_PRIORITY_VIP)) WriteCallback(this, _callback)
@@ -1008,6 +1275,67 @@ VMAnonymousCache::_Commit(off_t size, int priority)
 }
 
 
+/*!	Frees the swap space of all pages in the range from \a fromOffset to
+	\a toOffset (exclusive), both rounded down to page boundaries.
+	The cache must be locked.
+*/
+void
+VMAnonymousCache::_FreeSwapPageRange(off_t fromOffset, off_t toOffset)
+{
+	if (fAllocatedSwapSize == 0)
+		return;
+
+	page_num_t endPageIndex = toOffset >> PAGE_SHIFT;
+	swap_block* swapBlock = NULL;
+
+	for (page_num_t pageIndex = fromOffset >> PAGE_SHIFT;
+			pageIndex < endPageIndex && fAllocatedSwapSize > 0;
+			pageIndex++) {
+		WriteLocker locker(sSwapHashLock);
+
+		// Get the swap slot index for the page.
+		swap_addr_t blockIndex = pageIndex & SWAP_BLOCK_MASK;
+		if (swapBlock == NULL || blockIndex == 0) {
+			swap_hash_key key = { this, pageIndex };
+			swapBlock = sSwapHashTable.Lookup(key);
+
+			if (swapBlock == NULL) {
+				pageIndex = ROUNDUP(pageIndex + 1, SWAP_BLOCK_PAGES);
+				continue;
+			}
+		}
+
+		swap_addr_t slotIndex = swapBlock->swap_slots[blockIndex];
+		vm_page* page;
+		if (slotIndex != SWAP_SLOT_NONE
+			&& ((page = LookupPage((off_t)pageIndex * B_PAGE_SIZE)) == NULL
+				|| !page->busy)) {
+				// TODO: We skip (i.e. leak) swap space of busy pages, since
+				// there could be I/O going on (paging in/out). Waiting is
+				// not an option as 1. unlocking the cache means that new
+				// swap pages could be added in a range we've already
+				// cleared (since the cache still has the old size) and 2.
+				// we'd risk a deadlock in case we come from the file cache
+				// and the FS holds the node's write-lock. We should mark
+				// the page invalid and let the one responsible clean up.
+				// There's just no such mechanism yet.
+			swap_slot_dealloc(slotIndex, 1);
+			fAllocatedSwapSize -= B_PAGE_SIZE;
+
+			swapBlock->swap_slots[blockIndex] = SWAP_SLOT_NONE;
+			if (--swapBlock->used == 0) {
+				// All swap pages have been freed -- we can discard the swap
+				// block.
+				sSwapHashTable.RemoveUnchecked(swapBlock);
+				object_cache_free(sSwapBlockCache, swapBlock,
+					CACHE_DONT_WAIT_FOR_MEMORY
+						| CACHE_DONT_LOCK_KERNEL_SPACE);
+			}
+		}
+	}
+}
+
+
 void
 VMAnonymousCache::_MergePagesSmallerSource(VMAnonymousCache* source)
 {
@@ -1339,6 +1667,8 @@ swap_init_post_modules()
 		return;
 
 	off_t size = 0;
+	bool compressedSwap = true;
+	off_t compressedSwapSize = (off_t)vm_page_num_pages() * B_PAGE_SIZE / 8;
 
 	void* settings = load_driver_settings("virtual_memory");
 	if (settings != NULL) {
@@ -1351,6 +1681,13 @@ swap_init_post_modules()
 			NULL);
 		size = string ? atoll(string) : 0;
 
+		compressedSwap = get_driver_boolean_parameter(settings,
+			"compressed_swap", true, true);
+		string = get_driver_parameter(settings, "compressed_swap_size", NULL,
+			NULL);
+		if (string != NULL)
+			compressedSwapSize = atoll(string);
+
 		unload_driver_settings(settings);
 	} else
 		size = (off_t)vm_page_num_pages() * B_PAGE_SIZE * 2;
@@ -1376,8 +1713,56 @@ swap_init_post_modules()
 	close(fd);
 
 	error = swap_file_add("/var/swap");
-	if (error != B_OK)
+	if (error != B_OK) {
 		dprintf("Failed to add swap file /var/swap: %s\n", strerror(error));
+		return;
+	}
+
+	// The compressed store only takes pages that have swap space reserved,
+	// so it is only used in front of a swap file.
+	if (compressedSwap && compressedSwapSize > 0) {
+		compressedSwapSize = min_c(compressedSwapSize,
+			(off_t)vm_page_num_pages() * B_PAGE_SIZE / 2);
+		error = compressed_swap_init(compressedSwapSize);
+		if (error != B_OK) {
+			dprintf("Failed to init compressed swap store: %s\n",
+				strerror(error));
+		}
+	}
+}
+
+
+/*!	Prints the statistics of the compressed swap store. Used by the "swap"
+	and "page_stats" debugger commands.
+*/
+void
+swap_dump_compressed_store(void)
+{
+	if (!sCompressedSwapEnabled) {
+		kprintf("compressed swap store: disabled\n");
+		return;
+	}
+
+	swap_addr_t pageCount = sCompressedSwap.slot_count
+		- sCompressedSwap.bmp->free_slots;
+
+	kprintf("compressed swap store:\n");
+	kprintf("  pages:          %9" B_PRIu32 "\n", pageCount);
+	kprintf("  used:           %9" B_PRIuSIZE " KB (%" B_PRIuSIZE
+		" KB compressed data, max %" B_PRIuSIZE " KB)\n",
+		sCompressedSwap.used_size / 1024,
+		sCompressedSwap.compressed_size / 1024,
+		sCompressedSwap.max_size / 1024);
+	if (pageCount > 0) {
+		kprintf("  ratio:          %9" B_PRIu64 "%%\n",
+			(uint64)sCompressedSwap.used_size * 100
+				/ ((uint64)pageCount * B_PAGE_SIZE));
+	}
+	kprintf("  stored:         %9" B_PRIu64 "\n", sCompressedSwap.stored);
+	kprintf("  loaded:         %9" B_PRIu64 "\n", sCompressedSwap.loaded);
+	kprintf("  incompressible: %9" B_PRIu64 "\n",
+		sCompressedSwap.incompressible);
+	kprintf("  store full:     %9" B_PRIu64 "\n", sCompressedSwap.full);
 }
 
 
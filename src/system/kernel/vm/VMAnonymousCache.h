@@ -27,6 +27,7 @@ extern "C" {
 	bool swap_free_page_swap_space(vm_page* page);
 	uint32 swap_available_pages(void);
 	uint32 swap_total_swap_pages(void);
+	void swap_dump_compressed_store(void);
 }
 
 
@@ -40,6 +41,7 @@ public:
 									uint32 allocationFlags);
 
 	virtual	status_t			Resize(off_t newSize, int priority);
+	virtual	status_t			Discard(off_t offset, off_t size);
 
 	virtual	status_t			Commit(off_t size, int priority);
 	virtual	bool				HasPage(off_t offset);
@@ -76,6 +78,8 @@ private:
 			void        		_SwapBlockFree(off_t pageIndex, uint32 count);
 			swap_addr_t			_SwapBlockGetAddress(off_t pageIndex);
 			status_t			_Commit(off_t size, int priority);
+			void				_FreeSwapPageRange(off_t fromOffset,
+									off_t toOffset);
 
 			void				_MergePagesSmallerSource(
 									VMAnonymousCache* source);
@@ -1105,37 +1105,8 @@ VMCache::Resize(off_t newSize, int priority)
 	if (newPageCount < oldPageCount) {
 		// we need to remove all pages in the cache outside of the new virtual
 		// size
-		for (VMCachePagesTree::Iterator it
-					= pages.GetIterator(newPageCount, true, true);
-				vm_page* page = it.Next();) {
-			if (page->busy) {
-				if (page->busy_writing) {
-					// We cannot wait for the page to become available
-					// as we might cause a deadlock this way
-					page->busy_writing = false;
-						// this will notify the writer to free the page
-				} else {
-					// wait for page to become unbusy
-					WaitForPageEvents(page, PAGE_EVENT_NOT_BUSY, true);
-
-					// restart from the start of the list
-					it = pages.GetIterator(newPageCount, true, true);
-				}
-				continue;
-			}
-
-			// remove the page and put it into the free queue
-			DEBUG_PAGE_ACCESS_START(page);
-			vm_remove_all_page_mappings(page);
-			ASSERT(page->WiredCount() == 0);
-				// TODO: Find a real solution! If the page is wired
-				// temporarily (e.g. by lock_memory()), we actually must not
-				// unmap it!
-			RemovePage(page);
-			vm_page_free(this, page);
-				// Note: When iterating through a IteratableSplayTree
-				// removing the current node is safe.
-		}
+		while (_FreePageRange(pages.GetIterator(newPageCount, true, true)))
+			;
 	}
 
 	virtual_end = newSize;
@@ -1143,6 +1114,25 @@ VMCache::Resize(off_t newSize, int priority)
 }
 
 
+/*!	Frees all pages in the given range of the cache, and thus discards their
+	contents. The pages are also removed from all areas they are mapped in.
+	Pages that are currently wired are left alone.
+	The cache must be locked.
+*/
+status_t
+VMCache::Discard(off_t offset, off_t size)
+{
+	AssertLocked();
+
+	page_num_t startPage = offset >> PAGE_SHIFT;
+	page_num_t endPage = (offset + size + B_PAGE_SIZE - 1) >> PAGE_SHIFT;
+	while (_FreePageRange(pages.GetIterator(startPage, true, true), &endPage))
+		;
+
+	return B_OK;
+}
+
+
 /*!	You have to call this function with the VMCache lock held. */
 status_t
 VMCache::FlushAndRemoveAllPages()
@@ -1456,6 +1446,55 @@ VMCache::_RemoveConsumer(VMCache* consumer)
 }
 
 
+/*!	Frees the pages the given iterator yields, up to \a toPage (exclusive),
+	or up to the end of the cache, if \a toPage is \c NULL.
+	Returns \c true, if it had to wait for a busy page, and the caller needs
+	to start over with a new iterator, \c false when it is done.
+	The cache must be locked.
+*/
+bool
+VMCache::_FreePageRange(VMCachePagesTree::Iterator it, page_num_t* toPage)
+{
+	for (vm_page* page = it.Next();
+		page != NULL && (toPage == NULL || page->cache_offset < *toPage);
+		page = it.Next()) {
+		if (page->busy) {
+			if (page->busy_writing) {
+				// We cannot wait for the page to become available
+				// as we might cause a deadlock this way
+				page->busy_writing = false;
+					// this will notify the writer to free the page
+				continue;
+			}
+
+			// wait for page to become unbusy
+			WaitForPageEvents(page, PAGE_EVENT_NOT_BUSY, true);
+			return true;
+		}
+
+		if (toPage != NULL && page->WiredCount() > 0) {
+			// When discarding only a range, we leave pages alone that are
+			// wired, e.g. by lock_memory().
+			continue;
+		}
+
+		// remove the page and put it into the free queue
+		DEBUG_PAGE_ACCESS_START(page);
+		vm_remove_all_page_mappings(page);
+		ASSERT(page->WiredCount() == 0);
+			// TODO: Find a real solution! If the page is wired
+			// temporarily (e.g. by lock_memory()), we actually must not
+			// unmap it!
+		RemovePage(page);
+		vm_page_free(this, page);
+			// Note: When iterating through a IteratableSplayTree
+			// removing the current node is safe.
+	}
+
+	return false;
+}
+
+
 // #pragma mark - VMCacheFactory
 	// TODO: Move to own source file!
 
@@ -31,6 +31,20 @@ VMTranslationMap::~VMTranslationMap()
 }
 
 
+/*!	Returns the size of the large pages the map uses for suitably aligned,
+	physically contiguous ranges, or 0, if it always uses \c B_PAGE_SIZE
+	pages.
+
+	Callers can use it to align areas that would benefit from large pages.
+	The default implementation returns 0.
+*/
+size_t
+VMTranslationMap::LargePageSize() const
+{
+	return 0;
+}
+
+
 status_t
 VMTranslationMap::DebugMarkRangePresent(addr_t start, addr_t end,
 	bool markPresent)
@@ -116,6 +130,39 @@ VMTranslationMap::UnmapArea(VMArea* area, bool deletingAddressSpace,
 }
 
 
+/*!	Starts deferring the TLB invalidations the calling thread causes via
+	Lock()/Unlock() until EndInvalidationBatch() is called.
+
+	This is meant for operations that change many mappings of an address
+	space whose pages cannot be freed in the meantime (like write-protecting
+	all areas of a team that is being forked), so that the other CPUs running
+	the address space only need to be interrupted once. Invalidations that
+	the map performs explicitly (e.g. when unmapping pages) are never
+	deferred. Other threads flush the pending invalidations when they unlock
+	the map.
+
+	The default implementation does nothing and returns \c false.
+
+	\return \c true, if the batch has been started and EndInvalidationBatch()
+		must be called, \c false otherwise.
+*/
+bool
+VMTranslationMap::BeginInvalidationBatch()
+{
+	return false;
+}
+
+
+/*!	Ends a batch started by BeginInvalidationBatch() and flushes all pending
+	invalidations.
+	The default implementation does nothing.
+*/
+void
+VMTranslationMap::EndInvalidationBatch()
+{
+}
+
+
 /*!	Called by UnmapPage() after performing the architecture specific part.
 	Looks up the page, updates its flags, removes the page-area mapping, and
 	requeues the page, if necessary.
@@ -1284,6 +1284,7 @@ vm_create_anonymous_area(team_id team, const char *name, addr_t size,
 	// For full lock or contiguous areas we're also going to map the pages and
 	// thus need to reserve pages for the mapping backend upfront.
 	addr_t reservedMapPages = 0;
+	size_t largePageSize = 0;
 	if (wiring == B_FULL_LOCK || wiring == B_CONTIGUOUS) {
 		AddressSpaceWriteLocker locker;
 		status_t status = locker.SetTo(team);
@@ -1292,6 +1293,21 @@ vm_create_anonymous_area(team_id team, const char *name, addr_t size,
 
 		VMTranslationMap* map = locker.AddressSpace()->TranslationMap();
 		reservedMapPages = map->MaxPagesNeededToMap(0, size - 1);
+		largePageSize = map->LargePageSize();
+	}
+
+	// Contiguous areas and full lock areas that ask for it can be mapped with
+	// large pages, if they are aligned accordingly -- virtually and physically.
+	bool useLargePages = largePageSize != 0 && size >= largePageSize
+		&& !isStack
+		&& (wiring == B_CONTIGUOUS || (protection & B_LARGE_PAGES_AREA) != 0);
+	virtual_address_restrictions largePageVirtualRestrictions;
+	if (useLargePages
+		&& virtualAddressRestrictions->address_specification != B_EXACT_ADDRESS
+		&& virtualAddressRestrictions->alignment < largePageSize) {
+		largePageVirtualRestrictions = *virtualAddressRestrictions;
+		largePageVirtualRestrictions.alignment = largePageSize;
+		virtualAddressRestrictions = &largePageVirtualRestrictions;
 	}
 
 	int priority;
@@ -1346,8 +1362,21 @@ vm_create_anonymous_area(team_id team, const char *name, addr_t size,
 	if (wiring == B_CONTIGUOUS) {
 		// we try to allocate the page run here upfront as this may easily
 		// fail for obvious reasons
-		page = vm_page_allocate_page_run(PAGE_STATE_WIRED | pageAllocFlags,
-			size / B_PAGE_SIZE, physicalAddressRestrictions, priority);
+		if (useLargePages
+			&& physicalAddressRestrictions->alignment < largePageSize
+			&& (physicalAddressRestrictions->boundary == 0
+				|| physicalAddressRestrictions->boundary >= largePageSize)) {
+			// prefer a run that can be mapped with large pages
+			physical_address_restrictions largePageRestrictions
+				= *physicalAddressRestrictions;
+			largePageRestrictions.alignment = largePageSize;
+			page = vm_page_allocate_page_run(PAGE_STATE_WIRED | pageAllocFlags,
+				size / B_PAGE_SIZE, &largePageRestrictions, priority);
+		}
+		if (page == NULL) {
+			page = vm_page_allocate_page_run(PAGE_STATE_WIRED | pageAllocFlags,
+				size / B_PAGE_SIZE, physicalAddressRestrictions, priority);
+		}
 		if (page == NULL) {
 			status = B_NO_MEMORY;
 			goto err0;
@@ -1408,6 +1437,7 @@ vm_create_anonymous_area(team_id team, const char *name, addr_t size,
 		{
 			// Allocate and map all pages for this area
 
+			bool tryLargePages = useLargePages;
 			off_t offset = 0;
 			for (addr_t address = area->Base();
 					address < area->Base() + (area->Size() - 1);
@@ -1422,6 +1452,42 @@ vm_create_anonymous_area(team_id team, const char *name, addr_t size,
 #	endif
 					continue;
 #endif
+				if (tryLargePages && address % largePageSize == 0
+					&& area->Base() + (area->Size() - 1) - address
+						>= largePageSize - 1) {
+					// try to get a page run that can be mapped with a large
+					// page, falling back to single pages, if there is none
+					physical_address_restrictions restrictions = {};
+					restrictions.alignment = largePageSize;
+					vm_page* run = vm_page_allocate_page_run(
+						PAGE_STATE_WIRED | pageAllocFlags,
+						largePageSize / B_PAGE_SIZE, &restrictions, priority);
+					if (run == NULL) {
+						// the next run won't be any easier to find
+						tryLargePages = false;
+					} else {
+						// the run has its own reservation, so we won't need
+						// the pages we reserved for this range anymore
+						vm_page_unreserve_pages_etc(&reservation,
+							largePageSize / B_PAGE_SIZE);
+
+						for (size_t i = 0; i < largePageSize / B_PAGE_SIZE;
+								i++) {
+							vm_page* page = vm_lookup_page(
+								run->physical_page_number + i);
+							cache->InsertPage(page, offset + i * B_PAGE_SIZE);
+							map_page(area, page, address + i * B_PAGE_SIZE,
+								protection, &reservation);
+
+							DEBUG_PAGE_ACCESS_END(page);
+						}
+
+						address += largePageSize - B_PAGE_SIZE;
+						offset += largePageSize - B_PAGE_SIZE;
+						continue;
+					}
+				}
+
 				vm_page* page = vm_page_allocate_page(&reservation,
 					PAGE_STATE_WIRED | pageAllocFlags);
 				cache->InsertPage(page, offset);
@@ -1589,6 +1655,16 @@ vm_map_physical_memory(team_id team, const char* name, void** _address,
 	virtual_address_restrictions addressRestrictions = {};
 	addressRestrictions.address = *_address;
 	addressRestrictions.address_specification = addressSpec & ~B_MTR_MASK;
+
+	// align the area so that it can be mapped with large pages, if possible
+	size_t largePageSize = locker.AddressSpace()->TranslationMap()
+		->LargePageSize();
+	if (largePageSize != 0 && size >= largePageSize
+		&& physicalAddress % largePageSize == 0
+		&& addressRestrictions.address_specification != B_EXACT_ADDRESS) {
+		addressRestrictions.alignment = largePageSize;
+	}
+
 	status = map_backing_store(locker.AddressSpace(), cache, 0, name, size,
 		B_FULL_LOCK, protection, REGION_NO_PRIVATE_MAP, 0, &addressRestrictions,
 		true, &area, _address);
@@ -2274,6 +2350,43 @@ vm_delete_area(team_id team, area_id id, bool kernel)
 }
 
 
+/*!	Changes the protection of all pages of \a cache that are mapped in
+	\a area to \a protection.
+	If the cache only has few pages compared to the size of the area, as is
+	common for heaps and stacks, the pages are protected one by one, instead
+	of walking all of the area's page tables. Either way, the translation map
+	is only flushed once.
+	The cache must be locked.
+*/
+static void
+protect_cache_pages_in_area(VMCache* cache, VMArea* area, uint32 protection)
+{
+	VMTranslationMap* map = area->address_space->TranslationMap();
+	map->Lock();
+
+	page_num_t areaPages = area->Size() / B_PAGE_SIZE;
+	if ((page_num_t)cache->page_count * 8 >= areaPages) {
+		map->ProtectArea(area, protection);
+		map->Unlock();
+		return;
+	}
+
+	page_num_t firstPage = area->cache_offset >> PAGE_SHIFT;
+	page_num_t endPage = firstPage + areaPages;
+
+	for (VMCachePagesTree::Iterator it
+				= cache->pages.GetIterator(firstPage, true, true);
+			vm_page* page = it.Next();) {
+		if (page->cache_offset >= endPage)
+			break;
+
+		map->ProtectPage(area, virtual_page_address(area, page), protection);
+	}
+
+	map->Unlock();
+}
+
+
 /*!	Creates a new cache on top of given cache, moves all areas from
 	the old cache to the new one, and changes the protection of all affected
 	areas' pages to read-only. If requested, wired pages are moved up to the
@@ -2363,10 +2476,12 @@ vm_copy_on_write_area(VMCache* lowerCache,
 				}
 			}
 		}
-	} else {
+	} else if (lowerCache->page_count > 0) {
 		ASSERT(lowerCache->WiredPagesCount() == 0);
 
-		// just change the protection of all areas
+		// Just change the protection of all areas. If the cache doesn't have
+		// any pages, there is nothing to do: pages of caches further down
+		// are never mapped writable in the first place.
 		for (VMArea* tempArea = upperCache->areas; tempArea != NULL;
 				tempArea = tempArea->cache_next) {
 			// The area must be readable in the same way it was previously
@@ -2375,10 +2490,7 @@ vm_copy_on_write_area(VMCache* lowerCache,
 			if ((tempArea->protection & B_READ_AREA) != 0)
 				protection |= B_READ_AREA;
 
-			VMTranslationMap* map = tempArea->address_space->TranslationMap();
-			map->Lock();
-			map->ProtectArea(tempArea, protection);
-			map->Unlock();
+			protect_cache_pages_in_area(lowerCache, tempArea, protection);
 		}
 	}
 
@@ -4323,6 +4435,14 @@ fault_get_page(PageFaultContext& context)
 		sourcePage->busy = true;
 		context.cacheChainLocker.UnlockKeepRefs(true);
 
+		// Another CPU might still write to the source page via a stale TLB
+		// entry, if the invalidation of the write-protecting change has been
+		// deferred (cf. VMTranslationMap::BeginInvalidationBatch()). Make sure
+		// it is flushed before copying, or the write would be lost.
+		context.map->Lock();
+		context.map->Flush();
+		context.map->Unlock();
+
 		// copy the page
 		vm_memcpy_physical_page(page->physical_page_number * B_PAGE_SIZE,
 			sourcePage->physical_page_number * B_PAGE_SIZE);
@@ -6446,9 +6566,73 @@ _user_sync_memory(void* _address, size_t size, uint32 flags)
 
 
 status_t
-_user_memory_advice(void* address, size_t size, uint32 advice)
+_user_memory_advice(void* _address, size_t size, uint32 advice)
 {
-	// TODO: Implement!
+	addr_t address = (addr_t)_address;
+	size = PAGE_ALIGN(size);
+
+	// check params
+	if ((address % B_PAGE_SIZE) != 0)
+		return B_BAD_VALUE;
+	if ((addr_t)address + size < (addr_t)address || !IS_USER_ADDRESS(address)
+		|| !IS_USER_ADDRESS((addr_t)address + size)) {
+		// weird error code required by POSIX
+		return B_NO_MEMORY;
+	}
+
+	switch (advice) {
+		case POSIX_MADV_NORMAL:
+		case POSIX_MADV_SEQUENTIAL:
+		case POSIX_MADV_RANDOM:
+		case POSIX_MADV_WILLNEED:
+		case POSIX_MADV_DONTNEED:
+			// TODO: Implement!
+			return B_OK;
+
+		case MADV_FREE:
+			break;
+
+		default:
+			return B_BAD_VALUE;
+	}
+
+	// iterate through the range and discard the pages of all concerned areas
+	while (size > 0) {
+		// read lock the address space
+		AddressSpaceReadLocker locker;
+		status_t error = locker.SetTo(team_get_current_team_id());
+		if (error != B_OK)
+			return error;
+
+		// get the first area
+		VMArea* area = locker.AddressSpace()->LookupArea(address);
+		if (area == NULL)
+			return B_NO_MEMORY;
+
+		addr_t offset = address - area->Base();
+		size_t rangeSize = min_c(area->Size() - offset, size);
+
+		// Only the pages of private anonymous areas can be discarded -- for
+		// all other areas the advice is silently ignored.
+		if (area->wiring == B_NO_LOCK
+			&& (area->protection & B_KERNEL_AREA) == 0) {
+			AreaCacheLocker cacheLocker(area);
+			if (!cacheLocker)
+				return B_BAD_VALUE;
+			VMCache* cache = area->cache;
+
+			locker.Unlock();
+
+			if (cache->type == CACHE_TYPE_RAM && cache->areas == area
+				&& area->cache_next == NULL) {
+				cache->Discard(area->cache_offset + offset, rangeSize);
+			}
+		}
+
+		address += rangeSize;
+		size -= rangeSize;
+	}
+
 	return B_OK;
 }
 
@@ -24,9 +24,11 @@
 #include <boot/kernel_args.h>
 #include <condition_variable.h>
 #include <elf.h>
+#include <fs_cache.h>
 #include <heap.h>
 #include <kernel.h>
 #include <low_resource_manager.h>
+#include <smp.h>
 #include <thread.h>
 #include <tracing.h>
 #include <util/AutoLock.h>
@@ -38,6 +40,7 @@
 #include <vm/VMArea.h>
 #include <vm/VMCache.h>
 
+#include "../cache/vnode_store.h"
 #include "IORequest.h"
 #include "PageCacheLocker.h"
 #include "VMAnonymousCache.h"
@@ -66,6 +69,12 @@
 #define SCRUB_SIZE 16
 	// this many pages will be cleared at once in the page scrubber thread
 
+#define PAGE_MAGAZINE_SIZE	32
+	// the number of free and clear pages each CPU can cache
+#define PAGE_MAGAZINE_BATCH	16
+	// this many pages are moved between a magazine and the global queues at
+	// once
+
 #define MAX_PAGE_WRITER_IO_PRIORITY				B_URGENT_DISPLAY_PRIORITY
 	// maximum I/O priority of the page writer
 #define MAX_PAGE_WRITER_IO_PRIORITY_THRESHOLD	10000
@@ -133,6 +142,24 @@ static mutex sPageDeficitLock = MUTEX_INITIALIZER("page deficit");
 static rw_lock sFreePageQueuesLock
 	= RW_LOCK_INITIALIZER("free/clear page queues");
 
+// Each CPU caches a few free and clear pages, so that allocating and freeing
+// single pages doesn't need to touch the global queues most of the time. The
+// pages in a magazine are in the free or clear state, but not in any queue;
+// they are still accounted for in sUnreservedFreePages.
+// A magazine may only be accessed by its CPU with interrupts disabled and
+// sFreePageQueuesLock read-locked, or by anyone holding the write lock.
+struct page_magazine {
+	vm_page*	pages[2][PAGE_MAGAZINE_SIZE];
+		// indexed by whether or not the pages are clear
+	uint32		count[2];
+} __attribute__((aligned(64)));
+
+static page_magazine sPageMagazines[SMP_MAX_CPUS];
+static bool sPageMagazinesEnabled = false;
+	// the magazines are only used once the threading is up
+
+static page_num_t count_magazine_pages();
+
 #ifdef TRACK_PAGE_USAGE_STATS
 static page_num_t sPageUsageArrays[512];
 static page_num_t* sPageUsage = sPageUsageArrays;
@@ -256,6 +283,18 @@ private:
 static DaemonCondition sPageWriterCondition;
 static DaemonCondition sPageDaemonCondition;
 
+static struct page_writer_stats {
+	uint64		runs;
+	uint64		pages;
+	uint64		failed_pages;
+	uint64		transfers;
+	uint64		caches;
+	uint64		ordered_caches;
+		// caches whose pages could be sorted by their disk location
+	bigtime_t	collection_time;
+	bigtime_t	writing_time;
+} sPageWriterStats;
+
 
 #if PAGE_ALLOCATION_TRACING
 
@@ -1125,6 +1164,10 @@ dump_page_stats(int argc, char **argv)
 		B_PRIuPHYSADDR ")\n", longestCachedRun.Length(),
 		sPages[longestCachedRun.start].physical_page_number);
 
+#if ENABLE_SWAP_SUPPORT
+	swap_dump_compressed_store();
+#endif
+
 	kprintf("waiting threads:\n");
 	for (PageReservationWaiterList::Iterator it
 			= sPageReservationWaiters.GetIterator();
@@ -1138,6 +1181,8 @@ dump_page_stats(int argc, char **argv)
 		sFreePageQueue.Count());
 	kprintf("clear queue: %p, count = %" B_PRIuPHYSADDR "\n", &sClearPageQueue,
 		sClearPageQueue.Count());
+	kprintf("CPU magazines: count = %" B_PRIuPHYSADDR "\n",
+		count_magazine_pages());
 	kprintf("modified queue: %p, count = %" B_PRIuPHYSADDR " (%" B_PRId32
 		" temporary, %" B_PRIuPHYSADDR " swappable, " "inactive: %"
 		B_PRIuPHYSADDR ")\n", &sModifiedPageQueue, sModifiedPageQueue.Count(),
@@ -1152,6 +1197,37 @@ dump_page_stats(int argc, char **argv)
 }
 
 
+static int
+dump_page_writer_stats(int argc, char **argv)
+{
+	const page_writer_stats& stats = sPageWriterStats;
+
+	kprintf("runs:            %" B_PRIu64 "\n", stats.runs);
+	kprintf("pages written:   %" B_PRIu64 " (%" B_PRIu64 " failed)\n",
+		stats.pages, stats.failed_pages);
+	kprintf("transfers:       %" B_PRIu64 "\n", stats.transfers);
+	kprintf("caches:          %" B_PRIu64 " (%" B_PRIu64 " ordered by disk "
+		"offset)\n", stats.caches, stats.ordered_caches);
+	kprintf("collection time: %" B_PRId64 " ms\n",
+		stats.collection_time / 1000);
+	kprintf("writing time:    %" B_PRId64 " ms\n", stats.writing_time / 1000);
+
+	if (stats.runs == 0 || stats.transfers == 0)
+		return 0;
+
+	kprintf("pages per run:      %" B_PRIu64 "\n", stats.pages / stats.runs);
+	kprintf("pages per transfer: %" B_PRIu64 ".%02" B_PRIu64 "\n",
+		stats.pages / stats.transfers,
+		stats.pages * 100 / stats.transfers % 100);
+	if (stats.writing_time > 0) {
+		kprintf("throughput:         %" B_PRIu64 " KB/s\n",
+			stats.pages * (B_PAGE_SIZE / 1024) * 1000000
+				/ stats.writing_time);
+	}
+	return 0;
+}
+
+
 #if VM_PAGE_ALLOCATION_TRACKING_AVAILABLE
 
 static caller_info*
@@ -1483,6 +1559,133 @@ unreserve_pages(uint32 count)
 }
 
 
+static inline VMPageQueue&
+magazine_queue(bool clear)
+{
+	return clear ? sClearPageQueue : sFreePageQueue;
+}
+
+
+/*!	Moves up to \a count pages from the bottom of the magazine, where the
+	least recently freed ones are, to the respective global queue.
+	Interrupts must be disabled.
+*/
+static void
+drain_page_magazine(page_magazine& magazine, bool clear, uint32 count)
+{
+	vm_page** pages = magazine.pages[clear];
+	count = std::min(count, magazine.count[clear]);
+	if (count == 0)
+		return;
+
+	VMPageQueue& queue = magazine_queue(clear);
+	SpinLocker locker(queue.GetLock());
+
+	for (uint32 i = 0; i < count; i++)
+		queue.Prepend(pages[i]);
+
+	locker.Unlock();
+
+	magazine.count[clear] -= count;
+	memmove(pages, pages + count, magazine.count[clear] * sizeof(vm_page*));
+}
+
+
+/*!	Returns the pages of all CPU magazines to the global queues.
+	The free/clear page queues must be write-locked.
+*/
+static void
+drain_page_magazines()
+{
+	InterruptsLocker locker;
+
+	int32 cpuCount = smp_get_num_cpus();
+	for (int32 i = 0; i < cpuCount; i++) {
+		drain_page_magazine(sPageMagazines[i], false, PAGE_MAGAZINE_SIZE);
+		drain_page_magazine(sPageMagazines[i], true, PAGE_MAGAZINE_SIZE);
+	}
+}
+
+
+/*!	Returns the number of free and clear pages that are currently cached in
+	the CPU magazines. The result is only a snapshot.
+*/
+static page_num_t
+count_magazine_pages()
+{
+	page_num_t count = 0;
+	int32 cpuCount = smp_get_num_cpus();
+	for (int32 i = 0; i < cpuCount; i++)
+		count += sPageMagazines[i].count[0] + sPageMagazines[i].count[1];
+
+	return count;
+}
+
+
+/*!	Takes a page from the current CPU's magazine. If the magazine is empty,
+	a batch of pages is moved into it from the global queue first. Clear
+	pages are preferred if \a clear is \c true, free pages otherwise.
+	The free/clear page queues must be read-locked.
+	Returns \c NULL if neither the magazine, nor the global queues had a page
+	left.
+*/
+static vm_page*
+allocate_page_from_magazine(bool clear)
+{
+	if (!sPageMagazinesEnabled) {
+		vm_page* page = magazine_queue(clear).RemoveHeadUnlocked();
+		if (page == NULL)
+			page = magazine_queue(!clear).RemoveHeadUnlocked();
+		return page;
+	}
+
+	InterruptsLocker locker;
+	page_magazine& magazine = sPageMagazines[smp_get_current_cpu()];
+
+	for (int32 i = 0; i < 2; i++, clear = !clear) {
+		uint32& count = magazine.count[clear];
+		if (count == 0) {
+			VMPageQueue& queue = magazine_queue(clear);
+			SpinLocker queueLocker(queue.GetLock());
+
+			while (count < PAGE_MAGAZINE_BATCH) {
+				vm_page* page = queue.RemoveHead();
+				if (page == NULL)
+					break;
+				magazine.pages[clear][count++] = page;
+			}
+		}
+
+		if (count > 0)
+			return magazine.pages[clear][--count];
+	}
+
+	return NULL;
+}
+
+
+/*!	Puts a free or clear page into the current CPU's magazine. If it's full,
+	a batch of pages is returned to the global queue first.
+	The free/clear page queues must be read-locked.
+*/
+static void
+free_page_to_magazine(vm_page* page, bool clear)
+{
+	if (!sPageMagazinesEnabled) {
+		magazine_queue(clear).PrependUnlocked(page);
+		return;
+	}
+
+	InterruptsLocker locker;
+	page_magazine& magazine = sPageMagazines[smp_get_current_cpu()];
+
+	if (magazine.count[clear] == PAGE_MAGAZINE_SIZE)
+		drain_page_magazine(magazine, clear, PAGE_MAGAZINE_BATCH);
+
+	magazine.pages[clear][magazine.count[clear]++] = page;
+}
+
+
 static void
 free_page(vm_page* page, bool clear)
 {
@@ -1537,13 +1740,8 @@ free_page(vm_page* page, bool clear)
 
 	DEBUG_PAGE_ACCESS_END(page);
 
-	if (clear) {
-		page->SetState(PAGE_STATE_CLEAR);
-		sClearPageQueue.PrependUnlocked(page);
-	} else {
-		page->SetState(PAGE_STATE_FREE);
-		sFreePageQueue.PrependUnlocked(page);
-	}
+	page->SetState(clear ? PAGE_STATE_CLEAR : PAGE_STATE_FREE);
+	free_page_to_magazine(page, clear);
 
 	locker.Unlock();
 
@@ -1710,6 +1908,7 @@ mark_page_range_in_use(page_num_t startPage, page_num_t length, bool wired)
 	}
 
 	WriteLocker locker(sFreePageQueuesLock);
+	drain_page_magazines();
 
 	for (page_num_t i = 0; i < length; i++) {
 		vm_page *page = &sPages[startPage + i];
@@ -1898,12 +2097,34 @@ public:
 	void PageWritten(PageWriteTransfer* transfer, status_t status,
 		bool partialTransfer, size_t bytesTransferred);
 
+	uint32 TransferCount() const { return fTransferCount; }
+	uint32 CacheCount() const { return fCacheCount; }
+	uint32 OrderedCacheCount() const { return fOrderedCacheCount; }
+
 private:
+	struct PageEntry {
+		PageWriteWrapper*	wrapper;
+		vm_page*			page;
+		struct VMCache*		cache;
+		off_t				offset;
+		void*				fileMap;
+		off_t				diskOffset;
+	};
+
+	static bool _CompareByCache(const PageEntry& a, const PageEntry& b);
+	static bool _CompareByDiskOffset(const PageEntry& a, const PageEntry& b);
+
+	void _SortPages();
+	void _BuildTransfers();
+
 	uint32				fMaxPages;
 	uint32				fWrapperCount;
 	uint32				fTransferCount;
+	uint32				fCacheCount;
+	uint32				fOrderedCacheCount;
 	vint32				fPendingTransfers;
 	PageWriteWrapper*	fWrappers;
+	PageEntry*			fEntries;
 	PageWriteTransfer*	fTransfers;
 	ConditionVariable	fAllFinishedCondition;
 };
@@ -2188,11 +2409,14 @@ PageWriterRun::Init(uint32 maxPages)
 	fMaxPages = maxPages;
 	fWrapperCount = 0;
 	fTransferCount = 0;
+	fCacheCount = 0;
+	fOrderedCacheCount = 0;
 	fPendingTransfers = 0;
 
 	fWrappers = new(std::nothrow) PageWriteWrapper[maxPages];
+	fEntries = new(std::nothrow) PageEntry[maxPages];
 	fTransfers = new(std::nothrow) PageWriteTransfer[maxPages];
-	if (fWrappers == NULL || fTransfers == NULL)
+	if (fWrappers == NULL || fEntries == NULL || fTransfers == NULL)
 		return B_NO_MEMORY;
 
 	return B_OK;
@@ -2204,6 +2428,8 @@ PageWriterRun::PrepareNextRun()
 {
 	fWrapperCount = 0;
 	fTransferCount = 0;
+	fCacheCount = 0;
+	fOrderedCacheCount = 0;
 	fPendingTransfers = 0;
 }
 
@@ -2213,12 +2439,19 @@ PageWriterRun::PrepareNextRun()
 void
 PageWriterRun::AddPage(vm_page* page)
 {
-	fWrappers[fWrapperCount++].SetTo(page);
+	PageWriteWrapper* wrapper = &fWrappers[fWrapperCount];
+	wrapper->SetTo(page);
 
-	if (fTransferCount == 0 || !fTransfers[fTransferCount - 1].AddPage(page)) {
-		fTransfers[fTransferCount++].SetTo(this, page,
-			page->Cache()->MaxPagesPerAsyncWrite());
-	}
+	VMCache* cache = page->Cache();
+
+	PageEntry& entry = fEntries[fWrapperCount++];
+	entry.wrapper = wrapper;
+	entry.page = page;
+	entry.cache = cache;
+	entry.offset = page->cache_offset;
+	entry.fileMap = cache->type == CACHE_TYPE_VNODE
+		? ((VMVnodeCache*)cache)->FileMap() : NULL;
+	entry.diskOffset = -1;
 }
 
 
@@ -2228,6 +2461,9 @@ PageWriterRun::AddPage(vm_page* page)
 uint32
 PageWriterRun::Go()
 {
+	_SortPages();
+	_BuildTransfers();
+
 	fPendingTransfers = fTransferCount;
 
 	fAllFinishedCondition.Init(this, "page writer wait for I/O");
@@ -2244,20 +2480,20 @@ PageWriterRun::Go()
 	// mark pages depending on whether they could be written or not
 
 	uint32 failedPages = 0;
-	uint32 wrapperIndex = 0;
+	uint32 entryIndex = 0;
 	for (uint32 i = 0; i < fTransferCount; i++) {
 		PageWriteTransfer& transfer = fTransfers[i];
 		transfer.Cache()->Lock();
 
 		for (uint32 j = 0; j < transfer.PageCount(); j++) {
-			if (!fWrappers[wrapperIndex++].Done(transfer.Status()))
+			if (!fEntries[entryIndex++].wrapper->Done(transfer.Status()))
 				failedPages++;
 		}
 
 		transfer.Cache()->Unlock();
 	}
 
-	ASSERT(wrapperIndex == fWrapperCount);
+	ASSERT(entryIndex == fWrapperCount);
 
 	for (uint32 i = 0; i < fTransferCount; i++) {
 		PageWriteTransfer& transfer = fTransfers[i];
@@ -2285,6 +2521,103 @@ PageWriterRun::PageWritten(PageWriteTransfer* transfer, status_t status,
 }
 
 
+/*static*/ bool
+PageWriterRun::_CompareByCache(const PageEntry& a, const PageEntry& b)
+{
+	if (a.cache != b.cache)
+		return a.cache < b.cache;
+	return a.offset < b.offset;
+}
+
+
+/*static*/ bool
+PageWriterRun::_CompareByDiskOffset(const PageEntry& a, const PageEntry& b)
+{
+	// pages without a known disk location go last
+	uint64 aOffset = (uint64)a.diskOffset;
+	uint64 bOffset = (uint64)b.diskOffset;
+	if (aOffset != bOffset)
+		return aOffset < bOffset;
+	return _CompareByCache(a, b);
+}
+
+
+/*!	Orders the pages so that the pages of each cache are adjacent and sorted
+	by their offset in the cache, and so that the caches are written in the
+	order of their location on disk, as far as their file map can tell.
+	The pages are busy, and we own a reference to their cache's store, so
+	that none of the file maps can go away while we are looking at them.
+	No cache must be locked, since translating an offset might have to ask
+	the file system.
+*/
+void
+PageWriterRun::_SortPages()
+{
+	std::sort(fEntries, fEntries + fWrapperCount, &_CompareByCache);
+
+	uint32 start = 0;
+	while (start < fWrapperCount) {
+		PageEntry& first = fEntries[start];
+
+		uint32 end = start + 1;
+		while (end < fWrapperCount && fEntries[end].cache == first.cache)
+			end++;
+
+		// the disk offset of the first page decides where the whole cache
+		// goes, so that we don't split up its transfers
+		off_t diskOffset = -1;
+		if (first.fileMap != NULL) {
+			file_io_vec vec;
+			size_t count = 1;
+			if (file_map_translate(first.fileMap,
+					first.offset << PAGE_SHIFT, 1, &vec, &count, 0) == B_OK
+				&& count == 1) {
+				diskOffset = vec.offset;
+			}
+		}
+
+		if (diskOffset >= 0)
+			fOrderedCacheCount++;
+		fCacheCount++;
+
+		for (uint32 i = start; i < end; i++)
+			fEntries[i].diskOffset = diskOffset;
+
+		start = end;
+	}
+
+	std::sort(fEntries, fEntries + fWrapperCount, &_CompareByDiskOffset);
+}
+
+
+/*!	Merges the sorted pages into as few transfers as possible.
+*/
+void
+PageWriterRun::_BuildTransfers()
+{
+	VMCache* lockedCache = NULL;
+
+	for (uint32 i = 0; i < fWrapperCount; i++) {
+		PageEntry& entry = fEntries[i];
+		if (entry.cache != lockedCache) {
+			if (lockedCache != NULL)
+				lockedCache->Unlock();
+			lockedCache = entry.cache;
+			lockedCache->Lock();
+		}
+
+		if (fTransferCount == 0
+			|| !fTransfers[fTransferCount - 1].AddPage(entry.page)) {
+			fTransfers[fTransferCount++].SetTo(this, entry.page,
+				entry.cache->MaxPagesPerAsyncWrite());
+		}
+	}
+
+	if (lockedCache != NULL)
+		lockedCache->Unlock();
+}
+
+
 /*!	The page writer continuously takes some pages from the modified
 	queue, writes them back, and moves them back to the active queue.
 	It runs in its own thread, and is only there to keep the number
@@ -2294,7 +2627,7 @@ PageWriterRun::PageWritten(PageWriteTransfer* transfer, status_t status,
 status_t
 page_writer(void* /*unused*/)
 {
-	const uint32 kNumPages = 256;
+	const uint32 kNumPages = 512;
 	uint32 writtenPages = 0;
 #ifdef TRACE_VM_PAGE
 	bigtime_t lastWrittenTime = 0;
@@ -2356,7 +2689,7 @@ page_writer(void* /*unused*/)
 		// enough to do).
 
 		// collect pages to be written
-		pageCollectionTime -= system_time();
+		bigtime_t collectionStartTime = system_time();
 
 		page_num_t maxPagesToSee = modifiedPages;
 
@@ -2429,15 +2762,26 @@ page_writer(void* /*unused*/)
 			numPages++;
 		}
 
-		pageCollectionTime += system_time();
+		bigtime_t collectionTime = system_time() - collectionStartTime;
+		pageCollectionTime += collectionTime;
+		sPageWriterStats.collection_time += collectionTime;
 
 		if (numPages == 0)
 			continue;
 
 		// write pages to disk and do all the cleanup
-		pageWritingTime -= system_time();
+		bigtime_t writeStartTime = system_time();
 		uint32 failedPages = run.Go();
-		pageWritingTime += system_time();
+		bigtime_t writeTime = system_time() - writeStartTime;
+		pageWritingTime += writeTime;
+
+		sPageWriterStats.runs++;
+		sPageWriterStats.pages += numPages;
+		sPageWriterStats.failed_pages += failedPages;
+		sPageWriterStats.transfers += run.TransferCount();
+		sPageWriterStats.caches += run.CacheCount();
+		sPageWriterStats.ordered_caches += run.OrderedCacheCount();
+		sPageWriterStats.writing_time += writeTime;
 
 		// debug output only...
 		writtenPages += numPages;
@@ -3366,6 +3710,8 @@ vm_page_init_post_area(kernel_args *args)
 	add_debugger_command("page_queue", &dump_page_queue, "Dump page queue");
 	add_debugger_command("find_page", &find_page,
 		"Find out which queue a page is actually in");
+	add_debugger_command("page_writer_stats", &dump_page_writer_stats,
+		"Dump statistics about the page writer");
 
 #ifdef TRACK_PAGE_USAGE_STATS
 	add_debugger_command_etc("page_usage", &dump_page_usage_stats,
@@ -3411,6 +3757,9 @@ vm_page_init_post_thread(kernel_args *args)
 	new (&sFreePageCondition) ConditionVariable;
 	sFreePageCondition.Publish(&sFreePageQueue, "free page");
 
+	// from now on, we can rely on the current thread's CPU
+	sPageMagazinesEnabled = true;
+
 	// create a kernel thread to clear out pages
 
 	thread_id thread = spawn_kernel_thread(&page_scrubber, "page scrubber",
@@ -3468,6 +3817,24 @@ vm_page_unreserve_pages(vm_page_reservation* reservation)
 }
 
 
+/*!	Returns \a count pages of the \a reservation, e.g. when they have not
+	been needed after all. The rest of the reservation remains intact.
+*/
+void
+vm_page_unreserve_pages_etc(vm_page_reservation* reservation, uint32 count)
+{
+	count = std::min(count, reservation->count);
+	reservation->count -= count;
+
+	if (count == 0)
+		return;
+
+	TA(UnreservePages(count));
+
+	unreserve_pages(count);
+}
+
+
 /*!	With this call, you can reserve a number of free pages in the system.
 	They will only be handed out to someone who has actually reserved them.
 	This call returns as soon as the number of requested pages has been
@@ -3521,44 +3888,32 @@ vm_page_allocate_page(vm_page_reservation* reservation, uint32 flags)
 	ASSERT(reservation->count > 0);
 	reservation->count--;
 
-	VMPageQueue* queue;
-	VMPageQueue* otherQueue;
-
-	if ((flags & VM_PAGE_ALLOC_CLEAR) != 0) {
-		queue = &sClearPageQueue;
-		otherQueue = &sFreePageQueue;
-	} else {
-		queue = &sFreePageQueue;
-		otherQueue = &sClearPageQueue;
-	}
+	bool clear = (flags & VM_PAGE_ALLOC_CLEAR) != 0;
 
 	ReadLocker locker(sFreePageQueuesLock);
 
-	vm_page* page = queue->RemoveHeadUnlocked();
+	vm_page* page = allocate_page_from_magazine(clear);
 	if (page == NULL) {
-		// if the primary queue was empty, grab the page from the
-		// secondary queue
-		page = otherQueue->RemoveHeadUnlocked();
-
-		if (page == NULL) {
-			// Unlikely, but possible: the page we have reserved has moved
-			// between the queues after we checked the first queue. Grab the
-			// write locker to make sure this doesn't happen again.
-			locker.Unlock();
-			WriteLocker writeLocker(sFreePageQueuesLock);
+		// The page we have reserved is either sitting in the magazine of
+		// another CPU, or it has moved between the queues while we were
+		// looking. Grab the write locker to get all pages back into the
+		// queues, and to make sure they stay there.
+		locker.Unlock();
+		WriteLocker writeLocker(sFreePageQueuesLock);
 
-			page = queue->RemoveHead();
-			if (page == NULL)
-				otherQueue->RemoveHead();
+		drain_page_magazines();
 
-			if (page == NULL) {
-				panic("Had reserved page, but there is none!");
-				return NULL;
-			}
+		page = magazine_queue(clear).RemoveHead();
+		if (page == NULL)
+			page = magazine_queue(!clear).RemoveHead();
 
-			// downgrade to read lock
-			locker.Lock();
+		if (page == NULL) {
+			panic("Had reserved page, but there is none!");
+			return NULL;
 		}
+
+		// downgrade to read lock
+		locker.Lock();
 	}
 
 	if (page->CacheRef() != NULL)
@@ -3843,6 +4198,7 @@ vm_page_allocate_page_run(uint32 flags, page_num_t length,
 	vm_page_reserve_pages(&reservation, length, priority);
 
 	WriteLocker freeClearQueueLocker(sFreePageQueuesLock);
+	drain_page_magazines();
 
 	// First we try to get a run with free pages only. If that fails, we also
 	// consider cached pages. If there are only few free pages and many cached
@@ -3908,6 +4264,7 @@ vm_page_allocate_page_run(uint32 flags, page_num_t length,
 			// apparently a cached page couldn't be allocated -- skip it and
 			// continue
 			freeClearQueueLocker.Lock();
+			drain_page_magazines();
 		}
 
 		start += i + 1;
@@ -4091,7 +4448,7 @@ vm_page_get_stats(system_info *info)
 	// So taking out the cached (including modified non-temporary), free and
 	// clear ones leaves us with all used pages.
 	int32 subtractPages = info->cached_pages + sFreePageQueue.Count()
-		+ sClearPageQueue.Count();
+		+ sClearPageQueue.Count() + count_magazine_pages();
 	info->used_pages = subtractPages > info->max_pages
 		? 0 : info->max_pages - subtractPages;
 
@@ -398,6 +398,8 @@ create_select_sync(int numFDs, select_sync*& _sync)
 
 	sync->count = numFDs;
 	sync->ref_count = 1;
+	sync->notify = NULL;
+	sync->destroy = NULL;
 
 	for (int i = 0; i < numFDs; i++) {
 		sync->set[i].next = NULL;
@@ -418,6 +420,11 @@ put_select_sync(select_sync* sync)
 	FUNCTION(("put_select_sync(%p): -> %ld\n", sync, sync->ref_count - 1));
 
 	if (atomic_add(&sync->ref_count, -1) == 1) {
+		if (sync->destroy != NULL) {
+			sync->destroy(sync);
+			return;
+		}
+
 		delete_sem(sync->sem);
 		delete[] sync->set;
 		delete sync;
@@ -698,15 +705,21 @@ notify_select_events(select_info* info, uint16 events)
 
 	if (info == NULL
 		|| info->sync == NULL
-		|| info->sync->sem < B_OK)
+		|| (info->sync->notify == NULL && info->sync->sem < B_OK))
 		return B_BAD_VALUE;
 
 	atomic_or(&info->events, events);
 
 	// only wake up the waiting select()/poll() call if the events
 	// match one of the selected ones
-	if (info->selected_events & events)
+	if (info->selected_events & events) {
+		if (info->sync->notify != NULL) {
+			info->sync->notify(info);
+			return B_OK;
+		}
+
 		return release_sem_etc(info->sync->sem, 1, B_DO_NOT_RESCHEDULE);
+	}
 
 	return B_OK;
 }
@@ -723,6 +736,26 @@ notify_select_events_list(select_info* list, uint16 events)
 }
 
 
+status_t
+select_object(uint16 type, int32 object, select_info* info, bool kernel)
+{
+	if (type >= kSelectOpsCount)
+		return B_BAD_VALUE;
+
+	return kSelectOps[type].select(object, info, kernel);
+}
+
+
+status_t
+deselect_object(uint16 type, int32 object, select_info* info, bool kernel)
+{
+	if (type >= kSelectOpsCount)
+		return B_BAD_VALUE;
+
+	return kSelectOps[type].deselect(object, info, kernel);
+}
+
+
 //	#pragma mark - public kernel API
 
 
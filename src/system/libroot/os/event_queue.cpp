@@ -0,0 +1,31 @@
+/*
+ * Copyright 2013, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include <event_queue_private.h>
+
+#include <syscalls.h>
+
+
+int
+event_queue_create(int openFlags)
+{
+	return _kern_event_queue_create(openFlags);
+}
+
+
+status_t
+event_queue_select(int queue, event_wait_info* infos, int numInfos)
+{
+	return _kern_event_queue_select(queue, infos, numInfos);
+}
+
+
+ssize_t
+event_queue_wait(int queue, event_wait_info* infos, int numInfos,
+	uint32 flags, bigtime_t timeout)
+{
+	return _kern_event_queue_wait(queue, infos, numInfos, flags, timeout);
+}
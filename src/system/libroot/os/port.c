@@ -5,6 +5,7 @@
 
 
 #include <OS.h>
+#include <port_defs.h>
 #include "syscalls.h"
 
 
@@ -52,6 +53,24 @@ read_port_etc(port_id port, int32 *code, void *buffer, size_t bufferSize,
 }
 
 
+ssize_t
+write_port_messages_etc(port_id port, const port_message_data *messages,
+	int32 count, uint32 flags, bigtime_t timeout)
+{
+	return _kern_write_port_messages_etc(port, messages, count, flags,
+		timeout);
+}
+
+
+ssize_t
+read_port_messages_etc(port_id port, port_message_data *messages,
+	int32 count, uint32 flags, bigtime_t timeout)
+{
+	return _kern_read_port_messages_etc(port, messages, count, flags,
+		timeout);
+}
+
+
 ssize_t
 port_buffer_size(port_id port)
 {
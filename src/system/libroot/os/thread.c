@@ -71,6 +71,8 @@ _thread_do_exit_work(void)
 	tls_set(TLS_ON_EXIT_THREAD_SLOT, NULL);
 
 	__pthread_destroy_thread();
+
+	__heap_thread_exit();
 }
 
 
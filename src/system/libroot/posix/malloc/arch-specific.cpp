@@ -23,6 +23,7 @@
 #include <OS.h>
 #include <Debug.h>
 #include <syscalls.h>
+#include <vm_defs.h>
 
 #include <stdlib.h>
 #include <unistd.h>
@@ -87,6 +88,7 @@ extern "C" status_t
 __init_heap(void)
 {
 	hoardHeap::initNumProcs();
+	hoardHeap::initSizeClassLookup();
 
 	// This will locate the heap base at 384 MB and reserve the next 1152 MB
 	// for it. They may get reclaimed by other areas, though, but the maximum
@@ -349,6 +351,16 @@ hoardUnsbrk(void *ptr, long size)
 }
 
 
+void
+hoardDiscard(void *ptr, long size)
+{
+	CTRACE(("discard: %p, %ld\n", ptr, size));
+
+	// The memory stays mapped, we just don't need its contents anymore.
+	_kern_memory_advice(ptr, size, MADV_FREE);
+}
+
+
 void
 hoardLockInit(hoardLockType &lock, const char *name)
 {
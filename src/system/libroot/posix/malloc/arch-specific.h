@@ -42,6 +42,7 @@ void hoardUnlock(hoardLockType &lock);
 
 void *hoardSbrk(long size);
 void hoardUnsbrk(void *ptr, long size);
+void hoardDiscard(void *ptr, long size);
 
 ///// Other.
 
@@ -29,6 +29,10 @@
 
 #define HEAP_LOG 0		// If non-zero, keep a log of heap accesses.
 
+#ifndef THREAD_CACHE
+#	define THREAD_CACHE 1	// If non-zero, every thread caches free blocks of the smaller size classes.
+#endif
+
 
 ///// You should not change anything below here. /////
 
@@ -102,6 +102,9 @@ size_t hoardHeap::_threshold[hoardHeap::SIZE_CLASSES] = {
 int hoardHeap::_numProcessors;
 int hoardHeap::_numProcessorsMask;
 
+uint8 hoardHeap::_sizeClassLookup[hoardHeap::MAX_LOOKUP_SIZE
+	/ hoardHeap::ALIGNMENT + 1];
+
 
 // Return ceil(log_2(num)).
 // num must be positive.
@@ -126,7 +129,8 @@ lg(int num)
 
 hoardHeap::hoardHeap(void)
 	:
-	_index(0), _reusableSuperblocks(NULL), _reusableSuperblocksCount(0)
+	_index(0), _reusableSuperblocks(NULL), _reusableSuperblocksCount(0),
+	_discardedSuperblocks(NULL)
 #if HEAP_DEBUG
 	, _magic(HEAP_MAGIC)
 #endif
@@ -401,6 +405,12 @@ hoardHeap::freeBlock(block * &b, superblock * &sb,
 		// before the call to removeSuperblock, above.
 		incStats(sizeclass,
 			sb->getNumBlocks() - sb->getNumAvailable(), sb->getNumBlocks());
+
+		// If we already have enough empty superblocks to reuse, give the
+		// memory of the one that has been empty the longest back to the
+		// system, instead of one that is likely to be reused right away.
+		if (_reusableSuperblocksCount > MAX_EMPTY_SUPERBLOCKS)
+			discardOldestSuperblock();
 #endif
 	}
 
@@ -445,6 +455,45 @@ hoardHeap::freeBlock(block * &b, superblock * &sb,
 }
 
 
+/*!	Moves the superblock at the end of the reusable-superblock list, that is
+	the one that was recycled first, to the list of discarded superblocks,
+	and gives the memory of its blocks back to the system. It is only reused
+	(and reformatted) once no other empty superblock is left.
+*/
+void
+hoardHeap::discardOldestSuperblock(void)
+{
+	assert(_reusableSuperblocks != NULL);
+
+	superblock *sb = _reusableSuperblocks;
+	while (sb->getNext() != NULL)
+		sb = sb->getNext();
+
+	if (sb == _reusableSuperblocks)
+		_reusableSuperblocks = NULL;
+	sb->remove();
+	--_reusableSuperblocksCount;
+
+	sb->discardBlocks();
+
+	sb->insertBefore(_discardedSuperblocks);
+	_discardedSuperblocks = sb;
+}
+
+
+void
+hoardHeap::initSizeClassLookup(void)
+{
+	int sizeclass = 0;
+	for (size_t i = 0; i <= MAX_LOOKUP_SIZE / ALIGNMENT; i++) {
+		while (_sizeTable[sizeclass] < i * ALIGNMENT)
+			sizeclass++;
+
+		_sizeClassLookup[i] = sizeclass;
+	}
+}
+
+
 void
 hoardHeap::initNumProcs(void)
 {
@@ -89,6 +89,10 @@ class hoardHeap {
 		// ANDing with this rounds to ALIGNMENT.
 		enum { ALIGNMENT_MASK = ALIGNMENT - 1 };
 
+		// Sizes up to this one are mapped to their size class via a
+		// lookup table instead of searching the size table.
+		enum { MAX_LOOKUP_SIZE = 1024 };
+
 		// Used for sanity checking.
 		enum { HEAP_MAGIC = 0x0badcafe };
 
@@ -161,6 +165,10 @@ class hoardHeap {
 		// Reuse a superblock (if one is available).
 		inline superblock *reuse(int sizeclass);
 
+		// Give the memory of the superblock that has been empty the longest
+		// back to the system.
+		void discardOldestSuperblock(void);
+
 		// Remove a particular superblock.
 		void removeSuperblock(superblock *, int sizeclass);
 
@@ -191,6 +199,9 @@ class hoardHeap {
 		superblock *_reusableSuperblocks;
 		int _reusableSuperblocksCount;
 
+		// Reusable superblocks whose blocks have been discarded.
+		superblock *_discardedSuperblocks;
+
 		// Lists of superblocks.
 		superblock *_superblocks[SUPERBLOCK_FULLNESS_GROUP][SIZE_CLASSES];
 
@@ -210,8 +221,12 @@ class hoardHeap {
 		// The lookup table for release thresholds.
 		static size_t _threshold[SIZE_CLASSES];
 
+		// The lookup table for the size classes of small sizes.
+		static uint8 _sizeClassLookup[MAX_LOOKUP_SIZE / ALIGNMENT + 1];
+
 	public:
 		static void initNumProcs(void);
+		static void initSizeClassLookup(void);
 
 	protected:
 		// number of CPUs, cached
@@ -384,9 +399,14 @@ hoardHeap::findAvailableSuperblock(int sizeclass,
 int
 hoardHeap::sizeClass(const size_t sz)
 {
+	// Small sizes, which are by far the most common ones, are looked up
+	// directly.
+	if (sz <= MAX_LOOKUP_SIZE)
+		return _sizeClassLookup[(sz + ALIGNMENT_MASK) / ALIGNMENT];
+
 	// Find the size class for a given object size
 	// (the smallest i such that _sizeTable[i] >= sz).
-	int sizeclass = 0;
+	int sizeclass = _sizeClassLookup[MAX_LOOKUP_SIZE / ALIGNMENT];
 	while (_sizeTable[sizeclass] < sz) {
 		sizeclass++;
 		assert(sizeclass < SIZE_CLASSES);
@@ -486,7 +506,7 @@ hoardHeap::recycle(superblock *sb)
 superblock *
 hoardHeap::reuse(int sizeclass)
 {
-	if (_reusableSuperblocks == NULL)
+	if (_reusableSuperblocks == NULL && _discardedSuperblocks == NULL)
 		return NULL;
 
 	// Make sure that we aren't using a sizeclass
@@ -494,16 +514,25 @@ hoardHeap::reuse(int sizeclass)
 	if (hoardHeap::numBlocks(sizeclass) <= 1)
 		return NULL;
 
-	// Pop off a superblock from the reusable-superblock list.
-	assert(_reusableSuperblocksCount > 0);
-	superblock *sb = _reusableSuperblocks;
-	_reusableSuperblocks = sb->getNext();
+	// Pop off a superblock from the reusable-superblock list. Superblocks
+	// that still have their memory are preferred, as the pages of the
+	// discarded ones would have to be faulted in again.
+	superblock *sb;
+	if (_reusableSuperblocks != NULL) {
+		assert(_reusableSuperblocksCount > 0);
+		sb = _reusableSuperblocks;
+		_reusableSuperblocks = sb->getNext();
+		--_reusableSuperblocksCount;
+	} else {
+		sb = _discardedSuperblocks;
+		_discardedSuperblocks = sb->getNext();
+	}
 	sb->remove();
 	assert(sb->getNumBlocks() > 1);
-	--_reusableSuperblocksCount;
 
-	// Reformat the superblock if necessary.
-	if (sb->getBlockSizeClass() != sizeclass) {
+	// Reformat the superblock if necessary -- this is also the case if its
+	// blocks have been discarded, as that destroyed their headers.
+	if (sb->getBlockSizeClass() != sizeclass || sb->blocksDiscarded()) {
 		decStats(sb->getBlockSizeClass(),
 			sb->getNumBlocks() - sb->getNumAvailable(),
 			sb->getNumBlocks());
@@ -150,16 +150,7 @@ processHeap::free(void *ptr)
 
 	// Find the block and superblock corresponding to this ptr.
 
-	block *b = (block *) ptr - 1;
-	assert(b->isValid());
-
-	// Check to see if this block came from a memalign() call.
-	if (((unsigned long)b->getNext() & 1) == 1) {
-		// It did. Set the block to the actual block header.
-		b = (block *) ((unsigned long)b->getNext() & ~1);
-		assert(b->isValid());
-	}
-
+	block *b = blockFromPointer(ptr);
 	b->markFree();
 
 	superblock *sb = b->getSuperblock();
@@ -209,3 +200,61 @@ processHeap::free(void *ptr)
 	if (!sbUnmapped)
 		sb->upUnlock();
 }
+
+
+// freeBlocks (list):
+//   inputs: a list of blocks that have already been marked free.
+//   side effects: like free() for every block in the list, but keeps
+//                 the owning heap locked for as long as consecutive blocks
+//                 belong to it.
+
+void
+processHeap::freeBlocks(block *list)
+{
+	hoardHeap *owner = NULL;
+
+	while (list != NULL) {
+		block *b = list;
+		list = b->getNext();
+
+		superblock *sb = b->getSuperblock();
+		assert(sb);
+		assert(sb->isValid());
+
+		// As long as we hold the lock of the superblock's owner, the
+		// superblock cannot move to another heap. Unlike free(), we don't
+		// acquire the superblock's up lock, as we may already hold a heap
+		// lock, and would risk a deadlock with free().
+		if (owner != NULL && owner != sb->getOwner()) {
+			owner->unlock();
+			owner = NULL;
+		}
+
+		while (owner == NULL) {
+			owner = sb->getOwner();
+			owner->lock();
+			if (owner == sb->getOwner())
+				break;
+
+			owner->unlock();
+			owner = NULL;
+
+			// Suspend to allow ownership to quiesce.
+			hoardYield();
+		}
+
+#if HEAP_LOG
+		MemoryRequest m;
+		m.free((void *)(b + 1));
+		getLog(owner->getIndex()).append(m);
+#endif
+#if HEAP_FRAG_STATS
+		setDeallocated(b->getRequestedSize(), 0);
+#endif
+
+		owner->freeBlock(b, sb, sb->getBlockSizeClass(), this);
+	}
+
+	if (owner != NULL)
+		owner->unlock();
+}
@@ -61,6 +61,13 @@ class processHeap : public hoardHeap {
 		// Memory deallocation routines.
 		void free(void *ptr);
 
+		// Return a list of blocks (linked via their next pointers) that
+		// have already been marked free to their superblocks.
+		void freeBlocks(block *list);
+
+		// Get the block header of an object allocated by malloc().
+		inline static block *blockFromPointer(void *ptr);
+
 		// Print out statistics information.
 		void stats(void);
 
@@ -183,6 +190,23 @@ processHeap::getLog(int i)
 #endif
 
 
+block *
+processHeap::blockFromPointer(void *ptr)
+{
+	block *b = (block *)ptr - 1;
+	assert(b->isValid());
+
+	// Check to see if this block came from a memalign() call.
+	if (((unsigned long)b->getNext() & 1) == 1) {
+		// It did. Set the block to the actual block header.
+		b = (block *)((unsigned long)b->getNext() & ~1);
+		assert(b->isValid());
+	}
+
+	return b;
+}
+
+
 // Hash out the thread id to a heap and return an index to that heap.
 
 int
@@ -49,7 +49,8 @@ superblock::superblock(int numBlocks,	// The number of blocks in the sb.
 	_sizeClass(szclass),
 	_numBlocks(numBlocks),
 	_numAvailable(0),
-	_fullness(0), _freeList(NULL), _owner(o), _next(NULL), _prev(NULL)
+	_fullness(0), _freeList(NULL), _owner(o), _next(NULL), _prev(NULL),
+	_blocksDiscarded(false)
 {
 	assert(_numBlocks >= 1);
 
@@ -127,3 +128,23 @@ superblock::makeSuperblock(int sizeclass, processHeap *pHeap)
 	// Instantiate the new superblock in the buffer.
 	return new(buf) superblock(numBlocks, sizeclass, NULL);
 }
+
+
+void
+superblock::discardBlocks(void)
+{
+	assert(getNumAvailable() == getNumBlocks());
+	assert(getNumBlocks() > 1);
+
+	// Only whole pages can be discarded, and the superblock header itself
+	// has to stay intact.
+	const unsigned long start = ((unsigned long)(this + 1) + B_PAGE_SIZE - 1)
+		& ~(unsigned long)(B_PAGE_SIZE - 1);
+	const unsigned long end = ((unsigned long)this
+		+ hoardHeap::SUPERBLOCK_SIZE) & ~(unsigned long)(B_PAGE_SIZE - 1);
+	if (start >= end)
+		return;
+
+	hoardDiscard((void *)start, end - start);
+	_blocksDiscarded = true;
+}
@@ -96,6 +96,18 @@ class superblock {
 		// Remove this superblock from its linked list.
 		inline void remove(void);
 
+		// Give the memory of the blocks back to the system. The superblock
+		// must be empty, and has to be reformatted before it can be used
+		// again.
+		void discardBlocks(void);
+
+		// Have the blocks been discarded?
+		bool
+		blocksDiscarded(void)
+		{
+			return _blocksDiscarded;
+		}
+
 		// Is this superblock valid? (i.e.,
 		// does it have the right magic number?)
 		inline int isValid(void);
@@ -134,6 +146,7 @@ class superblock {
 		hoardHeap *_owner;			// The heap who owns this superblock.
 		superblock *_next;			// The next superblock in the list.
 		superblock *_prev;			// The previous superblock in the list.
+		bool _blocksDiscarded;		// Has the memory of the blocks been given back?
 
 		hoardLockType _upLock;		// Lock this when moving a superblock to the global (process) heap.
 
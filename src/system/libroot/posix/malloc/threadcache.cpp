@@ -0,0 +1,124 @@
+/*
+ * Copyright 2013, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include "threadcache.h"
+
+#include <string.h>
+
+#include "arch-specific.h"
+#include "threadheap.h"
+
+using namespace BPrivate;
+
+
+// Caches of threads that have exited, ready to be reused.
+static threadCache *sUnusedCaches = NULL;
+static hoardLockType sUnusedCachesLock = 0;
+
+
+threadCache::threadCache(void)
+	:
+	_next(NULL)
+{
+	memset(_lists, 0, sizeof(_lists));
+}
+
+
+threadCache *
+threadCache::create(void)
+{
+	hoardLock(sUnusedCachesLock);
+
+	threadCache *cache = sUnusedCaches;
+	if (cache != NULL)
+		sUnusedCaches = cache->_next;
+
+	hoardUnlock(sUnusedCachesLock);
+
+	if (cache == NULL) {
+		void *buffer = hoardSbrk(sizeof(threadCache));
+		if (buffer == NULL)
+			return NULL;
+
+		cache = new(buffer) threadCache;
+	}
+
+	cache->_next = NULL;
+	tls_set(TLS_MALLOC_SLOT, cache);
+	return cache;
+}
+
+
+void
+threadCache::destroy(processHeap *pHeap)
+{
+	threadCache *cache = (threadCache *)tls_get(TLS_MALLOC_SLOT);
+	if (cache == NULL)
+		return;
+
+	tls_set(TLS_MALLOC_SLOT, NULL);
+
+	for (int i = 0; i <= MAX_CACHED_SIZE_CLASS; i++)
+		cache->flush(pHeap, i, 0);
+
+	hoardLock(sUnusedCachesLock);
+	cache->_next = sUnusedCaches;
+	sUnusedCaches = cache;
+	hoardUnlock(sUnusedCachesLock);
+}
+
+
+void *
+threadCache::refill(processHeap *pHeap, int sizeclass)
+{
+	block *list;
+	int count = pHeap->getHeap(pHeap->getHeapIndex()).mallocBlocks(sizeclass,
+		maxBlocks(sizeclass) / 2, list);
+	if (count == 0)
+		return NULL;
+
+	// We return the first block, and cache the rest of them.
+	block *b = list;
+	list = b->getNext();
+	b->setNext(NULL);
+
+	for (block *cached = list; cached != NULL; cached = cached->getNext())
+		cached->markFree();
+
+	_lists[sizeclass].head = list;
+	_lists[sizeclass].count = count - 1;
+
+	// Skip past the block header and return the pointer.
+	return (void *)(b + 1);
+}
+
+
+void
+threadCache::flush(processHeap *pHeap, int sizeclass, int keep)
+{
+	freeList &list = _lists[sizeclass];
+	if (list.count <= keep)
+		return;
+
+	// The blocks at the head of the list have been freed most recently,
+	// and are thus the most likely ones to still be in the CPU cache; we
+	// keep those.
+	block *flush;
+	if (keep == 0) {
+		flush = list.head;
+		list.head = NULL;
+	} else {
+		block *last = list.head;
+		for (int i = 1; i < keep; i++)
+			last = last->getNext();
+
+		flush = last->getNext();
+		last->setNext(NULL);
+	}
+
+	list.count = keep;
+	pHeap->freeBlocks(flush);
+}
@@ -0,0 +1,147 @@
+/*
+ * Copyright 2013, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef _THREADCACHE_H_
+#define _THREADCACHE_H_
+
+#include "config.h"
+
+#include <tls.h>
+
+#include "block.h"
+#include "heap.h"
+#include "processheap.h"
+#include "superblock.h"
+
+
+namespace BPrivate {
+
+//
+// Every thread has a cache of free blocks of the smaller size classes, so
+// that most allocations and deallocations don't need to lock any heap.
+// Blocks in a cache still count as being in use by the heap that owns their
+// superblock; they are returned to it in batches.
+//
+
+class threadCache {
+	public:
+		// The largest size class that is cached (1024 bytes with the default
+		// size classes).
+		enum { MAX_CACHED_SIZE_CLASS = 22 };
+
+		// The number of bytes a thread may cache per size class, and the
+		// limits for the number of blocks this results in.
+		enum { MAX_CACHED_BYTES = 8192 };
+		enum { MIN_CACHED_BLOCKS = 8 };
+		enum { MAX_CACHED_BLOCKS = 256 };
+
+		// Get the cache of the current thread; creates it, if necessary.
+		// Returns NULL if there is no memory left for the cache.
+		inline static threadCache *get(void);
+
+		// Return all blocks of the current thread's cache to their heaps,
+		// and delete the cache.
+		static void destroy(processHeap *pHeap);
+
+		// Allocate a block of the given size class.
+		inline void *malloc(processHeap *pHeap, int sizeclass);
+
+		// Put the given block into the cache. Returns false if the block
+		// does not belong to a cached size class.
+		inline bool free(processHeap *pHeap, block *b);
+
+	private:
+		threadCache(void);
+
+		static threadCache *create(void);
+
+		// Get some blocks from the thread's heap, and return one of them.
+		void *refill(processHeap *pHeap, int sizeclass);
+
+		// Return all but keep blocks of the size class to their heaps.
+		void flush(processHeap *pHeap, int sizeclass, int keep);
+
+		inline static int maxBlocks(int sizeclass);
+
+		struct freeList {
+			block *head;
+			int count;
+		};
+
+		freeList _lists[MAX_CACHED_SIZE_CLASS + 1];
+
+		// The next unused cache.
+		threadCache *_next;
+};
+
+
+threadCache *
+threadCache::get(void)
+{
+	threadCache *cache = (threadCache *)tls_get(TLS_MALLOC_SLOT);
+	if (cache != NULL)
+		return cache;
+
+	return create();
+}
+
+
+void *
+threadCache::malloc(processHeap *pHeap, int sizeclass)
+{
+	assert(sizeclass <= MAX_CACHED_SIZE_CLASS);
+
+	freeList &list = _lists[sizeclass];
+	block *b = list.head;
+	if (b == NULL)
+		return refill(pHeap, sizeclass);
+
+	list.head = b->getNext();
+	list.count--;
+
+	b->setNext(NULL);
+	b->markAllocated();
+
+	// Skip past the block header and return the pointer.
+	return (void *)(b + 1);
+}
+
+
+bool
+threadCache::free(processHeap *pHeap, block *b)
+{
+	const int sizeclass = b->getSuperblock()->getBlockSizeClass();
+	if (sizeclass > MAX_CACHED_SIZE_CLASS)
+		return false;
+
+	b->markFree();
+
+	freeList &list = _lists[sizeclass];
+	b->setNext(list.head);
+	list.head = b;
+
+	// If we've got too many blocks, give the least recently freed half
+	// back to the heaps.
+	const int max = maxBlocks(sizeclass);
+	if (++list.count > max)
+		flush(pHeap, sizeclass, max / 2);
+
+	return true;
+}
+
+
+int
+threadCache::maxBlocks(int sizeclass)
+{
+	int count = MAX_CACHED_BYTES / hoardHeap::sizeFromClass(sizeclass);
+	if (count < MIN_CACHED_BLOCKS)
+		return MIN_CACHED_BLOCKS;
+	if (count > MAX_CACHED_BLOCKS)
+		return MAX_CACHED_BLOCKS;
+	return count;
+}
+
+}	// namespace BPrivate
+
+#endif	// _THREADCACHE_H_
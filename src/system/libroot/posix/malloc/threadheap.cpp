@@ -52,10 +52,71 @@ threadHeap::malloc(const size_t size)
 #endif
 
 	const int sizeclass = sizeClass(size);
-	block *b = NULL;
 
 	lock();
 
+	block *b = allocateBlock(sizeclass);
+	if (b == NULL) {
+		// We're out of memory!
+		unlock();
+		return NULL;
+	}
+
+#if HEAP_LOG
+	MemoryRequest m;
+	m.malloc((void *)(b + 1), align(size));
+	_pHeap->getLog(getIndex()).append(m);
+#endif
+#if HEAP_FRAG_STATS
+	b->setRequestedSize(align(size));
+	_pHeap->setAllocated(align(size), 0);
+#endif
+
+	unlock();
+
+	// Skip past the block header and return the pointer.
+	return (void *)(b + 1);
+}
+
+
+// mallocBlocks (sizeclass, count, list):
+//   inputs: the size class and the number of blocks to be allocated.
+//   returns: the number of blocks allocated, and the blocks themselves
+//            linked via their next pointers in list.
+//   side effects: like malloc(), but only locks the heap once.
+
+int
+threadHeap::mallocBlocks(int sizeclass, int count, block *&list)
+{
+	list = NULL;
+
+	lock();
+
+	int allocated = 0;
+	for (; allocated < count; allocated++) {
+		block *b = allocateBlock(sizeclass);
+		if (b == NULL)
+			break;
+
+		b->setNext(list);
+		list = b;
+	}
+
+	unlock();
+
+	return allocated;
+}
+
+
+// allocateBlock (sizeclass):
+//   returns: an allocated block of the given size class, or NULL.
+//   The heap must be locked.
+
+block *
+threadHeap::allocateBlock(int sizeclass)
+{
+	block *b = NULL;
+
 	// Look for a free block.
 	// We usually have memory locally so we first look for space in the
 	// superblock list.
@@ -74,7 +135,6 @@ threadHeap::malloc(const size_t size)
 			sb = superblock::makeSuperblock(sizeclass, _pHeap);
 			if (sb == NULL) {
 				// We're out of memory!
-				unlock();
 				return NULL;
 			}
 #if HEAP_LOG
@@ -102,19 +162,5 @@ threadHeap::malloc(const size_t size)
 	assert(sb->isValid());
 
 	b->markAllocated();
-
-#if HEAP_LOG
-	MemoryRequest m;
-	m.malloc((void *)(b + 1), align(size));
-	_pHeap->getLog(getIndex()).append(m);
-#endif
-#if HEAP_FRAG_STATS
-	b->setRequestedSize(align(size));
-	_pHeap->setAllocated(align(size), 0);
-#endif
-
-	unlock();
-
-	// Skip past the block header and return the pointer.
-	return (void *)(b + 1);
+	return b;
 }
@@ -22,6 +22,7 @@
 #include "config.h"
 #include "threadheap.h"
 #include "processheap.h"
+#include "threadcache.h"
 #include "arch-specific.h"
 
 #include <image.h>
@@ -256,6 +257,52 @@ getAllocator(void)
 }
 
 
+inline static void *
+allocate(processHeap *pHeap, size_t size)
+{
+#if THREAD_CACHE
+	if (size <= hoardHeap::sizeFromClass(threadCache::MAX_CACHED_SIZE_CLASS)) {
+		threadCache *cache = threadCache::get();
+		if (cache != NULL)
+			return cache->malloc(pHeap, hoardHeap::sizeClass(size));
+	}
+#endif
+
+	return pHeap->getHeap(pHeap->getHeapIndex()).malloc(size);
+}
+
+
+inline static void
+deallocate(processHeap *pHeap, void *ptr)
+{
+#if THREAD_CACHE
+	if (ptr != NULL) {
+		threadCache *cache = threadCache::get();
+		if (cache != NULL
+			&& cache->free(pHeap, processHeap::blockFromPointer(ptr))) {
+			return;
+		}
+	}
+#endif
+
+	pHeap->free(ptr);
+}
+
+
+//	#pragma mark - private functions
+
+
+extern "C" void
+__heap_thread_exit(void)
+{
+#if THREAD_CACHE
+	defer_signals();
+	threadCache::destroy(getAllocator());
+	undefer_signals();
+#endif
+}
+
+
 //	#pragma mark - public functions
 
 
@@ -270,7 +317,7 @@ malloc(size_t size)
 
 	defer_signals();
 
-	void *addr = pHeap->getHeap(pHeap->getHeapIndex()).malloc(size);
+	void *addr = allocate(pHeap, size);
 	if (addr == NULL) {
 		undefer_signals();
 		__set_errno(B_NO_MEMORY);
@@ -306,7 +353,7 @@ calloc(size_t nelem, size_t elsize)
 
 	defer_signals();
 
-	void *ptr = pHeap->getHeap(pHeap->getHeapIndex()).malloc(size);
+	void *ptr = allocate(pHeap, size);
 	if (ptr == NULL) {
 		undefer_signals();
 		__set_errno(B_NO_MEMORY);
@@ -352,7 +399,7 @@ free(void *ptr)
 	if (ptr != NULL)
 		remove_address(ptr);
 #endif
-	pHeap->free(ptr);
+	deallocate(pHeap, ptr);
 
 	undefer_signals();
 }
@@ -1839,6 +1839,13 @@ __init_heap_post_env(void)
 }
 
 
+extern "C" void
+__heap_thread_exit(void)
+{
+	// nothing to do
+}
+
+
 //	#pragma mark - Public API
 
 
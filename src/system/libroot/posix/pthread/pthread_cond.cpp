@@ -51,6 +51,14 @@ pthread_cond_destroy(pthread_cond_t* cond)
 }
 
 
+/*!	The condition variable's lock field is used as a sequence counter that is
+	incremented on every signal. A waiter remembers its value before unlocking
+	the mutex, and only blocks in the kernel as long as it is unchanged, so it
+	cannot miss a signal that arrives in between. waiter_count lets signalling
+	a condition variable that no one waits on skip the kernel entirely.
+	A broadcast may move the waiters over to the mutex instead of waking them
+	up; the kernel then hands the mutex over to them one after the other.
+*/
 static status_t
 cond_wait(pthread_cond_t* cond, pthread_mutex_t* mutex, bigtime_t timeout)
 {
@@ -65,31 +73,43 @@ cond_wait(pthread_cond_t* cond, pthread_mutex_t* mutex, bigtime_t timeout)
 	}
 
 	cond->mutex = mutex;
-	cond->waiter_count++;
+	atomic_add((int32*)&cond->waiter_count, 1);
 
-	// make sure the user mutex we use for blocking is locked
-	atomic_or((int32*)&cond->lock, B_USER_MUTEX_LOCKED);
+	int32 sequence = atomic_get((int32*)&cond->lock);
 
-	// atomically unlock the mutex and start waiting on the user mutex
+	// unlock the mutex, regardless of its recursion count
 	mutex->owner = -1;
 	mutex->owner_count = 0;
 
-	status_t status = _kern_mutex_switch_lock((int32*)&mutex->lock,
-		(int32*)&cond->lock, "pthread condition",
+	int32 oldValue = atomic_and((int32*)&mutex->lock,
+		~(int32)B_USER_MUTEX_LOCKED);
+	if ((oldValue & B_USER_MUTEX_WAITING) != 0)
+		_kern_mutex_unlock((int32*)&mutex->lock, 0);
+
+	// wait for the sequence to change
+	status_t status = _kern_address_wait((int32*)&cond->lock, sequence,
+		B_ADDRESS_WAIT_ALL_BITS,
 		timeout == B_INFINITE_TIMEOUT ? 0 : B_ABSOLUTE_REAL_TIME_TIMEOUT,
 		timeout);
 
-	if (status == B_INTERRUPTED) {
-		// EINTR is not an allowed return value. We either have to restart
-		// waiting -- which we can't atomically -- or return a spurious 0.
+	if (status == B_ADDRESS_WAIT_MUTEX_LOCKED) {
+		// we've been requeued to the mutex, and already own it
+		mutex->owner = find_thread(NULL);
+		mutex->owner_count = 1;
 		status = 0;
+	} else {
+		if (status == B_INTERRUPTED || status == B_WOULD_BLOCK) {
+			// EINTR is not an allowed return value. We either have to restart
+			// waiting -- which we can't atomically -- or return a spurious 0.
+			// B_WOULD_BLOCK means we've been signalled before we could block.
+			status = 0;
+		}
+
+		pthread_mutex_lock(mutex);
 	}
 
-	pthread_mutex_lock(mutex);
-
-	cond->waiter_count--;
 	// If there are no more waiters, we can change mutexes.
-	if (cond->waiter_count == 0)
+	if (atomic_add((int32*)&cond->waiter_count, -1) == 1)
 		cond->mutex = NULL;
 
 	return status;
@@ -99,12 +119,27 @@ cond_wait(pthread_cond_t* cond, pthread_mutex_t* mutex, bigtime_t timeout)
 static inline void
 cond_signal(pthread_cond_t* cond, bool broadcast)
 {
-	if (cond->waiter_count == 0)
+	if (atomic_get((int32*)&cond->waiter_count) == 0)
 		return;
 
-	// release the condition lock
-	_kern_mutex_unlock((int32*)&cond->lock,
-		broadcast ? B_USER_MUTEX_UNBLOCK_ALL : 0);
+	// advance the sequence
+	int32 sequence = atomic_add((int32*)&cond->lock, 1) + 1;
+
+	// All waiters of a broadcast would just block on the mutex again, if we
+	// are holding it. Therefore, we only wake up one of them, and move the
+	// others over to the mutex, so that they are woken up one by one as it
+	// becomes available. cond->mutex can only change while we don't hold it.
+	pthread_mutex_t* mutex = cond->mutex;
+	if (broadcast && (cond->flags & COND_FLAG_SHARED) == 0 && mutex != NULL
+		&& mutex->owner == find_thread(NULL)
+		&& _kern_address_requeue((int32*)&cond->lock, sequence, 1,
+			(int32*)&mutex->lock, INT32_MAX) >= 0) {
+		return;
+	}
+
+	// wake up the waiters
+	_kern_address_wake((int32*)&cond->lock, broadcast ? INT32_MAX : 1,
+		B_ADDRESS_WAIT_ALL_BITS);
 }
 
 
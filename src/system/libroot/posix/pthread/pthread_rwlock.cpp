@@ -5,15 +5,9 @@
 
 #include <pthread.h>
 
-#include <new>
-
 #include <Debug.h>
 
-#include <AutoLocker.h>
-#include <libroot_lock.h>
 #include <syscalls.h>
-#include <user_thread.h>
-#include <util/DoublyLinkedList.h>
 
 #include "pthread_private.h"
 
@@ -22,25 +16,11 @@
 
 #define RWLOCK_FLAG_SHARED	0x01
 
+#define RWLOCK_WRITE_LOCKED	0x40000000
 
-struct Waiter : DoublyLinkedListLinkImpl<Waiter> {
-	Waiter(bool writer)
-		:
-		userThread(get_user_thread()),
-		thread(find_thread(NULL)),
-		writer(writer),
-		queued(false)
-	{
-	}
-
-	user_thread*	userThread;
-	thread_id		thread;
-	status_t		status;
-	bool			writer;
-	bool			queued;
-};
-
-typedef DoublyLinkedList<Waiter> WaiterList;
+// address wait bits of the waiters of a LocalRWLock
+#define RWLOCK_WAIT_READER	0x01
+#define RWLOCK_WAIT_WRITER	0x02
 
 
 struct SharedRWLock {
@@ -93,182 +73,166 @@ struct SharedRWLock {
 struct LocalRWLock {
 	uint32_t	flags;
 	int32_t		owner;
-	int32_t		lock_sem;
-	int32_t		lock_count;
-	int32_t		reader_count;
-	int32_t		writer_count;
-		// Note, that reader_count and writer_count are not used the same way.
-		// writer_count includes the write lock owner as well as waiting
-		// writers. reader_count includes read lock owners only.
-	WaiterList	waiters;
+	int32_t		state;
+		// the number of readers, or RWLOCK_WRITE_LOCKED
+	int32_t		sequence;
+		// changed whenever waiters need to check the state again
+	int32_t		reader_waiters;
+	int32_t		writer_waiters;
+		// Note, that reader_waiters and writer_waiters are not used the same
+		// way. writer_waiters includes all writers trying to get the lock,
+		// and keeps new readers from getting it in the meantime.
+		// reader_waiters only includes readers that are about to block.
 
 	status_t Init()
 	{
 		flags = 0;
 		owner = -1;
-		lock_sem = create_sem(0, "pthread rwlock");
-		lock_count = 1;
-		reader_count = 0;
-		writer_count = 0;
-		new(&waiters) WaiterList;
+		state = 0;
+		sequence = 0;
+		reader_waiters = 0;
+		writer_waiters = 0;
 
-		return lock_sem >= 0 ? B_OK : EAGAIN;
+		return B_OK;
 	}
 
 	status_t Destroy()
 	{
-		if (lock_sem < 0)
-			return B_BAD_VALUE;
-		return delete_sem(lock_sem) == B_OK ? B_OK : B_BAD_VALUE;
-	}
-
-	bool StructureLock()
-	{
-		if (atomic_add((int32*)&lock_count, -1) <= 0)
-			acquire_sem(lock_sem);
-		return true;
+		return B_OK;
 	}
 
-	void StructureUnlock()
+	status_t ReadLock(bigtime_t timeout)
 	{
-		if (atomic_add((int32*)&lock_count, 1) < 0)
-			release_sem(lock_sem);
+		while (true) {
+			if (_TryReadLock())
+				return B_OK;
+
+			if (timeout == 0)
+				return B_TIMED_OUT;
+
+			// Announce ourselves before checking again, so that whoever
+			// unlocks in the meantime changes the sequence and wakes us up.
+			int32 sequence = atomic_get((int32*)&this->sequence);
+			atomic_add((int32*)&reader_waiters, 1);
+
+			status_t error = B_OK;
+			bool locked = _TryReadLock();
+			if (!locked)
+				error = _Wait(sequence, RWLOCK_WAIT_READER, timeout);
+
+			atomic_add((int32*)&reader_waiters, -1);
+
+			if (locked)
+				return B_OK;
+			if (error != B_OK && error != B_WOULD_BLOCK
+				&& error != B_INTERRUPTED) {
+				return error;
+			}
+		}
 	}
 
-	status_t ReadLock(bigtime_t timeout)
+	status_t WriteLock(bigtime_t timeout)
 	{
-		Locker locker(this);
-
-		if (writer_count == 0) {
-			reader_count++;
+		if (_TryWriteLock()) {
+			owner = find_thread(NULL);
 			return B_OK;
 		}
 
-		return _Wait(false, timeout);
-	}
+		if (timeout == 0)
+			return B_TIMED_OUT;
 
-	status_t WriteLock(bigtime_t timeout)
-	{
-		Locker locker(this);
+		atomic_add((int32*)&writer_waiters, 1);
 
-		if (reader_count == 0 && writer_count == 0) {
-			writer_count++;
+		status_t error;
+		while (true) {
+			int32 sequence = atomic_get((int32*)&this->sequence);
+			if (_TryWriteLock()) {
+				error = B_OK;
+				break;
+			}
+
+			error = _Wait(sequence, RWLOCK_WAIT_WRITER, timeout);
+			if (error != B_OK && error != B_WOULD_BLOCK
+				&& error != B_INTERRUPTED) {
+				break;
+			}
+		}
+
+		atomic_add((int32*)&writer_waiters, -1);
+
+		if (error == B_OK) {
 			owner = find_thread(NULL);
 			return B_OK;
 		}
 
-		return _Wait(true, timeout);
+		// We might have kept readers from getting the lock, or might have
+		// been woken up instead of another writer.
+		if (atomic_get((int32*)&state) != RWLOCK_WRITE_LOCKED)
+			_WakeWaiters();
+
+		return error;
 	}
 
 	status_t Unlock()
 	{
-		Locker locker(this);
-
 		if (find_thread(NULL) == owner) {
-			writer_count--;
 			owner = -1;
-		} else
-			reader_count--;
+			atomic_set((int32*)&state, 0);
+		} else if (atomic_add((int32*)&state, -1) != 1) {
+			// there are still other readers
+			return B_OK;
+		}
 
-		_Unblock();
+		_WakeWaiters();
 
 		return B_OK;
 	}
 
 private:
-	status_t _Wait(bool writer, bigtime_t timeout)
+	bool _TryReadLock()
 	{
-		if (timeout == 0)
-			return B_TIMED_OUT;
-
-		Waiter waiter(writer);
-		waiters.Add(&waiter);
-		waiter.queued = true;
-		waiter.userThread->wait_status = 1;
-
-		if (writer)
-			writer_count++;
-
-		StructureUnlock();
-		status_t error = _kern_block_thread(
-			timeout >= 0 ? B_ABSOLUTE_REAL_TIME_TIMEOUT : 0, timeout);
-		StructureLock();
-
-		if (!waiter.queued)
-			return waiter.status;
-
-		// we're still queued, which means an error (timeout, interrupt)
-		// occurred
-		waiters.Remove(&waiter);
-
-		if (writer)
-			writer_count--;
-
-		_Unblock();
+		while (true) {
+			int32 oldState = atomic_get((int32*)&state);
+			if (oldState == RWLOCK_WRITE_LOCKED
+				|| atomic_get((int32*)&writer_waiters) > 0) {
+				return false;
+			}
 
-		return error;
+			if (atomic_test_and_set((int32*)&state, oldState + 1, oldState)
+					== oldState) {
+				return true;
+			}
+		}
 	}
 
-	void _Unblock()
+	bool _TryWriteLock()
 	{
-		// Check whether there any waiting threads at all and whether anyone
-		// has the write lock
-		Waiter* waiter = waiters.Head();
-		if (waiter == NULL || owner >= 0)
-			return;
+		return atomic_test_and_set((int32*)&state, RWLOCK_WRITE_LOCKED, 0)
+			== 0;
+	}
 
-		// writer at head of queue?
-		if (waiter->writer) {
-			if (reader_count == 0) {
-				waiter->status = B_OK;
-				waiter->queued = false;
-				waiters.Remove(waiter);
-				owner = waiter->thread;
+	status_t _Wait(int32 sequence, uint32 waiterType, bigtime_t timeout)
+	{
+		return _kern_address_wait((int32*)&this->sequence, sequence,
+			waiterType, timeout >= 0 ? B_ABSOLUTE_REAL_TIME_TIMEOUT : 0,
+			timeout);
+	}
 
-				if (waiter->userThread->wait_status > 0)
-					_kern_unblock_thread(waiter->thread, B_OK);
-			}
+	void _WakeWaiters()
+	{
+		// writers go first -- as long as there are any, readers have to wait
+		if (atomic_get((int32*)&writer_waiters) > 0) {
+			atomic_add((int32*)&sequence, 1);
+			_kern_address_wake((int32*)&sequence, 1, RWLOCK_WAIT_WRITER);
 			return;
 		}
 
-		// wake up one or more readers -- we unblock more than one reader at
-		// a time to save trips to the kernel
-		while (!waiters.IsEmpty() && !waiters.Head()->writer) {
-			static const int kMaxReaderUnblockCount = 128;
-			thread_id readers[kMaxReaderUnblockCount];
-			int readerCount = 0;
-
-			while (readerCount < kMaxReaderUnblockCount
-					&& (waiter = waiters.Head()) != NULL
-					&& !waiter->writer) {
-				waiter->status = B_OK;
-				waiter->queued = false;
-				waiters.Remove(waiter);
-
-				if (waiter->userThread->wait_status > 0) {
-					readers[readerCount++] = waiter->thread;
-					reader_count++;
-				}
-			}
-
-			if (readerCount > 0)
-				_kern_unblock_threads(readers, readerCount, B_OK);
+		if (atomic_get((int32*)&reader_waiters) > 0) {
+			atomic_add((int32*)&sequence, 1);
+			_kern_address_wake((int32*)&sequence, INT32_MAX,
+				RWLOCK_WAIT_READER);
 		}
 	}
-
-
-	struct Locking {
-		inline bool Lock(LocalRWLock* lockable)
-		{
-			return lockable->StructureLock();
-		}
-
-		inline void Unlock(LocalRWLock* lockable)
-		{
-			lockable->StructureUnlock();
-		}
-	};
-	typedef AutoLocker<LocalRWLock, Locking> Locker;
 };
 
 
@@ -0,0 +1,695 @@
+/*
+ * Copyright 2013, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include <spawn.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <image.h>
+#include <OS.h>
+
+#include <libroot_private.h>
+#include <syscalls.h>
+#include <umask.h>
+
+
+enum {
+	SPAWN_ACTION_OPEN,
+	SPAWN_ACTION_CLOSE,
+	SPAWN_ACTION_DUP2
+};
+
+struct spawn_file_action {
+	int			type;
+	int			fd;
+	int			newFD;
+	char*		path;
+	int			openFlags;
+	mode_t		mode;
+};
+
+struct _posix_spawn_file_actions {
+	int					count;
+	int					capacity;
+	spawn_file_action*	actions;
+};
+
+struct _posix_spawnattr {
+	short		flags;
+	pid_t		processGroup;
+	sigset_t	signalDefault;
+	sigset_t	signalMask;
+};
+
+
+static const mode_t kDefaultUmask = 022;
+	// the umask a team started via load_image() gets, see umask.c
+
+
+static spawn_file_action*
+add_file_action(posix_spawn_file_actions_t* _fileActions, int type, int fd)
+{
+	if (_fileActions == NULL || *_fileActions == NULL) {
+		errno = EINVAL;
+		return NULL;
+	}
+	if (fd < 0) {
+		errno = EBADF;
+		return NULL;
+	}
+
+	_posix_spawn_file_actions* fileActions = *_fileActions;
+	if (fileActions->count == fileActions->capacity) {
+		int capacity = fileActions->capacity > 0
+			? fileActions->capacity * 2 : 4;
+		spawn_file_action* actions = (spawn_file_action*)realloc(
+			fileActions->actions, capacity * sizeof(spawn_file_action));
+		if (actions == NULL) {
+			errno = ENOMEM;
+			return NULL;
+		}
+
+		fileActions->actions = actions;
+		fileActions->capacity = capacity;
+	}
+
+	spawn_file_action* action = &fileActions->actions[fileActions->count++];
+	memset(action, 0, sizeof(spawn_file_action));
+	action->type = type;
+	action->fd = fd;
+	return action;
+}
+
+
+/*!	Returns whether the child can be created via load_image(), that is
+	without duplicating the address space of this team first.
+	This is only possible when the child doesn't need to do anything before
+	executing the program, and when the new team, which starts with the
+	default umask, signal mask, and signal handlers, would not be any
+	different from one started by exec().
+*/
+static bool
+can_load_image(const posix_spawn_file_actions_t* fileActions,
+	const posix_spawnattr_t* attributes, char* const argv[],
+	char* const environment[])
+{
+	if (argv[0] == NULL || environment == NULL)
+		return false;
+
+	if (fileActions != NULL && *fileActions != NULL
+		&& (*fileActions)->count > 0) {
+		return false;
+	}
+	if (attributes != NULL && *attributes != NULL
+		&& (*attributes)->flags != 0) {
+		return false;
+	}
+
+	if (__gUmask != kDefaultUmask)
+		return false;
+
+	sigset_t signalMask;
+	if (sigprocmask(SIG_BLOCK, NULL, &signalMask) != 0 || signalMask != 0)
+		return false;
+
+	// ignored signals stay ignored across exec()
+	for (int signal = 1; signal <= __MAX_SIGNO; signal++) {
+		struct sigaction action;
+		if (sigaction(signal, NULL, &action) == 0
+			&& action.sa_handler == SIG_IGN) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
+/*!	Looks up the leaf name \a file in the PATH the same way execvp() does,
+	and stores the path of the executable found in \a path.
+*/
+static status_t
+find_in_path(const char* file, char* path)
+{
+	const char* paths = getenv("PATH");
+	if (paths == NULL)
+		return B_ENTRY_NOT_FOUND;
+
+	int fileNameLength = strlen(file);
+
+	const char* pathEnd = paths - 1;
+	while (pathEnd != NULL) {
+		paths = pathEnd + 1;
+		pathEnd = strchr(paths, ':');
+		int pathLength = pathEnd != NULL ? pathEnd - paths : strlen(paths);
+
+		if (pathLength == 0
+			|| pathLength + 1 + fileNameLength >= B_PATH_NAME_LENGTH) {
+			continue;
+		}
+
+		memcpy(path, paths, pathLength);
+		path[pathLength] = '\0';
+
+		if (path[pathLength - 1] != '/')
+			strcat(path, "/");
+		strcat(path, file);
+
+		struct stat st;
+		if (stat(path, &st) == 0 && S_ISREG(st.st_mode)
+			&& access(path, X_OK) == 0) {
+			return B_OK;
+		}
+	}
+
+	return B_ENTRY_NOT_FOUND;
+}
+
+
+/*!	Lets the kernel create a new team for the executable at \a path, passing
+	it \a argv unchanged, like exec() would do. Scripts are started through
+	their interpreter; when \a useDefaultInterpreter is \c true, files that
+	are no executables are run by the shell, as execvp() does.
+	The team is started already when this function returns successfully.
+*/
+static thread_id
+load_image_at(const char* path, char* const argv[], char* const environment[],
+	bool useDefaultInterpreter)
+{
+	int32 argCount = 0;
+	while (argv[argCount] != NULL)
+		argCount++;
+	int32 envCount = 0;
+	while (environment[envCount] != NULL)
+		envCount++;
+
+	// test validity of executable + support for scripts
+	char invoker[B_FILE_NAME_LENGTH];
+	status_t status = __test_executable(path, invoker);
+	if (status == B_NOT_AN_EXECUTABLE && useDefaultInterpreter) {
+		strcpy(invoker, "/bin/sh");
+		status = B_OK;
+	}
+	if (status != B_OK)
+		return status;
+
+	char** newArgs = NULL;
+	if (invoker[0] != '\0') {
+		status = __parse_invoke_line(invoker, &newArgs, &argv, &argCount,
+			path);
+		if (status != B_OK)
+			return status;
+
+		path = newArgs[0];
+	}
+
+	char** flatArgs = NULL;
+	size_t flatArgsSize;
+	status = __flatten_process_args(argv, argCount, environment, envCount,
+		&flatArgs, &flatArgsSize);
+
+	thread_id thread = status;
+	if (status == B_OK) {
+		thread = _kern_load_image_etc(path, flatArgs, flatArgsSize, argCount,
+			envCount, B_NORMAL_PRIORITY, B_WAIT_TILL_LOADED, -1, 0);
+		free(flatArgs);
+	}
+
+	free(newArgs);
+
+	if (thread >= 0)
+		resume_thread(thread);
+	return thread;
+}
+
+
+/*!	Moves \a fd out of the way, if it is about to be replaced by one of the
+	file actions, so that it stays usable until the program is executed.
+*/
+static int
+protect_error_pipe(const _posix_spawn_file_actions* fileActions, int fd)
+{
+	for (int i = 0; i < fileActions->count; i++) {
+		const spawn_file_action& action = fileActions->actions[i];
+		int target = action.type == SPAWN_ACTION_DUP2
+			? action.newFD : action.fd;
+		if (target != fd)
+			continue;
+
+		int newFD = fcntl(fd, F_DUPFD, fd + 1);
+		if (newFD < 0)
+			return fd;
+
+		fcntl(newFD, F_SETFD, FD_CLOEXEC);
+		close(fd);
+		return protect_error_pipe(fileActions, newFD);
+	}
+
+	return fd;
+}
+
+
+static int
+apply_file_actions(const _posix_spawn_file_actions* fileActions)
+{
+	for (int i = 0; i < fileActions->count; i++) {
+		const spawn_file_action& action = fileActions->actions[i];
+
+		switch (action.type) {
+			case SPAWN_ACTION_OPEN:
+			{
+				int fd = open(action.path, action.openFlags, action.mode);
+				if (fd < 0)
+					return errno;
+				if (fd != action.fd) {
+					if (dup2(fd, action.fd) < 0)
+						return errno;
+					close(fd);
+				}
+				break;
+			}
+
+			case SPAWN_ACTION_CLOSE:
+				if (close(action.fd) != 0)
+					return errno;
+				break;
+
+			case SPAWN_ACTION_DUP2:
+				if (action.fd == action.newFD) {
+					// the descriptor is inherited in this case
+					int flags = fcntl(action.fd, F_GETFD);
+					if (flags < 0
+						|| fcntl(action.fd, F_SETFD, flags & ~FD_CLOEXEC)
+							< 0) {
+						return errno;
+					}
+				} else if (dup2(action.fd, action.newFD) < 0)
+					return errno;
+				break;
+		}
+	}
+
+	return 0;
+}
+
+
+static int
+apply_attributes(const _posix_spawnattr* attributes)
+{
+	if ((attributes->flags & POSIX_SPAWN_SETSIGDEF) != 0) {
+		struct sigaction action;
+		memset(&action, 0, sizeof(action));
+		action.sa_handler = SIG_DFL;
+
+		for (int signal = 1; signal <= __MAX_SIGNO; signal++) {
+			if (sigismember(&attributes->signalDefault, signal) == 1
+				&& sigaction(signal, &action, NULL) != 0) {
+				return errno;
+			}
+		}
+	}
+
+	if ((attributes->flags & POSIX_SPAWN_SETSIGMASK) != 0
+		&& sigprocmask(SIG_SETMASK, &attributes->signalMask, NULL) != 0) {
+		return errno;
+	}
+
+	if ((attributes->flags & POSIX_SPAWN_SETPGROUP) != 0
+		&& setpgid(0, attributes->processGroup) != 0) {
+		return errno;
+	}
+
+	if ((attributes->flags & POSIX_SPAWN_RESETIDS) != 0) {
+		if (setegid(getgid()) != 0 || seteuid(getuid()) != 0)
+			return errno;
+	}
+
+	return 0;
+}
+
+
+static int
+fork_and_exec(pid_t* _pid, const char* path, bool searchPath,
+	const posix_spawn_file_actions_t* fileActions,
+	const posix_spawnattr_t* attributes, char* const argv[],
+	char* const environment[])
+{
+	// The child reports the error, if it fails to execute the program, back
+	// through this pipe. On success it's closed by exec().
+	int errorPipe[2];
+	if (pipe(errorPipe) != 0)
+		return errno;
+
+	fcntl(errorPipe[0], F_SETFD, FD_CLOEXEC);
+	fcntl(errorPipe[1], F_SETFD, FD_CLOEXEC);
+
+	pid_t child = fork();
+	if (child < 0) {
+		int error = errno;
+		close(errorPipe[0]);
+		close(errorPipe[1]);
+		return error;
+	}
+
+	if (child == 0) {
+		// we are the child
+		close(errorPipe[0]);
+
+		int error = 0;
+		if (attributes != NULL && *attributes != NULL)
+			error = apply_attributes(*attributes);
+
+		if (error == 0 && fileActions != NULL && *fileActions != NULL) {
+			errorPipe[1] = protect_error_pipe(*fileActions, errorPipe[1]);
+			error = apply_file_actions(*fileActions);
+		}
+
+		if (error == 0) {
+			if (searchPath) {
+				environ = (char**)environment;
+				execvp(path, argv);
+			} else
+				execve(path, argv, environment);
+
+			error = errno;
+		}
+
+		write(errorPipe[1], &error, sizeof(error));
+		_exit(127);
+	}
+
+	// we are the parent
+	close(errorPipe[1]);
+
+	int error;
+	ssize_t bytesRead;
+	while ((bytesRead = read(errorPipe[0], &error, sizeof(error))) < 0
+		&& errno == B_INTERRUPTED) {
+	}
+
+	close(errorPipe[0]);
+
+	if (bytesRead == sizeof(error)) {
+		// the child failed to execute the program and is gone already
+		while (waitpid(child, NULL, 0) < 0 && errno == B_INTERRUPTED) {
+		}
+		return error;
+	}
+
+	if (_pid != NULL)
+		*_pid = child;
+	return 0;
+}
+
+
+static int
+do_posix_spawn(pid_t* _pid, const char* path, bool searchPath,
+	const posix_spawn_file_actions_t* fileActions,
+	const posix_spawnattr_t* attributes, char* const argv[],
+	char* const environment[])
+{
+	if (path == NULL || argv == NULL)
+		return EINVAL;
+
+	// In the common case, let the kernel create the team directly, instead
+	// of copying our whole address space just to throw it away again.
+	if (can_load_image(fileActions, attributes, argv, environment)) {
+		char pathBuffer[B_PATH_NAME_LENGTH];
+		if (searchPath && strchr(path, '/') == NULL) {
+			status_t status = find_in_path(path, pathBuffer);
+			if (status != B_OK)
+				return status;
+
+			path = pathBuffer;
+		}
+
+		thread_id thread = load_image_at(path, argv, environment,
+			searchPath);
+		if (thread < 0)
+			return thread;
+
+		if (_pid != NULL)
+			*_pid = thread;
+		return 0;
+	}
+
+	return fork_and_exec(_pid, path, searchPath, fileActions, attributes,
+		argv, environment);
+}
+
+
+//	#pragma mark -
+
+
+int
+posix_spawn(pid_t* pid, const char* path,
+	const posix_spawn_file_actions_t* fileActions,
+	const posix_spawnattr_t* attributes, char* const argv[],
+	char* const environment[])
+{
+	return do_posix_spawn(pid, path, false, fileActions, attributes, argv,
+		environment);
+}
+
+
+int
+posix_spawnp(pid_t* pid, const char* file,
+	const posix_spawn_file_actions_t* fileActions,
+	const posix_spawnattr_t* attributes, char* const argv[],
+	char* const environment[])
+{
+	return do_posix_spawn(pid, file, true, fileActions, attributes, argv,
+		environment);
+}
+
+
+//	#pragma mark - file actions
+
+
+int
+posix_spawn_file_actions_init(posix_spawn_file_actions_t* _fileActions)
+{
+	_posix_spawn_file_actions* fileActions
+		= (_posix_spawn_file_actions*)malloc(
+			sizeof(_posix_spawn_file_actions));
+	if (fileActions == NULL)
+		return ENOMEM;
+
+	fileActions->count = 0;
+	fileActions->capacity = 0;
+	fileActions->actions = NULL;
+
+	*_fileActions = fileActions;
+	return 0;
+}
+
+
+int
+posix_spawn_file_actions_destroy(posix_spawn_file_actions_t* _fileActions)
+{
+	if (_fileActions == NULL || *_fileActions == NULL)
+		return EINVAL;
+
+	_posix_spawn_file_actions* fileActions = *_fileActions;
+	for (int i = 0; i < fileActions->count; i++)
+		free(fileActions->actions[i].path);
+
+	free(fileActions->actions);
+	free(fileActions);
+	*_fileActions = NULL;
+	return 0;
+}
+
+
+int
+posix_spawn_file_actions_addopen(posix_spawn_file_actions_t* fileActions,
+	int fd, const char* path, int openFlags, mode_t mode)
+{
+	if (path == NULL)
+		return EINVAL;
+
+	char* pathCopy = strdup(path);
+	if (pathCopy == NULL)
+		return ENOMEM;
+
+	spawn_file_action* action = add_file_action(fileActions,
+		SPAWN_ACTION_OPEN, fd);
+	if (action == NULL) {
+		free(pathCopy);
+		return errno;
+	}
+
+	action->path = pathCopy;
+	action->openFlags = openFlags;
+	action->mode = mode;
+	return 0;
+}
+
+
+int
+posix_spawn_file_actions_addclose(posix_spawn_file_actions_t* fileActions,
+	int fd)
+{
+	if (add_file_action(fileActions, SPAWN_ACTION_CLOSE, fd) == NULL)
+		return errno;
+
+	return 0;
+}
+
+
+int
+posix_spawn_file_actions_adddup2(posix_spawn_file_actions_t* fileActions,
+	int fd, int newFD)
+{
+	if (newFD < 0)
+		return EBADF;
+
+	spawn_file_action* action = add_file_action(fileActions,
+		SPAWN_ACTION_DUP2, fd);
+	if (action == NULL)
+		return errno;
+
+	action->newFD = newFD;
+	return 0;
+}
+
+
+//	#pragma mark - attributes
+
+
+int
+posix_spawnattr_init(posix_spawnattr_t* _attributes)
+{
+	_posix_spawnattr* attributes
+		= (_posix_spawnattr*)malloc(sizeof(_posix_spawnattr));
+	if (attributes == NULL)
+		return ENOMEM;
+
+	attributes->flags = 0;
+	attributes->processGroup = 0;
+	sigemptyset(&attributes->signalDefault);
+	sigemptyset(&attributes->signalMask);
+
+	*_attributes = attributes;
+	return 0;
+}
+
+
+int
+posix_spawnattr_destroy(posix_spawnattr_t* attributes)
+{
+	if (attributes == NULL || *attributes == NULL)
+		return EINVAL;
+
+	free(*attributes);
+	*attributes = NULL;
+	return 0;
+}
+
+
+int
+posix_spawnattr_getflags(const posix_spawnattr_t* attributes, short* flags)
+{
+	if (attributes == NULL || *attributes == NULL || flags == NULL)
+		return EINVAL;
+
+	*flags = (*attributes)->flags;
+	return 0;
+}
+
+
+int
+posix_spawnattr_setflags(posix_spawnattr_t* attributes, short flags)
+{
+	if (attributes == NULL || *attributes == NULL)
+		return EINVAL;
+
+	if ((flags & ~(POSIX_SPAWN_RESETIDS | POSIX_SPAWN_SETPGROUP
+			| POSIX_SPAWN_SETSIGDEF | POSIX_SPAWN_SETSIGMASK)) != 0) {
+		return EINVAL;
+	}
+
+	(*attributes)->flags = flags;
+	return 0;
+}
+
+
+int
+posix_spawnattr_getpgroup(const posix_spawnattr_t* attributes,
+	pid_t* processGroup)
+{
+	if (attributes == NULL || *attributes == NULL || processGroup == NULL)
+		return EINVAL;
+
+	*processGroup = (*attributes)->processGroup;
+	return 0;
+}
+
+
+int
+posix_spawnattr_setpgroup(posix_spawnattr_t* attributes, pid_t processGroup)
+{
+	if (attributes == NULL || *attributes == NULL)
+		return EINVAL;
+
+	(*attributes)->processGroup = processGroup;
+	return 0;
+}
+
+
+int
+posix_spawnattr_getsigdefault(const posix_spawnattr_t* attributes,
+	sigset_t* signals)
+{
+	if (attributes == NULL || *attributes == NULL || signals == NULL)
+		return EINVAL;
+
+	*signals = (*attributes)->signalDefault;
+	return 0;
+}
+
+
+int
+posix_spawnattr_setsigdefault(posix_spawnattr_t* attributes,
+	const sigset_t* signals)
+{
+	if (attributes == NULL || *attributes == NULL || signals == NULL)
+		return EINVAL;
+
+	(*attributes)->signalDefault = *signals;
+	return 0;
+}
+
+
+int
+posix_spawnattr_getsigmask(const posix_spawnattr_t* attributes,
+	sigset_t* signals)
+{
+	if (attributes == NULL || *attributes == NULL || signals == NULL)
+		return EINVAL;
+
+	*signals = (*attributes)->signalMask;
+	return 0;
+}
+
+
+int
+posix_spawnattr_setsigmask(posix_spawnattr_t* attributes,
+	const sigset_t* signals)
+{
+	if (attributes == NULL || *attributes == NULL || signals == NULL)
+		return EINVAL;
+
+	(*attributes)->signalMask = *signals;
+	return 0;
+}
@@ -224,6 +224,32 @@ assert_dynamic_loadable(image_t* image)
 }
 
 
+/*!	The GNU hash table consists of a header (bucket count, index of the first
+	hashed symbol, bloom filter size, and bloom filter shift), followed by the
+	bloom filter words, the buckets, and the hash chain values.
+*/
+static void
+parse_gnu_hash_table(image_t* image, uint32* table)
+{
+	uint32 bucketCount = table[0];
+	uint32 bloomSize = table[2];
+
+	// ignore broken tables, we'll just use the SysV hash table instead
+	if (bucketCount == 0 || bloomSize == 0
+		|| (bloomSize & (bloomSize - 1)) != 0) {
+		return;
+	}
+
+	image->gnu_hash_bucket_count = bucketCount;
+	image->gnu_hash_symbol_index = table[1];
+	image->gnu_hash_bloom_size = bloomSize;
+	image->gnu_hash_bloom_shift = table[3];
+	image->gnu_hash_bloom = table + 4;
+	image->gnu_hash_buckets = image->gnu_hash_bloom + bloomSize;
+	image->gnu_hash_chains = image->gnu_hash_buckets + bucketCount;
+}
+
+
 static bool
 parse_dynamic_segment(image_t* image)
 {
@@ -248,6 +274,10 @@ parse_dynamic_segment(image_t* image)
 				image->symhash
 					= (uint32*)(d[i].d_un.d_ptr + image->regions[0].delta);
 				break;
+			case DT_GNU_HASH:
+				parse_gnu_hash_table(image,
+					(uint32*)(d[i].d_un.d_ptr + image->regions[0].delta));
+				break;
 			case DT_STRTAB:
 				image->strtab
 					= (char*)(d[i].d_un.d_ptr + image->regions[0].delta);
@@ -335,7 +365,9 @@ parse_dynamic_segment(image_t* image)
 		}
 	}
 
-	// lets make sure we found all the required sections
+	// lets make sure we found all the required sections -- the SysV hash
+	// table is needed even if there is a GNU one, since only the former
+	// tells the number of symbols
 	if (!image->symhash || !image->syms || !image->strtab)
 		return false;
 
@@ -63,6 +63,60 @@ elf_hash(const char* _name)
 }
 
 
+uint32
+elf_gnu_hash(const char* _name)
+{
+	const uint8* name = (const uint8*)_name;
+
+	uint32 hash = 5381;
+	while (*name)
+		hash = hash * 33 + *name++;
+
+	return hash;
+}
+
+
+/*!	Returns the index of the first symbol in \a image that may match
+	\a lookupInfo, or \c STN_UNDEF, if the image doesn't define the symbol.
+	Uses the GNU hash table, if the image has one, whose bloom filter allows
+	to skip most images not defining the symbol without even looking at their
+	hash chains.
+*/
+static inline uint32
+first_symbol_candidate(image_t* image, const SymbolLookupInfo& lookupInfo)
+{
+	if (image->gnu_hash_buckets == NULL)
+		return HASHBUCKETS(image)[lookupInfo.hash % HASHTABSIZE(image)];
+
+	uint32 hash = lookupInfo.gnuHash;
+	uint32 word = image->gnu_hash_bloom[(hash / 32)
+		& (image->gnu_hash_bloom_size - 1)];
+	uint32 mask = (1U << (hash % 32))
+		| (1U << ((hash >> image->gnu_hash_bloom_shift) % 32));
+	if ((word & mask) != mask)
+		return STN_UNDEF;
+
+	return image->gnu_hash_buckets[hash % image->gnu_hash_bucket_count];
+}
+
+
+static inline uint32
+next_symbol_candidate(image_t* image, uint32 index)
+{
+	if (image->gnu_hash_buckets == NULL)
+		return HASHCHAINS(image)[index];
+
+	// the symbols of a GNU hash chain are consecutive, the lowest bit of
+	// the hash value marks the last one
+	if ((image->gnu_hash_chains[index - image->gnu_hash_symbol_index] & 1)
+			!= 0) {
+		return STN_UNDEF;
+	}
+
+	return index + 1;
+}
+
+
 void
 patch_defined_symbol(image_t* image, const char* name, void** symbol,
 	int32* type)
@@ -102,10 +156,16 @@ find_symbol(image_t* image, const SymbolLookupInfo& lookupInfo)
 	Elf32_Sym* versionedSymbol = NULL;
 	uint32 versionedSymbolCount = 0;
 
-	uint32 bucket = lookupInfo.hash % HASHTABSIZE(image);
+	for (uint32 i = first_symbol_candidate(image, lookupInfo); i != STN_UNDEF;
+			i = next_symbol_candidate(image, i)) {
+		// The GNU hash chain contains the full hash values (save for the
+		// lowest bit), which saves us most string comparisons.
+		if (image->gnu_hash_buckets != NULL
+			&& ((image->gnu_hash_chains[i - image->gnu_hash_symbol_index]
+				^ lookupInfo.gnuHash) >> 1) != 0) {
+			continue;
+		}
 
-	for (uint32 i = HASHBUCKETS(image)[bucket]; i != STN_UNDEF;
-			i = HASHCHAINS(image)[i]) {
 		Elf32_Sym* symbol = &image->syms[i];
 
 		if (symbol->st_shndx != SHN_UNDEF
@@ -0,0 +1,127 @@
+/*
+ * Copyright 2013, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+/*!	Measures how long it takes to load (and thus relocate) the given
+	libraries or add-ons, and how fast the runtime loader looks up symbols
+	that are defined in them, and ones that are not.
+
+	Loading a large library that hasn't been loaded before also loads and
+	relocates its dependencies; the first run therefore gives an idea of the
+	launch time of an application using it.
+*/
+
+
+#include <image.h>
+#include <OS.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+static const int kDefaultIterations = 10;
+static const int kLookupIterations = 10;
+static const int32 kMaxLookupSymbols = 1000;
+
+
+static void
+benchmark_lookups(image_id image)
+{
+	char name[B_OS_NAME_LENGTH * 4];
+	bigtime_t hitTime = 0;
+	bigtime_t missTime = 0;
+	int32 symbolCount;
+	int j;
+
+	// get_nth_image_symbol() has to iterate over all symbols up to the
+	// requested one, so we only use the first ones
+	for (symbolCount = 0; symbolCount < kMaxLookupSymbols; symbolCount++) {
+		int32 nameLength = sizeof(name) - 2;
+		void* location;
+		bigtime_t startTime;
+
+		if (get_nth_image_symbol(image, symbolCount, name, &nameLength, NULL,
+				NULL) != B_OK) {
+			break;
+		}
+
+		startTime = system_time();
+		for (j = 0; j < kLookupIterations; j++)
+			get_image_symbol(image, name, B_SYMBOL_TYPE_ANY, &location);
+		hitTime += system_time() - startTime;
+
+		// a similar name that most likely doesn't exist
+		strcat(name, "_x");
+
+		startTime = system_time();
+		for (j = 0; j < kLookupIterations; j++)
+			get_image_symbol(image, name, B_SYMBOL_TYPE_ANY, &location);
+		missTime += system_time() - startTime;
+	}
+
+	if (symbolCount == 0)
+		return;
+
+	printf("  %ld symbols, lookup: %.3f us (hit), %.3f us (miss)\n",
+		symbolCount, (double)hitTime / symbolCount / kLookupIterations,
+		(double)missTime / symbolCount / kLookupIterations);
+}
+
+
+static void
+benchmark_load(const char* path, int iterations)
+{
+	bigtime_t firstTime = 0;
+	bigtime_t totalTime = 0;
+	int i;
+
+	printf("%s:\n", path);
+
+	for (i = 0; i < iterations; i++) {
+		bigtime_t startTime = system_time();
+		image_id image = load_add_on(path);
+		bigtime_t time = system_time() - startTime;
+
+		if (image < 0) {
+			fprintf(stderr, "  failed to load: %s\n", strerror(image));
+			return;
+		}
+
+		if (i == 0) {
+			firstTime = time;
+			benchmark_lookups(image);
+		} else
+			totalTime += time;
+
+		unload_add_on(image);
+	}
+
+	printf("  load and relocation: %lld us (first), %lld us (average)\n",
+		firstTime, iterations > 1 ? totalTime / (iterations - 1) : firstTime);
+}
+
+
+int
+main(int argc, char** argv)
+{
+	int iterations = kDefaultIterations;
+	int i = 1;
+
+	if (argc > 2 && !strcmp(argv[1], "-i")) {
+		iterations = atoi(argv[2]);
+		i = 3;
+	}
+
+	if (i >= argc || iterations < 1) {
+		fprintf(stderr, "usage: %s [-i <iterations>] <library> ...\n",
+			argv[0]);
+		return 1;
+	}
+
+	for (; i < argc; i++)
+		benchmark_load(argv[i], iterations);
+
+	return 0;
+}
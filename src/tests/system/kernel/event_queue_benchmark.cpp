@@ -0,0 +1,240 @@
+/*
+ * Copyright 2013, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Compares the cost of waiting for one ready pipe out of many with poll()
+	and with an event queue. With poll(), all pipes have to be passed to (and
+	selected by) the kernel on every call, while they are only added to the
+	event queue once.
+*/
+
+
+#include <errno.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <OS.h>
+
+#include <event_queue_private.h>
+
+
+static const int kPipeCounts[] = { 100, 1000, 10000 };
+static const int kDefaultRounds = 1000;
+
+
+struct pipe_set {
+	int		count;
+	int*	readFDs;
+	int*	writeFDs;
+};
+
+
+static bool
+create_pipes(pipe_set& pipes, int count)
+{
+	pipes.count = 0;
+	pipes.readFDs = (int*)malloc(count * sizeof(int));
+	pipes.writeFDs = (int*)malloc(count * sizeof(int));
+	if (pipes.readFDs == NULL || pipes.writeFDs == NULL)
+		return false;
+
+	for (int i = 0; i < count; i++) {
+		int fds[2];
+		if (pipe(fds) != 0) {
+			fprintf(stderr, "creating pipe %d failed: %s\n", i,
+				strerror(errno));
+			return false;
+		}
+
+		pipes.readFDs[i] = fds[0];
+		pipes.writeFDs[i] = fds[1];
+		pipes.count++;
+	}
+
+	return true;
+}
+
+
+static void
+delete_pipes(pipe_set& pipes)
+{
+	for (int i = 0; i < pipes.count; i++) {
+		close(pipes.readFDs[i]);
+		close(pipes.writeFDs[i]);
+	}
+
+	free(pipes.readFDs);
+	free(pipes.writeFDs);
+}
+
+
+static bigtime_t
+benchmark_poll(const pipe_set& pipes, int rounds)
+{
+	struct pollfd* pollFDs = (struct pollfd*)malloc(
+		pipes.count * sizeof(struct pollfd));
+	if (pollFDs == NULL)
+		return -1;
+
+	for (int i = 0; i < pipes.count; i++) {
+		pollFDs[i].fd = pipes.readFDs[i];
+		pollFDs[i].events = POLLIN;
+	}
+
+	bigtime_t time = 0;
+
+	for (int round = 0; round < rounds; round++) {
+		int index = rand() % pipes.count;
+		char buffer = 'x';
+		write(pipes.writeFDs[index], &buffer, 1);
+
+		bigtime_t start = system_time();
+
+		int count = poll(pollFDs, pipes.count, -1);
+
+		// find the ready pipe, as a real server would have to
+		int ready = -1;
+		for (int i = 0; i < pipes.count && count > 0; i++) {
+			if ((pollFDs[i].revents & POLLIN) != 0) {
+				ready = i;
+				break;
+			}
+		}
+
+		time += system_time() - start;
+
+		if (ready != index) {
+			fprintf(stderr, "poll() reported pipe %d instead of %d\n", ready,
+				index);
+			free(pollFDs);
+			return -1;
+		}
+
+		read(pipes.readFDs[index], &buffer, 1);
+	}
+
+	free(pollFDs);
+	return time;
+}
+
+
+static bigtime_t
+benchmark_event_queue(const pipe_set& pipes, int rounds)
+{
+	int queue = event_queue_create(0);
+	if (queue < 0) {
+		fprintf(stderr, "creating the event queue failed: %s\n",
+			strerror(queue));
+		return -1;
+	}
+
+	event_wait_info* infos = (event_wait_info*)malloc(
+		pipes.count * sizeof(event_wait_info));
+	if (infos == NULL) {
+		close(queue);
+		return -1;
+	}
+
+	for (int i = 0; i < pipes.count; i++) {
+		infos[i].object = pipes.readFDs[i];
+		infos[i].type = B_OBJECT_TYPE_FD;
+		infos[i].events = B_EVENT_READ;
+		infos[i].user_data = (void*)(addr_t)i;
+	}
+
+	// the kernel accepts only a limited number of objects per call
+	for (int i = 0; i < pipes.count; i += 1000) {
+		int count = min_c(pipes.count - i, 1000);
+		status_t status = event_queue_select(queue, infos + i, count);
+		if (status != B_OK) {
+			fprintf(stderr, "adding the pipes to the event queue failed: "
+				"%s\n", strerror(status));
+			free(infos);
+			close(queue);
+			return -1;
+		}
+	}
+
+	bigtime_t time = 0;
+
+	for (int round = 0; round < rounds; round++) {
+		int index = rand() % pipes.count;
+		char buffer = 'x';
+		write(pipes.writeFDs[index], &buffer, 1);
+
+		bigtime_t start = system_time();
+
+		event_wait_info info;
+		ssize_t count = event_queue_wait(queue, &info, 1, 0, 0);
+
+		time += system_time() - start;
+
+		if (count != 1 || (int)(addr_t)info.user_data != index) {
+			fprintf(stderr, "event queue reported %s instead of pipe %d\n",
+				count < 0 ? strerror(count) : "a wrong pipe", index);
+			free(infos);
+			close(queue);
+			return -1;
+		}
+
+		read(pipes.readFDs[index], &buffer, 1);
+	}
+
+	free(infos);
+	close(queue);
+	return time;
+}
+
+
+int
+main(int argc, char** argv)
+{
+	int rounds = kDefaultRounds;
+	if (argc > 1)
+		rounds = atoi(argv[1]);
+	if (rounds < 1) {
+		fprintf(stderr, "usage: %s [<rounds>]\n", argv[0]);
+		return 1;
+	}
+
+	// every pipe needs two FDs, and the event queue one more
+	int maxPipes = kPipeCounts[sizeof(kPipeCounts) / sizeof(kPipeCounts[0])
+		- 1];
+	struct rlimit limit;
+	getrlimit(RLIMIT_NOFILE, &limit);
+	limit.rlim_cur = 2 * maxPipes + 64;
+	if (setrlimit(RLIMIT_NOFILE, &limit) != 0) {
+		fprintf(stderr, "raising the FD limit failed: %s\n",
+			strerror(errno));
+	}
+
+	printf("%8s %14s %14s\n", "pipes", "poll() us", "event queue us");
+
+	for (size_t i = 0; i < sizeof(kPipeCounts) / sizeof(kPipeCounts[0]);
+			i++) {
+		pipe_set pipes;
+		if (!create_pipes(pipes, kPipeCounts[i])) {
+			delete_pipes(pipes);
+			break;
+		}
+
+		bigtime_t pollTime = benchmark_poll(pipes, rounds);
+		bigtime_t queueTime = benchmark_event_queue(pipes, rounds);
+
+		delete_pipes(pipes);
+
+		if (pollTime < 0 || queueTime < 0)
+			return 1;
+
+		printf("%8d %14.2f %14.2f\n", kPipeCounts[i],
+			(double)pollTime / rounds, (double)queueTime / rounds);
+	}
+
+	return 0;
+}
@@ -0,0 +1,150 @@
+/*
+ * Copyright 2013, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <OS.h>
+
+
+static const int32 kDefaultThreadCount = 4;
+static const int32 kDefaultAreaPages = 16 * 1024;	// 64 MB
+static const int32 kDefaultIterations = 8;
+
+
+struct thread_data {
+	int32		pages;
+	int32		iterations;
+	bigtime_t	time;
+	status_t	status;
+};
+
+
+static sem_id sStartSemaphore;
+
+
+static status_t
+fault_thread(void* _data)
+{
+	thread_data* data = (thread_data*)_data;
+	data->time = 0;
+	data->status = B_OK;
+
+	acquire_sem(sStartSemaphore);
+
+	for (int32 i = 0; i < data->iterations; i++) {
+		uint8* address;
+		area_id area = create_area("page fault benchmark", (void**)&address,
+			B_ANY_ADDRESS, data->pages * B_PAGE_SIZE, B_NO_LOCK,
+			B_READ_AREA | B_WRITE_AREA);
+		if (area < 0) {
+			data->status = area;
+			return area;
+		}
+
+		bigtime_t start = system_time();
+
+		// every write faults in a new page
+		for (int32 page = 0; page < data->pages; page++)
+			address[page * B_PAGE_SIZE] = 42;
+
+		data->time += system_time() - start;
+
+		// deleting the area gives the pages back to the allocator
+		delete_area(area);
+	}
+
+	return B_OK;
+}
+
+
+static void
+usage(const char* programName)
+{
+	fprintf(stderr, "Usage: %s [ <threads> [ <pages> [ <iterations> ] ] ]\n"
+		"Faults in <pages> pages of a fresh area <iterations> times from each "
+		"of\n<threads> threads concurrently, and reports the rate at which "
+		"pages could\nbe faulted in.\n", programName);
+	exit(1);
+}
+
+
+int
+main(int argc, const char* const* argv)
+{
+	int32 threadCount = kDefaultThreadCount;
+	int32 pages = kDefaultAreaPages;
+	int32 iterations = kDefaultIterations;
+
+	if (argc > 4)
+		usage(argv[0]);
+	if (argc > 1)
+		threadCount = atol(argv[1]);
+	if (argc > 2)
+		pages = atol(argv[2]);
+	if (argc > 3)
+		iterations = atol(argv[3]);
+
+	if (threadCount <= 0 || pages <= 0 || iterations <= 0)
+		usage(argv[0]);
+
+	sStartSemaphore = create_sem(0, "start");
+	if (sStartSemaphore < 0) {
+		fprintf(stderr, "Creating the semaphore failed: %s\n",
+			strerror(sStartSemaphore));
+		return 1;
+	}
+
+	thread_data* data = new thread_data[threadCount];
+	thread_id* threads = new thread_id[threadCount];
+
+	for (int32 i = 0; i < threadCount; i++) {
+		data[i].pages = pages;
+		data[i].iterations = iterations;
+
+		threads[i] = spawn_thread(&fault_thread, "fault thread",
+			B_NORMAL_PRIORITY, &data[i]);
+		if (threads[i] < 0) {
+			fprintf(stderr, "Spawning thread failed: %s\n",
+				strerror(threads[i]));
+			return 1;
+		}
+		resume_thread(threads[i]);
+	}
+
+	bigtime_t start = system_time();
+	release_sem_etc(sStartSemaphore, threadCount, 0);
+
+	bigtime_t faultTime = 0;
+	for (int32 i = 0; i < threadCount; i++) {
+		status_t status;
+		wait_for_thread(threads[i], &status);
+
+		if (data[i].status != B_OK) {
+			fprintf(stderr, "Thread %" B_PRId32 " failed: %s\n", i,
+				strerror(data[i].status));
+			return 1;
+		}
+		faultTime += data[i].time;
+	}
+
+	bigtime_t totalTime = system_time() - start;
+	int64 totalPages = (int64)threadCount * pages * iterations;
+
+	printf("%" B_PRId32 " threads faulted in %" B_PRId64 " pages in %g s\n",
+		threadCount, totalPages, totalTime / 1000000.0);
+	printf("  total:       %g pages/s\n",
+		totalPages * 1000000.0 / totalTime);
+	printf("  per thread:  %g pages/s (time spent faulting only)\n",
+		totalPages * 1000000.0 / faultTime);
+
+	delete[] data;
+	delete[] threads;
+	delete_sem(sStartSemaphore);
+	return 0;
+}
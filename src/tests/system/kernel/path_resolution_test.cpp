@@ -4,11 +4,27 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <sys/stat.h>
 
 #include <OS.h>
 
 
+static const int32 kIterations = 10000;
+
+static const char* const kPaths[] = {
+	"/",
+	"/boot",
+	"/boot/develop",
+	"/boot/develop/headers",
+	"/boot/develop/headers/posix",
+	"/boot/develop/headers/posix/sys",
+	"/boot/develop/headers/posix/sys/stat.h",
+	"/boot/develop/headers/posix/sys/does-not-exist.h",
+	NULL
+};
+
+
 static void
 time_lstat(const char* path)
 {
@@ -16,33 +32,80 @@ time_lstat(const char* path)
 	fflush(stdout);
 	bigtime_t startTime = system_time();
 
-	static const int32 iterations = 10000;
-	for (int32 i = 0; i < iterations; i++) {
+	for (int32 i = 0; i < kIterations; i++) {
 		struct stat st;
 		lstat(path, &st);
 	}
 
 	bigtime_t totalTime = system_time() - startTime;
-	printf(" %5.3f us/call\n", (double)totalTime / iterations);
+	printf(" %5.3f us/call\n", (double)totalTime / kIterations);
+}
+
+
+static status_t
+lstat_thread(void* /*data*/)
+{
+	for (int32 i = 0; i < kIterations; i++) {
+		for (int32 j = 0; kPaths[j] != NULL; j++) {
+			struct stat st;
+			lstat(kPaths[j], &st);
+		}
+	}
+
+	return B_OK;
+}
+
+
+/*!	Resolves all paths from \a threadCount threads at the same time, like a
+	parallel build does with its header files.
+*/
+static void
+time_concurrent_lstat(int32 threadCount)
+{
+	printf("%" B_PRId32 " threads, all paths ...", threadCount);
+	fflush(stdout);
+
+	thread_id threads[threadCount];
+	for (int32 i = 0; i < threadCount; i++) {
+		threads[i] = spawn_thread(&lstat_thread, "lstat thread",
+			B_NORMAL_PRIORITY, NULL);
+	}
+
+	bigtime_t startTime = system_time();
+
+	for (int32 i = 0; i < threadCount; i++)
+		resume_thread(threads[i]);
+
+	for (int32 i = 0; i < threadCount; i++) {
+		status_t status;
+		wait_for_thread(threads[i], &status);
+	}
+
+	bigtime_t totalTime = system_time() - startTime;
+
+	int32 pathCount = 0;
+	while (kPaths[pathCount] != NULL)
+		pathCount++;
+
+	int64 calls = (int64)threadCount * pathCount * kIterations;
+	printf(" %5.3f us/call, %g calls/s\n",
+		(double)totalTime * threadCount / calls,
+		calls * 1000000.0 / totalTime);
 }
 
 
 int
-main()
+main(int argc, const char* const* argv)
 {
-	const char* const paths[] = {
-		"/",
-		"/boot",
-		"/boot/develop",
-		"/boot/develop/headers",
-		"/boot/develop/headers/posix",
-		"/boot/develop/headers/posix/sys",
-		"/boot/develop/headers/posix/sys/stat.h",
-		NULL
-	};
-
-	for (int32 i = 0; paths[i] != NULL; i++)
-		time_lstat(paths[i]);
+	for (int32 i = 0; kPaths[i] != NULL; i++)
+		time_lstat(kPaths[i]);
+
+	system_info info;
+	get_system_info(&info);
+
+	int32 threadCount = argc > 1 ? atol(argv[1]) : info.cpu_count;
+	if (threadCount > 0)
+		time_concurrent_lstat(threadCount);
 
 	return 0;
 }
@@ -0,0 +1,90 @@
+/*
+ * Copyright 2013, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include <stdio.h>
+#include <string.h>
+
+#include <OS.h>
+
+#include <port_defs.h>
+
+
+#define MESSAGE_COUNT	10
+
+
+static bool
+check(bool condition, const char* what)
+{
+	if (!condition)
+		fprintf(stderr, "FAILED: %s\n", what);
+	return condition;
+}
+
+
+int
+main()
+{
+	port_id port = create_port(MESSAGE_COUNT - 2, "batch test port");
+	if (port < 0) {
+		fprintf(stderr, "creating port failed: %s\n", strerror(port));
+		return 1;
+	}
+
+	char outBuffers[MESSAGE_COUNT][32];
+	port_message_data outMessages[MESSAGE_COUNT];
+	for (int32 i = 0; i < MESSAGE_COUNT; i++) {
+		snprintf(outBuffers[i], sizeof(outBuffers[i]), "message %" B_PRId32,
+			i);
+		outMessages[i].code = 'tst0' + i;
+		outMessages[i].buffer = outBuffers[i];
+		outMessages[i].size = strlen(outBuffers[i]) + 1;
+	}
+
+	bool success = true;
+
+	// only as many messages as fit into the port are written
+	ssize_t written = write_port_messages_etc(port, outMessages,
+		MESSAGE_COUNT, B_RELATIVE_TIMEOUT, 0);
+	success &= check(written == MESSAGE_COUNT - 2, "partial batch write");
+	success &= check(port_count(port) == MESSAGE_COUNT - 2, "port count");
+
+	// a buffer that is too small stops the batch
+	char inBuffers[MESSAGE_COUNT][32];
+	port_message_data inMessages[MESSAGE_COUNT];
+	for (int32 i = 0; i < MESSAGE_COUNT; i++) {
+		inMessages[i].buffer = inBuffers[i];
+		inMessages[i].size = i == 3 ? 2 : sizeof(inBuffers[i]);
+	}
+
+	ssize_t read = read_port_messages_etc(port, inMessages, MESSAGE_COUNT,
+		B_RELATIVE_TIMEOUT, 0);
+	success &= check(read == 3, "batch read stops at small buffer");
+
+	for (int32 i = 0; i < read; i++) {
+		success &= check(inMessages[i].code == outMessages[i].code
+			&& inMessages[i].size == outMessages[i].size
+			&& strcmp(inBuffers[i], outBuffers[i]) == 0, "message contents");
+	}
+
+	inMessages[0].size = 2;
+	read = read_port_messages_etc(port, inMessages, 1, B_RELATIVE_TIMEOUT, 0);
+	success &= check(read == B_BUFFER_OVERFLOW, "buffer overflow");
+
+	// the rest of the messages
+	for (int32 i = 0; i < MESSAGE_COUNT; i++)
+		inMessages[i].size = sizeof(inBuffers[i]);
+
+	read = read_port_messages_etc(port, inMessages, MESSAGE_COUNT,
+		B_RELATIVE_TIMEOUT, 0);
+	success &= check(read == MESSAGE_COUNT - 5, "batch read of the rest");
+	success &= check(read_port_messages_etc(port, inMessages, MESSAGE_COUNT,
+		B_RELATIVE_TIMEOUT, 0) == B_WOULD_BLOCK, "empty port");
+
+	delete_port(port);
+
+	printf("%s\n", success ? "All tests passed." : "Some tests FAILED.");
+	return success ? 0 : 1;
+}
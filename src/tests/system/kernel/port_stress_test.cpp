@@ -0,0 +1,209 @@
+/*
+ * Copyright 2013, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+/*!	Hammers the ports of several threads in parallel, while another thread
+	keeps creating and deleting ports, and ports that are being waited on are
+	deleted. Reports the throughput for an increasing number of threads, which
+	should scale with the number of CPUs, as port lookups don't serialize.
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <OS.h>
+
+
+#define MAX_THREADS		32
+#define RUN_TIME		1000000
+
+
+struct thread_data {
+	port_id	port;
+	int64	operations;
+	bool	failed;
+};
+
+
+static volatile bool sQuit;
+
+
+static status_t
+ping_thread(void* _data)
+{
+	thread_data* data = (thread_data*)_data;
+	char buffer[64];
+	memset(buffer, 0x42, sizeof(buffer));
+
+	while (!sQuit) {
+		if (write_port(data->port, 'ping', buffer, sizeof(buffer)) != B_OK) {
+			data->failed = true;
+			break;
+		}
+
+		int32 code;
+		if (read_port(data->port, &code, buffer, sizeof(buffer))
+				!= (ssize_t)sizeof(buffer) || code != 'ping') {
+			data->failed = true;
+			break;
+		}
+
+		data->operations++;
+	}
+
+	return B_OK;
+}
+
+
+static status_t
+churn_thread(void* _data)
+{
+	int64* _count = (int64*)_data;
+
+	while (!sQuit) {
+		port_id port = create_port(1, "churn port");
+		if (port < 0)
+			continue;
+
+		write_port(port, 0, NULL, 0);
+		delete_port(port);
+		(*_count)++;
+	}
+
+	return B_OK;
+}
+
+
+static status_t
+blocked_reader_thread(void* _data)
+{
+	port_id port = (port_id)(addr_t)_data;
+
+	int32 code;
+	return read_port(port, &code, NULL, 0);
+}
+
+
+static bool
+test_delete_while_waiting()
+{
+	port_id port = create_port(1, "delete test port");
+	if (port < 0)
+		return false;
+
+	thread_id threads[8];
+	for (int32 i = 0; i < 8; i++) {
+		threads[i] = spawn_thread(blocked_reader_thread, "blocked reader",
+			B_NORMAL_PRIORITY, (void*)(addr_t)port);
+		resume_thread(threads[i]);
+	}
+
+	snooze(50000);
+	delete_port(port);
+
+	bool success = true;
+	for (int32 i = 0; i < 8; i++) {
+		status_t status;
+		wait_for_thread(threads[i], &status);
+		if (status != B_BAD_PORT_ID) {
+			fprintf(stderr, "reader of deleted port returned: %s\n",
+				strerror(status));
+			success = false;
+		}
+	}
+
+	return success;
+}
+
+
+static bool
+run(int32 threadCount, bool churn)
+{
+	thread_data data[MAX_THREADS];
+	thread_id threads[MAX_THREADS];
+	sQuit = false;
+
+	for (int32 i = 0; i < threadCount; i++) {
+		data[i].port = create_port(1, "stress port");
+		data[i].operations = 0;
+		data[i].failed = false;
+		if (data[i].port < 0) {
+			fprintf(stderr, "creating port failed: %s\n",
+				strerror(data[i].port));
+			return false;
+		}
+	}
+
+	int64 churnCount = 0;
+	thread_id churnThread = -1;
+	if (churn) {
+		churnThread = spawn_thread(churn_thread, "churn", B_NORMAL_PRIORITY,
+			&churnCount);
+		resume_thread(churnThread);
+	}
+
+	bigtime_t startTime = system_time();
+	for (int32 i = 0; i < threadCount; i++) {
+		threads[i] = spawn_thread(ping_thread, "ping", B_NORMAL_PRIORITY,
+			&data[i]);
+		resume_thread(threads[i]);
+	}
+
+	snooze(RUN_TIME);
+	sQuit = true;
+
+	int64 operations = 0;
+	bool success = true;
+	for (int32 i = 0; i < threadCount; i++) {
+		status_t status;
+		wait_for_thread(threads[i], &status);
+		operations += data[i].operations;
+		success &= !data[i].failed;
+		delete_port(data[i].port);
+	}
+	bigtime_t runTime = system_time() - startTime;
+
+	if (churn) {
+		status_t status;
+		wait_for_thread(churnThread, &status);
+	}
+
+	printf("%3ld threads%s: %10.0f round trips/s (%.0f per thread)",
+		threadCount, churn ? " + churn" : "        ",
+		operations * 1000000.0 / runTime,
+		operations * 1000000.0 / runTime / threadCount);
+	if (churn)
+		printf(", %lld ports created", churnCount);
+	printf("\n");
+
+	return success;
+}
+
+
+int
+main(int argc, char** argv)
+{
+	system_info info;
+	get_system_info(&info);
+
+	int32 maxThreads = argc > 1 ? atoi(argv[1]) : info.cpu_count * 2;
+	if (maxThreads < 1 || maxThreads > MAX_THREADS)
+		maxThreads = MAX_THREADS;
+
+	bool success = test_delete_while_waiting();
+
+	for (int32 threadCount = 1; threadCount <= maxThreads; threadCount *= 2) {
+		success &= run(threadCount, false);
+		success &= run(threadCount, true);
+	}
+
+	if (!success) {
+		fprintf(stderr, "Some tests FAILED.\n");
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,108 @@
+/*
+ * Copyright 2013, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <util/lz_compression.h>
+
+
+#define PAGE_SIZE	4096
+
+
+static uint8 sWorkspace[LZ_COMPRESS_WORKSPACE_SIZE];
+static uint8 sCompressed[LZ_MAX_INPUT_SIZE * 2];
+static uint8 sDecompressed[LZ_MAX_INPUT_SIZE];
+
+
+static bool
+check_round_trip(const uint8* data, size_t size, const char* what)
+{
+	size_t compressedSize = lz_compress(data, size, sCompressed,
+		sizeof(sCompressed), sWorkspace);
+	if (compressedSize == 0) {
+		fprintf(stderr, "FAILED: compressing %s (%lu bytes)\n", what, size);
+		return false;
+	}
+
+	ssize_t decompressedSize = lz_decompress(sCompressed, compressedSize,
+		sDecompressed, sizeof(sDecompressed));
+	if (decompressedSize != (ssize_t)size
+		|| memcmp(data, sDecompressed, size) != 0) {
+		fprintf(stderr, "FAILED: round trip of %s (%lu bytes)\n", what, size);
+		return false;
+	}
+
+	// truncated data must be rejected, or at least not overflow the buffer
+	for (size_t i = 0; i < compressedSize; i += 13) {
+		lz_decompress(sCompressed, i, sDecompressed, size);
+	}
+
+	return true;
+}
+
+
+int
+main()
+{
+	static uint8 data[LZ_MAX_INPUT_SIZE];
+	int failed = 0;
+
+	srand(42);
+
+	for (int i = 0; i < 1000; i++) {
+		size_t size = rand() % (PAGE_SIZE * 2);
+		int kind = i % 4;
+		for (size_t j = 0; j < size; j++) {
+			switch (kind) {
+				case 0:
+					data[j] = rand();
+					break;
+				case 1:
+					data[j] = 0;
+					break;
+				case 2:
+					data[j] = j % 37;
+					break;
+				default:
+					data[j] = rand() % 4;
+					break;
+			}
+		}
+
+		if (!check_round_trip(data, size, "generated data"))
+			failed++;
+	}
+
+	for (size_t i = 0; i < sizeof(data); i++)
+		data[i] = (i * 7) ^ (i >> 5);
+	if (!check_round_trip(data, sizeof(data), "maximum size data"))
+		failed++;
+
+	// a zeroed page must compress well, a random one not at all
+	memset(data, 0, PAGE_SIZE);
+	size_t size = lz_compress(data, PAGE_SIZE, sCompressed, PAGE_SIZE / 2,
+		sWorkspace);
+	if (size == 0 || size > 64) {
+		fprintf(stderr, "FAILED: zeroed page compressed to %lu bytes\n", size);
+		failed++;
+	}
+
+	for (size_t i = 0; i < PAGE_SIZE; i++)
+		data[i] = rand();
+	if (lz_compress(data, PAGE_SIZE, sCompressed, PAGE_SIZE * 3 / 4,
+			sWorkspace) != 0) {
+		fprintf(stderr, "FAILED: random page fit into 3/4 of a page\n");
+		failed++;
+	}
+
+	if (failed > 0)
+		return 1;
+
+	printf("All tests passed.\n");
+	return 0;
+}
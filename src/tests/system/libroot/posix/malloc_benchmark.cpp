@@ -0,0 +1,216 @@
+/*
+ * Copyright 2013, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+/*!	Measures the throughput of malloc() and free() for small allocations,
+	once with every thread freeing its own allocations, and once with pairs
+	of producer and consumer threads, where the consumer frees the
+	allocations of the producer. The latter is the worst case for allocators
+	with thread local caches.
+	Also verifies that blocks are not handed out twice while they are in use.
+*/
+
+
+#include <OS.h>
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+static const int kMaxThreads = 32;
+static const int32 kDefaultOperations = 1000000;
+static const int32 kQueueSize = 1024;
+static const int32 kLiveAllocations = 256;
+static const size_t kMaxSize = 512;
+
+static int32 sOperations = kDefaultOperations;
+
+
+struct allocation_queue {
+	void* volatile	slots[kQueueSize];
+	int32			produced;
+	int32			consumed;
+};
+
+struct thread_data {
+	allocation_queue*	queue;
+	uint32				seed;
+};
+
+
+static inline size_t
+random_size(uint32& seed)
+{
+	seed = seed * 1103515245 + 12345;
+	return 1 + (seed >> 16) % kMaxSize;
+}
+
+
+static inline void
+fill(void* buffer, size_t size)
+{
+	// the first word identifies the allocation, and is checked when freeing
+	memset(buffer, 0, size);
+	*(void**)buffer = buffer;
+}
+
+
+static inline void
+check(void* buffer)
+{
+	if (*(void**)buffer != buffer) {
+		fprintf(stderr, "allocation %p has been handed out twice!\n", buffer);
+		exit(1);
+	}
+	*(void**)buffer = NULL;
+}
+
+
+static void*
+local_thread(void* _data)
+{
+	thread_data* data = (thread_data*)_data;
+	void* live[kLiveAllocations];
+	memset(live, 0, sizeof(live));
+
+	for (int32 i = 0; i < sOperations; i++) {
+		int32 index = i % kLiveAllocations;
+		if (live[index] != NULL) {
+			check(live[index]);
+			free(live[index]);
+		}
+
+		size_t size = random_size(data->seed) + sizeof(void*);
+		live[index] = malloc(size);
+		if (live[index] == NULL) {
+			fprintf(stderr, "out of memory\n");
+			exit(1);
+		}
+		fill(live[index], size);
+	}
+
+	for (int32 i = 0; i < kLiveAllocations; i++) {
+		if (live[i] != NULL) {
+			check(live[i]);
+			free(live[i]);
+		}
+	}
+
+	return NULL;
+}
+
+
+static void*
+producer_thread(void* _data)
+{
+	thread_data* data = (thread_data*)_data;
+	allocation_queue* queue = data->queue;
+
+	for (int32 i = 0; i < sOperations; i++) {
+		size_t size = random_size(data->seed) + sizeof(void*);
+		void* buffer = malloc(size);
+		if (buffer == NULL) {
+			fprintf(stderr, "out of memory\n");
+			exit(1);
+		}
+		fill(buffer, size);
+
+		// wait for a free slot
+		while (i - atomic_get(&queue->consumed) >= kQueueSize)
+			snooze(10);
+
+		queue->slots[i % kQueueSize] = buffer;
+		atomic_add(&queue->produced, 1);
+	}
+
+	return NULL;
+}
+
+
+static void*
+consumer_thread(void* _data)
+{
+	thread_data* data = (thread_data*)_data;
+	allocation_queue* queue = data->queue;
+
+	for (int32 i = 0; i < sOperations; i++) {
+		// wait for an allocation
+		while (atomic_get(&queue->produced) <= i)
+			snooze(10);
+
+		void* buffer = queue->slots[i % kQueueSize];
+		check(buffer);
+		free(buffer);
+		atomic_add(&queue->consumed, 1);
+	}
+
+	return NULL;
+}
+
+
+static void
+run(const char* name, int threadCount, bool producerConsumer)
+{
+	pthread_t threads[kMaxThreads * 2];
+	thread_data data[kMaxThreads * 2];
+	allocation_queue* queues = new allocation_queue[threadCount];
+	memset(queues, 0, sizeof(allocation_queue) * threadCount);
+
+	bigtime_t startTime = system_time();
+
+	int count = 0;
+	for (int i = 0; i < threadCount; i++) {
+		data[count].queue = &queues[i];
+		data[count].seed = i + 1;
+
+		if (producerConsumer) {
+			data[count + 1] = data[count];
+			pthread_create(&threads[count], NULL, &producer_thread,
+				&data[count]);
+			pthread_create(&threads[count + 1], NULL, &consumer_thread,
+				&data[count + 1]);
+			count += 2;
+		} else {
+			pthread_create(&threads[count], NULL, &local_thread, &data[count]);
+			count++;
+		}
+	}
+
+	for (int i = 0; i < count; i++)
+		pthread_join(threads[i], NULL);
+
+	bigtime_t time = system_time() - startTime;
+	delete[] queues;
+
+	printf("%-18s %2d threads: %8lld us, %6.1f ns per malloc()/free()\n",
+		name, count, time, time * 1000.0 / sOperations / threadCount);
+}
+
+
+int
+main(int argc, char** argv)
+{
+	if (argc > 1)
+		sOperations = atoi(argv[1]);
+	if (sOperations <= 0) {
+		fprintf(stderr, "usage: %s [<operations per thread>]\n", argv[0]);
+		return 1;
+	}
+
+	system_info info;
+	get_system_info(&info);
+	int maxThreads = min_c(kMaxThreads, (int)info.cpu_count * 2);
+
+	for (int threads = 1; threads <= maxThreads; threads *= 2)
+		run("local", threads, false);
+
+	for (int threads = 1; threads <= maxThreads / 2 || threads == 1;
+			threads *= 2) {
+		run("producer/consumer", threads, true);
+	}
+
+	return 0;
+}
@@ -0,0 +1,100 @@
+/*
+ * Copyright 2013, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include <errno.h>
+#include <fcntl.h>
+#include <spawn.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+
+static int
+wait_for_child(pid_t child)
+{
+	int status;
+	if (waitpid(child, &status, 0) < 0) {
+		fprintf(stderr, "waitpid() failed: %s\n", strerror(errno));
+		exit(1);
+	}
+
+	return WEXITSTATUS(status);
+}
+
+
+int
+main()
+{
+	// no file actions or attributes -- the child is created via load_image()
+	char* trueArgs[] = { (char*)"/bin/true", NULL };
+	pid_t child;
+	int error = posix_spawn(&child, "/bin/true", NULL, NULL, trueArgs,
+		environ);
+	if (error != 0) {
+		fprintf(stderr, "posix_spawn() failed: %s\n", strerror(error));
+		return 1;
+	}
+	if (wait_for_child(child) != 0) {
+		fprintf(stderr, "/bin/true failed\n");
+		return 1;
+	}
+
+	// argv[0] doesn't need to match the path of the executable
+	char* shellArgs[] = { (char*)"sh", (char*)"-c", (char*)"exit 3", NULL };
+	error = posix_spawn(&child, "/bin/sh", NULL, NULL, shellArgs, environ);
+	if (error != 0 || wait_for_child(child) != 3) {
+		fprintf(stderr, "posix_spawn() of the shell failed\n");
+		return 1;
+	}
+
+	// leaf names are looked up in the PATH
+	char* leafArgs[] = { (char*)"true", NULL };
+	error = posix_spawnp(&child, "true", NULL, NULL, leafArgs, environ);
+	if (error != 0 || wait_for_child(child) != 0) {
+		fprintf(stderr, "posix_spawnp() of \"true\" failed\n");
+		return 1;
+	}
+
+	// a missing executable is reported to the caller
+	error = posix_spawn(&child, "/nonexistent", NULL, NULL, trueArgs, environ);
+	if (error == 0) {
+		fprintf(stderr, "posix_spawn() of a missing file succeeded\n");
+		return 1;
+	}
+
+	// with file actions, the child is forked
+	const char* path = "/tmp/posix_spawn_test";
+	posix_spawn_file_actions_t fileActions;
+	posix_spawn_file_actions_init(&fileActions);
+	posix_spawn_file_actions_addopen(&fileActions, STDOUT_FILENO, path,
+		O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+	char* echoArgs[] = { (char*)"echo", (char*)"hello", NULL };
+	error = posix_spawnp(&child, "echo", &fileActions, NULL, echoArgs,
+		environ);
+	posix_spawn_file_actions_destroy(&fileActions);
+	if (error != 0) {
+		fprintf(stderr, "posix_spawnp() failed: %s\n", strerror(error));
+		return 1;
+	}
+	wait_for_child(child);
+
+	char buffer[32];
+	int fd = open(path, O_RDONLY);
+	ssize_t bytesRead = fd >= 0 ? read(fd, buffer, sizeof(buffer)) : -1;
+	close(fd);
+	unlink(path);
+
+	if (bytesRead != 6 || memcmp(buffer, "hello\n", 6) != 0) {
+		fprintf(stderr, "child output was not redirected\n");
+		return 1;
+	}
+
+	printf("All tests passed.\n");
+	return 0;
+}
@@ -0,0 +1,242 @@
+/*
+ * Copyright 2013, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+/*!	Checks that pthread condition variables and read-write locks work under
+	contention, and measures how long their uncontended operations take.
+	Broadcasts are tested both with the mutex held, when the waiters are
+	moved over to the mutex, and without it.
+*/
+
+
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <OS.h>
+
+
+#define THREAD_COUNT	8
+#define ITERATIONS		100000
+#define BROADCASTS		1000
+
+
+static pthread_mutex_t sMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t sCondition = PTHREAD_COND_INITIALIZER;
+static pthread_rwlock_t sLock;
+static int32 sTurn;
+static int32 sValue;
+static int32 sReaders;
+static int32 sGeneration;
+static int32 sArrived;
+static int32 sInside;
+static bool sFailed;
+
+
+static void*
+ping_pong_thread(void* _data)
+{
+	int32 self = (int32)(addr_t)_data;
+
+	pthread_mutex_lock(&sMutex);
+	for (int32 i = 0; i < ITERATIONS / 10; i++) {
+		while (sTurn != self)
+			pthread_cond_wait(&sCondition, &sMutex);
+
+		sTurn = 1 - self;
+		pthread_cond_signal(&sCondition);
+	}
+	pthread_mutex_unlock(&sMutex);
+
+	return NULL;
+}
+
+
+static void*
+broadcast_thread(void* _data)
+{
+	pthread_mutex_lock(&sMutex);
+	for (int32 i = 0; i < BROADCASTS; i++) {
+		int32 generation = sGeneration;
+		sArrived++;
+		pthread_cond_broadcast(&sCondition);
+
+		while (sGeneration == generation)
+			pthread_cond_wait(&sCondition, &sMutex);
+
+		// we must own the mutex alone, however we have been woken up
+		if (atomic_add(&sInside, 1) != 0)
+			sFailed = true;
+		atomic_add(&sInside, -1);
+	}
+
+	if (pthread_mutex_unlock(&sMutex) != 0)
+		sFailed = true;
+
+	return NULL;
+}
+
+
+/*!	Waits for all broadcast threads to wait on the condition variable, and
+	wakes them up again, with or without holding the mutex.
+*/
+static void
+broadcast_all(bool holdMutex)
+{
+	for (int32 i = 0; i < BROADCASTS; i++) {
+		pthread_mutex_lock(&sMutex);
+		while (sArrived < THREAD_COUNT)
+			pthread_cond_wait(&sCondition, &sMutex);
+
+		sArrived = 0;
+		sGeneration++;
+
+		if (holdMutex) {
+			pthread_cond_broadcast(&sCondition);
+			pthread_mutex_unlock(&sMutex);
+		} else {
+			pthread_mutex_unlock(&sMutex);
+			pthread_cond_broadcast(&sCondition);
+		}
+	}
+}
+
+
+static void*
+rwlock_thread(void* _data)
+{
+	bool writer = ((addr_t)_data & 1) != 0;
+
+	for (int32 i = 0; i < ITERATIONS / 10; i++) {
+		if (writer) {
+			pthread_rwlock_wrlock(&sLock);
+			if (atomic_get(&sReaders) != 0)
+				sFailed = true;
+
+			int32 value = sValue;
+			sValue = value + 1;
+		} else {
+			pthread_rwlock_rdlock(&sLock);
+			atomic_add(&sReaders, 1);
+
+			int32 value = sValue;
+			if (sValue != value)
+				sFailed = true;
+
+			atomic_add(&sReaders, -1);
+		}
+
+		pthread_rwlock_unlock(&sLock);
+	}
+
+	return NULL;
+}
+
+
+static void*
+try_read_lock_thread(void* _data)
+{
+	return (void*)(addr_t)pthread_rwlock_tryrdlock(&sLock);
+}
+
+
+static void
+benchmark_uncontended()
+{
+	bigtime_t startTime = system_time();
+	for (int32 i = 0; i < ITERATIONS; i++)
+		pthread_cond_signal(&sCondition);
+	printf("pthread_cond_signal() without waiters: %.3f us\n",
+		(double)(system_time() - startTime) / ITERATIONS);
+
+	startTime = system_time();
+	for (int32 i = 0; i < ITERATIONS; i++) {
+		pthread_rwlock_rdlock(&sLock);
+		pthread_rwlock_unlock(&sLock);
+	}
+	printf("pthread_rwlock_rdlock()/unlock(): %.3f us\n",
+		(double)(system_time() - startTime) / ITERATIONS);
+
+	startTime = system_time();
+	for (int32 i = 0; i < ITERATIONS; i++) {
+		pthread_rwlock_wrlock(&sLock);
+		pthread_rwlock_unlock(&sLock);
+	}
+	printf("pthread_rwlock_wrlock()/unlock(): %.3f us\n",
+		(double)(system_time() - startTime) / ITERATIONS);
+}
+
+
+int
+main()
+{
+	pthread_rwlock_init(&sLock, NULL);
+
+	benchmark_uncontended();
+
+	// condition variable ping pong
+	pthread_t threads[THREAD_COUNT];
+	bigtime_t startTime = system_time();
+	for (int32 i = 0; i < 2; i++)
+		pthread_create(&threads[i], NULL, ping_pong_thread, (void*)(addr_t)i);
+	for (int32 i = 0; i < 2; i++)
+		pthread_join(threads[i], NULL);
+	printf("condition variable round trip: %.3f us\n",
+		(double)(system_time() - startTime) / (ITERATIONS / 10));
+
+	// broadcasts, with and without holding the mutex
+	for (int32 pass = 0; pass < 2; pass++) {
+		bool holdMutex = pass == 0;
+		sArrived = 0;
+
+		startTime = system_time();
+		for (int32 i = 0; i < THREAD_COUNT; i++)
+			pthread_create(&threads[i], NULL, broadcast_thread, NULL);
+		broadcast_all(holdMutex);
+		for (int32 i = 0; i < THREAD_COUNT; i++)
+			pthread_join(threads[i], NULL);
+		printf("broadcast to %d threads%s: %.3f us\n", THREAD_COUNT,
+			holdMutex ? " holding the mutex" : "",
+			(double)(system_time() - startTime) / BROADCASTS);
+	}
+
+	// contended read-write lock
+	startTime = system_time();
+	for (int32 i = 0; i < THREAD_COUNT; i++)
+		pthread_create(&threads[i], NULL, rwlock_thread, (void*)(addr_t)i);
+	for (int32 i = 0; i < THREAD_COUNT; i++)
+		pthread_join(threads[i], NULL);
+	printf("contended read-write lock: %.3f us per operation\n",
+		(double)(system_time() - startTime) / (ITERATIONS / 10)
+			/ THREAD_COUNT);
+
+	int32 expectedValue = THREAD_COUNT / 2 * (ITERATIONS / 10);
+	if (sValue != expectedValue) {
+		fprintf(stderr, "FAILED: value is %ld instead of %ld\n", sValue,
+			expectedValue);
+		sFailed = true;
+	}
+
+	// a try lock must fail while a writer holds the lock
+	pthread_rwlock_wrlock(&sLock);
+	pthread_create(&threads[0], NULL, try_read_lock_thread, NULL);
+	void* result;
+	pthread_join(threads[0], &result);
+	if ((status_t)(addr_t)result != EBUSY) {
+		fprintf(stderr, "FAILED: tryrdlock returned: %s\n",
+			strerror((status_t)(addr_t)result));
+		sFailed = true;
+	}
+	pthread_rwlock_unlock(&sLock);
+
+	pthread_rwlock_destroy(&sLock);
+
+	if (sFailed) {
+		fprintf(stderr, "Some tests FAILED.\n");
+		return 1;
+	}
+
+	printf("All tests passed.\n");
+	return 0;
+}
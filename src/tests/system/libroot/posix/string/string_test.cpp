@@ -0,0 +1,288 @@
+/*
+ * Copyright 2013, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+/*!	Verifies the string and memory functions against trivial reference
+	implementations for all combinations of alignments and a range of sizes,
+	including buffers that end right before an unmapped page, and then
+	measures their throughput.
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include <OS.h>
+
+
+static const size_t kMaxSize = 256;
+static const size_t kMaxAlignment = 32;
+static const size_t kBenchmarkSize = 64 * 1024;
+static const int32 kBenchmarkIterations = 2000;
+
+static int sFailures = 0;
+static volatile int32 sResult;
+	// keeps the compiler from optimizing the benchmarked calls away
+
+
+#define CHECK(condition, function, size, alignment) \
+	do { \
+		if (!(condition)) { \
+			fprintf(stderr, "%s() failed: size %lu, alignment %lu (line %d)\n", \
+				function, (unsigned long)(size), (unsigned long)(alignment), \
+				__LINE__); \
+			sFailures++; \
+		} \
+	} while (false)
+
+
+static int
+sign(int value)
+{
+	return value < 0 ? -1 : (value > 0 ? 1 : 0);
+}
+
+
+static size_t
+reference_strlen(const char* string)
+{
+	size_t length = 0;
+	while (string[length] != '\0')
+		length++;
+	return length;
+}
+
+
+static int
+reference_memcmp(const void* _a, const void* _b, size_t size)
+{
+	const uint8* a = (const uint8*)_a;
+	const uint8* b = (const uint8*)_b;
+	for (size_t i = 0; i < size; i++) {
+		if (a[i] != b[i])
+			return a[i] < b[i] ? -1 : 1;
+	}
+	return 0;
+}
+
+
+static int
+reference_strcmp(const char* _a, const char* _b)
+{
+	const uint8* a = (const uint8*)_a;
+	const uint8* b = (const uint8*)_b;
+	while (*a != '\0' && *a == *b) {
+		a++;
+		b++;
+	}
+	return *a == *b ? 0 : (*a < *b ? -1 : 1);
+}
+
+
+static void
+test_functions(uint8* buffer, uint8* other, size_t size, size_t alignment,
+	size_t otherAlignment)
+{
+	uint8* a = buffer + alignment;
+	uint8* b = other + otherAlignment;
+
+	// memset()
+	memset(buffer, 0x11, kMaxSize + kMaxAlignment * 2);
+	memset(a, 0xa5, size);
+	bool valid = true;
+	for (size_t i = 0; i < kMaxSize + kMaxAlignment * 2; i++) {
+		uint8 expected = buffer + i >= a && buffer + i < a + size ? 0xa5 : 0x11;
+		if (buffer[i] != expected)
+			valid = false;
+	}
+	CHECK(valid, "memset", size, alignment);
+
+	// memcpy()
+	for (size_t i = 0; i < size; i++)
+		b[i] = (uint8)(i * 7 + 1);
+	memset(buffer, 0x11, kMaxSize + kMaxAlignment * 2);
+	memcpy(a, b, size);
+	CHECK(reference_memcmp(a, b, size) == 0 && a[size] == 0x11
+		&& (alignment == 0 || a[-1] == 0x11), "memcpy", size, alignment);
+
+	// memcmp() -- equal, and differing at the last byte
+	CHECK(memcmp(a, b, size) == 0, "memcmp", size, alignment);
+	if (size > 0) {
+		a[size - 1] = 0xff;
+		b[size - 1] = 0x01;
+		CHECK(sign(memcmp(a, b, size)) == 1 && sign(memcmp(b, a, size)) == -1,
+			"memcmp", size, alignment);
+	}
+
+	// memchr()
+	memset(a, 'a', size);
+	CHECK(memchr(a, 'b', size) == NULL, "memchr", size, alignment);
+	if (size > 0) {
+		a[size - 1] = 'b';
+		CHECK(memchr(a, 'b', size) == a + size - 1, "memchr", size, alignment);
+		a[0] = 'b';
+		CHECK(memchr(a, 'b', size) == a, "memchr", size, alignment);
+	}
+
+	if (size == 0)
+		return;
+
+	// strlen(), strchr()
+	memset(a, 'a', size);
+	a[size - 1] = '\0';
+	CHECK(strlen((char*)a) == size - 1, "strlen", size, alignment);
+	CHECK(strchr((char*)a, 'b') == NULL, "strchr", size, alignment);
+	CHECK(strchr((char*)a, '\0') == (char*)a + size - 1, "strchr", size,
+		alignment);
+	if (size > 1) {
+		a[size - 2] = 'b';
+		CHECK(strchr((char*)a, 'b') == (char*)a + size - 2, "strchr", size,
+			alignment);
+	}
+
+	// strcmp()
+	memcpy(b, a, size);
+	CHECK(strcmp((char*)a, (char*)b) == 0, "strcmp", size, alignment);
+	if (size > 1) {
+		b[size - 2] = (uint8)0xe6;
+		CHECK(sign(strcmp((char*)a, (char*)b))
+				== reference_strcmp((char*)a, (char*)b)
+			&& sign(strcmp((char*)b, (char*)a))
+				== reference_strcmp((char*)b, (char*)a),
+			"strcmp", size, alignment);
+	}
+}
+
+
+/*!	Places strings right at the end of the first of two pages, with the
+	second one being protected, so that any read beyond the terminating null
+	byte that crosses the page boundary crashes.
+*/
+static void
+test_page_boundary()
+{
+	uint8* pages;
+	area_id area = create_area("string test", (void**)&pages,
+		B_ANY_ADDRESS, 2 * B_PAGE_SIZE, B_NO_LOCK,
+		B_READ_AREA | B_WRITE_AREA);
+	if (area < 0) {
+		fprintf(stderr, "Could not create area: %s\n", strerror(area));
+		sFailures++;
+		return;
+	}
+
+	if (mprotect(pages + B_PAGE_SIZE, B_PAGE_SIZE, PROT_NONE) != 0) {
+		fprintf(stderr, "Could not protect guard page\n");
+		sFailures++;
+		delete_area(area);
+		return;
+	}
+
+	uint8* end = pages + B_PAGE_SIZE;
+	static uint8 other[B_PAGE_SIZE];
+
+	for (size_t length = 1; length <= kMaxSize; length++) {
+		uint8* string = end - length;
+		memset(string, 'x', length - 1);
+		string[length - 1] = '\0';
+
+		CHECK(strlen((char*)string) == length - 1, "strlen", length,
+			(addr_t)string % 16);
+		CHECK(strchr((char*)string, 'y') == NULL, "strchr", length,
+			(addr_t)string % 16);
+		CHECK(memchr(string, 'y', length) == NULL, "memchr", length,
+			(addr_t)string % 16);
+
+		memcpy(other, string, length);
+		CHECK(strcmp((char*)string, (char*)other) == 0, "strcmp", length,
+			(addr_t)string % 16);
+		CHECK(memcmp(string, other, length) == 0, "memcmp", length,
+			(addr_t)string % 16);
+	}
+
+	delete_area(area);
+}
+
+
+static void
+benchmark(const char* name, uint8* buffer, uint8* other)
+{
+	bigtime_t startTime = system_time();
+	int32 result = 0;
+
+	for (int32 i = 0; i < kBenchmarkIterations; i++) {
+		if (!strcmp(name, "memcpy"))
+			memcpy(buffer, other, kBenchmarkSize);
+		else if (!strcmp(name, "memset"))
+			memset(buffer, i, kBenchmarkSize);
+		else if (!strcmp(name, "strlen"))
+			result += strlen((char*)other);
+		else if (!strcmp(name, "memchr"))
+			result += memchr(other, 'y', kBenchmarkSize) != NULL;
+		else if (!strcmp(name, "memcmp"))
+			result += memcmp(buffer, other, kBenchmarkSize);
+		else if (!strcmp(name, "strchr"))
+			result += strchr((char*)other, 'y') != NULL;
+		else if (!strcmp(name, "strcmp"))
+			result += strcmp((char*)buffer, (char*)other);
+	}
+
+	bigtime_t time = system_time() - startTime;
+	sResult = result;
+
+	printf("  %-8s %8.1f MB/s\n", name,
+		(double)kBenchmarkSize * kBenchmarkIterations / time);
+}
+
+
+int
+main(int argc, char** argv)
+{
+	static uint8 buffer[kMaxSize + kMaxAlignment * 2];
+	static uint8 other[kMaxSize + kMaxAlignment * 2];
+
+	for (size_t size = 0; size <= kMaxSize; size++) {
+		for (size_t alignment = 0; alignment < kMaxAlignment; alignment++) {
+			test_functions(buffer, other, size, alignment,
+				(alignment * 5) % kMaxAlignment);
+		}
+	}
+
+	test_page_boundary();
+
+	if (sFailures > 0) {
+		fprintf(stderr, "%d tests failed!\n", sFailures);
+		return 1;
+	}
+
+	printf("All tests passed.\n\nThroughput (%lu KB buffers):\n",
+		(unsigned long)kBenchmarkSize / 1024);
+
+	uint8* large = (uint8*)malloc(kBenchmarkSize + 1);
+	uint8* largeOther = (uint8*)malloc(kBenchmarkSize + 1);
+	if (large == NULL || largeOther == NULL) {
+		fprintf(stderr, "Out of memory\n");
+		return 1;
+	}
+
+	memset(largeOther, 'x', kBenchmarkSize);
+	largeOther[kBenchmarkSize] = '\0';
+	memcpy(large, largeOther, kBenchmarkSize + 1);
+
+	const char* kFunctions[] = { "memcpy", "memset", "strlen", "memchr",
+		"memcmp", "strchr", "strcmp" };
+	for (size_t i = 0; i < sizeof(kFunctions) / sizeof(kFunctions[0]); i++) {
+		if (!strcmp(kFunctions[i], "strlen")) {
+			// memset() overwrote the string
+			memcpy(large, largeOther, kBenchmarkSize + 1);
+		}
+		benchmark(kFunctions[i], large, largeOther);
+	}
+
+	free(large);
+	free(largeOther);
+	return 0;
+}
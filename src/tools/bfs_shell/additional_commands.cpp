@@ -7,6 +7,8 @@
 #include "fssh.h"
 
 #include "command_checkfs.h"
+#include "command_querybench.h"
+#include "command_reindextest.h"
 
 
 namespace FSShell {
@@ -17,6 +19,10 @@ register_additional_commands()
 {
 	CommandManager::Default()->AddCommand(command_checkfs, "checkfs",
 		"check file system");
+	CommandManager::Default()->AddCommand(command_querybench, "querybench",
+		"measure query performance");
+	CommandManager::Default()->AddCommand(command_reindextest, "reindextest",
+		"test building an index bottom-up");
 }
 
 
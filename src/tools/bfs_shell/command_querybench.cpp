@@ -0,0 +1,220 @@
+/*
+ * Copyright 2013, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include <stdlib.h>
+
+#include "fssh_dirent.h"
+#include "fssh_stat.h"
+#include "fssh_stdio.h"
+#include "syscalls.h"
+
+#include "bfs.h"
+
+
+namespace FSShell {
+
+
+static const char* kBenchmarkDirectory = "/myfs/querybench";
+static const char* kValueAttribute = "querybench:value";
+static const char* kTypes[] = {
+	"text/plain",
+	"text/html",
+	"image/png",
+	"image/jpeg",
+	"audio/x-wav",
+	"application/x-vnd.Be-elfexecutable",
+	"application/pdf",
+	"text/x-email",
+};
+static const int32 kTypeCount = sizeof(kTypes) / sizeof(kTypes[0]);
+
+
+static status_t
+write_attribute(int fd, const char* name, uint32 type, const void* data,
+	size_t size)
+{
+	int attribute = _kern_create_attr(fd, name, type, O_WRONLY | O_TRUNC);
+	if (attribute < 0)
+		return attribute;
+
+	ssize_t bytesWritten = _kern_write(attribute, 0, data, size);
+	_kern_close(attribute);
+
+	if (bytesWritten < 0)
+		return bytesWritten;
+	return (size_t)bytesWritten == size ? B_OK : B_IO_ERROR;
+}
+
+
+/*!	Creates \a count files with a MIME type, a file size, and an indexed
+	integer attribute, each of them spread over a different number of values.
+*/
+static status_t
+create_files(dev_t volume, int32 count)
+{
+	status_t status = _kern_create_index(volume, "BEOS:TYPE",
+		B_MIME_STRING_TYPE, 0);
+	if (status == B_OK || status == B_FILE_EXISTS)
+		status = _kern_create_index(volume, kValueAttribute, B_INT32_TYPE, 0);
+	if (status != B_OK && status != B_FILE_EXISTS) {
+		fssh_dprintf("querybench: could not create indices: %s\n",
+			strerror(status));
+		return status;
+	}
+
+	status = _kern_create_dir(-1, kBenchmarkDirectory, 0755);
+	if (status != B_OK && status != B_FILE_EXISTS)
+		return status;
+
+	char data[256];
+	memset(data, 'x', sizeof(data));
+
+	bigtime_t startTime = system_time();
+
+	for (int32 i = 0; i < count; i++) {
+		char path[B_PATH_NAME_LENGTH];
+		snprintf(path, sizeof(path), "%s/file%" B_PRId32, kBenchmarkDirectory, i);
+
+		int fd = _kern_open(-1, path, O_CREAT | O_WRONLY | O_TRUNC, 0644);
+		if (fd < 0) {
+			fssh_dprintf("querybench: could not create \"%s\": %s\n", path,
+				strerror(fd));
+			return fd;
+		}
+
+		const char* type = kTypes[i % kTypeCount];
+		int32 value = i % 1000;
+
+		status = write_attribute(fd, "BEOS:TYPE", B_MIME_STRING_TYPE, type,
+			strlen(type) + 1);
+		if (status == B_OK) {
+			status = write_attribute(fd, kValueAttribute, B_INT32_TYPE,
+				&value, sizeof(value));
+		}
+		if (status == B_OK) {
+			ssize_t bytesWritten = _kern_write(fd, 0, data, i % sizeof(data));
+			if (bytesWritten < 0)
+				status = bytesWritten;
+		}
+
+		_kern_close(fd);
+
+		if (status != B_OK) {
+			fssh_dprintf("querybench: could not write \"%s\": %s\n", path,
+				strerror(status));
+			return status;
+		}
+	}
+
+	bigtime_t time = system_time() - startTime;
+	fssh_dprintf("created %" B_PRId32 " files in %" B_PRId64 " ms\n", count,
+		time / 1000);
+	return B_OK;
+}
+
+
+static status_t
+run_query(dev_t volume, const char* query, int32* _count)
+{
+	int fd = _kern_open_query(volume, query, strlen(query), 0, -1, -1);
+	if (fd < 0)
+		return fd;
+
+	char buffer[sizeof(struct dirent) + B_FILE_NAME_LENGTH];
+	struct dirent* entry = (struct dirent*)buffer;
+	int32 count = 0;
+	ssize_t entriesRead;
+	while ((entriesRead = _kern_read_dir(fd, entry, sizeof(buffer), 1)) == 1)
+		count++;
+
+	_kern_close(fd);
+
+	if (entriesRead < 0)
+		return entriesRead;
+
+	*_count = count;
+	return B_OK;
+}
+
+
+static void
+benchmark_query(dev_t volume, const char* query, int32 iterations)
+{
+	bigtime_t minTime = 0;
+	bigtime_t totalTime = 0;
+	int32 count = 0;
+
+	for (int32 i = 0; i < iterations; i++) {
+		bigtime_t startTime = system_time();
+		status_t status = run_query(volume, query, &count);
+		bigtime_t time = system_time() - startTime;
+
+		if (status != B_OK) {
+			fssh_dprintf("%s: failed: %s\n", query, strerror(status));
+			return;
+		}
+
+		if (i == 0 || time < minTime)
+			minTime = time;
+		totalTime += time;
+	}
+
+	fssh_dprintf("%s\n  %" B_PRId32 " entries, %" B_PRId64 " us (min), %"
+		B_PRId64 " us (average)\n", query, count, minTime,
+		totalTime / iterations);
+}
+
+
+/*!	Measures how long queries take on the mounted volume. Optionally, it
+	populates the volume with files to query for first; the files have the
+	attributes "BEOS:TYPE", "size", and "querybench:value", so that queries
+	combining several indices like
+		(BEOS:TYPE=="text/plain")&&(querybench:value<10)&&(size>100)
+	can be compared.
+*/
+fssh_status_t
+command_querybench(int argc, const char* const* argv)
+{
+	int32 iterations = 10;
+	int32 createCount = 0;
+	int argi = 1;
+
+	for (; argi < argc && argv[argi][0] == '-'; argi++) {
+		if (!strcmp(argv[argi], "-i") && argi + 1 < argc)
+			iterations = strtol(argv[++argi], NULL, 0);
+		else if (!strcmp(argv[argi], "-c") && argi + 1 < argc)
+			createCount = strtol(argv[++argi], NULL, 0);
+		else
+			break;
+	}
+
+	if ((argi == argc && createCount <= 0) || iterations < 1) {
+		fssh_dprintf("Usage: %s [-c <files>] [-i <iterations>] [<query> ...]\n"
+			"  -c  Create the given number of files to query for first\n"
+			"  -i  Run each query the given number of times (default 10)\n",
+			argv[0]);
+		return B_BAD_VALUE;
+	}
+
+	struct stat st;
+	status_t status = _kern_read_stat(-1, "/myfs", false, &st, sizeof(st));
+	if (status != B_OK)
+		return status;
+
+	if (createCount > 0) {
+		status = create_files(st.st_dev, createCount);
+		if (status != B_OK)
+			return status;
+	}
+
+	for (; argi < argc; argi++)
+		benchmark_query(st.st_dev, argv[argi], iterations);
+
+	return B_OK;
+}
+
+
+}	// namespace FSShell
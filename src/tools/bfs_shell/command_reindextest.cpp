@@ -0,0 +1,308 @@
+/*
+ * Copyright 2013, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include <stdlib.h>
+
+#include "fssh_dirent.h"
+#include "fssh_stat.h"
+#include "fssh_stdio.h"
+#include "syscalls.h"
+
+#include "bfs.h"
+#include "bfs_control.h"
+
+
+namespace FSShell {
+
+
+static const char* kTestDirectory = "/myfs/reindextest";
+static const char* kKeyAttribute = "reindextest:key";
+static const char* kKeyPrefix = "reindextest key";
+
+// With keys of this size, a 1024 byte node only holds 16 of them,
+// so that BFS_MAX_REINDEX_NODES keys need three levels
+static const int32 kDefaultCount = BFS_MAX_REINDEX_NODES;
+
+// The second pass shares each key between many files, so that the index
+// has to store long duplicate arrays
+static const int32 kDuplicateKeys = 3;
+
+
+static void
+make_key(int32 value, char* key, size_t size)
+{
+	snprintf(key, size, "%s %08" B_PRId32 " .......................",
+		kKeyPrefix, value);
+}
+
+
+/*!	Returns which of the \a distinctKeys keys the file with the given
+	\a index gets; the files are not created in key order.
+*/
+static int32
+key_value(int32 index, int32 distinctKeys)
+{
+	return (int32)((index * 7919LL) % distinctKeys);
+}
+
+
+/*!	Creates \a count files with a string attribute before its index exists,
+	so that the index can be built from them in one go. Only \a distinctKeys
+	different keys are used.
+*/
+static status_t
+create_files(int32 count, int32 distinctKeys, ino_t* nodes)
+{
+	status_t status = _kern_create_dir(-1, kTestDirectory, 0755);
+	if (status != B_OK && status != B_FILE_EXISTS)
+		return status;
+
+	for (int32 i = 0; i < count; i++) {
+		char path[B_PATH_NAME_LENGTH];
+		snprintf(path, sizeof(path), "%s/file%" B_PRId32, kTestDirectory, i);
+
+		int fd = _kern_open(-1, path, O_CREAT | O_WRONLY | O_TRUNC, 0644);
+		if (fd < 0) {
+			fssh_dprintf("reindextest: could not create \"%s\": %s\n", path,
+				strerror(fd));
+			return fd;
+		}
+
+		char key[64];
+		make_key(key_value(i, distinctKeys), key, sizeof(key));
+
+		status = B_OK;
+		int attribute = _kern_create_attr(fd, kKeyAttribute, B_STRING_TYPE,
+			O_WRONLY | O_TRUNC);
+		if (attribute < 0)
+			status = attribute;
+		else {
+			ssize_t bytesWritten = _kern_write(attribute, 0, key,
+				strlen(key) + 1);
+			if (bytesWritten < 0)
+				status = bytesWritten;
+			_kern_close(attribute);
+		}
+
+		struct stat st;
+		if (status == B_OK)
+			status = _kern_read_stat(fd, NULL, false, &st, sizeof(st));
+
+		_kern_close(fd);
+
+		if (status != B_OK) {
+			fssh_dprintf("reindextest: could not write \"%s\": %s\n", path,
+				strerror(status));
+			return status;
+		}
+
+		nodes[i] = st.st_ino;
+	}
+
+	return B_OK;
+}
+
+
+/*!	Runs the file system check without fixing anything, and returns an error
+	if any B+tree, including the one of the new index, failed to validate.
+*/
+static status_t
+check_trees()
+{
+	int rootDir = _kern_open_dir(-1, "/myfs");
+	if (rootDir < 0)
+		return rootDir;
+
+	struct check_control result;
+	memset(&result, 0, sizeof(result));
+	result.magic = BFS_IOCTL_CHECK_MAGIC;
+	result.flags = 0;
+
+	status_t status = _kern_ioctl(rootDir, BFS_IOCTL_START_CHECKING,
+		&result, sizeof(result));
+	if (status != B_OK) {
+		_kern_close(rootDir);
+		return status;
+	}
+
+	int32 invalidTrees = 0;
+	while (_kern_ioctl(rootDir, BFS_IOCTL_CHECK_NEXT_NODE, &result,
+			sizeof(result)) == B_OK) {
+		if (result.pass == BFS_CHECK_PASS_BITMAP
+			&& (result.errors & BFS_INVALID_BPLUSTREE) != 0) {
+			fssh_dprintf("reindextest: invalid b+tree: %s (inode = %"
+				B_PRIdINO ")\n", result.name, result.inode);
+			invalidTrees++;
+		}
+	}
+
+	_kern_ioctl(rootDir, BFS_IOCTL_STOP_CHECKING, &result, sizeof(result));
+	_kern_close(rootDir);
+
+	return invalidTrees == 0 ? B_OK : B_BAD_DATA;
+}
+
+
+static status_t
+count_query_results(dev_t volume, const char* value, int32* _count)
+{
+	char query[B_FILE_NAME_LENGTH + 128];
+	snprintf(query, sizeof(query), "%s==\"%s\"", kKeyAttribute, value);
+
+	int fd = _kern_open_query(volume, query, strlen(query), 0, -1, -1);
+	if (fd < 0)
+		return fd;
+
+	char buffer[sizeof(struct dirent) + B_FILE_NAME_LENGTH];
+	struct dirent* entry = (struct dirent*)buffer;
+	int32 count = 0;
+	ssize_t entriesRead;
+	while ((entriesRead = _kern_read_dir(fd, entry, sizeof(buffer), 1)) == 1)
+		count++;
+
+	_kern_close(fd);
+
+	if (entriesRead < 0)
+		return entriesRead;
+
+	*_count = count;
+	return B_OK;
+}
+
+
+/*!	Creates the test files with \a distinctKeys different keys, and builds
+	their index via BFS_IOCTL_REINDEX. The resulting B+tree is validated,
+	and queried for all and for one of the keys.
+*/
+static status_t
+reindex_files(dev_t volume, int32 count, int32 distinctKeys, ino_t* nodes)
+{
+	_kern_remove_index(volume, kKeyAttribute);
+
+	status_t status = create_files(count, distinctKeys, nodes);
+	if (status == B_OK)
+		status = _kern_create_index(volume, kKeyAttribute, B_STRING_TYPE, 0);
+
+	if (status == B_OK) {
+		int rootDir = _kern_open_dir(-1, "/myfs");
+		if (rootDir < 0)
+			status = rootDir;
+		else {
+			reindex_control control;
+			strlcpy(control.index, kKeyAttribute, sizeof(control.index));
+			control.nodes = nodes;
+			control.count = count;
+			control.inserted = 0;
+
+			status = _kern_ioctl(rootDir, BFS_IOCTL_REINDEX, &control,
+				sizeof(control));
+			if (status == B_OK && control.inserted != (uint32)count) {
+				fssh_dprintf("reindextest: %" B_PRIu32 " of %" B_PRId32
+					" nodes inserted\n", control.inserted, count);
+				status = B_ERROR;
+			}
+
+			_kern_close(rootDir);
+		}
+	}
+
+	if (status == B_OK) {
+		struct stat indexStat;
+		status = _kern_read_index_stat(volume, kKeyAttribute, &indexStat);
+		if (status == B_OK) {
+			fssh_dprintf("reindextest: built index of %" B_PRId32 " keys (%"
+				B_PRId32 " distinct) in %" B_PRIdOFF " bytes\n", count,
+				distinctKeys, indexStat.st_size);
+		}
+	}
+
+	if (status == B_OK)
+		status = check_trees();
+
+	if (status == B_OK) {
+		char pattern[64];
+		snprintf(pattern, sizeof(pattern), "%s*", kKeyPrefix);
+
+		int32 found = 0;
+		status = count_query_results(volume, pattern, &found);
+		if (status == B_OK && found != count) {
+			fssh_dprintf("reindextest: query found %" B_PRId32 " of %"
+				B_PRId32 " files\n", found, count);
+			status = B_ERROR;
+		}
+	}
+
+	if (status == B_OK) {
+		int32 expected = 0;
+		for (int32 i = 0; i < count; i++) {
+			if (key_value(i, distinctKeys) == 0)
+				expected++;
+		}
+
+		char key[64];
+		make_key(0, key, sizeof(key));
+
+		int32 found = 0;
+		status = count_query_results(volume, key, &found);
+		if (status == B_OK && found != expected) {
+			fssh_dprintf("reindextest: query for \"%s\" found %" B_PRId32
+				" of %" B_PRId32 " files\n", key, found, expected);
+			status = B_ERROR;
+		}
+	}
+
+	_kern_remove_index(volume, kKeyAttribute);
+	return status;
+}
+
+
+/*!	Builds a new index of several levels bottom-up via BFS_IOCTL_REINDEX,
+	and validates the resulting B+tree, once with unique keys, and once with
+	heavily duplicated ones. The index is removed again afterwards, the files
+	are left on the volume.
+*/
+fssh_status_t
+command_reindextest(int argc, const char* const* argv)
+{
+	int32 count = kDefaultCount;
+	if (argc == 3 && !strcmp(argv[1], "-c"))
+		count = strtol(argv[2], NULL, 0);
+	else if (argc != 1)
+		count = 0;
+
+	if (count <= 0 || count > BFS_MAX_REINDEX_NODES) {
+		fssh_dprintf("Usage: %s [-c <files>]\n"
+			"  -c  Number of files to index, at most %d (default %" B_PRId32
+			")\n", argv[0], BFS_MAX_REINDEX_NODES, kDefaultCount);
+		return B_BAD_VALUE;
+	}
+
+	struct stat st;
+	status_t status = _kern_read_stat(-1, "/myfs", false, &st, sizeof(st));
+	if (status != B_OK)
+		return status;
+
+	ino_t* nodes = (ino_t*)malloc(count * sizeof(ino_t));
+	if (nodes == NULL)
+		return B_NO_MEMORY;
+
+	status = reindex_files(st.st_dev, count, count, nodes);
+	if (status == B_OK)
+		status = reindex_files(st.st_dev, count, kDuplicateKeys, nodes);
+
+	free(nodes);
+
+	if (status != B_OK) {
+		fssh_dprintf("reindextest: failed: %s\n", strerror(status));
+		return status;
+	}
+
+	fssh_dprintf("reindextest: passed\n");
+	return B_OK;
+}
+
+
+}	// namespace FSShell
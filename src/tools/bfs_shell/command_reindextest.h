@@ -0,0 +1,21 @@
+/*
+ * Copyright 2013, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef REINDEXTEST_H
+#define REINDEXTEST_H
+
+
+#include "fssh_types.h"
+
+
+namespace FSShell {
+
+
+fssh_status_t command_reindextest(int argc, const char* const* argv);
+
+
+}	// namespace FSShell
+
+
+#endif	// REINDEXTEST_H
@@ -1702,6 +1702,18 @@ fssh_block_cache_get(void* _cache, fssh_off_t blockNumber)
 }
 
 
+/*!	Prefetching is not supported in the fs_shell; all blocks are read in
+	synchronously on demand.
+*/
+fssh_status_t
+fssh_block_cache_prefetch(void* _cache, fssh_off_t blockNumber,
+	fssh_size_t* _numBlocks)
+{
+	*_numBlocks = 0;
+	return FSSH_B_OK;
+}
+
+
 /*!	Changes the internal status of a writable block to \a dirty. This can be
 	helpful in case you realize you don't need to change that block anymore
 	for whatever reason.
@@ -155,32 +155,37 @@ hash_remove_current(struct hash_table *table, struct hash_iterator *iterator)
 {
 	uint32_t index = iterator->bucket;
 	void *element;
+	void *lastElement = NULL;
 
-	if (iterator->current == NULL)
-		fssh_panic("hash_remove_current() called too early.");
-
-	for (element = table->table[index]; index < table->table_size; index++) {
-		void *lastElement = NULL;
-
-		while (element != NULL) {
-			if (element == iterator->current) {
-				iterator->current = lastElement;
+	if (iterator->current == NULL || (element = table->table[index]) == NULL) {
+		fssh_panic("hash_remove_current(): invalid iteration state");
+		return;
+	}
 
-				if (lastElement != NULL) {
-					// connect the previous entry with the next one
-					PUT_IN_NEXT(table, lastElement, NEXT(table, element));
-				} else {
-					table->table[index] = (struct hash_element *)NEXT(table,
-						element);
-				}
+	while (element != NULL) {
+		if (element == iterator->current) {
+			iterator->current = lastElement;
 
-				table->num_elements--;
-				return;
+			if (lastElement != NULL) {
+				// connect the previous entry with the next one
+				PUT_IN_NEXT(table, lastElement, NEXT(table, element));
+			} else {
+				table->table[index] = (struct hash_element *)NEXT(table,
+					element);
+				// let hash_next() continue with the new first entry of
+				// this bucket, instead of skipping the rest of it
+				iterator->bucket = index - 1;
 			}
 
-			element = NEXT(table, element);
+			table->num_elements--;
+			return;
 		}
+
+		lastElement = element;
+		element = NEXT(table, element);
 	}
+
+	fssh_panic("hash_remove_current(): current element not found!");
 }
 
 
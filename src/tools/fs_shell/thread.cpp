@@ -52,3 +52,11 @@ fssh_snooze_until(fssh_bigtime_t time, int timeBase)
 {
 	return snooze_until(time, timeBase);
 }
+
+
+fssh_status_t
+fssh_wait_for_thread(fssh_thread_id thread, fssh_status_t* _returnValue)
+{
+	// fssh_spawn_kernel_thread() never creates any threads
+	return FSSH_B_BAD_THREAD_ID;
+}
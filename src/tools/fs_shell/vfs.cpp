@@ -2242,6 +2242,15 @@ fssh_entry_cache_add(fssh_dev_t mountID, fssh_ino_t dirID, const char* name,
 }
 
 
+extern "C" fssh_status_t
+fssh_entry_cache_add_missing(fssh_dev_t mountID, fssh_ino_t dirID,
+	const char* name)
+{
+	// We don't implement an entry cache in the FS shell.
+	return FSSH_B_OK;
+}
+
+
 extern "C" fssh_status_t
 fssh_entry_cache_remove(fssh_dev_t mountID, fssh_ino_t dirID, const char* name)
 {